@@ -213,6 +213,71 @@ virAdmServerPtr virAdmConnectLookupServer(virAdmConnectPtr conn,
 
 # define VIR_THREADPOOL_JOB_QUEUE_DEPTH "jobQueueDepth"
 
+/* Statistics of RPC message buffers, returned with
+ * VIR_SERVER_THREADPOOL_MESSAGE_STATS. All servers of a daemon share one
+ * buffer pool, so these are the same whichever server they are queried
+ * from. */
+
+/**
+ * VIR_THREADPOOL_MESSAGE_BUFFERS_ALLOCATED:
+ * Macro represents the number of RPC message buffers allocated from the heap
+ * so far by the whole daemon process, not just by the server queried, as
+ * VIR_TYPED_PARAM_ULLONG.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_THREADPOOL_MESSAGE_BUFFERS_ALLOCATED "messageBuffersAllocated"
+
+/**
+ * VIR_THREADPOOL_MESSAGE_BUFFERS_REUSED:
+ * Macro represents the number of RPC message buffers reused from the
+ * daemon's buffer pool so far, counting the messages of all servers of the
+ * daemon, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_THREADPOOL_MESSAGE_BUFFERS_REUSED "messageBuffersReused"
+
+/**
+ * VIR_THREADPOOL_MESSAGE_BUFFERS_FREED:
+ * Macro represents the number of RPC message buffers returned to the heap
+ * so far because the buffer pool was full, counting the messages of all
+ * servers of the daemon, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_THREADPOOL_MESSAGE_BUFFERS_FREED "messageBuffersFreed"
+
+/**
+ * VIR_THREADPOOL_MESSAGE_BUFFERS_CACHED:
+ * Macro represents the number of RPC message buffers currently kept in the
+ * buffer pool the daemon process shares between all its servers, as
+ * VIR_TYPED_PARAM_ULLONG.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_THREADPOOL_MESSAGE_BUFFERS_CACHED "messageBuffersCached"
+
+/**
+ * VIR_THREADPOOL_MESSAGE_BUFFERS_CACHED_BYTES:
+ * Macro represents the size in bytes of the RPC message buffers currently
+ * kept in the process wide buffer pool, at most 1 MiB, as
+ * VIR_TYPED_PARAM_ULLONG.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_THREADPOOL_MESSAGE_BUFFERS_CACHED_BYTES "messageBuffersCachedBytes"
+
+/**
+ * virAdmServerGetThreadPoolParametersFlags:
+ *
+ * Since: 12.1.0
+ */
+typedef enum {
+    /* Report statistics of RPC message buffers (Since: 12.1.0) */
+    VIR_SERVER_THREADPOOL_MESSAGE_STATS = (1 << 0),
+} virAdmServerGetThreadPoolParametersFlags;
+
 /* Tunables for a server workerpool */
 int virAdmServerGetThreadPoolParameters(virAdmServerPtr srv,
                                         virTypedParameterPtr *params,
@@ -394,6 +459,111 @@ virAdmServerLookupClient(virAdmServerPtr srv,
 
 # define VIR_CLIENT_INFO_SELINUX_CONTEXT "selinux_context"
 
+/* Statistics of calls, returned with VIR_CLIENT_GET_INFO_CALL_STATS */
+
+/**
+ * VIR_CLIENT_INFO_CALL_COUNT:
+ * Macro represents the number of procedures called by the client so far,
+ * as VIR_TYPED_PARAM_UINT. Statistics of each of them are reported using
+ * the VIR_CLIENT_INFO_CALL_PREFIX macros.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_CLIENT_INFO_CALL_COUNT "call.count"
+
+/**
+ * VIR_CLIENT_INFO_CALL_PREFIX:
+ * The parameter name prefix to access statistics of a called procedure.
+ * Concatenate the prefix with the entry number formatted as %zu and one of
+ * the VIR_CLIENT_INFO_CALL_SUFFIX_* macros to form a complete parameter
+ * name.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_CLIENT_INFO_CALL_PREFIX "call."
+
+/**
+ * VIR_CLIENT_INFO_CALL_SUFFIX_PROGRAM:
+ * Number of the RPC program of the procedure, as VIR_TYPED_PARAM_UINT.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_CLIENT_INFO_CALL_SUFFIX_PROGRAM ".program"
+
+/**
+ * VIR_CLIENT_INFO_CALL_SUFFIX_PROCEDURE:
+ * Number of the procedure within its RPC program, as VIR_TYPED_PARAM_UINT.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_CLIENT_INFO_CALL_SUFFIX_PROCEDURE ".procedure"
+
+/**
+ * VIR_CLIENT_INFO_CALL_SUFFIX_CALLS:
+ * Number of calls of the procedure, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_CLIENT_INFO_CALL_SUFFIX_CALLS ".calls"
+
+/**
+ * VIR_CLIENT_INFO_CALL_SUFFIX_TIME:
+ * Total time in microseconds from receiving the calls of the procedure to
+ * sending their replies, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_CLIENT_INFO_CALL_SUFFIX_TIME ".time"
+
+/**
+ * VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_COUNT:
+ * Number of buckets of the histogram of latencies of the procedure,
+ * as VIR_TYPED_PARAM_UINT.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_COUNT ".bucket.count"
+
+/**
+ * VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_PREFIX:
+ * The parameter name prefix to access a bucket of the histogram of latencies
+ * of a procedure. Concatenate the call prefix and entry number with this
+ * prefix, the bucket number formatted as %zu and one of the
+ * VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_SUFFIX_* macros.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_PREFIX ".bucket."
+
+/**
+ * VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_SUFFIX_LIMIT:
+ * Upper bound in microseconds of the latencies counted in the bucket,
+ * as VIR_TYPED_PARAM_ULLONG. Not reported for the last bucket which is
+ * unbounded.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_SUFFIX_LIMIT ".limit"
+
+/**
+ * VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_SUFFIX_CALLS:
+ * Number of calls with a latency within the bucket, i.e. above the limit of
+ * the previous bucket, as VIR_TYPED_PARAM_ULLONG.
+ *
+ * Since: 12.1.0
+ */
+# define VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_SUFFIX_CALLS ".calls"
+
+/**
+ * virAdmClientGetInfoFlags:
+ *
+ * Since: 12.1.0
+ */
+typedef enum {
+    /* Report statistics of calls (Since: 12.1.0) */
+    VIR_CLIENT_GET_INFO_CALL_STATS = (1 << 0),
+} virAdmClientGetInfoFlags;
+
 int virAdmClientGetInfo(virAdmClientPtr client,
                         virTypedParameterPtr *params,
                         int *nparams,
@@ -4385,6 +4385,8 @@ typedef enum {
     VIR_CONNECT_GET_ALL_DOMAINS_STATS_SHUTOFF = VIR_CONNECT_LIST_DOMAINS_SHUTOFF, /* (Since: 1.2.8) */
     VIR_CONNECT_GET_ALL_DOMAINS_STATS_OTHER = VIR_CONNECT_LIST_DOMAINS_OTHER, /* (Since: 1.2.8) */
 
+    VIR_CONNECT_GET_ALL_DOMAINS_STATS_PARALLEL = 1 << 28, /* collect statistics of individual
+                                                             domains concurrently (Since: 12.1.0) */
     VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT = 1 << 29, /* report statistics that can be obtained
                                                            immediately without any blocking (Since: 4.5.0) */
     VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING = 1 << 30, /* include backing chain for block stats (Since: 1.2.12) */
@@ -4403,6 +4405,11 @@ int virDomainListGetStats(virDomainPtr *doms,
 
 void virDomainStatsRecordListFree(virDomainStatsRecordPtr *stats);
 
+int virConnectGetAllDomainStatsStream(virConnectPtr conn,
+                                      virStreamPtr st,
+                                      unsigned int stats,
+                                      unsigned int flags);
+
 /*
  * Perf Event API
  */
@@ -40,8 +40,9 @@ const ADMIN_SERVER_THREADPOOL_PARAMETERS_MAX = 32;
 /* Upper limit on list of clients */
 const ADMIN_CLIENT_LIST_MAX = 16384;
 
-/* Upper limit on number of client info parameters */
-const ADMIN_CLIENT_INFO_PARAMETERS_MAX = 64;
+/* Upper limit on number of client info parameters, including statistics
+ * of calls which are only returned to clients asking for them */
+const ADMIN_CLIENT_INFO_PARAMETERS_MAX = 8192;
 
 /* Upper limit on number of client processing controls */
 const ADMIN_SERVER_CLIENT_LIMITS_MAX = 32;
@@ -25,6 +25,7 @@
 #include "viridentity.h"
 #include "virlog.h"
 #include "rpc/virnetdaemon.h"
+#include "rpc/virnetmessage.h"
 #include "rpc/virnetserver.h"
 #include "virtypedparam.h"
 
@@ -78,7 +79,7 @@ adminServerGetThreadPoolParameters(virNetServer *srv,
     size_t jobQueueDepth;
     g_autoptr(virTypedParamList) paramlist = virTypedParamListNew();
 
-    virCheckFlags(0, -1);
+    virCheckFlags(VIR_SERVER_THREADPOOL_MESSAGE_STATS, -1);
 
     if (virNetServerGetThreadPoolParameters(srv, &minWorkers, &maxWorkers,
                                             &nWorkers, &freeWorkers,
@@ -96,6 +97,23 @@ adminServerGetThreadPoolParameters(virNetServer *srv,
     virTypedParamListAddUInt(paramlist, nPrioWorkers, VIR_THREADPOOL_WORKERS_PRIORITY);
     virTypedParamListAddUInt(paramlist, jobQueueDepth, VIR_THREADPOOL_JOB_QUEUE_DEPTH);
 
+    if (flags & VIR_SERVER_THREADPOOL_MESSAGE_STATS) {
+        virNetMessageBufferStats stats;
+
+        virNetMessageGetBufferStats(&stats);
+
+        virTypedParamListAddULLong(paramlist, stats.allocated,
+                                   VIR_THREADPOOL_MESSAGE_BUFFERS_ALLOCATED);
+        virTypedParamListAddULLong(paramlist, stats.reused,
+                                   VIR_THREADPOOL_MESSAGE_BUFFERS_REUSED);
+        virTypedParamListAddULLong(paramlist, stats.freed,
+                                   VIR_THREADPOOL_MESSAGE_BUFFERS_FREED);
+        virTypedParamListAddULLong(paramlist, stats.cached,
+                                   VIR_THREADPOOL_MESSAGE_BUFFERS_CACHED);
+        virTypedParamListAddULLong(paramlist, stats.cachedBytes,
+                                   VIR_THREADPOOL_MESSAGE_BUFFERS_CACHED_BYTES);
+    }
+
     if (virTypedParamListSteal(paramlist, params, nparams) < 0)
         return -1;
 
@@ -175,6 +193,55 @@ adminServerLookupClient(virNetServer *srv,
     return virNetServerGetClient(srv, id);
 }
 
+static void
+adminClientGetCallStats(virNetServerClient *client,
+                        virTypedParamList *paramlist)
+{
+    g_autofree virNetServerClientCallStats *stats = NULL;
+    size_t nstats;
+    size_t i;
+    size_t j;
+
+    virNetServerClientGetCallStats(client, &stats, &nstats);
+
+    virTypedParamListAddUInt(paramlist, nstats, VIR_CLIENT_INFO_CALL_COUNT);
+
+    for (i = 0; i < nstats; i++) {
+        virTypedParamListAddUInt(paramlist, stats[i].prog,
+                                 VIR_CLIENT_INFO_CALL_PREFIX "%zu"
+                                 VIR_CLIENT_INFO_CALL_SUFFIX_PROGRAM, i);
+        virTypedParamListAddUInt(paramlist, stats[i].proc,
+                                 VIR_CLIENT_INFO_CALL_PREFIX "%zu"
+                                 VIR_CLIENT_INFO_CALL_SUFFIX_PROCEDURE, i);
+        virTypedParamListAddULLong(paramlist, stats[i].calls,
+                                   VIR_CLIENT_INFO_CALL_PREFIX "%zu"
+                                   VIR_CLIENT_INFO_CALL_SUFFIX_CALLS, i);
+        virTypedParamListAddULLong(paramlist, stats[i].time,
+                                   VIR_CLIENT_INFO_CALL_PREFIX "%zu"
+                                   VIR_CLIENT_INFO_CALL_SUFFIX_TIME, i);
+        virTypedParamListAddUInt(paramlist, VIR_NET_SERVER_CLIENT_CALL_BUCKETS,
+                                 VIR_CLIENT_INFO_CALL_PREFIX "%zu"
+                                 VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_COUNT, i);
+
+        for (j = 0; j < VIR_NET_SERVER_CLIENT_CALL_BUCKETS; j++) {
+            unsigned long long limit = virNetServerClientCallBucketLimit(j);
+
+            if (limit > 0)
+                virTypedParamListAddULLong(paramlist, limit,
+                                           VIR_CLIENT_INFO_CALL_PREFIX "%zu"
+                                           VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_PREFIX "%zu"
+                                           VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_SUFFIX_LIMIT,
+                                           i, j);
+            virTypedParamListAddULLong(paramlist, stats[i].buckets[j],
+                                       VIR_CLIENT_INFO_CALL_PREFIX "%zu"
+                                       VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_PREFIX "%zu"
+                                       VIR_CLIENT_INFO_CALL_SUFFIX_BUCKET_SUFFIX_CALLS,
+                                       i, j);
+        }
+    }
+}
+
+
 int
 adminClientGetInfo(virNetServerClient *client,
                    virTypedParameterPtr *params,
@@ -188,7 +255,7 @@ adminClientGetInfo(virNetServerClient *client,
     g_autoptr(virIdentity) identity = NULL;
     int rc;
 
-    virCheckFlags(0, -1);
+    virCheckFlags(VIR_CLIENT_GET_INFO_CALL_STATS, -1);
 
     if (virNetServerClientGetInfo(client, &readonly,
                                   &sock_addr, &identity) < 0)
@@ -243,6 +310,9 @@ adminClientGetInfo(virNetServerClient *client,
     if (rc == 1)
         virTypedParamListAddString(paramlist, attr, VIR_CLIENT_INFO_SELINUX_CONTEXT);
 
+    if (flags & VIR_CLIENT_GET_INFO_CALL_STATS)
+        adminClientGetCallStats(client, paramlist);
+
     if (virTypedParamListSteal(paramlist, params, nparams) < 0)
         return -1;
 
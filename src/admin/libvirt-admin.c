@@ -792,7 +792,7 @@ virAdmConnectLookupServer(virAdmConnectPtr conn,
  * @params: pointer to a list of typed parameters which will be allocated
  *          to store all returned parameters
  * @nparams: pointer which will hold the number of params returned in @params
- * @flags: extra flags; not used yet, so callers should always pass 0
+ * @flags: bitwise-OR of virAdmServerGetThreadPoolParametersFlags
  *
  * Retrieves threadpool parameters from @srv. Upon successful completion,
  * @params will be allocated automatically to hold all returned data, setting
@@ -805,6 +805,10 @@ virAdmConnectLookupServer(virAdmConnectPtr conn,
  *      VIR_THREADPOOL_WORKERS_FREE
  *      VIR_THREADPOOL_WORKERS_CURRENT
  *
+ * If @flags contains VIR_SERVER_THREADPOOL_MESSAGE_STATS, counters of the
+ * pool the daemon recycles its RPC message buffers through are returned as
+ * well, see VIR_THREADPOOL_MESSAGE_BUFFERS_ALLOCATED.
+ *
  * Returns 0 on success, -1 in case of an error.
  *
  * Since: 2.0.0
@@ -960,7 +964,7 @@ virAdmServerLookupClient(virAdmServerPtr srv,
  * @params: pointer to a list of typed parameters which will be allocated
  *          to store all returned parameters
  * @nparams: pointer which will hold the number of params returned in @params
- * @flags: extra flags; not used yet, so callers should always pass 0
+ * @flags: bitwise-OR of virAdmClientGetInfoFlags
  *
  * Extract identity information about a client. Attributes returned in @params
  * are mostly transport-dependent, i.e. some attributes including client
@@ -976,6 +980,11 @@ virAdmServerLookupClient(virAdmServerPtr srv,
  * even though a TCP client is able to restrict access to certain APIs for
  * itself.
  *
+ * If @flags contains VIR_CLIENT_GET_INFO_CALL_STATS, statistics of the calls
+ * made by the client are returned as well: the number of calls of each
+ * procedure, the total time it took to process them and a histogram of their
+ * latencies, see VIR_CLIENT_INFO_CALL_COUNT.
+ *
  * Returns 0 if the information has been successfully retrieved or -1 in case
  * of an error.
  *
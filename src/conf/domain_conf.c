@@ -5853,13 +5853,40 @@ virDomainDeviceAliasIsUserAlias(const char *aliasStr)
 }
 
 
+/**
+ * virDomainDeviceGetSubelement:
+ * @node: device element
+ * @name: name of the sub-element
+ *
+ * Looks up a sub-element the way an XPath expression such as "./alias"
+ * evaluated on @node does. Unlike virXMLNodeGetSubelement, sub-elements
+ * from other namespaces are skipped, as in virDomainDefDevicesGroup.
+ *
+ * Returns the first sub-element of @node named @name, or NULL.
+ */
+static xmlNodePtr
+virDomainDeviceGetSubelement(xmlNodePtr node,
+                             const char *name)
+{
+    xmlNodePtr n;
+
+    for (n = node->children; n; n = n->next) {
+        if (n->type == XML_ELEMENT_NODE && !n->ns &&
+            virXMLNodeNameEqual(n, name))
+            return n;
+    }
+
+    return NULL;
+}
+
+
 static int
 virDomainDeviceInfoParseXML(virDomainXMLOption *xmlopt,
                             xmlNodePtr node,
-                            xmlXPathContextPtr ctxt,
                             virDomainDeviceInfo *info,
                             unsigned int flags)
 {
+    xmlNodePtr alias = NULL;
     xmlNodePtr acpi = NULL;
     xmlNodePtr address = NULL;
     xmlNodePtr master = NULL;
@@ -5867,32 +5894,33 @@ virDomainDeviceInfoParseXML(virDomainXMLOption *xmlopt,
     xmlNodePtr rom = NULL;
     int ret = -1;
     g_autofree char *aliasStr = NULL;
-    VIR_XPATH_NODE_AUTORESTORE(ctxt)
 
     virDomainDeviceInfoClear(info);
-    ctxt->node = node;
 
-    if ((aliasStr = virXPathString("string(./alias/@name)", ctxt)))
+    /* This is called for every device, so the sub-elements are looked up
+     * directly rather than via XPath. */
+    if ((alias = virDomainDeviceGetSubelement(node, "alias")) &&
+        (aliasStr = virXMLPropString(alias, "name")) && *aliasStr)
         if (!(flags & VIR_DOMAIN_DEF_PARSE_INACTIVE) ||
             (xmlopt->config.features & VIR_DOMAIN_DEF_FEATURE_USER_ALIAS &&
              virDomainDeviceAliasIsUserAlias(aliasStr) &&
              strspn(aliasStr, USER_ALIAS_CHARS) == strlen(aliasStr)))
             info->alias = g_steal_pointer(&aliasStr);
 
-    if ((master = virXPathNode("./master", ctxt))) {
+    if ((master = virDomainDeviceGetSubelement(node, "master"))) {
         info->mastertype = VIR_DOMAIN_CONTROLLER_MASTER_USB;
         if (virDomainDeviceUSBMasterParseXML(master, &info->master.usb) < 0)
             goto cleanup;
     }
 
     if (flags & VIR_DOMAIN_DEF_PARSE_ALLOW_BOOT &&
-        (boot = virXPathNode("./boot", ctxt))) {
+        (boot = virDomainDeviceGetSubelement(node, "boot"))) {
         if (virDomainDeviceBootParseXML(boot, info))
             goto cleanup;
     }
 
     if ((flags & VIR_DOMAIN_DEF_PARSE_ALLOW_ROM) &&
-        (rom = virXPathNode("./rom", ctxt))) {
+        (rom = virDomainDeviceGetSubelement(node, "rom"))) {
         if (virXMLPropTristateBool(rom, "enabled", VIR_XML_PROP_NONE,
                                    &info->romenabled) < 0)
             goto cleanup;
@@ -5911,7 +5939,7 @@ virDomainDeviceInfoParseXML(virDomainXMLOption *xmlopt,
         }
     }
 
-    if ((acpi = virXPathNode("./acpi", ctxt))) {
+    if ((acpi = virDomainDeviceGetSubelement(node, "acpi"))) {
         g_autofree char *nodeset = NULL;
 
         if (virXMLPropUInt(acpi, "index", 10, VIR_XML_PROP_NONZERO,
@@ -5931,7 +5959,7 @@ virDomainDeviceInfoParseXML(virDomainXMLOption *xmlopt,
         }
     }
 
-    if ((address = virXPathNode("./address", ctxt)) &&
+    if ((address = virDomainDeviceGetSubelement(node, "address")) &&
         virDomainDeviceAddressParseXML(address, info) < 0)
         goto cleanup;
 
@@ -8572,7 +8600,7 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
                        VIR_XML_PROP_NONZERO, &def->sgio) < 0)
         return NULL;
 
-    if ((sourceNode = virXPathNode("./source", ctxt))) {
+    if ((sourceNode = virDomainDeviceGetSubelement(node, "source"))) {
         if (virXMLPropEnum(sourceNode, "startupPolicy",
                            virDomainStartupPolicyTypeFromString,
                            VIR_XML_PROP_NONZERO,
@@ -8580,7 +8608,7 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
             return NULL;
     }
 
-    if ((targetNode = virXPathNode("./target", ctxt))) {
+    if ((targetNode = virDomainDeviceGetSubelement(node, "target"))) {
         def->dst = virXMLPropString(targetNode, "dev");
 
         if (virXMLPropEnum(targetNode, "bus",
@@ -8606,12 +8634,12 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
             return NULL;
     }
 
-    if ((geometryNode = virXPathNode("./geometry", ctxt))) {
+    if ((geometryNode = virDomainDeviceGetSubelement(node, "geometry"))) {
         if (virDomainDiskDefGeometryParse(def, geometryNode) < 0)
             return NULL;
     }
 
-    if ((blockioNode = virXPathNode("./blockio", ctxt))) {
+    if ((blockioNode = virDomainDeviceGetSubelement(node, "blockio"))) {
         int tmp = 0;
 
         if (virXMLPropUInt(blockioNode, "logical_block_size", 10, VIR_XML_PROP_NONE,
@@ -8629,7 +8657,7 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
             def->blockio.discard_granularity_specified = true;
     }
 
-    if ((driverNode = virXPathNode("./driver", ctxt))) {
+    if ((driverNode = virDomainDeviceGetSubelement(node, "driver"))) {
         if (virDomainVirtioOptionsParseXML(driverNode, &def->virtio) < 0)
             return NULL;
 
@@ -8640,23 +8668,23 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
             return NULL;
     }
 
-    if ((mirrorNode = virXPathNode("./mirror", ctxt))) {
+    if ((mirrorNode = virDomainDeviceGetSubelement(node, "mirror"))) {
         if (!(flags & VIR_DOMAIN_DEF_PARSE_INACTIVE)) {
             if (virDomainDiskDefMirrorParse(def, mirrorNode, ctxt, flags, xmlopt) < 0)
                 return NULL;
         }
     }
 
-    if (virXPathNode("./auth", ctxt))
+    if (virDomainDeviceGetSubelement(node, "auth"))
         def->diskElementAuth = true;
 
-    if (virXPathNode("./encryption", ctxt))
+    if (virDomainDeviceGetSubelement(node, "encryption"))
         def->diskElementEnc = true;
 
     if (flags & VIR_DOMAIN_DEF_PARSE_STATUS) {
         xmlNodePtr diskSecretsPlacementNode;
 
-        if ((diskSecretsPlacementNode = virXPathNode("./diskSecretsPlacement", ctxt))) {
+        if ((diskSecretsPlacementNode = virDomainDeviceGetSubelement(node, "diskSecretsPlacement"))) {
             g_autofree char *secretAuth = virXMLPropString(diskSecretsPlacementNode, "auth");
             g_autofree char *secretEnc = virXMLPropString(diskSecretsPlacementNode, "enc");
 
@@ -8665,7 +8693,7 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
         }
     }
 
-    if ((transientNode = virXPathNode("./transient", ctxt))) {
+    if ((transientNode = virDomainDeviceGetSubelement(node, "transient"))) {
         def->transient = true;
 
         if (virXMLPropTristateBool(transientNode, "shareBacking",
@@ -8686,7 +8714,7 @@ virDomainDiskDefParseXML(virDomainXMLOption *xmlopt,
     def->vendor = virXPathString("string(./vendor)", ctxt);
     def->product = virXPathString("string(./product)", ctxt);
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info,
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info,
                                     flags | VIR_DOMAIN_DEF_PARSE_ALLOW_BOOT) < 0) {
         return NULL;
     }
@@ -9049,7 +9077,7 @@ virDomainControllerDefParseXML(virDomainXMLOption *xmlopt,
     if (def->type == VIR_DOMAIN_CONTROLLER_TYPE_USB &&
         def->model == VIR_DOMAIN_CONTROLLER_MODEL_USB_NONE) {
         VIR_DEBUG("Ignoring device address for none model usb controller");
-    } else if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt,
+    } else if (virDomainDeviceInfoParseXML(xmlopt, node,
                                            &def->info, flags) < 0) {
         return NULL;
     }
@@ -9461,7 +9489,7 @@ virDomainFSDefParseXML(virDomainXMLOption *xmlopt,
     def->sock = g_steal_pointer(&sock);
     def->dst = g_steal_pointer(&target);
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info,
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info,
                                     flags | VIR_DOMAIN_DEF_PARSE_ALLOW_BOOT) < 0)
         goto error;
 
@@ -10361,7 +10389,7 @@ virDomainNetDefParseXML(virDomainXMLOption *xmlopt,
         def->mac_generated = true;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info,
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info,
                                     flags | VIR_DOMAIN_DEF_PARSE_ALLOW_BOOT
                                     | VIR_DOMAIN_DEF_PARSE_ALLOW_ROM) < 0) {
         return NULL;
@@ -11069,7 +11097,7 @@ virDomainChrDefParseXML(virDomainXMLOption *xmlopt,
         }
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     if (def->deviceType == VIR_DOMAIN_CHR_DEVICE_TYPE_SERIAL &&
@@ -11174,7 +11202,7 @@ virDomainSmartcardDefParseXML(virDomainXMLOption *xmlopt,
         return NULL;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         return NULL;
 
     return g_steal_pointer(&def);
@@ -11385,7 +11413,7 @@ virDomainTPMDefParseXML(virDomainXMLOption *xmlopt,
         goto error;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     if (flags & VIR_DOMAIN_DEF_PARSE_STATUS &&
@@ -11406,7 +11434,6 @@ virDomainTPMDefParseXML(virDomainXMLOption *xmlopt,
 static virDomainPanicDef *
 virDomainPanicDefParseXML(virDomainXMLOption *xmlopt,
                           xmlNodePtr node,
-                          xmlXPathContextPtr ctxt,
                           unsigned int flags)
 {
     virDomainPanicDef *panic;
@@ -11414,7 +11441,7 @@ virDomainPanicDefParseXML(virDomainXMLOption *xmlopt,
 
     panic = g_new0(virDomainPanicDef, 1);
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt,
+    if (virDomainDeviceInfoParseXML(xmlopt, node,
                                     &panic->info, flags) < 0)
         goto error;
 
@@ -11483,7 +11510,7 @@ virDomainInputDefParseXML(virDomainXMLOption *xmlopt,
         goto error;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     if (def->bus == VIR_DOMAIN_INPUT_BUS_USB &&
@@ -11547,7 +11574,6 @@ virDomainInputDefParseXML(virDomainXMLOption *xmlopt,
 static virDomainHubDef *
 virDomainHubDefParseXML(virDomainXMLOption *xmlopt,
                         xmlNodePtr node,
-                        xmlXPathContextPtr ctxt,
                         unsigned int flags)
 {
     virDomainHubDef *def;
@@ -11569,7 +11595,7 @@ virDomainHubDefParseXML(virDomainXMLOption *xmlopt,
         goto error;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     return def;
@@ -12449,7 +12475,7 @@ virDomainSoundDefParseXML(virDomainXMLOption *xmlopt,
             return NULL;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         return NULL;
 
     if (virDomainVirtioOptionsParseXML(virXPathNode("./driver", ctxt),
@@ -12822,7 +12848,6 @@ virDomainAudioDefParseXML(virDomainXMLOption *xmlopt G_GNUC_UNUSED,
 static virDomainWatchdogDef *
 virDomainWatchdogDefParseXML(virDomainXMLOption *xmlopt,
                              xmlNodePtr node,
-                             xmlXPathContextPtr ctxt,
                              unsigned int flags)
 {
     virDomainWatchdogDef *def;
@@ -12844,7 +12869,7 @@ virDomainWatchdogDefParseXML(virDomainXMLOption *xmlopt,
         goto error;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     return def;
@@ -12940,7 +12965,7 @@ virDomainRNGDefParseXML(virDomainXMLOption *xmlopt,
         break;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     if (virDomainVirtioOptionsParseXML(virXPathNode("./driver", ctxt),
@@ -12993,7 +13018,7 @@ virDomainMemballoonDefParseXML(virDomainXMLOption *xmlopt,
 
     if (def->model == VIR_DOMAIN_MEMBALLOON_MODEL_NONE)
         VIR_DEBUG("Ignoring device address for none model Memballoon");
-    else if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt,
+    else if (virDomainDeviceInfoParseXML(xmlopt, node,
                                          &def->info, flags) < 0)
         goto error;
 
@@ -13011,14 +13036,13 @@ virDomainMemballoonDefParseXML(virDomainXMLOption *xmlopt,
 static virDomainNVRAMDef *
 virDomainNVRAMDefParseXML(virDomainXMLOption *xmlopt,
                           xmlNodePtr node,
-                          xmlXPathContextPtr ctxt,
                           unsigned int flags)
 {
     virDomainNVRAMDef *def;
 
     def = g_new0(virDomainNVRAMDef, 1);
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         goto error;
 
     return def;
@@ -13099,7 +13123,7 @@ virDomainShmemDefParseXML(virDomainXMLOption *xmlopt,
         return NULL;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         return NULL;
 
 
@@ -13661,7 +13685,7 @@ virDomainVideoDefParseXML(virDomainXMLOption *xmlopt,
             return NULL;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         return NULL;
 
     def->driver = virDomainVideoDriverDefParseXML(node, ctxt);
@@ -13717,7 +13741,7 @@ virDomainHostdevDefParseXML(virDomainXMLOption *xmlopt,
     }
 
     if (def->info->type == VIR_DOMAIN_DEVICE_ADDRESS_TYPE_NONE) {
-        if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, def->info,
+        if (virDomainDeviceInfoParseXML(xmlopt, node, def->info,
                                         flags  | VIR_DOMAIN_DEF_PARSE_ALLOW_BOOT
                                         | VIR_DOMAIN_DEF_PARSE_ALLOW_ROM) < 0)
             goto error;
@@ -13801,7 +13825,7 @@ virDomainRedirdevDefParseXML(virDomainXMLOption *xmlopt,
     if (def->source->type == VIR_DOMAIN_CHR_TYPE_DBUS && !def->source->data.dbus.channel)
         def->source->data.dbus.channel = g_strdup("org.qemu.usbredir");
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info,
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info,
                                     flags | VIR_DOMAIN_DEF_PARSE_ALLOW_BOOT) < 0)
         goto error;
 
@@ -14448,7 +14472,7 @@ virDomainMemoryDefParseXML(virDomainXMLOption *xmlopt,
     if (virDomainMemoryTargetDefParseXML(node, ctxt, def) < 0)
         return NULL;
 
-    if (virDomainDeviceInfoParseXML(xmlopt, memdevNode, ctxt,
+    if (virDomainDeviceInfoParseXML(xmlopt, memdevNode,
                                     &def->info, flags) < 0)
         return NULL;
 
@@ -14516,7 +14540,7 @@ virDomainIOMMUDefParseXML(virDomainXMLOption *xmlopt,
             return NULL;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt,
+    if (virDomainDeviceInfoParseXML(xmlopt, node,
                                     &iommu->info, flags) < 0)
         return NULL;
 
@@ -14554,7 +14578,7 @@ virDomainVsockDefParseXML(virDomainXMLOption *xmlopt,
             return NULL;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &vsock->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &vsock->info, flags) < 0)
         return NULL;
 
     if (virDomainVirtioOptionsParseXML(virXPathNode("./driver", ctxt),
@@ -14612,7 +14636,7 @@ virDomainCryptoDefParseXML(virDomainXMLOption *xmlopt,
         return NULL;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         return NULL;
 
     if (virDomainVirtioOptionsParseXML(virXPathNode("./driver", ctxt),
@@ -14650,7 +14674,7 @@ virDomainPstoreDefParseXML(virDomainXMLOption *xmlopt,
         return NULL;
     }
 
-    if (virDomainDeviceInfoParseXML(xmlopt, node, ctxt, &def->info, flags) < 0)
+    if (virDomainDeviceInfoParseXML(xmlopt, node, &def->info, flags) < 0)
         return NULL;
 
     return g_steal_pointer(&def);
@@ -14739,7 +14763,7 @@ virDomainDeviceDefParse(const char *xmlStr,
         break;
     case VIR_DOMAIN_DEVICE_WATCHDOG:
         if (!(dev->data.watchdog = virDomainWatchdogDefParseXML(xmlopt, node,
-                                                                ctxt, flags)))
+                                                                flags)))
             return NULL;
         break;
     case VIR_DOMAIN_DEVICE_VIDEO:
@@ -14765,7 +14789,7 @@ virDomainDeviceDefParse(const char *xmlStr,
         break;
     case VIR_DOMAIN_DEVICE_HUB:
         if (!(dev->data.hub = virDomainHubDefParseXML(xmlopt, node,
-                                                      ctxt, flags)))
+                                                      flags)))
             return NULL;
         break;
     case VIR_DOMAIN_DEVICE_REDIRDEV:
@@ -14799,7 +14823,7 @@ virDomainDeviceDefParse(const char *xmlStr,
         break;
     case VIR_DOMAIN_DEVICE_NVRAM:
         if (!(dev->data.nvram = virDomainNVRAMDefParseXML(xmlopt, node,
-                                                          ctxt, flags)))
+                                                          flags)))
             return NULL;
         break;
     case VIR_DOMAIN_DEVICE_SHMEM:
@@ -14813,7 +14837,7 @@ virDomainDeviceDefParse(const char *xmlStr,
         break;
     case VIR_DOMAIN_DEVICE_PANIC:
         if (!(dev->data.panic = virDomainPanicDefParseXML(xmlopt, node,
-                                                          ctxt, flags)))
+                                                          flags)))
             return NULL;
         break;
     case VIR_DOMAIN_DEVICE_MEMORY:
@@ -19548,8 +19572,82 @@ virDomainDefClockParse(virDomainDef *def,
     return 0;
 }
 
+/**
+ * virDomainDefDevicesGroup:
+ * @root: the <domain> element
+ *
+ * Groups the sub-elements of <devices> by their name in a single pass over
+ * the document. Fetching the devices of each type via
+ * virDomainDefDevicesNodeSet is then considerably cheaper than evaluating
+ * an XPath expression such as "./devices/disk" for each of them, which
+ * matters for definitions with many devices.
+ *
+ * Returns a hash table of GPtrArrays of xmlNodePtr keyed by element name.
+ */
+static GHashTable *
+virDomainDefDevicesGroup(xmlNodePtr root)
+{
+    GHashTable *devices = virHashNew((GDestroyNotify) g_ptr_array_unref);
+    xmlNodePtr cur;
+    xmlNodePtr dev;
+
+    for (cur = root->children; cur; cur = cur->next) {
+        /* elements from other namespaces are not matched by XPath either */
+        if (cur->type != XML_ELEMENT_NODE || cur->ns ||
+            !virXMLNodeNameEqual(cur, "devices"))
+            continue;
+
+        for (dev = cur->children; dev; dev = dev->next) {
+            GPtrArray *list;
+
+            if (dev->type != XML_ELEMENT_NODE || dev->ns)
+                continue;
+
+            if (!(list = g_hash_table_lookup(devices, dev->name))) {
+                list = g_ptr_array_new();
+                g_hash_table_insert(devices, g_strdup((const char *)dev->name), list);
+            }
+
+            g_ptr_array_add(list, dev);
+        }
+    }
+
+    return devices;
+}
+
+
+/**
+ * virDomainDefDevicesNodeSet:
+ * @devices: devices grouped by virDomainDefDevicesGroup
+ * @name: element name of the devices
+ * @list: filled with the devices named @name in document order
+ *
+ * Equivalent of virXPathNodeSet("./devices/<name>", ...).
+ *
+ * Returns the number of devices in @list.
+ */
+static int
+virDomainDefDevicesNodeSet(GHashTable *devices,
+                           const char *name,
+                           xmlNodePtr **list)
+{
+    GPtrArray *nodes = g_hash_table_lookup(devices, name);
+
+    *list = NULL;
+
+    if (!nodes || nodes->len == 0)
+        return 0;
+
+    *list = g_new0(xmlNodePtr, nodes->len);
+    memcpy(*list, nodes->pdata, nodes->len * sizeof(xmlNodePtr));
+
+    return nodes->len;
+}
+
+
 static int
 virDomainDefControllersParse(virDomainDef *def,
+                             GHashTable *devices,
                              xmlXPathContextPtr ctxt,
                              virDomainXMLOption *xmlopt,
                              unsigned int flags,
@@ -19561,7 +19659,7 @@ virDomainDefControllersParse(virDomainDef *def,
     size_t i;
     int n;
 
-    if ((n = virXPathNodeSet("./devices/controller", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "controller", &nodes)) < 0)
         return -1;
 
     if (n)
@@ -19623,6 +19721,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     g_autofree xmlNodePtr *nodes = NULL;
     g_autofree char *tmp = NULL;
     g_autoptr(virDomainDef) def = NULL;
+    g_autoptr(GHashTable) devices = NULL;
 
     if (!(def = virDomainDefNew(xmlopt)))
         return NULL;
@@ -19720,8 +19819,10 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     if (virDomainDefThrottleGroupsParse(def, ctxt) < 0)
         return NULL;
 
+    devices = virDomainDefDevicesGroup(ctxt->node);
+
     /* analysis of the disk devices */
-    if ((n = virXPathNodeSet("./devices/disk", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "disk", &nodes)) < 0)
         return NULL;
 
     for (i = 0; i < n; i++) {
@@ -19736,11 +19837,11 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if (virDomainDefControllersParse(def, ctxt, xmlopt, flags, &usb_none) < 0)
+    if (virDomainDefControllersParse(def, devices, ctxt, xmlopt, flags, &usb_none) < 0)
         return NULL;
 
     /* analysis of the resource leases */
-    if ((n = virXPathNodeSet("./devices/lease", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "lease", &nodes)) < 0)
         return NULL;
 
     if (n)
@@ -19755,7 +19856,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the filesystems */
-    if ((n = virXPathNodeSet("./devices/filesystem", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "filesystem", &nodes)) < 0)
         return NULL;
     if (n)
         def->fss = g_new0(virDomainFSDef *, n);
@@ -19772,7 +19873,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the network devices */
-    if ((n = virXPathNodeSet("./devices/interface", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "interface", &nodes)) < 0)
         return NULL;
     if (n)
         def->nets = g_new0(virDomainNetDef *, n);
@@ -19797,7 +19898,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
 
 
     /* analysis of the smartcard devices */
-    if ((n = virXPathNodeSet("./devices/smartcard", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "smartcard", &nodes)) < 0)
         return NULL;
     if (n)
         def->smartcards = g_new0(virDomainSmartcardDef *, n);
@@ -19816,7 +19917,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
 
 
     /* analysis of the character devices */
-    if ((n = virXPathNodeSet("./devices/parallel", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "parallel", &nodes)) < 0)
         return NULL;
     if (n)
         def->parallels = g_new0(virDomainChrDef *, n);
@@ -19841,7 +19942,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./devices/serial", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "serial", &nodes)) < 0)
         return NULL;
 
     if (n)
@@ -19859,7 +19960,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./devices/console", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "console", &nodes)) < 0)
         return NULL;
 
     if (n)
@@ -19878,7 +19979,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./devices/channel", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "channel", &nodes)) < 0)
         return NULL;
     if (n)
         def->channels = g_new0(virDomainChrDef *, n);
@@ -19897,7 +19998,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
 
 
     /* analysis of the input devices */
-    if ((n = virXPathNodeSet("./devices/input", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "input", &nodes)) < 0)
         return NULL;
     if (n)
         def->inputs = g_new0(virDomainInputDef *, n);
@@ -19923,7 +20024,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the graphics devices */
-    if ((n = virXPathNodeSet("./devices/graphics", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "graphics", &nodes)) < 0)
         return NULL;
     if (n)
         def->graphics = g_new0(virDomainGraphicsDef *, n);
@@ -19940,7 +20041,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the sound devices */
-    if ((n = virXPathNodeSet("./devices/sound", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "sound", &nodes)) < 0)
         return NULL;
     if (n)
         def->sounds = g_new0(virDomainSoundDef *, n);
@@ -19957,7 +20058,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the audio devices */
-    if ((n = virXPathNodeSet("./devices/audio", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "audio", &nodes)) < 0)
         return NULL;
     if (n)
         def->audios = g_new0(virDomainAudioDef *, n);
@@ -19973,7 +20074,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the video devices */
-    if ((n = virXPathNodeSet("./devices/video", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "video", &nodes)) < 0)
         return NULL;
     if (n)
         def->videos = g_new0(virDomainVideoDef *, n);
@@ -20000,7 +20101,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the host devices */
-    if ((n = virXPathNodeSet("./devices/hostdev", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "hostdev", &nodes)) < 0)
         return NULL;
     if (n > 0)
         VIR_REALLOC_N(def->hostdevs, def->nhostdevs + n);
@@ -20034,7 +20135,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the watchdog devices */
-    n = virXPathNodeSet("./devices/watchdog", ctxt, &nodes);
+    n = virDomainDefDevicesNodeSet(devices, "watchdog", &nodes);
     if (n < 0)
         return NULL;
     if (n)
@@ -20042,7 +20143,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     for (i = 0; i < n; i++) {
         virDomainWatchdogDef *watchdog;
 
-        watchdog = virDomainWatchdogDefParseXML(xmlopt, nodes[i], ctxt, flags);
+        watchdog = virDomainWatchdogDefParseXML(xmlopt, nodes[i], flags);
         if (!watchdog)
             return NULL;
 
@@ -20052,7 +20153,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
 
     /* analysis of the memballoon devices */
     def->memballoon = NULL;
-    if ((n = virXPathNodeSet("./devices/memballoon", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "memballoon", &nodes)) < 0)
         return NULL;
     if (n > 1) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -20071,7 +20172,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
 
     /* Parse the RNG devices */
-    if ((n = virXPathNodeSet("./devices/rng", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "rng", &nodes)) < 0)
         return NULL;
     if (n)
         def->rngs = g_new0(virDomainRNGDef *, n);
@@ -20086,7 +20187,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* Parse the crypto devices */
-    if ((n = virXPathNodeSet("./devices/crypto", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "crypto", &nodes)) < 0)
         return NULL;
     if (n)
         def->cryptos = g_new0(virDomainCryptoDef *, n);
@@ -20101,7 +20202,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* Parse the TPM devices */
-    if ((n = virXPathNodeSet("./devices/tpm", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "tpm", &nodes)) < 0)
         return NULL;
 
     if (n > 2) {
@@ -20123,7 +20224,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./devices/nvram", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "nvram", &nodes)) < 0)
         return NULL;
 
     if (n > 1) {
@@ -20132,7 +20233,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
         return NULL;
     } else if (n == 1) {
         virDomainNVRAMDef *nvram =
-            virDomainNVRAMDefParseXML(xmlopt, nodes[0], ctxt, flags);
+            virDomainNVRAMDefParseXML(xmlopt, nodes[0], flags);
         if (!nvram)
             return NULL;
         def->nvram = nvram;
@@ -20140,14 +20241,14 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
 
     /* analysis of the hub devices */
-    if ((n = virXPathNodeSet("./devices/hub", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "hub", &nodes)) < 0)
         return NULL;
     if (n)
         def->hubs = g_new0(virDomainHubDef *, n);
     for (i = 0; i < n; i++) {
         virDomainHubDef *hub;
 
-        hub = virDomainHubDefParseXML(xmlopt, nodes[i], ctxt, flags);
+        hub = virDomainHubDefParseXML(xmlopt, nodes[i], flags);
         if (!hub)
             return NULL;
 
@@ -20163,7 +20264,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the redirected devices */
-    if ((n = virXPathNodeSet("./devices/redirdev", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "redirdev", &nodes)) < 0)
         return NULL;
     if (n)
         def->redirdevs = g_new0(virDomainRedirdevDef *, n);
@@ -20178,7 +20279,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the redirection filter rules */
-    if ((n = virXPathNodeSet("./devices/redirfilter", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "redirfilter", &nodes)) < 0)
         return NULL;
     if (n > 1) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -20197,14 +20298,14 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the panic devices */
-    if ((n = virXPathNodeSet("./devices/panic", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "panic", &nodes)) < 0)
         return NULL;
     if (n)
         def->panics = g_new0(virDomainPanicDef *, n);
     for (i = 0; i < n; i++) {
         virDomainPanicDef *panic;
 
-        panic = virDomainPanicDefParseXML(xmlopt, nodes[i], ctxt, flags);
+        panic = virDomainPanicDefParseXML(xmlopt, nodes[i], flags);
         if (!panic)
             return NULL;
 
@@ -20213,7 +20314,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* analysis of the shmem devices */
-    if ((n = virXPathNodeSet("./devices/shmem", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "shmem", &nodes)) < 0)
         return NULL;
     if (n)
         def->shmems = g_new0(virDomainShmemDef *, n);
@@ -20239,7 +20340,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
 
     /* analysis of memory devices */
-    if ((n = virXPathNodeSet("./devices/memory", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "memory", &nodes)) < 0)
         return NULL;
     if (n)
         def->mems = g_new0(virDomainMemoryDef *, n);
@@ -20257,7 +20358,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     VIR_FREE(nodes);
 
     /* Parsing iommu device definitions */
-    if ((n = virXPathNodeSet("./devices/iommu", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "iommu", &nodes)) < 0)
         return NULL;
 
     if (n > 0)
@@ -20275,7 +20376,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./devices/vsock", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "vsock", &nodes)) < 0)
         return NULL;
 
     if (n > 1) {
@@ -20291,7 +20392,7 @@ virDomainDefParseXML(xmlXPathContextPtr ctxt,
     }
     VIR_FREE(nodes);
 
-    if ((n = virXPathNodeSet("./devices/pstore", ctxt, &nodes)) < 0)
+    if ((n = virDomainDefDevicesNodeSet(devices, "pstore", &nodes)) < 0)
         return NULL;
 
     if (n > 1) {
@@ -29262,7 +29363,8 @@ virDomainDefFormatInternalSetRootName(virDomainDef *def,
                   VIR_DOMAIN_DEF_FORMAT_ACTUAL_NET |
                   VIR_DOMAIN_DEF_FORMAT_PCI_ORIG_STATES |
                   VIR_DOMAIN_DEF_FORMAT_CLOCK_ADJUST |
-                  VIR_DOMAIN_DEF_FORMAT_VOLUME_TRANSLATED,
+                  VIR_DOMAIN_DEF_FORMAT_VOLUME_TRANSLATED |
+                  VIR_DOMAIN_DEF_FORMAT_SKIP_DISKS,
                   -1);
 
     if (!(type = virDomainVirtTypeToString(def->virtType))) {
@@ -29571,9 +29673,11 @@ virDomainDefFormatInternalSetRootName(virDomainDef *def,
     virBufferEscapeString(buf, "<emulator>%s</emulator>\n",
                           def->emulator);
 
-    for (n = 0; n < def->ndisks; n++)
-        if (virDomainDiskDefFormat(buf, def->disks[n], flags, xmlopt) < 0)
-            return -1;
+    if (!(flags & VIR_DOMAIN_DEF_FORMAT_SKIP_DISKS)) {
+        for (n = 0; n < def->ndisks; n++)
+            if (virDomainDiskDefFormat(buf, def->disks[n], flags, xmlopt) < 0)
+                return -1;
+    }
 
     for (n = 0; n < def->ncontrollers; n++)
         if (virDomainControllerDefFormat(buf, def->controllers[n], flags) < 0)
@@ -30305,6 +30409,350 @@ virDomainSmartcardDefForeach(virDomainDef *def,
 }
 
 
+/*
+ * The helpers below copy disks directly, yielding what formatting them with
+ * VIR_DOMAIN_DEF_FORMAT_SECURE and parsing the result back with
+ * VIR_DOMAIN_DEF_PARSE_INACTIVE would. Only fields which survive such a
+ * round-trip are copied. Disks using anything not handled here are copied
+ * via XML along with the rest of the definition.
+ *
+ * When adding fields to virDomainDiskDef or virStorageSource, make sure to
+ * either handle them here or reject them in virDomainDiskDefIsCopyable.
+ */
+static bool
+virDomainStorageSourceIsCopyable(const virStorageSource *src,
+                                 bool backing)
+{
+    /* terminator of the backing chain */
+    if (backing && src->type == VIR_STORAGE_TYPE_NONE)
+        return true;
+
+    if (src->type != VIR_STORAGE_TYPE_FILE &&
+        src->type != VIR_STORAGE_TYPE_BLOCK)
+        return false;
+
+    if (!src->path || !*src->path ||
+        src->auth ||
+        src->encryption ||
+        src->pr ||
+        src->sliceStorage ||
+        src->nseclabels > 0 ||
+        src->dataFileStore)
+        return false;
+
+    /* formatting a backing store of unknown format fails */
+    if (backing &&
+        (src->format <= VIR_STORAGE_FILE_NONE ||
+         src->format >= VIR_STORAGE_FILE_LAST))
+        return false;
+
+    return !src->backingStore ||
+           virDomainStorageSourceIsCopyable(src->backingStore, true);
+}
+
+
+static bool
+virDomainDiskDefIsCopyable(const virDomainDiskDef *disk)
+{
+    if (!disk->dst ||
+        !virDomainStorageSourceIsCopyable(disk->src, false))
+        return false;
+
+    switch ((virDomainDeviceAddressType) disk->info.type) {
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_NONE:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_DRIVE:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_VIRTIO_MMIO:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_UNASSIGNED:
+        return true;
+
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_PCI:
+        return !virZPCIDeviceAddressIsPresent(&disk->info.addr.pci.zpci);
+
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_VIRTIO_SERIAL:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_CCID:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_USB:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_SPAPRVIO:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_VIRTIO_S390:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_CCW:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_ISA:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_DIMM:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_LAST:
+        break;
+    }
+
+    return false;
+}
+
+
+/* Elements whose text content is empty are parsed as NULL */
+static char *
+virDomainStrdupNonEmpty(const char *str)
+{
+    if (!str || !*str)
+        return NULL;
+
+    return g_strdup(str);
+}
+
+
+/*
+ * @inactive: whether the definition holding @src is formatted as inactive,
+ *            in which case detected backing chain members are omitted
+ */
+static virStorageSource *
+virDomainStorageSourceCopyInactive(const virStorageSource *src,
+                                   bool backing,
+                                   bool inactive)
+{
+    g_autoptr(virStorageSource) def = virStorageSourceNew();
+
+    if (src->type == VIR_STORAGE_TYPE_NONE)
+        return g_steal_pointer(&def);
+
+    def->type = src->type;
+    def->path = g_strdup(src->path);
+    if (src->type == VIR_STORAGE_TYPE_FILE)
+        def->fdgroup = g_strdup(src->fdgroup);
+
+    if (src->format > VIR_STORAGE_FILE_NONE)
+        def->format = src->format;
+    def->metadataCacheMaxSize = src->metadataCacheMaxSize;
+
+    /* backing store is always read-only */
+    if (backing)
+        def->readonly = true;
+
+    if (src->backingStore &&
+        !(inactive && src->backingStore->detected)) {
+        def->backingStore = virDomainStorageSourceCopyInactive(src->backingStore,
+                                                               true, inactive);
+    }
+
+    return g_steal_pointer(&def);
+}
+
+
+static void
+virDomainDeviceInfoCopyInactive(virDomainDeviceInfo *dst,
+                                const virDomainDeviceInfo *src,
+                                virDomainXMLOption *xmlopt)
+{
+    if (src->alias &&
+        xmlopt->config.features & VIR_DOMAIN_DEF_FEATURE_USER_ALIAS &&
+        virDomainDeviceAliasIsUserAlias(src->alias) &&
+        strspn(src->alias, USER_ALIAS_CHARS) == strlen(src->alias))
+        dst->alias = g_strdup(src->alias);
+
+    dst->mastertype = src->mastertype;
+    dst->master = src->master;
+
+    if (src->bootIndex) {
+        dst->bootIndex = src->bootIndex;
+        dst->effectiveBootIndex = src->bootIndex;
+        dst->loadparm = g_strdup(src->loadparm);
+    }
+
+    dst->acpiIndex = src->acpiIndex;
+    if (src->acpiNodeset)
+        dst->acpiNodeset = virBitmapNewCopy(src->acpiNodeset);
+
+    dst->type = src->type;
+
+    switch ((virDomainDeviceAddressType) src->type) {
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_PCI:
+        dst->addr.pci.domain = src->addr.pci.domain;
+        dst->addr.pci.bus = src->addr.pci.bus;
+        dst->addr.pci.slot = src->addr.pci.slot;
+        dst->addr.pci.function = src->addr.pci.function;
+        dst->addr.pci.multi = src->addr.pci.multi;
+        break;
+
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_DRIVE:
+        dst->addr.drive.controller = src->addr.drive.controller;
+        dst->addr.drive.bus = src->addr.drive.bus;
+        dst->addr.drive.target = src->addr.drive.target;
+        dst->addr.drive.unit = src->addr.drive.unit;
+        break;
+
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_NONE:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_VIRTIO_SERIAL:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_CCID:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_USB:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_SPAPRVIO:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_VIRTIO_S390:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_CCW:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_VIRTIO_MMIO:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_ISA:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_DIMM:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_UNASSIGNED:
+    case VIR_DOMAIN_DEVICE_ADDRESS_TYPE_LAST:
+        break;
+    }
+}
+
+
+/* Whether virDomainDiskDefFormatDriver formats a non-empty <driver> */
+static bool
+virDomainDiskDefHasDriver(const virDomainDiskDef *disk)
+{
+    const virDomainVirtioOptions *virtio = disk->virtio;
+
+    if (virtio &&
+        (virtio->iommu || virtio->ats ||
+         virtio->packed || virtio->page_per_vq))
+        return true;
+
+    return disk->driverName ||
+           disk->src->format > VIR_STORAGE_FILE_NONE ||
+           disk->cachemode ||
+           disk->error_policy ||
+           disk->rerror_policy ||
+           disk->iomode ||
+           disk->ioeventfd ||
+           disk->event_idx ||
+           disk->copy_on_read ||
+           disk->discard ||
+           disk->iothread ||
+           disk->detect_zeroes ||
+           disk->discard_no_unref ||
+           disk->queues ||
+           disk->queue_size ||
+           disk->src->metadataCacheMaxSize > 0 ||
+           disk->iothreads ||
+           (disk->statistics && disk->statistics[0] > 0);
+}
+
+
+static virDomainDiskDef *
+virDomainDiskDefCopyInactive(const virDomainDiskDef *src,
+                             virDomainXMLOption *xmlopt,
+                             bool inactive)
+{
+    g_autoptr(virStorageSource) storage = NULL;
+    g_autoptr(virDomainDiskDef) def = NULL;
+    GSList *n;
+    size_t i;
+
+    storage = virDomainStorageSourceCopyInactive(src->src, false, inactive);
+    storage->readonly = src->src->readonly;
+    storage->shared = src->src->shared;
+
+    if (!(def = virDomainDiskDefNewSource(xmlopt, &storage)))
+        return NULL;
+
+    def->device = src->device;
+    def->bus = src->bus;
+    def->dst = g_strdup(src->dst);
+    def->model = src->model;
+    def->rawio = src->rawio;
+    def->sgio = src->sgio;
+    def->startupPolicy = src->startupPolicy;
+    def->rotation_rate = src->rotation_rate;
+    def->dpofua = src->dpofua;
+
+    if (src->device == VIR_DOMAIN_DISK_DEVICE_FLOPPY ||
+        src->device == VIR_DOMAIN_DISK_DEVICE_CDROM)
+        def->tray_status = src->tray_status;
+
+    if (src->bus == VIR_DOMAIN_DISK_BUS_USB)
+        def->removable = src->removable;
+
+    if (!(src->snapshot == VIR_DOMAIN_SNAPSHOT_LOCATION_NO &&
+          src->src->readonly))
+        def->snapshot = src->snapshot;
+
+    if (src->geometry.cylinders > 0 &&
+        src->geometry.heads > 0 &&
+        src->geometry.sectors > 0)
+        def->geometry = src->geometry;
+
+    def->blockio.logical_block_size = src->blockio.logical_block_size;
+    def->blockio.physical_block_size = src->blockio.physical_block_size;
+    if (src->blockio.discard_granularity_specified) {
+        def->blockio.discard_granularity = src->blockio.discard_granularity;
+        def->blockio.discard_granularity_specified = true;
+    }
+
+    virDomainBlockIoTuneInfoCopy(&src->blkdeviotune, &def->blkdeviotune);
+
+    if (src->nthrottlefilters > 0) {
+        def->throttlefilters = g_new0(virDomainThrottleFilterDef *,
+                                      src->nthrottlefilters);
+
+        for (i = 0; i < src->nthrottlefilters; i++) {
+            virDomainThrottleFilterDef *filter = g_new0(virDomainThrottleFilterDef, 1);
+
+            filter->group_name = g_strdup(src->throttlefilters[i]->group_name);
+            def->throttlefilters[def->nthrottlefilters++] = filter;
+        }
+    }
+
+    def->driverName = g_strdup(src->driverName);
+    def->cachemode = src->cachemode;
+    def->error_policy = src->error_policy;
+    def->rerror_policy = src->rerror_policy;
+    def->iomode = src->iomode;
+    def->ioeventfd = src->ioeventfd;
+    def->event_idx = src->event_idx;
+    def->copy_on_read = src->copy_on_read;
+    def->discard = src->discard;
+    def->iothread = src->iothread;
+    def->detect_zeroes = src->detect_zeroes;
+    def->discard_no_unref = src->discard_no_unref;
+    def->queues = src->queues;
+    def->queue_size = src->queue_size;
+
+    for (n = src->iothreads; n; n = n->next) {
+        virDomainIothreadMappingDef *srcIoth = n->data;
+        virDomainIothreadMappingDef *ioth = g_new0(virDomainIothreadMappingDef, 1);
+
+        ioth->id = srcIoth->id;
+        if (srcIoth->queues && srcIoth->nqueues > 0) {
+            ioth->queues = g_new0(unsigned int, srcIoth->nqueues);
+            memcpy(ioth->queues, srcIoth->queues,
+                   sizeof(*ioth->queues) * srcIoth->nqueues);
+            ioth->nqueues = srcIoth->nqueues;
+        }
+
+        def->iothreads = g_slist_prepend(def->iothreads, ioth);
+    }
+    def->iothreads = g_slist_reverse(def->iothreads);
+
+    if (src->statistics && src->statistics[0] > 0) {
+        size_t nstatistics = 0;
+
+        while (src->statistics[nstatistics] > 0)
+            nstatistics++;
+
+        def->statistics = g_new0(unsigned int, nstatistics + 1);
+        memcpy(def->statistics, src->statistics,
+               sizeof(*def->statistics) * nstatistics);
+    }
+
+    /* the parser allocates virtio options whenever <driver> is present */
+    if (virDomainDiskDefHasDriver(src)) {
+        def->virtio = g_new0(virDomainVirtioOptions, 1);
+        if (src->virtio)
+            *def->virtio = *src->virtio;
+    }
+
+    def->transient = src->transient;
+    if (src->transient &&
+        src->transientShareBacking == VIR_TRISTATE_BOOL_YES)
+        def->transientShareBacking = VIR_TRISTATE_BOOL_YES;
+
+    def->domain_name = virDomainStrdupNonEmpty(src->domain_name);
+    def->serial = virDomainStrdupNonEmpty(src->serial);
+    def->wwn = virDomainStrdupNonEmpty(src->wwn);
+    def->vendor = virDomainStrdupNonEmpty(src->vendor);
+    def->product = virDomainStrdupNonEmpty(src->product);
+
+    virDomainDeviceInfoCopyInactive(&def->info, &src->info, xmlopt);
+
+    return g_steal_pointer(&def);
+}
+
+
 /* Copy src into a new definition; with the quality of the copy
  * depending on the migratable flag (false for transitions between
  * persistent and active, true for transitions across save files or
@@ -30318,16 +30766,58 @@ virDomainDefCopy(virDomainDef *src,
     unsigned int format_flags = VIR_DOMAIN_DEF_FORMAT_SECURE;
     unsigned int parse_flags = VIR_DOMAIN_DEF_PARSE_INACTIVE |
                                VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE;
-    g_autofree char *xml = NULL;
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *xmlStr = NULL;
+    g_autoptr(xmlDoc) xml = NULL;
+    g_autoptr(xmlXPathContext) ctxt = NULL;
+    g_autoptr(virDomainDef) def = NULL;
+    bool copyDisks = !migratable;
+    size_t i;
 
     if (migratable)
         format_flags |= VIR_DOMAIN_DEF_FORMAT_INACTIVE | VIR_DOMAIN_DEF_FORMAT_MIGRATABLE;
 
-    /* Easiest to clone via a round-trip through XML.  */
-    if (!(xml = virDomainDefFormat(src, xmlopt, format_flags)))
+    for (i = 0; i < src->ndisks && copyDisks; i++)
+        copyDisks = virDomainDiskDefIsCopyable(src->disks[i]);
+
+    /* Disks, which large guests have plenty of, are copied directly as
+     * parsing them is expensive. The rest is cloned via a round-trip
+     * through XML. The disks are added before the post parse callbacks
+     * run so that they see the same definition as after a full round-trip. */
+    if (copyDisks)
+        format_flags |= VIR_DOMAIN_DEF_FORMAT_SKIP_DISKS;
+
+    if (virDomainDefFormatInternal(src, xmlopt, &buf, format_flags) < 0)
+        return NULL;
+
+    xmlStr = virBufferContentAndReset(&buf);
+
+    if (!(xml = virXMLParseWithIndent(NULL, xmlStr, _("(domain_definition)"),
+                                      "domain", &ctxt, "domain.rng", false)))
+        return NULL;
+
+    if (!(def = virDomainDefParseXML(ctxt, xmlopt, parse_flags)))
         return NULL;
 
-    return virDomainDefParseString(xml, xmlopt, parseOpaque, parse_flags);
+    if (copyDisks) {
+        for (i = 0; i < src->ndisks; i++) {
+            virDomainDiskDef *disk;
+
+            if (!(disk = virDomainDiskDefCopyInactive(src->disks[i], xmlopt,
+                                                      src->id == -1)))
+                return NULL;
+
+            virDomainDiskInsert(def, disk);
+        }
+    }
+
+    if (virDomainDefPostParse(def, parse_flags, xmlopt, parseOpaque) < 0)
+        return NULL;
+
+    if (virDomainDefValidate(def, parse_flags, xmlopt, parseOpaque) < 0)
+        return NULL;
+
+    return g_steal_pointer(&def);
 }
 
 virDomainDef *
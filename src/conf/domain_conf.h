@@ -3931,6 +3931,8 @@ typedef enum {
     VIR_DOMAIN_DEF_FORMAT_CLOCK_ADJUST    = 1 << 8,
     /* format disk type='volume' translated data if present */
     VIR_DOMAIN_DEF_FORMAT_VOLUME_TRANSLATED = 1 << 9,
+    /* omit <disk> elements, used by virDomainDefCopy */
+    VIR_DOMAIN_DEF_FORMAT_SKIP_DISKS      = 1 << 10,
 } virDomainDefFormatFlags;
 
 /* Use these flags to skip specific domain ABI consistency checks done
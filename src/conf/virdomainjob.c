@@ -283,11 +283,12 @@ virDomainObjCanSetJob(virDomainJobObj *job,
  * @agentJob: virDomainAgentJob to start
  * @asyncJob: virDomainAsyncJob to start
  * @nowait: don't wait trying to acquire @job
+ * @timeout: maximum time to wait for @job in milliseconds, 0 for the default
  *
  * Acquires job for a domain object which must be locked before
- * calling. If there's already a job running waits up to
- * VIR_JOB_WAIT_TIME after which the functions fails reporting
- * an error unless @nowait is set.
+ * calling. If there's already a job running waits up to @timeout
+ * (VIR_JOB_WAIT_TIME by default) after which the functions fails
+ * reporting an error unless @nowait is set.
  *
  * If @nowait is true this function tries to acquire job and if
  * it fails, then it returns immediately without waiting. No
@@ -304,7 +305,8 @@ virDomainObjBeginJobInternal(virDomainObj *obj,
                              virDomainJob job,
                              virDomainAgentJob agentJob,
                              virDomainAsyncJob asyncJob,
-                             bool nowait)
+                             bool nowait,
+                             unsigned long long timeout)
 {
     unsigned long long now = 0;
     unsigned long long then = 0;
@@ -332,7 +334,7 @@ virDomainObjBeginJobInternal(virDomainObj *obj,
         return -1;
 
     jobObj->jobsQueued++;
-    then = now + VIR_JOB_WAIT_TIME;
+    then = now + (timeout ? timeout : VIR_JOB_WAIT_TIME);
 
  retry:
     if (job != VIR_JOB_ASYNC &&
@@ -519,7 +521,7 @@ int virDomainObjBeginJob(virDomainObj *obj,
 {
     if (virDomainObjBeginJobInternal(obj, obj->job, job,
                                      VIR_AGENT_JOB_NONE,
-                                     VIR_ASYNC_JOB_NONE, false) < 0)
+                                     VIR_ASYNC_JOB_NONE, false, 0) < 0)
         return -1;
     return 0;
 }
@@ -537,7 +539,7 @@ virDomainObjBeginAgentJob(virDomainObj *obj,
 {
     return virDomainObjBeginJobInternal(obj, obj->job, VIR_JOB_NONE,
                                         agentJob,
-                                        VIR_ASYNC_JOB_NONE, false);
+                                        VIR_ASYNC_JOB_NONE, false, 0);
 }
 
 int virDomainObjBeginAsyncJob(virDomainObj *obj,
@@ -547,7 +549,7 @@ int virDomainObjBeginAsyncJob(virDomainObj *obj,
 {
     if (virDomainObjBeginJobInternal(obj, obj->job, VIR_JOB_ASYNC,
                                      VIR_AGENT_JOB_NONE,
-                                     asyncJob, false) < 0)
+                                     asyncJob, false, 0) < 0)
         return -1;
 
     obj->job->current->operation = operation;
@@ -575,7 +577,7 @@ virDomainObjBeginNestedJob(virDomainObj *obj,
                                         VIR_JOB_ASYNC_NESTED,
                                         VIR_AGENT_JOB_NONE,
                                         VIR_ASYNC_JOB_NONE,
-                                        false);
+                                        false, 0);
 }
 
 /**
@@ -596,7 +598,30 @@ virDomainObjBeginJobNowait(virDomainObj *obj,
 {
     return virDomainObjBeginJobInternal(obj, obj->job, job,
                                         VIR_AGENT_JOB_NONE,
-                                        VIR_ASYNC_JOB_NONE, true);
+                                        VIR_ASYNC_JOB_NONE, true, 0);
+}
+
+/**
+ * virDomainObjBeginJobTimeout:
+ *
+ * @obj: domain object
+ * @job: virDomainJob to start
+ * @timeout: maximum time to wait for @job in milliseconds
+ *
+ * Acquires job for a domain object which must be locked before
+ * calling. Unlike virDomainObjBeginJob, it waits at most @timeout
+ * milliseconds for a running job to finish.
+ *
+ * Returns: see virDomainObjBeginJobInternal
+ */
+int
+virDomainObjBeginJobTimeout(virDomainObj *obj,
+                            virDomainJob job,
+                            unsigned long long timeout)
+{
+    return virDomainObjBeginJobInternal(obj, obj->job, job,
+                                        VIR_AGENT_JOB_NONE,
+                                        VIR_ASYNC_JOB_NONE, false, timeout);
 }
 
 /*
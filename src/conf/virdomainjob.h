@@ -248,7 +248,8 @@ int virDomainObjBeginJobInternal(virDomainObj *obj,
                                  virDomainJob job,
                                  virDomainAgentJob agentJob,
                                  virDomainAsyncJob asyncJob,
-                                 bool nowait)
+                                 bool nowait,
+                                 unsigned long long timeout)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) ATTRIBUTE_NONNULL(3);
 
 int virDomainObjBeginJob(virDomainObj *obj,
@@ -268,6 +269,10 @@ int virDomainObjBeginNestedJob(virDomainObj *obj,
 int virDomainObjBeginJobNowait(virDomainObj *obj,
                                virDomainJob job)
     G_GNUC_WARN_UNUSED_RESULT;
+int virDomainObjBeginJobTimeout(virDomainObj *obj,
+                                virDomainJob job,
+                                unsigned long long timeout)
+    G_GNUC_WARN_UNUSED_RESULT;
 
 void virDomainObjEndJob(virDomainObj *obj);
 void virDomainObjEndAgentJob(virDomainObj *obj);
@@ -25,10 +25,14 @@
 #include "internal.h"
 #include "datatypes.h"
 #include "virdomainobjlist.h"
+#define LIBVIRT_VIRDOMAINOBJLISTPRIV_H_ALLOW
+#include "virdomainobjlistpriv.h"
 #include "viralloc.h"
 #include "virfile.h"
 #include "virlog.h"
 #include "virstring.h"
+#include "virthread.h"
+#include "virthreadpool.h"
 #include "virdomainsnapshotobjlist.h"
 #include "virdomaincheckpointobjlist.h"
 
@@ -50,6 +54,14 @@ struct _virDomainObjList {
     /* name -> virDomainObj mapping for O(1),
      * lookup-by-name */
     GHashTable *objsName;
+
+    /* id -> virDomainObj mapping for O(1) lookup-by-ID.
+     * IDs are changed by the drivers without involving the list so the
+     * entries are merely hints validated by virDomainObjListFindByID.
+     * Protected by @idLock, which may be acquired with the list locked
+     * for reading. */
+    GHashTable *objsID;
+    virMutex idLock;
 };
 
 
@@ -73,8 +85,17 @@ virDomainObjList *virDomainObjListNew(void)
     if (!(doms = virObjectRWLockableNew(virDomainObjListClass)))
         return NULL;
 
+    if (virMutexInit(&doms->idLock) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot initialize mutex"));
+        virObjectUnref(doms);
+        return NULL;
+    }
+
     doms->objs = virHashNew(virObjectUnref);
     doms->objsName = virHashNew(virObjectUnref);
+    doms->objsID = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                         NULL, virObjectUnref);
     return doms;
 }
 
@@ -85,6 +106,8 @@ static void virDomainObjListDispose(void *obj)
 
     g_clear_pointer(&doms->objs, g_hash_table_unref);
     g_clear_pointer(&doms->objsName, g_hash_table_unref);
+    g_clear_pointer(&doms->objsID, g_hash_table_unref);
+    virMutexDestroy(&doms->idLock);
 }
 
 
@@ -105,16 +128,50 @@ static int virDomainObjListSearchID(const void *payload,
 }
 
 
+/**
+ * @doms: Domain object list
+ * @id: ID of a running domain
+ *
+ * Lookup the running domain with @id and return a locked and ref counted
+ * domain object if found. Domains are usually found in the doms->objsID
+ * table, the whole list is searched only if the entry is missing or no
+ * longer valid. Caller is expected to use the virDomainObjEndAPI when done
+ * with the object.
+ */
 virDomainObj *
 virDomainObjListFindByID(virDomainObjList *doms,
                          int id)
 {
-    virDomainObj *obj;
+    virDomainObj *obj = NULL;
+
+    virObjectRWLockRead(doms);
+    VIR_WITH_MUTEX_LOCK_GUARD(&doms->idLock) {
+        obj = virObjectRef(g_hash_table_lookup(doms->objsID, GINT_TO_POINTER(id)));
+    }
+    virObjectRWUnlock(doms);
+
+    if (obj) {
+        virObjectLock(obj);
+        if (!obj->removing &&
+            virDomainObjIsActive(obj) &&
+            obj->def->id == id)
+            return obj;
+
+        /* the domain was stopped or restarted meanwhile */
+        virDomainObjEndAPI(&obj);
+    }
 
     virObjectRWLockRead(doms);
     obj = virHashSearch(doms->objs, virDomainObjListSearchID, &id, NULL);
+    VIR_WITH_MUTEX_LOCK_GUARD(&doms->idLock) {
+        if (obj)
+            g_hash_table_insert(doms->objsID, GINT_TO_POINTER(id), virObjectRef(obj));
+        else
+            g_hash_table_remove(doms->objsID, GINT_TO_POINTER(id));
+    }
     virObjectRef(obj);
     virObjectRWUnlock(doms);
+
     if (obj) {
         virObjectLock(obj);
         if (obj->removing)
@@ -154,14 +211,23 @@ virDomainObj *
 virDomainObjListFindByUUID(virDomainObjList *doms,
                            const unsigned char *uuid)
 {
+    char uuidstr[VIR_UUID_STRING_BUFLEN];
     virDomainObj *obj;
 
+    virUUIDFormat(uuid, uuidstr);
+
+    /* Lock the object only after releasing the list so that lookups of
+     * a domain busy elsewhere don't hold off other lookups once a writer
+     * is waiting for the list. */
     virObjectRWLockRead(doms);
-    obj = virDomainObjListFindByUUIDLocked(doms, uuid);
+    obj = virObjectRef(virHashLookup(doms->objs, uuidstr));
     virObjectRWUnlock(doms);
 
-    if (obj && obj->removing)
-        virDomainObjEndAPI(&obj);
+    if (obj) {
+        virObjectLock(obj);
+        if (obj->removing)
+            virDomainObjEndAPI(&obj);
+    }
 
     return obj;
 }
@@ -197,11 +263,15 @@ virDomainObjListFindByName(virDomainObjList *doms,
     virDomainObj *obj;
 
     virObjectRWLockRead(doms);
-    obj = virDomainObjListFindByNameLocked(doms, name);
+    obj = virObjectRef(virHashLookup(doms->objsName, name));
     virObjectRWUnlock(doms);
 
-    if (obj && obj->removing)
-        virDomainObjEndAPI(&obj);
+    if (obj) {
+        virObjectLock(obj);
+        /* the domain might have been renamed before we locked it */
+        if (obj->removing || STRNEQ(obj->def->name, name))
+            virDomainObjEndAPI(&obj);
+    }
 
     return obj;
 }
@@ -362,6 +432,15 @@ virDomainObjListAdd(virDomainObjList *doms,
 }
 
 
+static gboolean
+virDomainObjListIDMatch(gpointer key G_GNUC_UNUSED,
+                        gpointer value,
+                        gpointer opaque)
+{
+    return value == opaque;
+}
+
+
 /* The caller must hold lock on 'doms' in addition to 'virDomainObjListRemove'
  * requirements
  *
@@ -378,6 +457,10 @@ virDomainObjListRemoveLocked(virDomainObjList *doms,
 
     virHashRemoveEntry(doms->objs, uuidstr);
     virHashRemoveEntry(doms->objsName, dom->def->name);
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&doms->idLock) {
+        g_hash_table_foreach_remove(doms->objsID, virDomainObjListIDMatch, dom);
+    }
 }
 
 
@@ -476,45 +559,180 @@ virDomainObjListRename(virDomainObjList *doms,
 }
 
 
+/* Upper limit of threads parsing domain XMLs in
+ * virDomainObjListLoadAllConfigs */
+#define VIR_DOMAIN_OBJ_LIST_LOAD_MAX_WORKERS 16
+
+typedef struct _virDomainObjListLoadJob virDomainObjListLoadJob;
+struct _virDomainObjListLoadJob {
+    char *name;
+
+    /* persistent config */
+    virDomainDef *def;
+    int autostart;
+    int autostartOnce;
+    char *autostartOnceLink;
+
+    /* live status */
+    virDomainObj *obj;
+};
+
+typedef struct _virDomainObjListLoadData virDomainObjListLoadData;
+struct _virDomainObjListLoadData {
+    const char *configDir;
+    const char *autostartDir;
+    bool liveStatus;
+    virDomainXMLOption *xmlopt;
+
+    virDomainObjListLoadJob *jobs;
+    size_t njobs;
+
+    virMutex lock;
+    virCond cond;
+    size_t pending; /* number of jobs not parsed yet, protected by @lock */
+};
+
+
+static void
+virDomainObjListLoadJobClear(virDomainObjListLoadJob *job)
+{
+    g_free(job->name);
+    virDomainDefFree(job->def);
+    g_free(job->autostartOnceLink);
+    virObjectUnref(job->obj);
+}
+
+
+static void
+virDomainObjListParseConfig(virDomainObjListLoadData *data,
+                            virDomainObjListLoadJob *job)
+{
+    g_autofree char *configFile = NULL;
+    g_autofree char *autostartLink = NULL;
+    g_autofree char *autostartOnceLink = NULL;
+
+    configFile = virDomainConfigFile(data->configDir, job->name);
+    if (!(job->def = virDomainDefParseFile(configFile, data->xmlopt, NULL,
+                                           VIR_DOMAIN_DEF_PARSE_INACTIVE |
+                                           VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
+                                           VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL)))
+        return;
+
+    autostartLink = virDomainConfigFile(data->autostartDir, job->name);
+    autostartOnceLink = g_strdup_printf("%s.once", autostartLink);
+
+    job->autostart = virFileLinkPointsTo(autostartLink, configFile);
+    job->autostartOnce = virFileLinkPointsTo(autostartOnceLink, configFile);
+
+    if (job->autostartOnce)
+        job->autostartOnceLink = g_steal_pointer(&autostartOnceLink);
+}
+
+
+static void
+virDomainObjListParseStatus(virDomainObjListLoadData *data,
+                            virDomainObjListLoadJob *job)
+{
+    g_autofree char *statusFile = virDomainConfigFile(data->configDir, job->name);
+
+    if (!(job->obj = virDomainObjParseFile(statusFile, data->xmlopt,
+                                           VIR_DOMAIN_DEF_PARSE_STATUS |
+                                           VIR_DOMAIN_DEF_PARSE_ACTUAL_NET |
+                                           VIR_DOMAIN_DEF_PARSE_PCI_ORIG_STATES |
+                                           VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
+                                           VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL |
+                                           VIR_DOMAIN_DEF_PARSE_VOLUME_TRANSLATED)))
+        return;
+
+    /* the object is locked again by the thread adding it to the list */
+    virObjectUnlock(job->obj);
+}
+
+
+static void
+virDomainObjListParseJob(void *jobdata,
+                         void *opaque)
+{
+    virDomainObjListLoadJob *job = jobdata;
+    virDomainObjListLoadData *data = opaque;
+
+    if (data->liveStatus)
+        virDomainObjListParseStatus(data, job);
+    else
+        virDomainObjListParseConfig(data, job);
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&data->lock) {
+        if (--data->pending == 0)
+            virCondSignal(&data->cond);
+    }
+}
+
+
+/**
+ * virDomainObjListParseAll:
+ * @data: jobs to process
+ * @nworkers: maximum number of threads parsing the jobs
+ *
+ * Parses XMLs of all jobs in @data using a pool of up to @nworkers threads,
+ * as parsing large numbers of domains one after another considerably delays
+ * daemon startup. Failures are reported and leave the job without
+ * a definition.
+ */
+static void
+virDomainObjListParseAll(virDomainObjListLoadData *data,
+                         size_t nworkers)
+{
+    virThreadPool *pool = NULL;
+    size_t i;
+
+    nworkers = MIN(nworkers, data->njobs);
+    data->pending = data->njobs;
+
+    if (nworkers > 1 &&
+        !(pool = virThreadPoolNewFull(0, nworkers, 0,
+                                      virDomainObjListParseJob,
+                                      "domain-load", NULL, data)))
+        VIR_WARN("Failed to create thread pool for loading domains");
+
+    for (i = 0; i < data->njobs; i++) {
+        if (pool && virThreadPoolSendJob(pool, 0, &data->jobs[i]) == 0)
+            continue;
+
+        /* parse in the calling thread if the job can't be queued */
+        virResetLastError();
+        virDomainObjListParseJob(&data->jobs[i], data);
+    }
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&data->lock) {
+        while (data->pending > 0)
+            ignore_value(virCondWait(&data->cond, &data->lock));
+    }
+
+    virThreadPoolFree(pool);
+}
+
+
 static virDomainObj *
 virDomainObjListLoadConfig(virDomainObjList *doms,
                            virDomainXMLOption *xmlopt,
-                           const char *configDir,
-                           const char *autostartDir,
-                           const char *name,
+                           virDomainObjListLoadJob *job,
                            virDomainLoadConfigNotify notify,
                            void *opaque)
 {
-    g_autofree char *configFile = NULL;
-    g_autofree char *autostartLink = NULL;
-    g_autofree char *autostartOnceLink = NULL;
-    g_autoptr(virDomainDef) def = NULL;
     virDomainObj *dom;
-    int autostart;
-    int autostartOnce;
     g_autoptr(virDomainDef) oldDef = NULL;
 
-    configFile = virDomainConfigFile(configDir, name);
-    if (!(def = virDomainDefParseFile(configFile, xmlopt, NULL,
-                                      VIR_DOMAIN_DEF_PARSE_INACTIVE |
-                                      VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
-                                      VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL)))
+    if (!job->def)
         return NULL;
 
-    autostartLink = virDomainConfigFile(autostartDir, name);
-    autostartOnceLink = g_strdup_printf("%s.once", autostartLink);
-
-    autostart = virFileLinkPointsTo(autostartLink, configFile);
-    autostartOnce = virFileLinkPointsTo(autostartOnceLink, configFile);
-
-    if (!(dom = virDomainObjListAddLocked(doms, &def, xmlopt, 0, &oldDef)))
+    if (!(dom = virDomainObjListAddLocked(doms, &job->def, xmlopt, 0, &oldDef)))
         return NULL;
 
-    dom->autostart = autostart;
-    dom->autostartOnce = autostartOnce;
+    dom->autostart = job->autostart;
+    dom->autostartOnce = job->autostartOnce;
 
-    if (autostartOnce)
-        dom->autostartOnceLink = g_steal_pointer(&autostartOnceLink);
+    if (job->autostartOnce)
+        dom->autostartOnceLink = g_steal_pointer(&job->autostartOnceLink);
 
     if (notify)
         (*notify)(dom, oldDef == NULL, opaque);
@@ -525,26 +743,17 @@ virDomainObjListLoadConfig(virDomainObjList *doms,
 
 static virDomainObj *
 virDomainObjListLoadStatus(virDomainObjList *doms,
-                           const char *statusDir,
-                           const char *name,
-                           virDomainXMLOption *xmlopt,
+                           virDomainObjListLoadJob *job,
                            virDomainLoadConfigNotify notify,
                            void *opaque)
 {
-    g_autofree char *statusFile = NULL;
     virDomainObj *obj = NULL;
     char uuidstr[VIR_UUID_STRING_BUFLEN];
 
-    statusFile = virDomainConfigFile(statusDir, name);
+    if (!(obj = g_steal_pointer(&job->obj)))
+        return NULL;
 
-    if (!(obj = virDomainObjParseFile(statusFile, xmlopt,
-                                      VIR_DOMAIN_DEF_PARSE_STATUS |
-                                      VIR_DOMAIN_DEF_PARSE_ACTUAL_NET |
-                                      VIR_DOMAIN_DEF_PARSE_PCI_ORIG_STATES |
-                                      VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE |
-                                      VIR_DOMAIN_DEF_PARSE_ALLOW_POST_PARSE_FAIL |
-                                      VIR_DOMAIN_DEF_PARSE_VOLUME_TRANSLATED)))
-        goto error;
+    virObjectLock(obj);
 
     virUUIDFormat(obj->def->uuid, uuidstr);
 
@@ -569,17 +778,31 @@ virDomainObjListLoadStatus(virDomainObjList *doms,
 }
 
 
+/**
+ * virDomainObjListLoadAllConfigsFull:
+ *
+ * Same as virDomainObjListLoadAllConfigs, but parses the XMLs using up to
+ * @nworkers threads.
+ */
 int
-virDomainObjListLoadAllConfigs(virDomainObjList *doms,
-                               const char *configDir,
-                               const char *autostartDir,
-                               bool liveStatus,
-                               virDomainXMLOption *xmlopt,
-                               virDomainLoadConfigNotify notify,
-                               void *opaque)
+virDomainObjListLoadAllConfigsFull(virDomainObjList *doms,
+                                   const char *configDir,
+                                   const char *autostartDir,
+                                   bool liveStatus,
+                                   virDomainXMLOption *xmlopt,
+                                   virDomainLoadConfigNotify notify,
+                                   void *opaque,
+                                   size_t nworkers)
 {
     g_autoptr(DIR) dir = NULL;
     struct dirent *entry;
+    virDomainObjListLoadData data = {
+        .configDir = configDir,
+        .autostartDir = autostartDir,
+        .liveStatus = liveStatus,
+        .xmlopt = xmlopt,
+    };
+    size_t i;
     int ret = -1;
     int rc;
 
@@ -588,46 +811,88 @@ virDomainObjListLoadAllConfigs(virDomainObjList *doms,
     if ((rc = virDirOpenIfExists(&dir, configDir)) <= 0)
         return rc;
 
-    virObjectRWLockWrite(doms);
-
     while ((ret = virDirRead(dir, &entry, configDir)) > 0) {
-        virDomainObj *dom;
+        virDomainObjListLoadJob job = { 0 };
 
         if (!virStringStripSuffix(entry->d_name, ".xml"))
             continue;
 
+        job.name = g_strdup(entry->d_name);
+        VIR_APPEND_ELEMENT(data.jobs, data.njobs, job);
+    }
+
+    if (virMutexInit(&data.lock) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize mutex"));
+        ret = -1;
+        goto cleanup;
+    }
+
+    if (virCondInit(&data.cond) < 0) {
+        virReportSystemError(errno, "%s", _("cannot initialize condition"));
+        virMutexDestroy(&data.lock);
+        ret = -1;
+        goto cleanup;
+    }
+
+    /* Parsing happens without holding the list lock, only adding the
+     * domains to the list is serialized. */
+    virDomainObjListParseAll(&data, nworkers);
+
+    virCondDestroy(&data.cond);
+    virMutexDestroy(&data.lock);
+
+    virObjectRWLockWrite(doms);
+
+    for (i = 0; i < data.njobs; i++) {
+        virDomainObjListLoadJob *job = &data.jobs[i];
+        virDomainObj *dom;
+
         /* NB: ignoring errors, so one malformed config doesn't
            kill the whole process */
-        VIR_INFO("Loading config file '%s.xml'", entry->d_name);
+        VIR_INFO("Loading config file '%s.xml'", job->name);
         if (liveStatus)
-            dom = virDomainObjListLoadStatus(doms,
-                                             configDir,
-                                             entry->d_name,
-                                             xmlopt,
-                                             notify,
-                                             opaque);
+            dom = virDomainObjListLoadStatus(doms, job, notify, opaque);
         else
-            dom = virDomainObjListLoadConfig(doms,
-                                             xmlopt,
-                                             configDir,
-                                             autostartDir,
-                                             entry->d_name,
-                                             notify,
-                                             opaque);
+            dom = virDomainObjListLoadConfig(doms, xmlopt, job, notify, opaque);
+
         if (dom) {
             if (!liveStatus)
                 dom->persistent = 1;
             virDomainObjEndAPI(&dom);
         } else {
-            VIR_ERROR(_("Failed to load config for domain '%1$s'"), entry->d_name);
+            VIR_ERROR(_("Failed to load config for domain '%1$s'"), job->name);
         }
     }
 
     virObjectRWUnlock(doms);
+
+ cleanup:
+    for (i = 0; i < data.njobs; i++)
+        virDomainObjListLoadJobClear(&data.jobs[i]);
+    g_free(data.jobs);
+
     return ret;
 }
 
 
+int
+virDomainObjListLoadAllConfigs(virDomainObjList *doms,
+                               const char *configDir,
+                               const char *autostartDir,
+                               bool liveStatus,
+                               virDomainXMLOption *xmlopt,
+                               virDomainLoadConfigNotify notify,
+                               void *opaque)
+{
+    size_t nworkers = MIN(VIR_DOMAIN_OBJ_LIST_LOAD_MAX_WORKERS,
+                          g_get_num_processors());
+
+    return virDomainObjListLoadAllConfigsFull(doms, configDir, autostartDir,
+                                              liveStatus, xmlopt, notify,
+                                              opaque, nworkers);
+}
+
+
 struct virDomainObjListData {
     virDomainObjListACLFilter filter;
     virConnectPtr conn;
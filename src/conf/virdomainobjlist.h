@@ -29,6 +29,8 @@ typedef struct _virDomainObjList virDomainObjList;
 virDomainObjList *
 virDomainObjListNew(void);
 
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virDomainObjList, virObjectUnref);
+
 virDomainObj *
 virDomainObjListFindByID(virDomainObjList *doms,
                          int id);
@@ -0,0 +1,35 @@
+/*
+ * virdomainobjlistpriv.h: domain objects list utilities (private)
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBVIRT_VIRDOMAINOBJLISTPRIV_H_ALLOW
+# error "virdomainobjlistpriv.h may only be included by virdomainobjlist.c or test suites"
+#endif /* LIBVIRT_VIRDOMAINOBJLISTPRIV_H_ALLOW */
+
+#pragma once
+
+#include "virdomainobjlist.h"
+
+int
+virDomainObjListLoadAllConfigsFull(virDomainObjList *doms,
+                                   const char *configDir,
+                                   const char *autostartDir,
+                                   bool liveStatus,
+                                   virDomainXMLOption *xmlopt,
+                                   virDomainLoadConfigNotify notify,
+                                   void *opaque,
+                                   size_t nworkers);
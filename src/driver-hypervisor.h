@@ -1473,6 +1473,12 @@ typedef int
                                 const char *groupname,
                                 unsigned int flags);
 
+typedef int
+(*virDrvConnectGetAllDomainStatsStream)(virConnectPtr conn,
+                                        virStreamPtr st,
+                                        unsigned int stats,
+                                        unsigned int flags);
+
 typedef struct _virHypervisorDriver virHypervisorDriver;
 
 /**
@@ -1750,4 +1756,5 @@ struct _virHypervisorDriver {
     virDrvDomainGraphicsReload domainGraphicsReload;
     virDrvDomainSetThrottleGroup domainSetThrottleGroup;
     virDrvDomainDelThrottleGroup domainDelThrottleGroup;
+    virDrvConnectGetAllDomainStatsStream connectGetAllDomainStatsStream;
 };
@@ -476,10 +476,56 @@ virDomainInterfaceDeleteDevice(virDomainDef *def,
 }
 
 
+/**
+ * virDomainInterfaceSetQoS:
+ * @def: domain definition
+ * @net: a net definition in the VM
+ * @backend: how to program traffic control of non-OVS interfaces
+ *
+ * For given interface @net apply its QoS settings in the host,
+ * replacing whatever was set before. Just warns if @net has QoS
+ * but is of a type that doesn't support it.
+ *
+ * Returns: 0 on success,
+ *         -1 otherwise (with appropriate error reported)
+ */
+int
+virDomainInterfaceSetQoS(virDomainDef *def,
+                         virDomainNetDef *net,
+                         virNetDevBandwidthBackend backend)
+{
+    const virNetDevBandwidth *actualBandwidth = virDomainNetGetActualBandwidth(net);
+    virDomainNetType actualType = virDomainNetGetActualType(net);
+    unsigned int flags = VIR_NETDEV_BANDWIDTH_SET_CLEAR_ALL;
+
+    if (!actualBandwidth)
+        return 0;
+
+    if (!virNetDevSupportsBandwidth(actualType)) {
+        VIR_WARN("setting bandwidth on interfaces of "
+                 "type '%s' is not implemented yet",
+                 virDomainNetTypeToString(actualType));
+        return 0;
+    }
+
+    if (virDomainNetDefIsOvsport(net)) {
+        return virNetDevOpenvswitchInterfaceSetQos(net->ifname, actualBandwidth,
+                                                   def->uuid,
+                                                   !virDomainNetTypeSharesHostView(net));
+    }
+
+    if (!virDomainNetTypeSharesHostView(net))
+        flags |= VIR_NETDEV_BANDWIDTH_SET_DIR_SWAPPED;
+
+    return virNetDevBandwidthSet(net->ifname, actualBandwidth, backend, flags);
+}
+
+
 /**
  * virDomainInterfaceClearQoS
  * @def: domain definition
  * @net: a net definition in the VM
+ * @backend: how to program traffic control of non-OVS interfaces
  *
  * For given interface @net clear its QoS settings in the
  * host. NOP if @net has no QoS or is of a type that doesn't
@@ -490,7 +536,8 @@ virDomainInterfaceDeleteDevice(virDomainDef *def,
  */
 int
 virDomainInterfaceClearQoS(virDomainDef *def,
-                           virDomainNetDef *net)
+                           virDomainNetDef *net,
+                           virNetDevBandwidthBackend backend)
 {
     if (!virDomainNetGetActualBandwidth(net))
         return 0;
@@ -502,17 +549,18 @@ virDomainInterfaceClearQoS(virDomainDef *def,
         return virNetDevOpenvswitchInterfaceClearQos(net->ifname, def->uuid);
     }
 
-    return virNetDevBandwidthClear(net->ifname);
+    return virNetDevBandwidthClear(net->ifname, backend);
 }
 
 
 void
-virDomainClearNetBandwidth(virDomainDef *def)
+virDomainClearNetBandwidth(virDomainDef *def,
+                           virNetDevBandwidthBackend backend)
 {
     size_t i;
 
     for (i = 0; i < def->nnets; i++) {
-        virDomainInterfaceClearQoS(def, def->nets[i]);
+        virDomainInterfaceClearQoS(def, def->nets[i], backend);
     }
 }
 
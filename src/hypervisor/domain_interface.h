@@ -44,9 +44,14 @@ void virDomainInterfaceDeleteDevice(virDomainDef *def,
                                 virDomainNetDef *net,
                                 bool priv_net_created,
                                 char *stateDir);
+int virDomainInterfaceSetQoS(virDomainDef *def,
+                             virDomainNetDef *net,
+                             virNetDevBandwidthBackend backend);
 int virDomainInterfaceClearQoS(virDomainDef *def,
-                               virDomainNetDef *net);
-void virDomainClearNetBandwidth(virDomainDef *def)
+                               virDomainNetDef *net,
+                               virNetDevBandwidthBackend backend);
+void virDomainClearNetBandwidth(virDomainDef *def,
+                                virNetDevBandwidthBackend backend)
     ATTRIBUTE_NONNULL(1);
 
 int virDomainInterfaceBridgeConnect(virDomainDef *def,
@@ -12527,6 +12527,13 @@ virConnectGetDomainCapabilities(virConnectPtr conn,
  * is returned for the domain.  That subset being statistics that
  * don't involve querying the underlying hypervisor.
  *
+ * Passing VIR_CONNECT_GET_ALL_DOMAINS_STATS_PARALLEL in @flags allows the
+ * hypervisor driver to collect statistics of individual domains
+ * concurrently. Drivers may also limit the time spent collecting the
+ * statistics in this mode, in which case domains which didn't respond in
+ * time are reported with the same subset of statistics as with
+ * VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT.
+ *
  * Similarly to virConnectListAllDomains, @flags can contain various flags to
  * filter the list of domains to provide stats for.
  *
@@ -12676,6 +12683,13 @@ virConnectGetAllDomainStats(virConnectPtr conn,
  * is returned for the domain.  That subset being statistics that
  * don't involve querying the underlying hypervisor.
  *
+ * Passing VIR_CONNECT_GET_ALL_DOMAINS_STATS_PARALLEL in @flags allows the
+ * hypervisor driver to collect statistics of individual domains
+ * concurrently. Drivers may also limit the time spent collecting the
+ * statistics in this mode, in which case domains which didn't respond in
+ * time are reported with the same subset of statistics as with
+ * VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT.
+ *
  * Note that any of the domain list filtering flags in @flags may be rejected
  * by this function.
  *
@@ -12746,6 +12760,87 @@ virDomainListGetStats(virDomainPtr *doms,
 }
 
 
+/**
+ * virConnectGetAllDomainStatsStream:
+ * @conn: pointer to the hypervisor connection
+ * @st: stream to use for transferring the statistics
+ * @stats: stats to return, binary-OR of virDomainStatsTypes
+ * @flags: extra flags; binary-OR of virConnectGetAllDomainStatsFlags
+ *
+ * Query the same statistics as virConnectGetAllDomainStats, but send them
+ * through @st in a compact binary form instead of as arrays of typed
+ * parameters. This avoids sending every parameter name again for every
+ * domain, which dominates the size of the data on hosts with many domains.
+ * The @stats and @flags arguments have the same meaning as for
+ * virConnectGetAllDomainStats.
+ *
+ * The stream consists of the four bytes "LVST", a 32 bit format version
+ * (currently 1) and a sequence of items. Each item starts with a single
+ * byte tag. All integers are little endian and strings are sent as a 32 bit
+ * length followed by that many bytes, without a terminating NUL.
+ *
+ *  'K' - a parameter name: a string. Names are numbered from 0 in the
+ *        order in which they appear in the stream.
+ *
+ *  'S' - a record layout: a 32 bit number of fields, then for each
+ *        field the 32 bit number of its name and a byte holding its
+ *        virTypedParameterType. Layouts are numbered from 0 in the order
+ *        in which they appear in the stream.
+ *
+ *  'R' - statistics of one domain: the 32 bit number of the record layout,
+ *        the 16 byte raw UUID, the 32 bit signed ID (-1 if inactive) and
+ *        the name of the domain, followed by the value of each field of
+ *        the layout. VIR_TYPED_PARAM_INT and VIR_TYPED_PARAM_UINT take
+ *        4 bytes, VIR_TYPED_PARAM_LLONG, VIR_TYPED_PARAM_ULLONG and
+ *        VIR_TYPED_PARAM_DOUBLE (IEEE 754) 8 bytes, VIR_TYPED_PARAM_BOOLEAN
+ *        one byte and VIR_TYPED_PARAM_STRING is a string.
+ *
+ *  'E' - end of the statistics, nothing follows.
+ *
+ * Names and layouts are always sent before the first record using them.
+ * The caller should use virStreamRecv or virStreamRecvAll to read the data
+ * and virStreamFinish once the end of the stream is reached.
+ *
+ * Returns 0 on success, -1 on error.
+ *
+ * Since: 12.1.0
+ */
+int
+virConnectGetAllDomainStatsStream(virConnectPtr conn,
+                                  virStreamPtr st,
+                                  unsigned int stats,
+                                  unsigned int flags)
+{
+    VIR_DEBUG("conn=%p, st=%p, stats=0x%x, flags=0x%x",
+              conn, st, stats, flags);
+
+    virResetLastError();
+
+    virCheckConnectReturn(conn, -1);
+    virCheckStreamGoto(st, error);
+
+    if (conn != st->conn) {
+        virReportInvalidArg(st, "%s",
+                            _("stream must match the connection"));
+        goto error;
+    }
+
+    if (conn->driver->connectGetAllDomainStatsStream) {
+        int ret;
+        ret = conn->driver->connectGetAllDomainStatsStream(conn, st, stats, flags);
+        if (ret < 0)
+            goto error;
+        return ret;
+    }
+
+    virReportUnsupportedError();
+
+ error:
+    virDispatchError(conn);
+    return -1;
+}
+
+
 /**
  * virDomainStatsRecordListFree:
  * @stats: NULL terminated array of virDomainStatsRecords to free
@@ -1765,7 +1765,10 @@ virStorageVolDownload(virStorageVolPtr vol,
  * stream APIs is necessary to transfer the actual data,
  * determine how much data is successfully transferred, and
  * detect any errors. The results will be unpredictable if
- * another active stream is writing to the storage volume.
+ * another active stream is writing to the same range of the
+ * storage volume. Streams writing disjoint ranges, given by
+ * @offset and @length, may be used in parallel to speed up the
+ * upload of large volumes.
  *
  * When the data stream is closed whether the upload is successful
  * or not an attempt will be made to refresh the target storage pool
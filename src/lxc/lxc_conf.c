@@ -228,6 +228,7 @@ virLXCLoadDriverConfig(virLXCDriverConfig *cfg,
                        const char *filename)
 {
     g_autoptr(virConf) conf = NULL;
+    g_autofree char *bandwidthBackend = NULL;
 
     /* Avoid error from non-existent or unreadable file. */
     if (access(filename, R_OK) == -1)
@@ -249,6 +250,24 @@ virLXCLoadDriverConfig(virLXCDriverConfig *cfg,
     if (virConfGetValueBool(conf, "security_require_confined", &cfg->securityRequireConfined) < 0)
         return -1;
 
+    if (virConfGetValueString(conf, "bandwidth_backend", &bandwidthBackend) < 0)
+        return -1;
+
+    if (bandwidthBackend) {
+        int val = virNetDevBandwidthBackendTypeFromString(bandwidthBackend);
+
+        if (val < 0) {
+            virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
+                           _("Unknown bandwidth_backend value %1$s"),
+                           bandwidthBackend);
+            return -1;
+        }
+        cfg->bandwidthBackend = val;
+    }
+
+    if (virNetDevBandwidthCheckBackend(cfg->bandwidthBackend) < 0)
+        return -1;
+
     return 0;
 }
 
@@ -54,6 +54,8 @@ struct _virLXCDriverConfig {
     char *securityDriverName;
     bool securityDefaultConfined;
     bool securityRequireConfined;
+
+    virNetDevBandwidthBackend bandwidthBackend;
 };
 
 struct _virLXCDriver {
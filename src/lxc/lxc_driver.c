@@ -3466,6 +3466,7 @@ lxcDomainAttachDeviceNetLive(virLXCDriver *driver,
                              virDomainObj *vm,
                              virDomainNetDef *net)
 {
+    g_autoptr(virLXCDriverConfig) cfg = virLXCDriverGetConfig(driver);
     virLXCDomainObjPrivate *priv = vm->privateData;
     int ret = -1;
     virDomainNetType actualType;
@@ -3550,7 +3551,9 @@ lxcDomainAttachDeviceNetLive(virLXCDriver *driver,
             if (!virDomainNetTypeSharesHostView(net))
                 flags |= VIR_NETDEV_BANDWIDTH_SET_DIR_SWAPPED;
 
-            if (virNetDevBandwidthSet(net->ifname, actualBandwidth, flags) < 0)
+            if (virNetDevBandwidthSet(net->ifname, actualBandwidth,
+                                      cfg->bandwidthBackend,
+                                      flags) < 0)
                 goto cleanup;
         } else {
             VIR_WARN("setting bandwidth on interfaces of "
@@ -4022,9 +4025,11 @@ lxcDomainDetachDeviceDiskLive(virDomainObj *vm,
 
 
 static int
-lxcDomainDetachDeviceNetLive(virDomainObj *vm,
+lxcDomainDetachDeviceNetLive(virLXCDriver *driver,
+                             virDomainObj *vm,
                              virDomainDeviceDef *dev)
 {
+    g_autoptr(virLXCDriverConfig) cfg = virLXCDriverGetConfig(driver);
     int detachidx, ret = -1;
     virDomainNetType actualType;
     virDomainNetDef *detach = NULL;
@@ -4037,7 +4042,7 @@ lxcDomainDetachDeviceNetLive(virDomainObj *vm,
     actualType = virDomainNetGetActualType(detach);
 
     /* clear network bandwidth */
-    virDomainInterfaceClearQoS(vm->def, detach);
+    virDomainInterfaceClearQoS(vm->def, detach, cfg->bandwidthBackend);
 
     switch (actualType) {
     case VIR_DOMAIN_NET_TYPE_BRIDGE:
@@ -4343,7 +4348,7 @@ lxcDomainDetachDeviceLive(virLXCDriver *driver,
         break;
 
     case VIR_DOMAIN_DEVICE_NET:
-        ret = lxcDomainDetachDeviceNetLive(vm, dev);
+        ret = lxcDomainDetachDeviceNetLive(driver, vm, dev);
         break;
 
     case VIR_DOMAIN_DEVICE_HOSTDEV:
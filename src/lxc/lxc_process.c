@@ -536,6 +536,7 @@ virLXCProcessSetupInterfaces(virLXCDriver *driver,
     virDomainNetDef *net;
     virDomainNetType type;
     g_autoptr(virConnect) netconn = NULL;
+    g_autoptr(virLXCDriverConfig) cfg = virLXCDriverGetConfig(driver);
     virErrorPtr save_err = NULL;
 
     *veths = g_new0(char *, def->nnets + 1);
@@ -613,7 +614,9 @@ virLXCProcessSetupInterfaces(virLXCDriver *driver,
                 if (!virDomainNetTypeSharesHostView(net))
                     flags |= VIR_NETDEV_BANDWIDTH_SET_DIR_SWAPPED;
 
-                if (virNetDevBandwidthSet(net->ifname, actualBandwidth, flags) < 0)
+                if (virNetDevBandwidthSet(net->ifname, actualBandwidth,
+                                          cfg->bandwidthBackend,
+                                          flags) < 0)
                     goto cleanup;
             } else {
                 VIR_WARN("setting bandwidth on interfaces of "
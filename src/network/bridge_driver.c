@@ -651,6 +651,9 @@ networkStateInitialize(bool privileged,
     if (!(network_driver->config = cfg = virNetworkDriverConfigNew(privileged)))
         goto error;
 
+    if (virNetDevBandwidthCheckBackend(cfg->bandwidthBackend) < 0)
+        goto error;
+
     network_driver->inhibitor = virInhibitorNew(
         VIR_INHIBITOR_WHAT_NONE,
         _("Libvirt Network"),
@@ -2121,6 +2124,7 @@ networkStartNetworkVirtual(virNetworkDriverState *driver,
     }
 
     if (virNetDevBandwidthSet(def->bridge, def->bandwidth,
+                              cfg->bandwidthBackend,
                               VIR_NETDEV_BANDWIDTH_SET_HIERARCHICAL_CLASS
                               | VIR_NETDEV_BANDWIDTH_SET_DIR_SWAPPED) < 0) {
         goto error;
@@ -2131,7 +2135,7 @@ networkStartNetworkVirtual(virNetworkDriverState *driver,
  error:
     virErrorPreserveLast(&save_err);
     if (def->bandwidth)
-       virNetDevBandwidthClear(def->bridge);
+       virNetDevBandwidthClear(def->bridge, cfg->bandwidthBackend);
 
     if (dnsmasqStarted) {
         pid_t dnsmasqPid = virNetworkObjGetDnsmasqPid(obj);
@@ -2155,13 +2159,14 @@ networkStartNetworkVirtual(virNetworkDriverState *driver,
 
 
 static int
-networkShutdownNetworkVirtual(virNetworkObj *obj)
+networkShutdownNetworkVirtual(virNetworkDriverConfig *cfg,
+                              virNetworkObj *obj)
 {
     virNetworkDef *def = virNetworkObjGetDef(obj);
     pid_t dnsmasqPid;
 
     if (def->bandwidth)
-        virNetDevBandwidthClear(def->bridge);
+        virNetDevBandwidthClear(def->bridge, cfg->bandwidthBackend);
 
     virNetworkObjUnrefMacMap(obj);
     dnsmasqPid = virNetworkObjGetDnsmasqPid(obj);
@@ -2196,7 +2201,8 @@ networkShutdownNetworkVirtual(virNetworkObj *obj)
 
 
 static int
-networkStartNetworkBridge(virNetworkObj *obj)
+networkStartNetworkBridge(virNetworkDriverConfig *cfg,
+                          virNetworkObj *obj)
 {
     virNetworkDef *def = virNetworkObjGetDef(obj);
 
@@ -2205,6 +2211,7 @@ networkStartNetworkBridge(virNetworkObj *obj)
      * and return -1. On success return 0.
      */
     if (virNetDevBandwidthSet(def->bridge, def->bandwidth,
+                              cfg->bandwidthBackend,
                               VIR_NETDEV_BANDWIDTH_SET_HIERARCHICAL_CLASS
                               | VIR_NETDEV_BANDWIDTH_SET_DIR_SWAPPED) < 0) {
         goto error;
@@ -2217,13 +2224,14 @@ networkStartNetworkBridge(virNetworkObj *obj)
 
  error:
     if (def->bandwidth)
-       virNetDevBandwidthClear(def->bridge);
+       virNetDevBandwidthClear(def->bridge, cfg->bandwidthBackend);
     return -1;
 }
 
 
 static int
-networkShutdownNetworkBridge(virNetworkObj *obj G_GNUC_UNUSED)
+networkShutdownNetworkBridge(virNetworkDriverConfig *cfg,
+                             virNetworkObj *obj)
 {
     virNetworkDef *def = virNetworkObjGetDef(obj);
 
@@ -2232,7 +2240,7 @@ networkShutdownNetworkBridge(virNetworkObj *obj G_GNUC_UNUSED)
      * and return -1. On success return 0.
      */
     if (def->bandwidth)
-       virNetDevBandwidthClear(def->bridge);
+       virNetDevBandwidthClear(def->bridge, cfg->bandwidthBackend);
 
     return 0;
 }
@@ -2404,7 +2412,7 @@ networkStartNetwork(virNetworkDriverState *driver,
 
     case VIR_NETWORK_FORWARD_BRIDGE:
         if (def->bridge) {
-            if (networkStartNetworkBridge(obj) < 0)
+            if (networkStartNetworkBridge(cfg, obj) < 0)
                 goto cleanup;
             break;
         }
@@ -2484,12 +2492,12 @@ networkShutdownNetwork(virNetworkDriverState *driver,
     case VIR_NETWORK_FORWARD_NAT:
     case VIR_NETWORK_FORWARD_ROUTE:
     case VIR_NETWORK_FORWARD_OPEN:
-        ret = networkShutdownNetworkVirtual(obj);
+        ret = networkShutdownNetworkVirtual(cfg, obj);
         break;
 
     case VIR_NETWORK_FORWARD_BRIDGE:
         if (def->bridge) {
-            ret = networkShutdownNetworkBridge(obj);
+            ret = networkShutdownNetworkBridge(cfg, obj);
             break;
         }
         /* intentionally fall through to the macvtap/direct case for
@@ -4628,9 +4636,11 @@ networkPlugBandwidthImpl(virNetworkObj *obj,
     }
 
     plug_ret = virNetDevBandwidthPlug(def->bridge, def->bandwidth,
-                                      mac, ifaceBand, next_id);
+                                      mac, ifaceBand, next_id,
+                                      cfg->bandwidthBackend);
     if (plug_ret < 0) {
-        ignore_value(virNetDevBandwidthUnplug(def->bridge, next_id));
+        ignore_value(virNetDevBandwidthUnplug(def->bridge, next_id,
+                                              cfg->bandwidthBackend));
         return -1;
     }
 
@@ -4645,13 +4655,15 @@ networkPlugBandwidthImpl(virNetworkObj *obj,
         tmp_floor_sum -= ifaceBand->in->floor;
         virNetworkObjSetFloorSum(obj, tmp_floor_sum);
         *class_id = 0;
-        ignore_value(virNetDevBandwidthUnplug(def->bridge, next_id));
+        ignore_value(virNetDevBandwidthUnplug(def->bridge, next_id,
+                                              cfg->bandwidthBackend));
         return -1;
     }
     /* update rate for non guaranteed NICs */
     new_rate -= tmp_floor_sum;
     if (virNetDevBandwidthUpdateRate(def->bridge, 2,
-                                     def->bandwidth, new_rate) < 0)
+                                     def->bandwidth, new_rate,
+                                     cfg->bandwidthBackend) < 0)
         VIR_WARN("Unable to update rate for 1:2 class on %s bridge",
                  def->bridge);
 
@@ -4713,7 +4725,8 @@ networkUnplugBandwidth(virNetworkObj *obj,
         if (def->bandwidth->in->peak > 0)
             new_rate = def->bandwidth->in->peak;
 
-        ret = virNetDevBandwidthUnplug(def->bridge, *class_id);
+        ret = virNetDevBandwidthUnplug(def->bridge, *class_id,
+                                       cfg->bandwidthBackend);
         if (ret < 0)
             return ret;
         /* update sum of 'floor'-s of attached NICs */
@@ -4733,7 +4746,8 @@ networkUnplugBandwidth(virNetworkObj *obj,
         /* update rate for non guaranteed NICs */
         new_rate -= tmp_floor_sum;
         if (virNetDevBandwidthUpdateRate(def->bridge, 2,
-                                         def->bandwidth, new_rate) < 0)
+                                         def->bandwidth, new_rate,
+                                         cfg->bandwidthBackend) < 0)
             VIR_WARN("Unable to update rate for 1:2 class on %s bridge",
                      def->bridge);
         /* no class is associated any longer */
@@ -4806,7 +4820,8 @@ networkUpdatePortBandwidth(virNetworkObj *obj,
         if (virNetDevBandwidthUpdateRate(def->bridge,
                                          *class_id,
                                          def->bandwidth,
-                                         new_floor) < 0)
+                                         new_floor,
+                                         cfg->bandwidthBackend) < 0)
             return -1;
 
         tmp_floor_sum = virNetworkObjGetFloorSum(obj);
@@ -4816,7 +4831,8 @@ networkUpdatePortBandwidth(virNetworkObj *obj,
         new_rate -= tmp_floor_sum;
 
         if (virNetDevBandwidthUpdateRate(def->bridge, 2,
-                                         def->bandwidth, new_rate) < 0 ||
+                                         def->bandwidth, new_rate,
+                                         cfg->bandwidthBackend) < 0 ||
             virNetworkObjSaveStatus(cfg->stateDir,
                                     obj, network_driver->xmlopt) < 0) {
             /* Ouch, rollback */
@@ -4827,7 +4843,8 @@ networkUpdatePortBandwidth(virNetworkObj *obj,
             ignore_value(virNetDevBandwidthUpdateRate(def->bridge,
                                                       *class_id,
                                                       def->bandwidth,
-                                                      old_floor));
+                                                      old_floor,
+                                                      cfg->bandwidthBackend));
             return -1;
         }
     } else if (new_floor > 0) {
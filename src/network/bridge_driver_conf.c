@@ -66,6 +66,7 @@ virNetworkLoadDriverConfig(virNetworkDriverConfig *cfg G_GNUC_UNUSED,
 {
     g_autoptr(virConf) conf = NULL;
     g_autofree char *fwBackendStr = NULL;
+    g_autofree char *bwBackendStr = NULL;
     bool fwBackendSelected = false;
     size_t i;
     int fwBackends[] = {
@@ -104,6 +105,21 @@ virNetworkLoadDriverConfig(virNetworkDriverConfig *cfg G_GNUC_UNUSED,
             VIR_DEBUG("firewall_backend setting requested from config file %s: '%s'",
                       filename, virFirewallBackendTypeToString(fwBackends[0]));
         }
+
+        if (virConfGetValueString(conf, "bandwidth_backend", &bwBackendStr) < 0)
+            return -1;
+
+        if (bwBackendStr) {
+            int bwBackend = virNetDevBandwidthBackendTypeFromString(bwBackendStr);
+
+            if (bwBackend < 0) {
+                virReportError(VIR_ERR_INTERNAL_ERROR,
+                               _("unrecognized bandwidth_backend = '%1$s' set in network driver config file %2$s"),
+                               bwBackendStr, filename);
+                return -1;
+            }
+            cfg->bandwidthBackend = bwBackend;
+        }
     }
 
     for (i = 0; i < nFwBackends && !fwBackendSelected; i++) {
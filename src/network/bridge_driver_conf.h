@@ -28,6 +28,7 @@
 #include "object_event.h"
 #include "virfirewall.h"
 #include "virinhibitor.h"
+#include "virnetdevbandwidth.h"
 
 typedef struct _virNetworkDriverConfig virNetworkDriverConfig;
 struct _virNetworkDriverConfig {
@@ -41,6 +42,7 @@ struct _virNetworkDriverConfig {
     char *dnsmasqStateDir;
 
     virFirewallBackend firewallBackend;
+    virNetDevBandwidthBackend bandwidthBackend;
 };
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(virNetworkDriverConfig, virObjectUnref);
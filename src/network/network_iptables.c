@@ -1616,7 +1616,8 @@ iptablesAddFirewallRules(virNetworkDef *def, virFirewall **fwRemoval)
     virNetworkIPDef *ipdef;
     g_autoptr(virFirewall) fw = virFirewallNew(VIR_FIREWALL_BACKEND_IPTABLES);
 
-    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_AUTO_ROLLBACK);
+    virFirewallStartTransaction(fw, (VIR_FIREWALL_TRANSACTION_AUTO_ROLLBACK |
+                                     VIR_FIREWALL_TRANSACTION_BATCH));
 
     iptablesAddGeneralFirewallRules(fw, def);
 
@@ -1004,7 +1004,8 @@ nftablesAddFirewallRules(virNetworkDef *def, virFirewall **fwRemoval)
     virNetworkIPDef *ipdef;
     g_autoptr(virFirewall) fw = virFirewallNew(VIR_FIREWALL_BACKEND_NFTABLES);
 
-    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_AUTO_ROLLBACK);
+    virFirewallStartTransaction(fw, (VIR_FIREWALL_TRANSACTION_AUTO_ROLLBACK |
+                                     VIR_FIREWALL_TRANSACTION_BATCH));
 
     /* add the tc filter rule needed to fixup the checksum of dhcp
      * response packets going from host to guest.
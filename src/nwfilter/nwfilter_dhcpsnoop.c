@@ -36,14 +36,16 @@
  */
 #include <config.h>
 
-#ifdef WITH_LIBPCAP
-# include <pcap.h>
-#endif
-
 #include <fcntl.h>
 #include <poll.h>
+#include <sys/socket.h>
 
+#include <net/ethernet.h>
 #include <net/if.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <linux/filter.h>
+#include <linux/if_packet.h>
 
 #include "virlog.h"
 #include "datatypes.h"
@@ -59,41 +61,58 @@
 #include "virtime.h"
 #include "virstring.h"
 
+#define LIBVIRT_NWFILTER_DHCPSNOOPPRIV_H_ALLOW
+#include "nwfilter_dhcpsnooppriv.h"
+
 #define VIR_FROM_THIS VIR_FROM_NWFILTER
 
 VIR_LOG_INIT("nwfilter.nwfilter_dhcpsnoop");
 
-#ifdef WITH_LIBPCAP
+#define LEASEFILE_DIR RUNSTATEDIR "/libvirt/network/"
+#define LEASEFILE LEASEFILE_DIR "nwfilter.leases"
+#define TMPLEASEFILE LEASEFILE_DIR "nwfilter.ltmp"
 
-# define LEASEFILE_DIR RUNSTATEDIR "/libvirt/network/"
-# define LEASEFILE LEASEFILE_DIR "nwfilter.leases"
-# define TMPLEASEFILE LEASEFILE_DIR "nwfilter.ltmp"
+/*
+ * Packets are decoded by single threaded workers so that the packets of
+ * one interface are processed in the order they were received; interfaces
+ * are spread across the workers by their index.
+ */
+#define SNOOP_DECODE_WORKERS 4
 
 struct virNWFilterSnoopState {
     /* lease file */
     int                  leaseFD;
     int                  nLeases; /* number of active leases */
     int                  wLeases; /* number of written leases */
-    int                  nThreads; /* number of running threads */
-    /* thread management */
+    int                  nJobs;   /* number of queued decode jobs */
+    /* request management */
     GHashTable *     snoopReqs;
     GHashTable *     ifnameToKey;
     virMutex             snoopLock;  /* protects SnoopReqs and IfNameToKey */
     GHashTable *     active;
     virMutex             activeLock; /* protects Active */
+    /* packet capture shared by all interfaces */
+    int                  sockfd;      /* owned by the Engine thread while it runs */
+    virThread            engine;
+    bool                 engineRunning;
+    int                  engineQuit;
+    GHashTable *     ifaces;      /* ifindex -> virNWFilterSnoopIface */
+    GPtrArray *      staleIfaces; /* replaced in Ifaces, yet to be freed */
+    virMutex             engineLock;  /* protects Ifaces, StaleIfaces, EngineRunning */
+    virThreadPool *  workers[SNOOP_DECODE_WORKERS];
 };
 
-# define VIR_IFKEY_LEN   ((VIR_UUID_STRING_BUFLEN) + (VIR_MAC_STRING_BUFLEN))
+#define VIR_IFKEY_LEN   ((VIR_UUID_STRING_BUFLEN) + (VIR_MAC_STRING_BUFLEN))
 
 typedef struct _virNWFilterSnoopReq virNWFilterSnoopReq;
 
 typedef struct _virNWFilterSnoopIPLease virNWFilterSnoopIPLease;
 
 typedef enum {
-    THREAD_STATUS_NONE,
-    THREAD_STATUS_OK,
-    THREAD_STATUS_FAIL,
-} virNWFilterSnoopThreadStatus;
+    SNOOP_DIR_TO_VM,
+    SNOOP_DIR_FROM_VM,
+    SNOOP_DIR_LAST
+} virNWFilterSnoopDir;
 
 struct _virNWFilterSnoopReq {
     /*
@@ -112,13 +131,12 @@ struct _virNWFilterSnoopReq {
     virNWFilterSnoopIPLease *          start;
     virNWFilterSnoopIPLease *          end;
     char                                *threadkey;
-    virErrorPtr                          threadError;
-
-    virNWFilterSnoopThreadStatus         threadStatus;
-    virCond                              threadStatusCond;
 
     int                                  jobCompletionStatus;
     /* the number of submitted jobs in the worker's queue */
+    int                                  qCtr[SNOOP_DIR_LAST];
+    /* whether a job expiring leases is in the worker's queue */
+    int                                  expiryQueued;
     /*
      * protect those members that can change while the
      * req is on the public SnoopReq hash and
@@ -128,7 +146,6 @@ struct _virNWFilterSnoopReq {
      * - start
      * - end
      * - a lease while it is on the list
-     * - threadStatus
      * (for refctr, see above)
      */
     virMutex                             lock;
@@ -138,8 +155,11 @@ struct _virNWFilterSnoopReq {
  * Note about lock-order:
  * 1st: virNWFilterSnoopState.snoopLock
  * 2nd: &req->lock
+ * 3rd: virNWFilterSnoopState.engineLock
  *
- * Rationale: Former protects the SnoopReqs hash, latter its contents
+ * Rationale: The first protects the SnoopReqs hash, the second its
+ * contents; the capture thread only looks up interfaces while holding
+ * the engineLock and takes the other locks after releasing it.
  */
 
 struct _virNWFilterSnoopIPLease {
@@ -183,61 +203,79 @@ G_STATIC_ASSERT(sizeof(struct _virNWFilterSnoopDHCPHdr) == 236);
 
 /* DHCP options */
 
-# define DHCPO_PAD         0
-# define DHCPO_LEASE      51     /* lease time in secs */
-# define DHCPO_MTYPE      53     /* message type */
-# define DHCPO_END       255     /* end of options */
+#define DHCPO_PAD         0
+#define DHCPO_LEASE      51     /* lease time in secs */
+#define DHCPO_MTYPE      53     /* message type */
+#define DHCPO_END       255     /* end of options */
+
+/* UDP ports */
+#define DHCP_SERVER_PORT 67
+#define DHCP_CLIENT_PORT 68
 
 /* DHCP message types */
-# define DHCPDECLINE     4
-# define DHCPACK         5
-# define DHCPRELEASE     7
+#define DHCPDECLINE     4
+#define DHCPACK         5
+#define DHCPRELEASE     7
 
-# define MIN_VALID_DHCP_PKT_SIZE \
+#define MIN_VALID_DHCP_PKT_SIZE \
     (offsetof(virNWFilterSnoopEthHdr, eh_data) + \
      sizeof(struct udphdr) + \
      offsetof(virNWFilterSnoopDHCPHdr, d_opts))
 
-# define PCAP_PBUFSIZE              576 /* >= IP/TCP/DHCP headers */
-# define PCAP_READ_MAXERRS          25 /* retries on failing device */
-# define PCAP_FLOOD_TIMEOUT_MS      10 /* ms */
+#define SNOOP_PBUFSIZE             576 /* >= IP/TCP/DHCP headers */
+#define SNOOP_RECV_BATCH           64 /* packets read per wakeup */
+#define SNOOP_FLOOD_TIMEOUT_MS     10 /* ms */
 
 typedef struct _virNWFilterDHCPDecodeJob virNWFilterDHCPDecodeJob;
 struct _virNWFilterDHCPDecodeJob {
-    unsigned char packet[PCAP_PBUFSIZE];
+    virNWFilterSnoopReq *req; /* holds a reference */
+    bool expire; /* run the lease timers instead of decoding a packet */
+    unsigned char packet[SNOOP_PBUFSIZE];
     int caplen;
-    bool fromVM;
-    int *qCtr;
+    virNWFilterSnoopDir dir;
 };
 
-# define DHCP_PKT_RATE          10 /* pkts/sec */
-# define DHCP_PKT_BURST         50 /* pkts/sec */
-# define DHCP_BURST_INTERVAL_S  10 /* sec */
+#define DHCP_PKT_RATE          10 /* pkts/sec */
+#define DHCP_PKT_BURST         50 /* pkts/sec */
+#define DHCP_BURST_INTERVAL_S  10 /* sec */
 
-# define MAX_QUEUED_JOBS        (DHCP_PKT_BURST + 2 * DHCP_PKT_RATE)
+#define MAX_QUEUED_JOBS        (DHCP_PKT_BURST + 2 * DHCP_PKT_RATE)
 
 typedef struct _virNWFilterSnoopRateLimitConf virNWFilterSnoopRateLimitConf;
 struct _virNWFilterSnoopRateLimitConf {
     time_t prev;
     unsigned int pkt_ctr;
     time_t burst;
-    const unsigned int rate;
-    const unsigned int burstRate;
-    const unsigned int burstInterval;
+    unsigned int rate;
+    unsigned int burstRate;
+    unsigned int burstInterval;
 };
-# define SNOOP_POLL_MAX_TIMEOUT_MS  (10 * 1000) /* milliseconds */
+#define SNOOP_POLL_TIMEOUT_MS      1000 /* milliseconds */
+#define SNOOP_VALIDATE_INTERVAL_S  10 /* sec */
+#define SNOOP_REOPEN_INTERVAL_S    10 /* sec */
 
-typedef struct _virNWFilterSnoopPcapConf virNWFilterSnoopPcapConf;
-struct _virNWFilterSnoopPcapConf {
-    pcap_t *handle;
-    const pcap_direction_t dir;
-    const char *filter;
+typedef struct _virNWFilterSnoopDirConf virNWFilterSnoopDirConf;
+struct _virNWFilterSnoopDirConf {
     virNWFilterSnoopRateLimitConf rateLimit; /* indep. rate limiters */
-    int qCtr; /* number of jobs in the worker's queue */
-    const unsigned int maxQSize;
     unsigned long long penaltyTimeoutAbs;
 };
 
+/*
+ * An interface whose DHCP traffic is captured; owned by the
+ * capture thread.
+ */
+typedef struct _virNWFilterSnoopIface virNWFilterSnoopIface;
+struct _virNWFilterSnoopIface {
+    virNWFilterSnoopReq *req; /* holds a reference */
+    int ifindex;
+    char *ifname;
+    char *threadkey;
+    virMacAddr mac;
+    virNWFilterSnoopDirConf dirConf[SNOOP_DIR_LAST];
+    time_t last_displayed;
+    time_t last_displayed_queue;
+};
+
 /* local function prototypes */
 static int virNWFilterSnoopReqLeaseDel(virNWFilterSnoopReq *req,
                                        virSocketAddr *ipaddr,
@@ -250,6 +288,7 @@ static void virNWFilterSnoopLeaseFileSave(virNWFilterSnoopIPLease *ipl);
 /* local variables */
 static struct virNWFilterSnoopState virNWFilterSnoopState = {
     .leaseFD = -1,
+    .sockfd = -1,
 };
 
 static const unsigned char dhcp_magic[4] = { 99, 130, 83, 99 };
@@ -491,18 +530,11 @@ virNWFilterSnoopReqNew(const char *ifkey)
         return NULL;
     }
 
-    req->threadStatus = THREAD_STATUS_NONE;
-
     if (virStrcpyStatic(req->ifkey, ifkey) < 0 ||
         virMutexInitRecursive(&req->lock) < 0) {
         return NULL;
     }
 
-    if (virCondInit(&req->threadStatusCond) < 0) {
-        virMutexDestroy(&req->lock);
-        return NULL;
-    }
-
     virNWFilterSnoopReqGet(req);
     return g_steal_pointer(&req);
 }
@@ -531,8 +563,6 @@ virNWFilterSnoopReqFree(virNWFilterSnoopReq *req)
     virNWFilterBindingDefFree(req->binding);
 
     virMutexDestroy(&req->lock);
-    virCondDestroy(&req->threadStatusCond);
-    virFreeError(req->threadError);
 
     g_free(req);
 }
@@ -748,7 +778,7 @@ virNWFilterSnoopReqLeaseDel(virNWFilterSnoopReq *req,
 }
 
 static int
-virNWFilterSnoopDHCPGetOpt(virNWFilterSnoopDHCPHdr *pd, int len,
+virNWFilterSnoopDHCPGetOpt(const virNWFilterSnoopDHCPHdr *pd, int len,
                            uint8_t *pmtype, uint32_t *pleasetime)
 {
     int oind, olen;
@@ -775,7 +805,7 @@ virNWFilterSnoopDHCPGetOpt(virNWFilterSnoopDHCPHdr *pd, int len,
                 goto error;
             if (*pleasetime)
                 return -1;  /* duplicate lease time */
-            memcpy(&nwint, (char *)pd->d_opts + oind + 2, sizeof(nwint));
+            memcpy(&nwint, (const char *)pd->d_opts + oind + 2, sizeof(nwint));
             *pleasetime = ntohl(nwint);
             break;
         case DHCPO_MTYPE:
@@ -802,52 +832,113 @@ virNWFilterSnoopDHCPGetOpt(virNWFilterSnoopDHCPHdr *pd, int len,
     return -1;
 }
 
-/*
- * Decode the DHCP options
+/**
+ * virNWFilterSnoopDHCPMatch:
+ * @packet: Ethernet frame
+ * @len: length of @packet
+ * @fromVM: whether @packet was sent by the VM
+ * @mac: MAC address of the VM
  *
- * Returns 0 in case of full success.
- * Returns -2 in case of some error with the packet.
- * Returns -1 in case of error with the installation of rules
+ * Checks whether @packet is a DHCP message sent by the DHCP client of the
+ * VM with @mac, or one sent by a DHCP server towards the VM.
+ *
+ * Returns true if @packet is to be decoded.
  */
-static int
-virNWFilterSnoopDHCPDecode(virNWFilterSnoopReq *req,
-                           virNWFilterSnoopEthHdr *pep,
-                           int len, bool fromVM)
+bool
+virNWFilterSnoopDHCPMatch(const unsigned char *packet,
+                          size_t len,
+                          bool fromVM,
+                          const virMacAddr *mac)
 {
-    struct iphdr *pip;
-    struct udphdr *pup;
-    virNWFilterSnoopDHCPHdr *pd;
-    virNWFilterSnoopIPLease ipl = { 0 };
-    uint8_t mtype;
-    uint32_t leasetime;
-    uint32_t nwint;
+    const virNWFilterSnoopEthHdr *pep = (const virNWFilterSnoopEthHdr *)packet;
+    const struct iphdr *pip;
+    const struct udphdr *pup;
+    size_t iphlen;
 
-    /* go through the protocol headers */
-    switch (ntohs(pep->eh_type)) {
-    case ETHERTYPE_IP:
-        VIR_WARNINGS_NO_CAST_ALIGN
-        pip = (struct iphdr *)pep->eh_data;
-        VIR_WARNINGS_RESET
-        len -= offsetof(virNWFilterSnoopEthHdr, eh_data);
-        break;
-    default:
-        return -2;
+    if (len <= MIN_VALID_DHCP_PKT_SIZE ||
+        ntohs(pep->eh_type) != ETHERTYPE_IP)
+        return false;
+
+    VIR_WARNINGS_NO_CAST_ALIGN
+    pip = (const struct iphdr *)pep->eh_data;
+    VIR_WARNINGS_RESET
+    iphlen = pip->ihl << 2;
+    len -= offsetof(virNWFilterSnoopEthHdr, eh_data);
+
+    if (pip->version != 4 ||
+        iphlen < sizeof(*pip) ||
+        len < iphlen + sizeof(*pup) ||
+        pip->protocol != IPPROTO_UDP ||
+        (ntohs(pip->frag_off) & IP_OFFMASK) != 0)
+        return false;
+
+    VIR_WARNINGS_NO_CAST_ALIGN
+    pup = (const struct udphdr *)((const char *)pip + iphlen);
+    VIR_WARNINGS_RESET
+
+    if (fromVM) {
+        if (ntohs(pup->source) != DHCP_CLIENT_PORT ||
+            ntohs(pup->dest) != DHCP_SERVER_PORT)
+            return false;
+
+        /* don't want to hear about another VM's DHCP requests */
+        if (virMacAddrCmp(mac, &pep->eh_src) != 0)
+            return false;
+    } else {
+        /*
+         * Some DHCP servers respond via MAC broadcast; the responses are
+         * filtered later by comparing the MAC address inside the DHCP
+         * response against the one of the VM.
+         */
+        if (ntohs(pup->source) != DHCP_SERVER_PORT ||
+            ntohs(pup->dest) != DHCP_CLIENT_PORT)
+            return false;
     }
 
-    if (len < 0)
-        return -2;
+    return true;
+}
+
+/**
+ * virNWFilterSnoopDHCPParse:
+ * @packet: Ethernet frame
+ * @len: length of @packet
+ * @fromVM: whether @packet was sent by the VM
+ * @mac: MAC address of the VM
+ * @msg: filled with the decoded message
+ *
+ * Decodes the DHCP message in @packet if it is relevant to the VM with
+ * @mac, see virNWFilterSnoopDHCPMatch().
+ *
+ * Returns 0 on success, -1 if @packet is to be ignored.
+ */
+int
+virNWFilterSnoopDHCPParse(const unsigned char *packet,
+                          size_t len,
+                          bool fromVM,
+                          const virMacAddr *mac,
+                          virNWFilterSnoopDHCPMsg *msg)
+{
+    const virNWFilterSnoopEthHdr *pep = (const virNWFilterSnoopEthHdr *)packet;
+    const struct iphdr *pip;
+    const virNWFilterSnoopDHCPHdr *pd;
+    size_t hdrlen;
+    uint32_t nwint;
+
+    if (!virNWFilterSnoopDHCPMatch(packet, len, fromVM, mac))
+        return -1;
 
     VIR_WARNINGS_NO_CAST_ALIGN
-    pup = (struct udphdr *)((char *)pip + (pip->ihl << 2));
+    pip = (const struct iphdr *)pep->eh_data;
     VIR_WARNINGS_RESET
-    len -= pip->ihl << 2;
-    if (len < 0)
-        return -2;
 
-    pd = (virNWFilterSnoopDHCPHdr *) ((char *)pup + sizeof(*pup));
-    len -= sizeof(*pup);
-    if (len < 0)
-        return -2;                 /* invalid packet length */
+    /* go through the protocol headers */
+    hdrlen = offsetof(virNWFilterSnoopEthHdr, eh_data) +
+             (pip->ihl << 2) + sizeof(struct udphdr);
+    if (len < hdrlen + sizeof(*pd))
+        return -1;                 /* invalid packet length */
+
+    pd = (const virNWFilterSnoopDHCPHdr *)(packet + hdrlen);
+    len -= hdrlen;
 
     /*
      * some DHCP servers send their responses as MAC broadcast replies
@@ -855,29 +946,53 @@ virNWFilterSnoopDHCPDecode(virNWFilterSnoopReq *req,
      * inside the DHCP response
      */
     if (!fromVM) {
-        if (virMacAddrCmpRaw(&req->binding->mac,
-                             (unsigned char *)&pd->d_chaddr) != 0)
-            return -2;
+        if (virMacAddrCmpRaw(mac, pd->d_chaddr) != 0)
+            return -1;
     }
 
-    if (virNWFilterSnoopDHCPGetOpt(pd, len, &mtype, &leasetime) < 0)
-        return -2;
+    if (virNWFilterSnoopDHCPGetOpt(pd, len, &msg->mtype, &msg->leasetime) < 0)
+        return -1;
 
     memcpy(&nwint, &pd->d_yiaddr, sizeof(nwint));
-    virSocketAddrSetIPv4AddrNetOrder(&ipl.ipAddress, nwint);
+    virSocketAddrSetIPv4AddrNetOrder(&msg->ipAddress, nwint);
 
     memcpy(&nwint, &pd->d_siaddr, sizeof(nwint));
-    virSocketAddrSetIPv4AddrNetOrder(&ipl.ipServer, nwint);
+    virSocketAddrSetIPv4AddrNetOrder(&msg->ipServer, nwint);
 
-    if (leasetime == ~0)
+    return 0;
+}
+
+/*
+ * Decode the DHCP options
+ *
+ * Returns 0 in case of full success.
+ * Returns -2 in case of some error with the packet.
+ * Returns -1 in case of error with the installation of rules
+ */
+static int
+virNWFilterSnoopDHCPDecode(virNWFilterSnoopReq *req,
+                           const unsigned char *packet,
+                           int len, bool fromVM)
+{
+    virNWFilterSnoopDHCPMsg msg;
+    virNWFilterSnoopIPLease ipl = { 0 };
+
+    if (virNWFilterSnoopDHCPParse(packet, len, fromVM,
+                                  &req->binding->mac, &msg) < 0)
+        return -2;
+
+    ipl.ipAddress = msg.ipAddress;
+    ipl.ipServer = msg.ipServer;
+
+    if (msg.leasetime == ~0)
         ipl.timeout = ~0;
     else
-        ipl.timeout = time(0) + leasetime;
+        ipl.timeout = time(0) + msg.leasetime;
 
     ipl.snoopReq = req;
 
     /* check that the type of message comes from the right direction */
-    switch (mtype) {
+    switch (msg.mtype) {
     case DHCPACK:
     case DHCPDECLINE:
         if (fromVM)
@@ -891,7 +1006,7 @@ virNWFilterSnoopDHCPDecode(virNWFilterSnoopReq *req,
         break;
     }
 
-    switch (mtype) {
+    switch (msg.mtype) {
     case DHCPACK:
         if (virNWFilterSnoopReqLeaseAdd(req, &ipl, true) < 0)
             return -1;
@@ -908,135 +1023,187 @@ virNWFilterSnoopDHCPDecode(virNWFilterSnoopReq *req,
     return 0;
 }
 
-static pcap_t *
-virNWFilterSnoopDHCPOpen(const char *ifname, virMacAddr *mac,
-                         const char *filter, pcap_direction_t dir)
+/*
+ * Open the packet socket capturing the DHCP traffic of all interfaces.
+ * Outgoing packets are only passed to sockets capturing all protocols,
+ * so the kernel is told to drop everything but unfragmented IPv4 UDP
+ * packets between the DHCP client and server ports right away.
+ */
+static int
+virNWFilterSnoopSocketOpen(void)
 {
-    pcap_t *handle = NULL;
-    struct bpf_program fp;
-    char pcap_errbuf[PCAP_ERRBUF_SIZE];
-    g_autofree char *ext_filter = NULL;
-    char macaddr[VIR_MAC_STRING_BUFLEN];
+    struct sock_filter code[] = {
+        /* IPv4 */
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETHERTYPE_IP, 0, 8),
+        /* UDP */
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 23),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 6),
+        /* first fragment */
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 20),
+        BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, IP_OFFMASK, 4, 0),
+        /* source and destination port */
+        BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+        BPF_STMT(BPF_LD | BPF_W | BPF_IND, 14),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                 (DHCP_CLIENT_PORT << 16) | DHCP_SERVER_PORT, 2, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,
+                 (DHCP_SERVER_PORT << 16) | DHCP_CLIENT_PORT, 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, 0),
+        BPF_STMT(BPF_RET | BPF_K, SNOOP_PBUFSIZE),
+    };
+    struct sock_fprog prog = {
+        .len = G_N_ELEMENTS(code),
+        .filter = code,
+    };
+    int fd;
 
-    virMacAddrFormat(mac, macaddr);
+    if ((fd = socket(AF_PACKET, SOCK_RAW | SOCK_CLOEXEC, htons(ETH_P_ALL))) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to open packet socket for DHCP snooping"));
+        return -1;
+    }
 
-    if (dir == PCAP_D_IN /* from VM */) {
-        /*
-         * don't want to hear about another VM's DHCP requests
-         *
-         * extend the filter with the macaddr of the VM; filter the
-         * more unlikely parameters first, then go for the MAC
-         */
-        ext_filter = g_strdup_printf("%s and ether src %s", filter, macaddr);
-    } else {
-        /*
-         * Some DHCP servers respond via MAC broadcast; we rely on later
-         * filtering of responses by comparing the MAC address inside the
-         * DHCP response against the one of the VM. Assuming that the
-         * bridge learns the VM's MAC address quickly this should not
-         * generate much more traffic than if we filtered by VM and
-         * braodcast MAC as well
-         */
-        ext_filter = g_strdup(filter);
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to set filter on DHCP snooping socket"));
+        VIR_FORCE_CLOSE(fd);
+        return -1;
     }
 
-    handle = pcap_create(ifname, pcap_errbuf);
+    return fd;
+}
 
-    if (handle == NULL) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("pcap_create failed"));
-        return NULL;
-    }
+/*
+ * Worker function to decode the DHCP message and with that
+ * also do the time-consuming work of instantiating the filters,
+ * or to remove the expired leases of an interface
+ */
+static void virNWFilterDHCPDecodeWorker(void *jobdata,
+                                        void *opaque G_GNUC_UNUSED)
+{
+    g_autofree virNWFilterDHCPDecodeJob *job = jobdata;
+    virNWFilterSnoopReq *req = job->req;
+    bool active;
 
-    if (pcap_set_snaplen(handle, PCAP_PBUFSIZE) < 0 ||
-        pcap_set_immediate_mode(handle, 1) < 0 ||
-        pcap_activate(handle) < 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("setup of pcap handle failed: %1$s"),
-                       pcap_geterr(handle));
-        goto cleanup;
+    if (job->expire) {
+        virNWFilterSnoopReqLeaseTimerRun(req);
+        g_atomic_int_set(&req->expiryQueued, 0);
+        ignore_value(g_atomic_int_dec_and_test(&virNWFilterSnoopState.nJobs));
+        virNWFilterSnoopReqPut(req);
+        return;
     }
 
-    if (pcap_compile(handle, &fp, ext_filter, 1, PCAP_NETMASK_UNKNOWN) != 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("pcap_compile: %1$s"), pcap_geterr(handle));
-        goto cleanup;
+    /* protect req->threadkey */
+    VIR_WITH_MUTEX_LOCK_GUARD(&req->lock) {
+        active = virNWFilterSnoopIsActive(req->threadkey);
     }
 
-    if (pcap_setfilter(handle, &fp) != 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("pcap_setfilter: %1$s"), pcap_geterr(handle));
-        goto cleanup_freecode;
-    }
+    if (active &&
+        virNWFilterSnoopDHCPDecode(req, job->packet, job->caplen,
+                                   job->dir == SNOOP_DIR_FROM_VM) == -1) {
+        req->jobCompletionStatus = -1;
 
-    if (pcap_setdirection(handle, dir) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("pcap_setdirection: %1$s"),
-                       pcap_geterr(handle));
-        goto cleanup_freecode;
+                       _("Instantiation of rules failed on interface '%1$s'"),
+                       req->binding->portdevname);
     }
+    ignore_value(g_atomic_int_dec_and_test(&req->qCtr[job->dir]));
+    ignore_value(g_atomic_int_dec_and_test(&virNWFilterSnoopState.nJobs));
 
-    pcap_freecode(&fp);
-    return handle;
-
- cleanup_freecode:
-    pcap_freecode(&fp);
- cleanup:
-    pcap_close(handle);
-    return NULL;
+    virNWFilterSnoopReqPut(req);
 }
 
 /*
- * Worker function to decode the DHCP message and with that
- * also do the time-consuming work of instantiating the filters
+ * Queue @job for @iface on the worker thread of the interface, which
+ * takes over @job.
  */
-static void virNWFilterDHCPDecodeWorker(void *jobdata, void *opaque)
+static int
+virNWFilterSnoopJobSubmit(virNWFilterSnoopIface *iface,
+                          virNWFilterDHCPDecodeJob *job)
 {
-    virNWFilterSnoopReq *req = opaque;
-    g_autofree virNWFilterDHCPDecodeJob *job = jobdata;
-    virNWFilterSnoopEthHdr *packet = (virNWFilterSnoopEthHdr *)job->packet;
+    virThreadPool *pool;
 
-    if (virNWFilterSnoopDHCPDecode(req, packet,
-                                   job->caplen, job->fromVM) == -1) {
-        req->jobCompletionStatus = -1;
+    pool = virNWFilterSnoopState.workers[iface->ifindex % SNOOP_DECODE_WORKERS];
 
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("Instantiation of rules failed on interface '%1$s'"),
-                       req->binding->portdevname);
+    job->req = iface->req;
+
+    virNWFilterSnoopReqGet(job->req);
+    g_atomic_int_add(&virNWFilterSnoopState.nJobs, 1);
+
+    if (virThreadPoolSendJob(pool, 0, job) < 0) {
+        ignore_value(g_atomic_int_dec_and_test(&virNWFilterSnoopState.nJobs));
+        /* @iface still holds a reference, so this can't be the last one;
+         * taking the snoopLock in virNWFilterSnoopReqPut() here would
+         * violate the lock order */
+        ignore_value(g_atomic_int_dec_and_test(&job->req->refctr));
+        g_free(job);
+        return -1;
     }
-    ignore_value(g_atomic_int_dec_and_test(job->qCtr));
+
+    return 0;
 }
 
 /*
  * Submit a job to the worker thread doing the time-consuming work...
+ *
+ * Called with the engineLock held.
  */
 static int
-virNWFilterSnoopDHCPDecodeJobSubmit(virThreadPool *pool,
-                                    virNWFilterSnoopEthHdr *pep,
-                                    int len, pcap_direction_t dir,
-                                    int *qCtr)
+virNWFilterSnoopDHCPDecodeJobSubmit(virNWFilterSnoopIface *iface,
+                                    const unsigned char *packet,
+                                    int len, virNWFilterSnoopDir dir)
 {
     virNWFilterDHCPDecodeJob *job;
-    int ret;
 
-    if (len <= MIN_VALID_DHCP_PKT_SIZE || len > sizeof(job->packet))
+    if (len > sizeof(job->packet))
         return 0;
 
     job = g_new0(virNWFilterDHCPDecodeJob, 1);
 
-    memcpy(job->packet, pep, len);
+    memcpy(job->packet, packet, len);
     job->caplen = len;
-    job->fromVM = (dir == PCAP_D_IN);
-    job->qCtr = qCtr;
+    job->dir = dir;
 
-    ret = virThreadPoolSendJob(pool, 0, job);
+    g_atomic_int_add(&iface->req->qCtr[dir], 1);
 
-    if (ret == 0)
-        g_atomic_int_add(qCtr, 1);
-    else
-        g_free(job);
+    if (virNWFilterSnoopJobSubmit(iface, job) < 0) {
+        ignore_value(g_atomic_int_dec_and_test(&iface->req->qCtr[dir]));
+        return -1;
+    }
 
-    return ret;
+    return 0;
+}
+
+/*
+ * Let the worker thread of @iface remove its expired leases, which
+ * involves instantiating the filters again, unless it's going to do
+ * so already.
+ */
+static void
+virNWFilterSnoopLeaseExpireJobSubmit(virNWFilterSnoopIface *iface,
+                                     time_t now)
+{
+    virNWFilterSnoopReq *req = iface->req;
+    virNWFilterDHCPDecodeJob *job;
+
+    /* protect req->start */
+    VIR_WITH_MUTEX_LOCK_GUARD(&req->lock) {
+        if (!req->start || req->start->timeout > now)
+            return;
+    }
+
+    if (!g_atomic_int_compare_and_exchange(&req->expiryQueued, 0, 1))
+        return;
+
+    job = g_new0(virNWFilterDHCPDecodeJob, 1);
+    job->expire = true;
+
+    if (virNWFilterSnoopJobSubmit(iface, job) < 0) {
+        g_atomic_int_set(&req->expiryQueued, 0);
+        VIR_WARN("Unable to expire leases on interface '%s': %s",
+                 iface->ifname, virGetLastErrorMessage());
+    }
 }
 
 /*
@@ -1057,7 +1224,7 @@ virNWFilterSnoopRateLimit(virNWFilterSnoopRateLimitConf *rl)
 {
     time_t now = time(0);
     int diff;
-# define IN_BURST(n, b) ((n)-(b) <= 1) /* bursts span 2 discrete seconds */
+#define IN_BURST(n, b) ((n)-(b) <= 1) /* bursts span 2 discrete seconds */
 
     if (rl->prev != now && !IN_BURST(now, rl->burst)) {
         rl->prev = now;
@@ -1088,309 +1255,464 @@ virNWFilterSnoopRateLimit(virNWFilterSnoopRateLimitConf *rl)
 /*
  * virNWFilterSnoopRatePenalty
  *
- * @pc: pointer to the virNWFilterSnoopPcapConf
+ * @dc: pointer to the virNWFilterSnoopDirConf
  * @diff: the amount of pkts beyond the rate, i.e., if the rate is 10
  *        and 13 pkts have been received now in one seconds, then
  *        this should be 3.
  *
- * Adjusts the timeout the virNWFilterSnooPcapConf will be penalized for
+ * Adjusts the timeout the virNWFilterSnoopDirConf will be penalized for
  * sending too many packets.
  */
 static void
-virNWFilterSnoopRatePenalty(virNWFilterSnoopPcapConf *pc,
+virNWFilterSnoopRatePenalty(virNWFilterSnoopDirConf *dc,
                             unsigned int diff, unsigned int limit)
 {
     if (diff > limit) {
         unsigned long long now;
 
         if (virTimeMillisNowRaw(&now) < 0) {
-            g_usleep(PCAP_FLOOD_TIMEOUT_MS); /* 1 ms */
-            pc->penaltyTimeoutAbs = 0;
+            dc->penaltyTimeoutAbs = 0;
         } else {
-            /* don't listen to the fd for 1 ms */
-            pc->penaltyTimeoutAbs = now + PCAP_FLOOD_TIMEOUT_MS;
+            /* ignore packets in this direction for some time */
+            dc->penaltyTimeoutAbs = now + SNOOP_FLOOD_TIMEOUT_MS;
         }
     }
 }
 
+static void
+virNWFilterSnoopIfaceFree(void *opaque)
+{
+    virNWFilterSnoopIface *iface = opaque;
+
+    if (!iface)
+        return;
+
+    virNWFilterSnoopReqPut(iface->req);
+    g_free(iface->ifname);
+    g_free(iface->threadkey);
+    g_free(iface);
+}
+
+/*
+ * Submit a packet captured on interface @ifindex to the worker thread
+ * unless the interface is not snooped or exceeds its rate limits.
+ */
+static void
+virNWFilterSnoopDispatch(const unsigned char *packet, size_t len,
+                         int ifindex, virNWFilterSnoopDir dir)
+{
+    VIR_LOCK_GUARD lock = virLockGuardLock(&virNWFilterSnoopState.engineLock);
+    virNWFilterSnoopIface *iface;
+    virNWFilterSnoopDirConf *dc;
+    unsigned int diff;
+
+    iface = g_hash_table_lookup(virNWFilterSnoopState.ifaces,
+                                GINT_TO_POINTER(ifindex));
+    if (!iface ||
+        !virNWFilterSnoopDHCPMatch(packet, len, dir == SNOOP_DIR_FROM_VM,
+                                   &iface->mac))
+        return;
+
+    dc = &iface->dirConf[dir];
+
+    if (dc->penaltyTimeoutAbs != 0) {
+        unsigned long long now;
+
+        if (virTimeMillisNowRaw(&now) == 0 && now < dc->penaltyTimeoutAbs)
+            return;
+
+        dc->penaltyTimeoutAbs = 0;
+    }
+
+    if (g_atomic_int_get(&iface->req->qCtr[dir]) > MAX_QUEUED_JOBS) {
+        if (time(0) - iface->last_displayed_queue > 10) {
+            iface->last_displayed_queue = time(0);
+            VIR_WARN("Worker thread for interface '%s' has a "
+                     "job queue that is too long",
+                     iface->ifname);
+        }
+        return;
+    }
+
+    diff = virNWFilterSnoopRateLimit(&dc->rateLimit);
+    if (diff > 0) {
+        virNWFilterSnoopRatePenalty(dc, diff, DHCP_PKT_RATE);
+        /* rate-limited warnings */
+        if (time(0) - iface->last_displayed > 10) {
+            iface->last_displayed = time(0);
+            VIR_WARN("Too many DHCP packets on interface '%s'",
+                     iface->ifname);
+        }
+        return;
+    }
+
+    if (virNWFilterSnoopDHCPDecodeJobSubmit(iface, packet, len, dir) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Job submission failed on interface '%1$s'"),
+                       iface->ifname);
+        iface->req->jobCompletionStatus = -1;
+    }
+}
+
+/*
+ * Read the packets queued on the capture socket.
+ *
+ * Returns 0 on success, -1 if the socket failed.
+ */
 static int
-virNWFilterSnoopAdjustPoll(virNWFilterSnoopPcapConf *pc,
-                           size_t nPc, struct pollfd *pfd,
-                           int *pollTo)
+virNWFilterSnoopReceive(void)
 {
-    int ret = 0;
+    unsigned char packet[SNOOP_PBUFSIZE];
     size_t i;
-    int tmp;
-    unsigned long long now = 0;
 
-    *pollTo = -1;
+    for (i = 0; i < SNOOP_RECV_BATCH; i++) {
+        struct sockaddr_ll sll = { 0 };
+        socklen_t slen = sizeof(sll);
+        ssize_t len;
 
-    for (i = 0; i < nPc; i++) {
-        if (pc[i].penaltyTimeoutAbs != 0) {
-            if (now == 0) {
-                if (virTimeMillisNow(&now) < 0) {
-                    ret = -1;
-                    break;
-                }
-            }
+        len = recvfrom(virNWFilterSnoopState.sockfd, packet, sizeof(packet),
+                       MSG_DONTWAIT, (struct sockaddr *)&sll, &slen);
+        if (len < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK ||
+                errno == EINTR || errno == ENETDOWN)
+                return 0;
 
-            if (now < pc[i].penaltyTimeoutAbs) {
-                /* don't listen to incoming data on the fd for some time */
-                pfd[i].events &= ~POLLIN;
-                /*
-                 * calc the max. time to spend in poll() until adjustments
-                 * to the pollfd array are needed again.
-                 */
-                tmp = pc[i].penaltyTimeoutAbs - now;
-                if (*pollTo == -1 || tmp < *pollTo)
-                    *pollTo = tmp;
-            } else {
-                /* listen again to the fd */
-                pfd[i].events |= POLLIN;
-
-                pc[i].penaltyTimeoutAbs = 0;
-            }
+            virReportSystemError(errno, "%s",
+                                 _("unable to read from DHCP snooping socket"));
+            return -1;
         }
+
+        /* packets sent by the host through the interface go to the VM */
+        virNWFilterSnoopDispatch(packet, len, sll.sll_ifindex,
+                                 sll.sll_pkttype == PACKET_OUTGOING ?
+                                 SNOOP_DIR_TO_VM : SNOOP_DIR_FROM_VM);
     }
 
-    return ret;
+    return 0;
 }
 
 /*
- * The DHCP snooping thread. It spends most of its time in the pcap
- * library and if it gets suitable packets, it submits them to the worker
- * thread for processing.
+ * Get the snooped interfaces. Called with the engineLock held.
+ */
+static GPtrArray *
+virNWFilterSnoopIfaceList(void)
+{
+    GPtrArray *ifaces = g_ptr_array_new();
+    GHashTableIter iter;
+    gpointer value;
+
+    g_hash_table_iter_init(&iter, virNWFilterSnoopState.ifaces);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+        g_ptr_array_add(ifaces, value);
+
+    return ifaces;
+}
+
+/*
+ * Stop snooping on @iface unless it was replaced in the meantime.
  */
 static void
-virNWFilterDHCPSnoopThread(void *req0)
+virNWFilterSnoopIfaceRemove(virNWFilterSnoopIface *iface)
 {
-    virNWFilterSnoopReq *req = req0;
-    struct pcap_pkthdr *hdr;
-    virNWFilterSnoopEthHdr *packet;
-    int ifindex = 0;
-    int errcount = 0;
-    int tmp = -1, rv, n, pollTo;
+    VIR_WITH_MUTEX_LOCK_GUARD(&virNWFilterSnoopState.engineLock) {
+        gpointer key = GINT_TO_POINTER(iface->ifindex);
+
+        /* a replaced interface is on the StaleIfaces list */
+        if (g_hash_table_lookup(virNWFilterSnoopState.ifaces, key) != iface)
+            return;
+
+        g_hash_table_remove(virNWFilterSnoopState.ifaces, key);
+    }
+
+    virNWFilterSnoopIfaceFree(iface);
+}
+
+/*
+ * Stop snooping on an interface on our own accord, e.g. because it
+ * disappeared, and forget about its request so that it can be snooped
+ * again once requested.
+ */
+static void
+virNWFilterSnoopIfaceAbort(virNWFilterSnoopIface *iface)
+{
+    virNWFilterSnoopReq *req = iface->req;
+
+    /* protect IfNameToKey */
+    VIR_WITH_MUTEX_LOCK_GUARD(&virNWFilterSnoopState.snoopLock) {
+        /* protect req->binding->portdevname & req->threadkey */
+        VIR_WITH_MUTEX_LOCK_GUARD(&req->lock) {
+            virNWFilterSnoopCancel(&req->threadkey);
+
+            ignore_value(virHashRemoveEntry(virNWFilterSnoopState.ifnameToKey,
+                                            req->binding->portdevname));
+
+            g_clear_pointer(&req->binding->portdevname, g_free);
+        }
+    }
+
+    virNWFilterSnoopIfaceRemove(iface);
+}
+
+/*
+ * Have the expired leases of all snooped interfaces removed and stop
+ * snooping on those which were cancelled, failed or disappeared.
+ */
+static void
+virNWFilterSnoopTick(time_t now,
+                     bool validate)
+{
+    g_autoptr(GPtrArray) stale = NULL;
+    g_autoptr(GPtrArray) ifaces = NULL;
     size_t i;
-    g_autofree char *threadkey = NULL;
-    virThreadPool *worker = NULL;
-    time_t last_displayed = 0, last_displayed_queue = 0;
-    virNWFilterSnoopPcapConf pcapConf[] = {
-        {
-            .dir = PCAP_D_IN, /* from VM */
-            .filter = "dst port 67 and src port 68",
-            .rateLimit = {
-                .prev = time(0),
-                .rate = DHCP_PKT_RATE,
-                .burstRate = DHCP_PKT_BURST,
-                .burstInterval = DHCP_BURST_INTERVAL_S,
-            },
-            .maxQSize = MAX_QUEUED_JOBS,
-        }, {
-            .dir = PCAP_D_OUT, /* to VM */
-            .filter = "src port 67 and dst port 68",
-            .rateLimit = {
-                .prev = time(0),
-                .rate = DHCP_PKT_RATE,
-                .burstRate = DHCP_PKT_BURST,
-                .burstInterval = DHCP_BURST_INTERVAL_S,
-            },
-            .maxQSize = MAX_QUEUED_JOBS,
-        },
-    };
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&virNWFilterSnoopState.engineLock) {
+        stale = g_steal_pointer(&virNWFilterSnoopState.staleIfaces);
+        virNWFilterSnoopState.staleIfaces = g_ptr_array_new();
+
+        /* only this thread frees interfaces, so they stay valid once
+         * the lock is released */
+        ifaces = virNWFilterSnoopIfaceList();
+    }
+
+    g_ptr_array_set_free_func(stale, virNWFilterSnoopIfaceFree);
+
+    for (i = 0; i < ifaces->len; i++) {
+        virNWFilterSnoopIface *iface = g_ptr_array_index(ifaces, i);
+        virNWFilterSnoopReq *req = iface->req;
+        int tmp = 1;
+
+        virNWFilterSnoopLeaseExpireJobSubmit(iface, now);
+
+        /* Check whether we were cancelled */
+        if (!virNWFilterSnoopIsActive(iface->threadkey)) {
+            virNWFilterSnoopIfaceRemove(iface);
+            continue;
+        }
+
+        /* Check whether a previously submitted job failed */
+        if (req->jobCompletionStatus != 0) {
+            virNWFilterSnoopIfaceAbort(iface);
+            continue;
+        }
+
+        if (!validate)
+            continue;
+
+        /* protect req->binding->portdevname */
+        VIR_WITH_MUTEX_LOCK_GUARD(&req->lock) {
+            if (req->binding->portdevname)
+                tmp = virNetDevValidateConfig(req->binding->portdevname,
+                                              NULL, iface->ifindex);
+        }
+
+        /* the interface disappeared */
+        if (tmp <= 0)
+            virNWFilterSnoopIfaceAbort(iface);
+    }
+}
+
+/*
+ * The DHCP snooping thread. It reads the DHCP packets of all snooped
+ * interfaces from a single socket and submits suitable ones to the worker
+ * threads for processing. Should the socket fail, it is reopened so that
+ * snooping resumes on all interfaces; the lease timers keep running in
+ * the meantime.
+ */
+static void
+virNWFilterDHCPSnoopThread(void *opaque G_GNUC_UNUSED)
+{
     struct pollfd fds[] = {
         {
-            /* get a POLLERR if interface goes down or disappears */
-            .events = POLLIN | POLLERR,
-        }, {
-            .events = POLLIN | POLLERR,
+            .fd = -1,
+            .events = POLLIN,
         },
     };
-    bool error = false;
+    time_t lastTick = 0;
+    time_t lastValidate = time(0);
+    time_t lastOpen = lastValidate;
+
+    while (!g_atomic_int_get(&virNWFilterSnoopState.engineQuit)) {
+        time_t now;
+
+        /* don't retry a failing socket more often than once in a while */
+        if (virNWFilterSnoopState.sockfd < 0 &&
+            time(0) - lastOpen >= SNOOP_REOPEN_INTERVAL_S) {
+            lastOpen = time(0);
+            if ((virNWFilterSnoopState.sockfd = virNWFilterSnoopSocketOpen()) >= 0)
+                VIR_INFO("DHCP snooping socket reopened");
+        }
 
-    /* whoever started us increased the reference counter for the req for us */
+        if (virNWFilterSnoopState.sockfd < 0) {
+            g_usleep(SNOOP_POLL_TIMEOUT_MS * 1000);
+        } else {
+            bool failed = false;
+            int n;
 
-    /* protect req->binding->portdevname & req->threadkey */
-    VIR_WITH_MUTEX_LOCK_GUARD(&req->lock) {
-        if (req->binding->portdevname && req->threadkey) {
-            for (i = 0; i < G_N_ELEMENTS(pcapConf); i++) {
-                pcapConf[i].handle =
-                    virNWFilterSnoopDHCPOpen(req->binding->portdevname,
-                                             &req->binding->mac,
-                                             pcapConf[i].filter,
-                                             pcapConf[i].dir);
-                if (!pcapConf[i].handle) {
-                    error = true;
-                    break;
+            fds[0].fd = virNWFilterSnoopState.sockfd;
+            n = poll(fds, G_N_ELEMENTS(fds), SNOOP_POLL_TIMEOUT_MS);
+
+            if (n < 0) {
+                if (errno != EAGAIN && errno != EINTR) {
+                    virReportSystemError(errno, "%s",
+                                         _("poll on DHCP snooping socket failed"));
+                    failed = true;
                 }
-                fds[i].fd = pcap_fileno(pcapConf[i].handle);
+            } else if (n > 0 && virNWFilterSnoopReceive() < 0) {
+                failed = true;
             }
-            tmp = virNetDevGetIndex(req->binding->portdevname, &ifindex);
-            threadkey = g_strdup(req->threadkey);
-            worker = virThreadPoolNewFull(1, 1, 0, virNWFilterDHCPDecodeWorker,
-                                          "dhcp-decode", NULL, req);
-        }
 
-        /* let creator know how well we initialized */
-        if (error || !threadkey || tmp < 0 || !worker || ifindex != req->ifindex) {
-            virErrorPreserveLast(&req->threadError);
-            req->threadStatus = THREAD_STATUS_FAIL;
-        } else {
-            req->threadStatus = THREAD_STATUS_OK;
+            if (failed) {
+                VIR_WARN("DHCP snooping suspended on all interfaces until the socket is reopened");
+                VIR_FORCE_CLOSE(virNWFilterSnoopState.sockfd);
+            }
         }
 
-        virCondSignal(&req->threadStatusCond);
-    }
+        now = time(0);
+        if (now != lastTick) {
+            bool validate = now - lastValidate >= SNOOP_VALIDATE_INTERVAL_S;
 
-    if (req->threadStatus != THREAD_STATUS_OK)
-        goto cleanup;
+            if (validate)
+                lastValidate = now;
+            lastTick = now;
 
-    while (!error) {
-        if (virNWFilterSnoopAdjustPoll(pcapConf,
-                                       G_N_ELEMENTS(pcapConf),
-                                       fds, &pollTo) < 0) {
-            break;
+            virNWFilterSnoopTick(now, validate);
         }
+    }
+}
 
-        /* cap pollTo so we don't hold up the join for too long */
-        if (pollTo < 0 || pollTo > SNOOP_POLL_MAX_TIMEOUT_MS)
-            pollTo = SNOOP_POLL_MAX_TIMEOUT_MS;
-
-        n = poll(fds, G_N_ELEMENTS(fds), pollTo);
+/*
+ * Start the snooping thread and its workers unless already running.
+ *
+ * Called with the engineLock held.
+ */
+static int
+virNWFilterSnoopEngineStart(void)
+{
+    size_t i;
 
-        if (n < 0) {
-            if (errno != EAGAIN && errno != EINTR)
-                error = true;
-        }
+    if (virNWFilterSnoopState.engineRunning)
+        return 0;
 
-        virNWFilterSnoopReqLeaseTimerRun(req);
+    for (i = 0; i < SNOOP_DECODE_WORKERS; i++) {
+        if (virNWFilterSnoopState.workers[i])
+            continue;
 
-        /*
-         * Check whether we were cancelled or whether
-         * a previously submitted job failed.
-         */
-        if (!virNWFilterSnoopIsActive(threadkey) ||
-            req->jobCompletionStatus != 0)
-            goto cleanup;
+        virNWFilterSnoopState.workers[i] =
+            virThreadPoolNewFull(1, 1, 0, virNWFilterDHCPDecodeWorker,
+                                 "dhcp-decode", NULL, NULL);
+        if (!virNWFilterSnoopState.workers[i])
+            return -1;
+    }
 
-        for (i = 0; n > 0 && i < G_N_ELEMENTS(fds); i++) {
-            if (!fds[i].revents)
-                continue;
+    if ((virNWFilterSnoopState.sockfd = virNWFilterSnoopSocketOpen()) < 0)
+        return -1;
 
-            fds[i].revents = 0;
-            n--;
+    g_atomic_int_set(&virNWFilterSnoopState.engineQuit, 0);
 
-            rv = pcap_next_ex(pcapConf[i].handle, &hdr,
-                              (const u_char **)&packet);
+    if (virThreadCreateFull(&virNWFilterSnoopState.engine, true,
+                            virNWFilterDHCPSnoopThread,
+                            "dhcp-snoop", false, NULL) != 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("unable to create DHCP snooping thread"));
+        VIR_FORCE_CLOSE(virNWFilterSnoopState.sockfd);
+        return -1;
+    }
 
-            if (rv < 0) {
-                /* error reading from socket */
-                tmp = -1;
+    virNWFilterSnoopState.engineRunning = true;
 
-                /* protect req->binding->portdevname */
-                VIR_WITH_MUTEX_LOCK_GUARD(&req->lock) {
-                    if (req->binding->portdevname)
-                        tmp = virNetDevValidateConfig(req->binding->portdevname, NULL, ifindex);
-                }
+    return 0;
+}
 
-                if (tmp <= 0) {
-                    error = true;
-                    break;
-                }
+/*
+ * Start snooping the DHCP traffic of @req's interface. The reference to
+ * @req held by the caller is passed on to the snooping thread.
+ *
+ * Called with the snoopLock and req->lock held.
+ */
+static int
+virNWFilterSnoopEngineAdd(virNWFilterSnoopReq *req)
+{
+    virNWFilterSnoopIface *iface = g_new0(virNWFilterSnoopIface, 1);
+    virNWFilterSnoopIface *old = NULL;
+    gpointer key = GINT_TO_POINTER(req->ifindex);
+    size_t i;
+    int rc;
 
-                if (++errcount > PCAP_READ_MAXERRS) {
-                    g_clear_pointer(&pcapConf[i].handle, pcap_close);
-
-                    /* protect req->binding->portdevname */
-                    VIR_WITH_MUTEX_LOCK_GUARD(&req->lock) {
-                        virReportError(VIR_ERR_INTERNAL_ERROR,
-                                       _("interface '%1$s' failing; reopening"),
-                                       req->binding->portdevname);
-                        if (req->binding->portdevname)
-                            pcapConf[i].handle =
-                                virNWFilterSnoopDHCPOpen(req->binding->portdevname,
-                                                         &req->binding->mac,
-                                                         pcapConf[i].filter,
-                                                         pcapConf[i].dir);
-                    }
-
-                    if (!pcapConf[i].handle) {
-                        error = true;
-                        break;
-                    }
-                }
-                continue;
-            }
+    iface->ifindex = req->ifindex;
+    iface->ifname = g_strdup(req->binding->portdevname);
+    iface->threadkey = g_strdup(req->threadkey);
+    virMacAddrSet(&iface->mac, &req->binding->mac);
 
-            errcount = 0;
-
-            if (rv) {
-                unsigned int diff;
-
-                /* submit packet to worker thread */
-                if (g_atomic_int_get(&pcapConf[i].qCtr) >
-                    pcapConf[i].maxQSize) {
-                    if (last_displayed_queue - time(0) > 10) {
-                        last_displayed_queue = time(0);
-                        VIR_WARN("Worker thread for interface '%s' has a "
-                                 "job queue that is too long",
-                                 req->binding->portdevname);
-                    }
-                    continue;
-                }
+    for (i = 0; i < SNOOP_DIR_LAST; i++) {
+        virNWFilterSnoopRateLimitConf *rl = &iface->dirConf[i].rateLimit;
 
-                diff = virNWFilterSnoopRateLimit(&pcapConf[i].rateLimit);
-                if (diff > 0) {
-                    virNWFilterSnoopRatePenalty(&pcapConf[i], diff,
-                                                DHCP_PKT_RATE);
-                    /* rate-limited warnings */
-                    if (time(0) - last_displayed > 10) {
-                         last_displayed = time(0);
-                         VIR_WARN("Too many DHCP packets on interface '%s'",
-                                  req->binding->portdevname);
-                    }
-                    continue;
-                }
+        rl->prev = time(0);
+        rl->rate = DHCP_PKT_RATE;
+        rl->burstRate = DHCP_PKT_BURST;
+        rl->burstInterval = DHCP_BURST_INTERVAL_S;
+    }
 
-                if (virNWFilterSnoopDHCPDecodeJobSubmit(worker, packet,
-                                                      hdr->caplen,
-                                                      pcapConf[i].dir,
-                                                      &pcapConf[i].qCtr) < 0) {
-                    virReportError(VIR_ERR_INTERNAL_ERROR,
-                                   _("Job submission failed on interface '%1$s'"),
-                                   req->binding->portdevname);
-                    error = true;
-                    break;
-                }
-            }
-        } /* for all fds */
-    } /* while (!error) */
+    VIR_WITH_MUTEX_LOCK_GUARD(&virNWFilterSnoopState.engineLock) {
+        if ((rc = virNWFilterSnoopEngineStart()) < 0)
+            continue;
 
-    /* protect IfNameToKey */
-    VIR_WITH_MUTEX_LOCK_GUARD(&virNWFilterSnoopState.snoopLock) {
-        /* protect req->binding->portdevname & req->threadkey */
-        VIR_WITH_MUTEX_LOCK_GUARD(&req->lock) {
-            virNWFilterSnoopCancel(&req->threadkey);
+        /* the snooping thread frees the interface this one replaces */
+        if (g_hash_table_steal_extended(virNWFilterSnoopState.ifaces, key,
+                                        NULL, (gpointer *)&old))
+            g_ptr_array_add(virNWFilterSnoopState.staleIfaces, old);
 
-            ignore_value(virHashRemoveEntry(virNWFilterSnoopState.ifnameToKey,
-                                            req->binding->portdevname));
+        iface->req = req;
+        g_hash_table_insert(virNWFilterSnoopState.ifaces, key, iface);
+    }
 
-            g_clear_pointer(&req->binding->portdevname, g_free);
-        }
+    if (rc < 0) {
+        virNWFilterSnoopIfaceFree(iface);
+        return -1;
     }
 
- cleanup:
-    virThreadPoolFree(worker);
+    return 0;
+}
 
-    virNWFilterSnoopReqPut(req);
+/*
+ * Stop the snooping thread, wait until all submitted packets have been
+ * processed and drop the references to all requests.
+ */
+static void
+virNWFilterSnoopEngineStop(void)
+{
+    g_autoptr(GPtrArray) ifaces = NULL;
+    g_autoptr(GPtrArray) stale = NULL;
+    bool running;
+    size_t i;
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&virNWFilterSnoopState.engineLock) {
+        running = virNWFilterSnoopState.engineRunning;
+        virNWFilterSnoopState.engineRunning = false;
+    }
 
-    for (i = 0; i < G_N_ELEMENTS(pcapConf); i++) {
-        if (pcapConf[i].handle)
-            pcap_close(pcapConf[i].handle);
+    if (running) {
+        g_atomic_int_set(&virNWFilterSnoopState.engineQuit, 1);
+        virThreadJoin(&virNWFilterSnoopState.engine);
     }
 
-    ignore_value(g_atomic_int_dec_and_test(&virNWFilterSnoopState.nThreads));
+    while (g_atomic_int_get(&virNWFilterSnoopState.nJobs) != 0)
+        g_usleep(10 * 1000);
+
+    for (i = 0; i < SNOOP_DECODE_WORKERS; i++)
+        g_clear_pointer(&virNWFilterSnoopState.workers[i], virThreadPoolFree);
+
+    VIR_FORCE_CLOSE(virNWFilterSnoopState.sockfd);
 
-    return;
+    VIR_WITH_MUTEX_LOCK_GUARD(&virNWFilterSnoopState.engineLock) {
+        ifaces = virNWFilterSnoopIfaceList();
+        g_hash_table_remove_all(virNWFilterSnoopState.ifaces);
+
+        stale = g_steal_pointer(&virNWFilterSnoopState.staleIfaces);
+        virNWFilterSnoopState.staleIfaces = g_ptr_array_new();
+    }
+
+    g_ptr_array_set_free_func(ifaces, virNWFilterSnoopIfaceFree);
+    g_ptr_array_set_free_func(stale, virNWFilterSnoopIfaceFree);
 }
 
 static void
@@ -1411,9 +1733,7 @@ virNWFilterDHCPSnoopReq(virNWFilterTechDriver *techdriver,
     bool isnewreq;
     char ifkey[VIR_IFKEY_LEN];
     int tmp;
-    virThread thread;
     virNWFilterVarValue *dhcpsrvrs;
-    bool threadPuts = false;
 
     virNWFilterSnoopIFKeyFMT(ifkey, binding->owneruuid, &binding->mac);
 
@@ -1477,21 +1797,9 @@ virNWFilterDHCPSnoopReq(virNWFilterTechDriver *techdriver,
         goto exit_rem_ifnametokey;
     }
 
-    /* prevent thread from holding req */
+    /* protect req->threadkey */
     virMutexLock(&req->lock);
 
-    if (virThreadCreateFull(&thread, false, virNWFilterDHCPSnoopThread,
-                            "dhcp-snoop", false, req) != 0) {
-        virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("virNWFilterDHCPSnoopReq virThreadCreate failed on interface '%1$s'"),
-                       binding->portdevname);
-        goto exit_snoopreq_unlock;
-    }
-
-    threadPuts = true;
-
-    g_atomic_int_add(&virNWFilterSnoopState.nThreads, 1);
-
     req->threadkey = virNWFilterSnoopActivate(req);
     if (!req->threadkey) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
@@ -1500,6 +1808,9 @@ virNWFilterDHCPSnoopReq(virNWFilterTechDriver *techdriver,
         goto exit_snoopreq_unlock;
     }
 
+    /* a restarted request must not inherit a failure of its previous run */
+    req->jobCompletionStatus = 0;
+
     if (virNWFilterSnoopReqRestore(req) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Restoring of leases failed on interface '%1$s'"),
@@ -1507,23 +1818,14 @@ virNWFilterDHCPSnoopReq(virNWFilterTechDriver *techdriver,
         goto exit_snoop_cancel;
     }
 
-    /* sync with thread */
-    if (virCondWait(&req->threadStatusCond, &req->lock) < 0) {
-        virReportSystemError(errno, "%s",
-                             _("unable to wait on dhcp snoop thread"));
+    if (virNWFilterSnoopEngineAdd(req) < 0)
         goto exit_snoop_cancel;
-    }
-
-    if (req->threadStatus != THREAD_STATUS_OK) {
-        virErrorRestore(&req->threadError);
-        goto exit_snoop_cancel;
-    }
 
     virMutexUnlock(&req->lock);
 
     virMutexUnlock(&virNWFilterSnoopState.snoopLock);
 
-    /* do not 'put' the req -- the thread will do this */
+    /* do not 'put' the req -- the snooping thread will do this */
 
     return 0;
 
@@ -1536,8 +1838,7 @@ virNWFilterDHCPSnoopReq(virNWFilterTechDriver *techdriver,
  exit_snoopunlock:
     virMutexUnlock(&virNWFilterSnoopState.snoopLock);
  exit_snoopreqput:
-    if (!threadPuts)
-        virNWFilterSnoopReqPut(req);
+    virNWFilterSnoopReqPut(req);
 
     return -1;
 }
@@ -1787,19 +2088,6 @@ virNWFilterSnoopLeaseFileLoad(void)
     virNWFilterSnoopLeaseFileRefresh();
 }
 
-/*
- * Wait until all threads have ended.
- */
-static void
-virNWFilterSnoopJoinThreads(void)
-{
-    while (g_atomic_int_get(&virNWFilterSnoopState.nThreads) != 0) {
-        VIR_WARN("Waiting for snooping threads to terminate: %u",
-                 g_atomic_int_get(&virNWFilterSnoopState.nThreads));
-        g_usleep(1000 * 1000);
-    }
-}
-
 /*
  * Iterator to remove a request, repeatedly called on one
  * request after another.
@@ -1837,7 +2125,7 @@ virNWFilterSnoopRemAllReqIter(const void *payload,
 
 
 /*
- * Terminate all threads; keep the SnoopReqs hash allocated
+ * Cancel all requests; keep the SnoopReqs hash allocated
  */
 static void
 virNWFilterSnoopEndThreads(void)
@@ -1865,6 +2153,15 @@ virNWFilterDHCPSnoopInit(void)
         return -1;
     }
 
+    if (virMutexInit(&virNWFilterSnoopState.engineLock) < 0) {
+        virMutexDestroy(&virNWFilterSnoopState.activeLock);
+        virMutexDestroy(&virNWFilterSnoopState.snoopLock);
+        return -1;
+    }
+
+    virNWFilterSnoopState.ifaces = g_hash_table_new(g_direct_hash,
+                                                    g_direct_equal);
+    virNWFilterSnoopState.staleIfaces = g_ptr_array_new();
     virNWFilterSnoopState.ifnameToKey = virHashNew(NULL);
     virNWFilterSnoopState.active = virHashNew(NULL);
     virNWFilterSnoopState.snoopReqs =
@@ -1943,7 +2240,7 @@ virNWFilterDHCPSnoopShutdown(void)
         return;
 
     virNWFilterSnoopEndThreads();
-    virNWFilterSnoopJoinThreads();
+    virNWFilterSnoopEngineStop();
 
     VIR_WITH_MUTEX_LOCK_GUARD(&virNWFilterSnoopState.snoopLock) {
         virNWFilterSnoopLeaseFileClose();
@@ -1958,37 +2255,11 @@ virNWFilterDHCPSnoopShutdown(void)
     }
 
     virMutexDestroy(&virNWFilterSnoopState.activeLock);
-}
-
-#else /* WITH_LIBPCAP */
-
-int
-virNWFilterDHCPSnoopInit(void)
-{
-    VIR_DEBUG("No DHCP snooping support available");
-    return 0;
-}
 
-void
-virNWFilterDHCPSnoopEnd(const char *ifname G_GNUC_UNUSED)
-{
-    return;
-}
-
-void
-virNWFilterDHCPSnoopShutdown(void)
-{
-    return;
-}
+    VIR_WITH_MUTEX_LOCK_GUARD(&virNWFilterSnoopState.engineLock) {
+        g_clear_pointer(&virNWFilterSnoopState.ifaces, g_hash_table_unref);
+        g_clear_pointer(&virNWFilterSnoopState.staleIfaces, g_ptr_array_unref);
+    }
 
-int
-virNWFilterDHCPSnoopReq(virNWFilterTechDriver *techdriver G_GNUC_UNUSED,
-                        virNWFilterBindingDef *binding G_GNUC_UNUSED,
-                        virNWFilterDriverState *driver G_GNUC_UNUSED)
-{
-    virReportError(VIR_ERR_INTERNAL_ERROR,
-                   _("libvirt was not compiled with libpcap and \"%1$s\" requires it"),
-                     NWFILTER_VARNAME_CTRL_IP_LEARNING "='dhcp'");
-    return -1;
+    virMutexDestroy(&virNWFilterSnoopState.engineLock);
 }
-#endif /* WITH_LIBPCAP */
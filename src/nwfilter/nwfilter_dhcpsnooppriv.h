@@ -0,0 +1,50 @@
+/*
+ * nwfilter_dhcpsnooppriv.h: private DHCP snooping header for unit testing
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBVIRT_NWFILTER_DHCPSNOOPPRIV_H_ALLOW
+# error "nwfilter_dhcpsnooppriv.h may only be included by nwfilter_dhcpsnoop.c or test suites"
+#endif /* LIBVIRT_NWFILTER_DHCPSNOOPPRIV_H_ALLOW */
+
+#pragma once
+
+#include "nwfilter_dhcpsnoop.h"
+#include "virmacaddr.h"
+#include "virsocketaddr.h"
+
+typedef struct _virNWFilterSnoopDHCPMsg virNWFilterSnoopDHCPMsg;
+struct _virNWFilterSnoopDHCPMsg {
+    uint8_t mtype;             /* DHCP message type */
+    uint32_t leasetime;        /* lease time in secs */
+    virSocketAddr ipAddress;   /* 'your' IP address */
+    virSocketAddr ipServer;    /* IP address of the server */
+};
+
+bool
+virNWFilterSnoopDHCPMatch(const unsigned char *packet,
+                          size_t len,
+                          bool fromVM,
+                          const virMacAddr *mac)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(4);
+
+int
+virNWFilterSnoopDHCPParse(const unsigned char *packet,
+                          size_t len,
+                          bool fromVM,
+                          const virMacAddr *mac,
+                          virNWFilterSnoopDHCPMsg *msg)
+    ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(4) ATTRIBUTE_NONNULL(5);
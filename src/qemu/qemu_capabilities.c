@@ -799,13 +799,20 @@ struct _virQEMUCapsAccel {
     qemuMonitorCPUDefs *cpuModels;
 };
 
+typedef struct _virQEMUCapsProbeTime virQEMUCapsProbeTime;
+struct _virQEMUCapsProbeTime {
+    char *name;
+    unsigned long long usec;
+};
+
 
 /*
- * Update the XML parser/formatter when adding more
- * information to this struct so that it gets cached
- * correctly. It does not have to be ABI-stable, as
- * the cache will be discarded & repopulated if the
- * timestamp on the libvirtd binary changes.
+ * Update the XML and binary parsers/formatters when
+ * adding more information to this struct so that it
+ * gets cached correctly. It does not have to be
+ * ABI-stable, as the cache will be discarded &
+ * repopulated if the timestamp on the libvirtd binary
+ * changes.
  *
  * And don't forget to update virQEMUCapsNewCopy.
  */
@@ -847,6 +854,12 @@ struct _virQEMUCaps {
     virQEMUCapsAccel hvf;
     virQEMUCapsAccel tcg;
     virQEMUCapsAccel mshv;
+
+    /* Time spent by individual probes of the binary, for diagnostics. Only
+     * recorded when probing an actual QEMU process. */
+    bool recordProbeTimes;
+    size_t nprobeTimes;
+    virQEMUCapsProbeTime *probeTimes;
 };
 
 static virClass *virQEMUCapsClass;
@@ -1253,6 +1266,8 @@ virQEMUCapsInit(virFileCache *cache)
      * so just probe for them all - we gracefully fail
      * if a qemu-system-$ARCH binary can't be found
      */
+    virQEMUCapsCachePrefetch(cache, hostarch);
+
     for (i = 0; i < VIR_ARCH_LAST; i++)
         virQEMUCapsInitGuest(caps, cache, hostarch, i);
 
@@ -2110,6 +2125,13 @@ virQEMUCaps *virQEMUCapsNewCopy(virQEMUCaps *qemuCaps)
 
     ret->hypervCapabilities = virDomainCapsFeatureHypervCopy(qemuCaps->hypervCapabilities);
 
+    ret->probeTimes = g_new0(virQEMUCapsProbeTime, qemuCaps->nprobeTimes);
+    ret->nprobeTimes = qemuCaps->nprobeTimes;
+    for (i = 0; i < qemuCaps->nprobeTimes; i++) {
+        ret->probeTimes[i].name = g_strdup(qemuCaps->probeTimes[i].name);
+        ret->probeTimes[i].usec = qemuCaps->probeTimes[i].usec;
+    }
+
     return g_steal_pointer(&ret);
 }
 
@@ -2132,6 +2154,58 @@ virQEMUCapsAccelClear(virQEMUCapsAccel *caps)
 }
 
 
+static void
+virQEMUCapsProbeTimesClear(virQEMUCaps *qemuCaps)
+{
+    size_t i;
+
+    for (i = 0; i < qemuCaps->nprobeTimes; i++)
+        g_free(qemuCaps->probeTimes[i].name);
+    g_clear_pointer(&qemuCaps->probeTimes, g_free);
+    qemuCaps->nprobeTimes = 0;
+}
+
+
+static void
+virQEMUCapsProbeTimeAdd(virQEMUCaps *qemuCaps,
+                        const char *name,
+                        unsigned long long usec)
+{
+    virQEMUCapsProbeTime probe = { .name = g_strdup(name), .usec = usec };
+
+    VIR_APPEND_ELEMENT(qemuCaps->probeTimes, qemuCaps->nprobeTimes, probe);
+}
+
+
+/**
+ * virQEMUCapsProbeTimeRecord:
+ * @qemuCaps: capabilities being probed
+ * @name: name of the probe which just finished
+ * @start: when the probe started, updated to the current time
+ *
+ * Records how long probe @name took if @qemuCaps are being probed from
+ * a QEMU process.
+ */
+static void
+virQEMUCapsProbeTimeRecord(virQEMUCaps *qemuCaps,
+                           const char *name,
+                           gint64 *start)
+{
+    gint64 now;
+
+    if (!qemuCaps->recordProbeTimes)
+        return;
+
+    now = g_get_monotonic_time();
+
+    VIR_DEBUG("Probe '%s' of '%s' took %lld us",
+              name, qemuCaps->binary, (long long) (now - *start));
+
+    virQEMUCapsProbeTimeAdd(qemuCaps, name, now - *start);
+    *start = now;
+}
+
+
 void virQEMUCapsDispose(void *obj)
 {
     virQEMUCaps *qemuCaps = obj;
@@ -2156,6 +2230,8 @@ void virQEMUCapsDispose(void *obj)
     virQEMUCapsAccelClear(&qemuCaps->hvf);
     virQEMUCapsAccelClear(&qemuCaps->tcg);
     virQEMUCapsAccelClear(&qemuCaps->mshv);
+
+    virQEMUCapsProbeTimesClear(qemuCaps);
 }
 
 void
@@ -4675,6 +4751,35 @@ virQEMUCapsParseSGXInfo(virQEMUCaps *qemuCaps,
 }
 
 
+static int
+virQEMUCapsParseProbeTimes(virQEMUCaps *qemuCaps,
+                           xmlXPathContextPtr ctxt)
+{
+    g_autofree xmlNodePtr *nodes = NULL;
+    int n;
+    size_t i;
+
+    if ((n = virXPathNodeSet("./probeTimes/probe", ctxt, &nodes)) < 0)
+        return -1;
+
+    for (i = 0; i < n; i++) {
+        g_autofree char *name = virXMLPropStringRequired(nodes[i], "name");
+        unsigned long long usec;
+
+        if (!name)
+            return -1;
+
+        if (virXMLPropULongLong(nodes[i], "usec", 10,
+                                VIR_XML_PROP_REQUIRED, &usec) < 0)
+            return -1;
+
+        virQEMUCapsProbeTimeAdd(qemuCaps, name, usec);
+    }
+
+    return 0;
+}
+
+
 static int
 virQEMUCapsParseHypervCapabilities(virQEMUCaps *qemuCaps,
                                    xmlXPathContextPtr ctxt)
@@ -5039,6 +5144,9 @@ virQEMUCapsLoadCache(virArch hostArch,
     if (virXPathBoolean("boolean(./kvmSupportsSecureGuest)", ctxt) > 0)
         qemuCaps->kvmSupportsSecureGuest = true;
 
+    if (virQEMUCapsParseProbeTimes(qemuCaps, ctxt) < 0)
+        return -1;
+
     if (skipInvalidation)
         qemuCaps->invalidation = false;
 
@@ -5416,6 +5524,18 @@ virQEMUCapsFormatCache(virQEMUCaps *qemuCaps)
     if (qemuCaps->kvmSupportsSecureGuest)
         virBufferAddLit(&buf, "<kvmSupportsSecureGuest/>\n");
 
+    if (qemuCaps->nprobeTimes > 0) {
+        virBufferAddLit(&buf, "<probeTimes>\n");
+        virBufferAdjustIndent(&buf, 2);
+        for (i = 0; i < qemuCaps->nprobeTimes; i++) {
+            virBufferAsprintf(&buf, "<probe name='%s' usec='%llu'/>\n",
+                              qemuCaps->probeTimes[i].name,
+                              qemuCaps->probeTimes[i].usec);
+        }
+        virBufferAdjustIndent(&buf, -2);
+        virBufferAddLit(&buf, "</probeTimes>\n");
+    }
+
     virBufferAdjustIndent(&buf, -2);
     virBufferAddLit(&buf, "</qemuCaps>\n");
 
@@ -5449,6 +5569,649 @@ virQEMUCapsSaveFile(void *data,
 }
 
 
+/*
+ * The binary representation of the capabilities cache holds the same data
+ * as the XML one, but loading it doesn't require parsing and evaluating
+ * XPath expressions. It's only ever read by the libvirt build which wrote
+ * it (virFileCache discards it otherwise), so the fields are simply stored
+ * in a fixed order in native byte order. Strings are prefixed with their
+ * length, UINT32_MAX denoting a NULL string.
+ */
+static void
+virQEMUCapsBinaryPutU8(GByteArray *buf,
+                       uint8_t val)
+{
+    g_byte_array_append(buf, &val, sizeof(val));
+}
+
+
+static void
+virQEMUCapsBinaryPutU32(GByteArray *buf,
+                        uint32_t val)
+{
+    g_byte_array_append(buf, (const guint8 *) &val, sizeof(val));
+}
+
+
+static void
+virQEMUCapsBinaryPutU64(GByteArray *buf,
+                        uint64_t val)
+{
+    g_byte_array_append(buf, (const guint8 *) &val, sizeof(val));
+}
+
+
+static void
+virQEMUCapsBinaryPutString(GByteArray *buf,
+                           const char *str)
+{
+    size_t len;
+
+    if (!str) {
+        virQEMUCapsBinaryPutU32(buf, UINT32_MAX);
+        return;
+    }
+
+    len = strlen(str);
+    virQEMUCapsBinaryPutU32(buf, len);
+    g_byte_array_append(buf, (const guint8 *) str, len);
+}
+
+
+static void
+virQEMUCapsBinaryPutStrv(GByteArray *buf,
+                         GStrv strv)
+{
+    size_t i;
+
+    if (!strv) {
+        virQEMUCapsBinaryPutU32(buf, UINT32_MAX);
+        return;
+    }
+
+    virQEMUCapsBinaryPutU32(buf, g_strv_length(strv));
+    for (i = 0; strv[i]; i++)
+        virQEMUCapsBinaryPutString(buf, strv[i]);
+}
+
+
+typedef struct _virQEMUCapsBinaryReader virQEMUCapsBinaryReader;
+struct _virQEMUCapsBinaryReader {
+    const char *data;
+    size_t len;
+    size_t pos;
+    /* set once reading past the end or an invalid value was attempted,
+     * all subsequent reads return zero or NULL */
+    bool error;
+};
+
+
+static void
+virQEMUCapsBinaryGet(virQEMUCapsBinaryReader *reader,
+                     void *val,
+                     size_t size)
+{
+    if (reader->error || size > reader->len - reader->pos) {
+        reader->error = true;
+        memset(val, 0, size);
+        return;
+    }
+
+    memcpy(val, reader->data + reader->pos, size);
+    reader->pos += size;
+}
+
+
+static bool
+virQEMUCapsBinaryGetBool(virQEMUCapsBinaryReader *reader)
+{
+    uint8_t val;
+
+    virQEMUCapsBinaryGet(reader, &val, sizeof(val));
+    return val != 0;
+}
+
+
+static uint32_t
+virQEMUCapsBinaryGetU32(virQEMUCapsBinaryReader *reader)
+{
+    uint32_t val;
+
+    virQEMUCapsBinaryGet(reader, &val, sizeof(val));
+    return val;
+}
+
+
+static uint64_t
+virQEMUCapsBinaryGetU64(virQEMUCapsBinaryReader *reader)
+{
+    uint64_t val;
+
+    virQEMUCapsBinaryGet(reader, &val, sizeof(val));
+    return val;
+}
+
+
+static int
+virQEMUCapsBinaryGetEnum(virQEMUCapsBinaryReader *reader,
+                         unsigned int last)
+{
+    uint32_t val = virQEMUCapsBinaryGetU32(reader);
+
+    if (val >= last) {
+        reader->error = true;
+        return 0;
+    }
+
+    return val;
+}
+
+
+/* Reads the number of elements of an array. Every element takes at least
+ * one byte so a corrupted count can't result in huge allocations. */
+static size_t
+virQEMUCapsBinaryGetCount(virQEMUCapsBinaryReader *reader)
+{
+    uint32_t count = virQEMUCapsBinaryGetU32(reader);
+
+    if (count > reader->len - reader->pos) {
+        reader->error = true;
+        return 0;
+    }
+
+    return count;
+}
+
+
+static char *
+virQEMUCapsBinaryGetString(virQEMUCapsBinaryReader *reader)
+{
+    uint32_t len = virQEMUCapsBinaryGetU32(reader);
+    char *str;
+
+    if (reader->error || len == UINT32_MAX)
+        return NULL;
+
+    if (len > reader->len - reader->pos) {
+        reader->error = true;
+        return NULL;
+    }
+
+    str = g_strndup(reader->data + reader->pos, len);
+    reader->pos += len;
+    return str;
+}
+
+
+static GStrv
+virQEMUCapsBinaryGetStrv(virQEMUCapsBinaryReader *reader)
+{
+    g_auto(GStrv) strv = NULL;
+    uint32_t count = virQEMUCapsBinaryGetU32(reader);
+    size_t i;
+
+    if (reader->error || count == UINT32_MAX)
+        return NULL;
+
+    if (count > reader->len - reader->pos) {
+        reader->error = true;
+        return NULL;
+    }
+
+    strv = g_new0(char *, count + 1);
+    for (i = 0; i < count; i++) {
+        if (!(strv[i] = virQEMUCapsBinaryGetString(reader))) {
+            reader->error = true;
+            return NULL;
+        }
+    }
+
+    return g_steal_pointer(&strv);
+}
+
+
+static void
+virQEMUCapsFormatBinaryHostCPUModelInfo(GByteArray *buf,
+                                        qemuMonitorCPUModelInfo *model)
+{
+    size_t i;
+
+    virQEMUCapsBinaryPutU8(buf, !!model);
+    if (!model)
+        return;
+
+    virQEMUCapsBinaryPutString(buf, model->name);
+    virQEMUCapsBinaryPutU8(buf, model->migratability);
+
+    virQEMUCapsBinaryPutU32(buf, model->nprops);
+    for (i = 0; i < model->nprops; i++) {
+        qemuMonitorCPUProperty *prop = model->props + i;
+
+        virQEMUCapsBinaryPutString(buf, prop->name);
+        virQEMUCapsBinaryPutU32(buf, prop->type);
+
+        switch (prop->type) {
+        case QEMU_MONITOR_CPU_PROPERTY_BOOLEAN:
+            virQEMUCapsBinaryPutU8(buf, prop->value.boolean);
+            break;
+
+        case QEMU_MONITOR_CPU_PROPERTY_STRING:
+            virQEMUCapsBinaryPutString(buf, prop->value.string);
+            break;
+
+        case QEMU_MONITOR_CPU_PROPERTY_NUMBER:
+            virQEMUCapsBinaryPutU64(buf, prop->value.number);
+            break;
+
+        case QEMU_MONITOR_CPU_PROPERTY_LAST:
+            break;
+        }
+
+        virQEMUCapsBinaryPutU32(buf, prop->migratable);
+    }
+
+    virQEMUCapsBinaryPutStrv(buf, model->full_dep_props);
+    virQEMUCapsBinaryPutStrv(buf, model->static_dep_props);
+}
+
+
+static void
+virQEMUCapsLoadBinaryHostCPUModelInfo(virQEMUCapsBinaryReader *reader,
+                                      virQEMUCapsAccel *caps)
+{
+    g_autoptr(qemuMonitorCPUModelInfo) hostCPU = NULL;
+    size_t i;
+
+    if (!virQEMUCapsBinaryGetBool(reader))
+        return;
+
+    hostCPU = g_new0(qemuMonitorCPUModelInfo, 1);
+    hostCPU->name = virQEMUCapsBinaryGetString(reader);
+    hostCPU->migratability = virQEMUCapsBinaryGetBool(reader);
+
+    hostCPU->nprops = virQEMUCapsBinaryGetCount(reader);
+    hostCPU->props = g_new0(qemuMonitorCPUProperty, hostCPU->nprops);
+
+    for (i = 0; i < hostCPU->nprops && !reader->error; i++) {
+        qemuMonitorCPUProperty *prop = hostCPU->props + i;
+
+        prop->name = virQEMUCapsBinaryGetString(reader);
+        prop->type = virQEMUCapsBinaryGetEnum(reader,
+                                              QEMU_MONITOR_CPU_PROPERTY_LAST);
+
+        switch (prop->type) {
+        case QEMU_MONITOR_CPU_PROPERTY_BOOLEAN:
+            prop->value.boolean = virQEMUCapsBinaryGetBool(reader);
+            break;
+
+        case QEMU_MONITOR_CPU_PROPERTY_STRING:
+            prop->value.string = virQEMUCapsBinaryGetString(reader);
+            break;
+
+        case QEMU_MONITOR_CPU_PROPERTY_NUMBER:
+            prop->value.number = virQEMUCapsBinaryGetU64(reader);
+            break;
+
+        case QEMU_MONITOR_CPU_PROPERTY_LAST:
+            break;
+        }
+
+        prop->migratable = virQEMUCapsBinaryGetEnum(reader,
+                                                    VIR_TRISTATE_BOOL_LAST);
+    }
+
+    hostCPU->full_dep_props = virQEMUCapsBinaryGetStrv(reader);
+    hostCPU->static_dep_props = virQEMUCapsBinaryGetStrv(reader);
+
+    caps->hostCPU.info = g_steal_pointer(&hostCPU);
+}
+
+
+static void
+virQEMUCapsFormatBinaryAccel(GByteArray *buf,
+                             virQEMUCapsAccel *caps)
+{
+    size_t ncpus = caps->cpuModels ? caps->cpuModels->ncpus : 0;
+    size_t i;
+
+    virQEMUCapsFormatBinaryHostCPUModelInfo(buf, caps->hostCPU.info);
+
+    virQEMUCapsBinaryPutU32(buf, ncpus);
+    for (i = 0; i < ncpus; i++) {
+        qemuMonitorCPUDefInfo *cpu = caps->cpuModels->cpus + i;
+
+        virQEMUCapsBinaryPutU32(buf, cpu->usable);
+        virQEMUCapsBinaryPutString(buf, cpu->name);
+        virQEMUCapsBinaryPutString(buf, cpu->type);
+        virQEMUCapsBinaryPutStrv(buf, cpu->blockers);
+        virQEMUCapsBinaryPutU8(buf, cpu->deprecated);
+    }
+
+    virQEMUCapsBinaryPutU32(buf, caps->nmachineTypes);
+    for (i = 0; i < caps->nmachineTypes; i++) {
+        virQEMUCapsMachineType *machine = caps->machineTypes + i;
+
+        virQEMUCapsBinaryPutString(buf, machine->name);
+        virQEMUCapsBinaryPutString(buf, machine->alias);
+        virQEMUCapsBinaryPutU32(buf, machine->maxCpus);
+        virQEMUCapsBinaryPutU8(buf, machine->hotplugCpus);
+        virQEMUCapsBinaryPutU8(buf, machine->qemuDefault);
+        virQEMUCapsBinaryPutString(buf, machine->defaultCPU);
+        virQEMUCapsBinaryPutU8(buf, machine->numaMemSupported);
+        virQEMUCapsBinaryPutString(buf, machine->defaultRAMid);
+        virQEMUCapsBinaryPutU8(buf, machine->deprecated);
+        virQEMUCapsBinaryPutU32(buf, machine->acpi);
+    }
+}
+
+
+static void
+virQEMUCapsLoadBinaryAccel(virQEMUCapsBinaryReader *reader,
+                           virQEMUCapsAccel *caps)
+{
+    size_t ncpus;
+    size_t i;
+
+    virQEMUCapsLoadBinaryHostCPUModelInfo(reader, caps);
+
+    if ((ncpus = virQEMUCapsBinaryGetCount(reader)) > 0) {
+        caps->cpuModels = qemuMonitorCPUDefsNew(ncpus);
+
+        for (i = 0; i < ncpus && !reader->error; i++) {
+            qemuMonitorCPUDefInfo *cpu = caps->cpuModels->cpus + i;
+
+            cpu->usable = virQEMUCapsBinaryGetEnum(reader,
+                                                   VIR_DOMCAPS_CPU_USABLE_LAST);
+            cpu->name = virQEMUCapsBinaryGetString(reader);
+            cpu->type = virQEMUCapsBinaryGetString(reader);
+            cpu->blockers = virQEMUCapsBinaryGetStrv(reader);
+            cpu->deprecated = virQEMUCapsBinaryGetBool(reader);
+        }
+    }
+
+    caps->nmachineTypes = virQEMUCapsBinaryGetCount(reader);
+    caps->machineTypes = g_new0(virQEMUCapsMachineType, caps->nmachineTypes);
+
+    for (i = 0; i < caps->nmachineTypes && !reader->error; i++) {
+        virQEMUCapsMachineType *machine = caps->machineTypes + i;
+
+        machine->name = virQEMUCapsBinaryGetString(reader);
+        machine->alias = virQEMUCapsBinaryGetString(reader);
+        machine->maxCpus = virQEMUCapsBinaryGetU32(reader);
+        machine->hotplugCpus = virQEMUCapsBinaryGetBool(reader);
+        machine->qemuDefault = virQEMUCapsBinaryGetBool(reader);
+        machine->defaultCPU = virQEMUCapsBinaryGetString(reader);
+        machine->numaMemSupported = virQEMUCapsBinaryGetBool(reader);
+        machine->defaultRAMid = virQEMUCapsBinaryGetString(reader);
+        machine->deprecated = virQEMUCapsBinaryGetBool(reader);
+        machine->acpi = virQEMUCapsBinaryGetEnum(reader, VIR_TRISTATE_BOOL_LAST);
+    }
+}
+
+
+/**
+ * virQEMUCapsFormatBinaryCache:
+ * @qemuCaps: capabilities to format
+ *
+ * Formats @qemuCaps into the binary representation loaded by
+ * virQEMUCapsLoadBinaryCache. It contains the same data as the XML
+ * formatted by virQEMUCapsFormatCache.
+ *
+ * Returns the binary data or NULL on error.
+ */
+GByteArray *
+virQEMUCapsFormatBinaryCache(virQEMUCaps *qemuCaps)
+{
+    g_autoptr(GByteArray) buf = g_byte_array_new();
+    g_autofree char *cpuData = NULL;
+    ssize_t flag = -1;
+    size_t i;
+
+    if (qemuCaps->cpuData &&
+        !(cpuData = virCPUDataFormat(qemuCaps->cpuData)))
+        return NULL;
+
+    virQEMUCapsBinaryPutString(buf, qemuCaps->binary);
+    virQEMUCapsBinaryPutU64(buf, qemuCaps->ctime);
+    virQEMUCapsBinaryPutU64(buf, qemuCaps->modDirMtime);
+    virQEMUCapsBinaryPutU64(buf, qemuCaps->libvirtCtime);
+    virQEMUCapsBinaryPutU32(buf, qemuCaps->libvirtVersion);
+
+    virQEMUCapsBinaryPutU32(buf, virBitmapCountBits(qemuCaps->flags));
+    while ((flag = virBitmapNextSetBit(qemuCaps->flags, flag)) >= 0)
+        virQEMUCapsBinaryPutU32(buf, flag);
+
+    virQEMUCapsBinaryPutU32(buf, qemuCaps->version);
+    virQEMUCapsBinaryPutU32(buf, qemuCaps->microcodeVersion);
+    virQEMUCapsBinaryPutString(buf, qemuCaps->hostCPUSignature);
+    virQEMUCapsBinaryPutString(buf, qemuCaps->package);
+    virQEMUCapsBinaryPutString(buf, qemuCaps->kernelVersion);
+    virQEMUCapsBinaryPutU32(buf, qemuCaps->arch);
+    virQEMUCapsBinaryPutString(buf, cpuData);
+
+    virQEMUCapsFormatBinaryAccel(buf, &qemuCaps->kvm);
+    virQEMUCapsFormatBinaryAccel(buf, &qemuCaps->hvf);
+    virQEMUCapsFormatBinaryAccel(buf, &qemuCaps->tcg);
+    virQEMUCapsFormatBinaryAccel(buf, &qemuCaps->mshv);
+
+    virQEMUCapsBinaryPutU32(buf, qemuCaps->ngicCapabilities);
+    for (i = 0; i < qemuCaps->ngicCapabilities; i++) {
+        virQEMUCapsBinaryPutU32(buf, qemuCaps->gicCapabilities[i].version);
+        virQEMUCapsBinaryPutU32(buf, qemuCaps->gicCapabilities[i].implementation);
+    }
+
+    virQEMUCapsBinaryPutU8(buf, !!qemuCaps->sevCapabilities);
+    if (qemuCaps->sevCapabilities) {
+        virSEVCapability *sev = qemuCaps->sevCapabilities;
+
+        virQEMUCapsBinaryPutString(buf, sev->pdh);
+        virQEMUCapsBinaryPutString(buf, sev->cert_chain);
+        virQEMUCapsBinaryPutString(buf, sev->cpu0_id);
+        virQEMUCapsBinaryPutU32(buf, sev->cbitpos);
+        virQEMUCapsBinaryPutU32(buf, sev->reduced_phys_bits);
+    }
+
+    virQEMUCapsBinaryPutU8(buf, !!qemuCaps->sgxCapabilities);
+    if (qemuCaps->sgxCapabilities) {
+        virSGXCapability *sgx = qemuCaps->sgxCapabilities;
+
+        virQEMUCapsBinaryPutU8(buf, sgx->flc);
+        virQEMUCapsBinaryPutU8(buf, sgx->sgx1);
+        virQEMUCapsBinaryPutU8(buf, sgx->sgx2);
+        virQEMUCapsBinaryPutU64(buf, sgx->section_size);
+        virQEMUCapsBinaryPutU32(buf, sgx->nSgxSections);
+        for (i = 0; i < sgx->nSgxSections; i++) {
+            virQEMUCapsBinaryPutU64(buf, sgx->sgxSections[i].size);
+            virQEMUCapsBinaryPutU32(buf, sgx->sgxSections[i].node);
+        }
+    }
+
+    virQEMUCapsBinaryPutU8(buf, !!qemuCaps->hypervCapabilities);
+    if (qemuCaps->hypervCapabilities) {
+        virDomainCapsFeatureHyperv *hvcaps = qemuCaps->hypervCapabilities;
+
+        virQEMUCapsBinaryPutU32(buf, hvcaps->supported);
+        virQEMUCapsBinaryPutU8(buf, hvcaps->features.report);
+        virQEMUCapsBinaryPutU32(buf, hvcaps->features.values);
+        virQEMUCapsBinaryPutU32(buf, hvcaps->spinlocks);
+        virQEMUCapsBinaryPutU32(buf, hvcaps->stimer_direct);
+        virQEMUCapsBinaryPutU32(buf, hvcaps->tlbflush_direct);
+        virQEMUCapsBinaryPutU32(buf, hvcaps->tlbflush_extended);
+        virQEMUCapsBinaryPutString(buf, hvcaps->vendor_id);
+    }
+
+    virQEMUCapsBinaryPutU8(buf, qemuCaps->kvmSupportsNesting);
+    virQEMUCapsBinaryPutU8(buf, qemuCaps->kvmSupportsSecureGuest);
+
+    virQEMUCapsBinaryPutU32(buf, qemuCaps->nprobeTimes);
+    for (i = 0; i < qemuCaps->nprobeTimes; i++) {
+        virQEMUCapsBinaryPutString(buf, qemuCaps->probeTimes[i].name);
+        virQEMUCapsBinaryPutU64(buf, qemuCaps->probeTimes[i].usec);
+    }
+
+    return g_steal_pointer(&buf);
+}
+
+
+/**
+ * virQEMUCapsLoadBinaryCache:
+ * @hostArch: host architecture
+ * @qemuCaps: capabilities of the binary to load the data into
+ * @data: binary data formatted by virQEMUCapsFormatBinaryCache
+ * @len: length of @data
+ * @skipInvalidation: don't check whether the data is outdated
+ *
+ * Returns 0 on success, 1 if outdated, -1 on error
+ */
+int
+virQEMUCapsLoadBinaryCache(virArch hostArch,
+                           virQEMUCaps *qemuCaps,
+                           const char *data,
+                           size_t len,
+                           bool skipInvalidation)
+{
+    virQEMUCapsBinaryReader reader = { .data = data, .len = len };
+    g_autofree char *binary = NULL;
+    g_autofree char *cpuData = NULL;
+    size_t nflags;
+    size_t i;
+
+    binary = virQEMUCapsBinaryGetString(&reader);
+    qemuCaps->ctime = virQEMUCapsBinaryGetU64(&reader);
+    qemuCaps->modDirMtime = virQEMUCapsBinaryGetU64(&reader);
+    qemuCaps->libvirtCtime = virQEMUCapsBinaryGetU64(&reader);
+    qemuCaps->libvirtVersion = virQEMUCapsBinaryGetU32(&reader);
+
+    if (reader.error)
+        goto malformed;
+
+    if (!skipInvalidation &&
+        (qemuCaps->libvirtCtime != virGetSelfLastChanged() ||
+         qemuCaps->libvirtVersion != LIBVIR_VERSION_NUMBER)) {
+        VIR_DEBUG("Outdated binary capabilities of %s: libvirt changed "
+                  "(%lld vs %lld, %lu vs %lu), stopping load",
+                  qemuCaps->binary,
+                  (long long)qemuCaps->libvirtCtime,
+                  (long long)virGetSelfLastChanged(),
+                  (unsigned long)qemuCaps->libvirtVersion,
+                  (unsigned long)LIBVIR_VERSION_NUMBER);
+        return 1;
+    }
+
+    if (STRNEQ_NULLABLE(binary, qemuCaps->binary)) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Expected caps for '%1$s' but saw '%2$s'"),
+                       qemuCaps->binary, NULLSTR(binary));
+        return -1;
+    }
+
+    nflags = virQEMUCapsBinaryGetCount(&reader);
+    for (i = 0; i < nflags; i++)
+        virQEMUCapsSet(qemuCaps,
+                       virQEMUCapsBinaryGetEnum(&reader, QEMU_CAPS_LAST));
+
+    qemuCaps->version = virQEMUCapsBinaryGetU32(&reader);
+    qemuCaps->microcodeVersion = virQEMUCapsBinaryGetU32(&reader);
+    qemuCaps->hostCPUSignature = virQEMUCapsBinaryGetString(&reader);
+    qemuCaps->package = virQEMUCapsBinaryGetString(&reader);
+    qemuCaps->kernelVersion = virQEMUCapsBinaryGetString(&reader);
+    qemuCaps->arch = virQEMUCapsBinaryGetEnum(&reader, VIR_ARCH_LAST);
+    cpuData = virQEMUCapsBinaryGetString(&reader);
+
+    virQEMUCapsLoadBinaryAccel(&reader, &qemuCaps->kvm);
+    virQEMUCapsLoadBinaryAccel(&reader, &qemuCaps->hvf);
+    virQEMUCapsLoadBinaryAccel(&reader, &qemuCaps->tcg);
+    virQEMUCapsLoadBinaryAccel(&reader, &qemuCaps->mshv);
+
+    qemuCaps->ngicCapabilities = virQEMUCapsBinaryGetCount(&reader);
+    qemuCaps->gicCapabilities = g_new0(virGICCapability,
+                                       qemuCaps->ngicCapabilities);
+    for (i = 0; i < qemuCaps->ngicCapabilities; i++) {
+        qemuCaps->gicCapabilities[i].version = virQEMUCapsBinaryGetU32(&reader);
+        qemuCaps->gicCapabilities[i].implementation = virQEMUCapsBinaryGetU32(&reader);
+    }
+
+    if (virQEMUCapsBinaryGetBool(&reader)) {
+        virSEVCapability *sev = g_new0(virSEVCapability, 1);
+
+        qemuCaps->sevCapabilities = sev;
+        sev->pdh = virQEMUCapsBinaryGetString(&reader);
+        sev->cert_chain = virQEMUCapsBinaryGetString(&reader);
+        sev->cpu0_id = virQEMUCapsBinaryGetString(&reader);
+        sev->cbitpos = virQEMUCapsBinaryGetU32(&reader);
+        sev->reduced_phys_bits = virQEMUCapsBinaryGetU32(&reader);
+
+        /* not cached, see virQEMUCapsParseSEVInfo */
+        virQEMUCapsGetSEVMaxGuests(sev);
+    }
+
+    if (virQEMUCapsBinaryGetBool(&reader)) {
+        virSGXCapability *sgx = g_new0(virSGXCapability, 1);
+
+        qemuCaps->sgxCapabilities = sgx;
+        sgx->flc = virQEMUCapsBinaryGetBool(&reader);
+        sgx->sgx1 = virQEMUCapsBinaryGetBool(&reader);
+        sgx->sgx2 = virQEMUCapsBinaryGetBool(&reader);
+        sgx->section_size = virQEMUCapsBinaryGetU64(&reader);
+        sgx->nSgxSections = virQEMUCapsBinaryGetCount(&reader);
+        sgx->sgxSections = g_new0(virSGXSection, sgx->nSgxSections);
+        for (i = 0; i < sgx->nSgxSections; i++) {
+            sgx->sgxSections[i].size = virQEMUCapsBinaryGetU64(&reader);
+            sgx->sgxSections[i].node = virQEMUCapsBinaryGetU32(&reader);
+        }
+    }
+
+    if (virQEMUCapsBinaryGetBool(&reader)) {
+        virDomainCapsFeatureHyperv *hvcaps = g_new0(virDomainCapsFeatureHyperv, 1);
+
+        qemuCaps->hypervCapabilities = hvcaps;
+        hvcaps->supported = virQEMUCapsBinaryGetEnum(&reader, VIR_TRISTATE_BOOL_LAST);
+        hvcaps->features.report = virQEMUCapsBinaryGetBool(&reader);
+        hvcaps->features.values = virQEMUCapsBinaryGetU32(&reader);
+        hvcaps->spinlocks = virQEMUCapsBinaryGetU32(&reader);
+        hvcaps->stimer_direct = virQEMUCapsBinaryGetEnum(&reader, VIR_TRISTATE_SWITCH_LAST);
+        hvcaps->tlbflush_direct = virQEMUCapsBinaryGetEnum(&reader, VIR_TRISTATE_SWITCH_LAST);
+        hvcaps->tlbflush_extended = virQEMUCapsBinaryGetEnum(&reader, VIR_TRISTATE_SWITCH_LAST);
+        hvcaps->vendor_id = virQEMUCapsBinaryGetString(&reader);
+    }
+
+    qemuCaps->kvmSupportsNesting = virQEMUCapsBinaryGetBool(&reader);
+    qemuCaps->kvmSupportsSecureGuest = virQEMUCapsBinaryGetBool(&reader);
+
+    qemuCaps->nprobeTimes = virQEMUCapsBinaryGetCount(&reader);
+    qemuCaps->probeTimes = g_new0(virQEMUCapsProbeTime, qemuCaps->nprobeTimes);
+    for (i = 0; i < qemuCaps->nprobeTimes; i++) {
+        qemuCaps->probeTimes[i].name = virQEMUCapsBinaryGetString(&reader);
+        qemuCaps->probeTimes[i].usec = virQEMUCapsBinaryGetU64(&reader);
+    }
+
+    if (reader.error || reader.pos != reader.len)
+        goto malformed;
+
+    if (cpuData && !(qemuCaps->cpuData = virCPUDataParse(cpuData)))
+        return -1;
+
+    if (virQEMUCapsGet(qemuCaps, QEMU_CAPS_KVM))
+        virQEMUCapsInitHostCPUModel(qemuCaps, hostArch, VIR_DOMAIN_VIRT_KVM);
+    if (virQEMUCapsGet(qemuCaps, QEMU_CAPS_HVF))
+        virQEMUCapsInitHostCPUModel(qemuCaps, hostArch, VIR_DOMAIN_VIRT_HVF);
+    if (virQEMUCapsGet(qemuCaps, QEMU_CAPS_MSHV))
+        virQEMUCapsInitHostCPUModel(qemuCaps, hostArch, VIR_DOMAIN_VIRT_HYPERV);
+    virQEMUCapsInitHostCPUModel(qemuCaps, hostArch, VIR_DOMAIN_VIRT_QEMU);
+
+    if (skipInvalidation)
+        qemuCaps->invalidation = false;
+
+    return 0;
+
+ malformed:
+    virReportError(VIR_ERR_INTERNAL_ERROR,
+                   _("malformed binary QEMU capabilities cache for '%1$s'"),
+                   qemuCaps->binary);
+    return -1;
+}
+
+
 /*
  * Check whether IBM Secure Execution (S390) is enabled
  */
@@ -5907,11 +6670,13 @@ virQEMUCapsInitQMPMonitor(virQEMUCaps *qemuCaps,
     g_autofree char *package = NULL;
     virQEMUCapsAccel *accel;
     virDomainVirtType type;
+    gint64 start = g_get_monotonic_time();
 
     /* @mon is supposed to be locked by callee */
 
     if (qemuMonitorGetVersion(mon, &major, &minor, &micro, &package) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "version", &start);
 
     VIR_DEBUG("Got version %d.%d.%d (%s)",
               major, minor, micro, NULLSTR(package));
@@ -5930,12 +6695,14 @@ virQEMUCapsInitQMPMonitor(virQEMUCaps *qemuCaps,
 
     if (virQEMUCapsInitQMPArch(qemuCaps, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "arch", &start);
 
     /* initiate all capabilities based on qemu version */
     virQEMUCapsInitQMPVersionCaps(qemuCaps);
 
     if (virQEMUCapsProbeQMPSchemaCapabilities(qemuCaps, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "schema", &start);
 
     if (virQEMUCapsGet(qemuCaps, QEMU_CAPS_QUERY_ACCELERATORS)) {
         if (virQEMUCapsProbeAccels(qemuCaps, mon) < 0)
@@ -5948,30 +6715,41 @@ virQEMUCapsInitQMPMonitor(virQEMUCaps *qemuCaps,
         if (virQEMUCapsProbeHVF(qemuCaps))
             virQEMUCapsSet(qemuCaps, QEMU_CAPS_HVF);
     }
+    virQEMUCapsProbeTimeRecord(qemuCaps, "accels", &start);
 
     type = virQEMUCapsGetVirtType(qemuCaps);
     accel = virQEMUCapsGetAccel(qemuCaps, type);
 
     if (virQEMUCapsProbeQMPObjectTypes(qemuCaps, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "objectTypes", &start);
     if (virQEMUCapsProbeQMPDeviceProperties(qemuCaps, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "deviceProperties", &start);
     if (virQEMUCapsProbeQMPObjectProperties(qemuCaps, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "objectProperties", &start);
     if (virQEMUCapsProbeQMPMachineTypes(qemuCaps, type, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "machineTypes", &start);
     if (virQEMUCapsProbeQMPMachineProps(qemuCaps, type, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "machineProps", &start);
     if (virQEMUCapsProbeQMPCPUDefinitions(qemuCaps, accel, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "cpuDefinitions", &start);
     if (virQEMUCapsProbeQMPCommandLine(qemuCaps, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "commandLine", &start);
     if (virQEMUCapsProbeQMPGICCapabilities(qemuCaps, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "gic", &start);
     if (virQEMUCapsProbeQMPSEVCapabilities(qemuCaps, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "sev", &start);
     if (virQEMUCapsProbeQMPSGXCapabilities(qemuCaps, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "sgx", &start);
     virQEMUCapsProbeTDXCapabilities(qemuCaps);
 
     virQEMUCapsInitProcessCaps(qemuCaps);
@@ -5981,6 +6759,7 @@ virQEMUCapsInitQMPMonitor(virQEMUCaps *qemuCaps,
 
     if (virQEMUCapsProbeQMPHostCPU(qemuCaps, accel, mon, type) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "hostCPU", &start);
 
     return 0;
 }
@@ -5991,15 +6770,19 @@ virQEMUCapsInitQMPMonitorTCG(virQEMUCaps *qemuCaps,
                              qemuMonitor *mon)
 {
     virQEMUCapsAccel *accel = virQEMUCapsGetAccel(qemuCaps, VIR_DOMAIN_VIRT_QEMU);
+    gint64 start = g_get_monotonic_time();
 
     if (virQEMUCapsProbeQMPCPUDefinitions(qemuCaps, accel, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "tcgCPUDefinitions", &start);
 
     if (virQEMUCapsProbeQMPHostCPU(qemuCaps, accel, mon, VIR_DOMAIN_VIRT_QEMU) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "tcgHostCPU", &start);
 
     if (virQEMUCapsProbeQMPMachineTypes(qemuCaps, VIR_DOMAIN_VIRT_QEMU, mon) < 0)
         return -1;
+    virQEMUCapsProbeTimeRecord(qemuCaps, "tcgMachineTypes", &start);
 
     return 0;
 }
@@ -6033,6 +6816,7 @@ virQEMUCapsInitQMPSingle(virQEMUCaps *qemuCaps,
                          bool onlyTCG)
 {
     g_autoptr(qemuProcessQMP) proc = NULL;
+    gint64 start = g_get_monotonic_time();
     int ret = -1;
 
     if (!(proc = qemuProcessQMPNew(qemuCaps->binary, libDir,
@@ -6042,6 +6826,8 @@ virQEMUCapsInitQMPSingle(virQEMUCaps *qemuCaps,
     if (qemuProcessQMPStart(proc) < 0)
         goto cleanup;
 
+    virQEMUCapsProbeTimeRecord(qemuCaps, onlyTCG ? "tcgStart" : "start", &start);
+
     if (onlyTCG)
         ret = virQEMUCapsInitQMPMonitorTCG(qemuCaps, proc->mon);
     else
@@ -6090,6 +6876,7 @@ virQEMUCapsNewForBinaryInternal(virArch hostArch,
                                 virCPUData* cpuData)
 {
     g_autoptr(virQEMUCaps) qemuCaps = virQEMUCapsNewBinary(binary);
+    gint64 start = g_get_monotonic_time();
     struct stat sb;
 
     /* We would also want to check faccessat if we cared about ACLs,
@@ -6120,9 +6907,16 @@ virQEMUCapsNewForBinaryInternal(virArch hostArch,
         qemuCaps->modDirMtime = sb.st_mtime;
     }
 
+    qemuCaps->recordProbeTimes = true;
+
     if (virQEMUCapsInitQMP(qemuCaps, libDir, runUid, runGid) < 0)
         return NULL;
 
+    qemuCaps->recordProbeTimes = false;
+
+    VIR_INFO("Probed capabilities of '%s' in %lld ms",
+             binary, (long long) (g_get_monotonic_time() - start) / 1000);
+
     qemuCaps->libvirtCtime = virGetSelfLastChanged();
     qemuCaps->libvirtVersion = LIBVIR_VERSION_NUMBER;
 
@@ -6192,12 +6986,46 @@ virQEMUCapsLoadFile(const char *filename,
 }
 
 
+static void *
+virQEMUCapsLoadBinary(const char *buf,
+                      size_t len,
+                      const char *binary,
+                      void *privData,
+                      bool *outdated)
+{
+    g_autoptr(virQEMUCaps) qemuCaps = virQEMUCapsNewBinary(binary);
+    virQEMUCapsCachePriv *priv = privData;
+    int ret;
+
+    ret = virQEMUCapsLoadBinaryCache(priv->hostArch, qemuCaps, buf, len, false);
+    if (ret < 0)
+        return NULL;
+    if (ret == 1) {
+        *outdated = true;
+        return NULL;
+    }
+
+    return g_steal_pointer(&qemuCaps);
+}
+
+
+static GByteArray *
+virQEMUCapsFormatBinary(void *data,
+                        void *privData G_GNUC_UNUSED)
+{
+    return virQEMUCapsFormatBinaryCache(data);
+}
+
+
 virFileCacheHandlers qemuCapsCacheHandlers = {
     .isValid = virQEMUCapsIsValid,
     .newData = virQEMUCapsNewData,
     .loadFile = virQEMUCapsLoadFile,
     .saveFile = virQEMUCapsSaveFile,
     .privFree = virQEMUCapsCachePrivFree,
+    .binaryVersion = 1,
+    .loadBinary = virQEMUCapsLoadBinary,
+    .formatBinary = virQEMUCapsFormatBinary,
 };
 
 
@@ -6259,6 +7087,54 @@ virQEMUCapsCacheLookup(virFileCache *cache,
 }
 
 
+/* Probing a binary mostly waits for QEMU to start and answer, but each
+ * probe runs a QEMU process so their number is limited anyway. */
+#define VIR_QEMU_CAPS_PROBE_MAX_WORKERS 8
+
+/**
+ * virQEMUCapsCachePrefetch:
+ * @cache: QEMU capabilities cache
+ * @hostarch: host architecture
+ *
+ * Makes sure @cache holds up to date capabilities of all QEMU binaries used
+ * for any guest architecture. Binaries which need to be (re)probed are
+ * probed in parallel rather than one after another.
+ */
+void
+virQEMUCapsCachePrefetch(virFileCache *cache,
+                         virArch hostarch)
+{
+    virQEMUCapsCachePriv *priv = virFileCacheGetPriv(cache);
+    g_autoptr(GPtrArray) binaries = g_ptr_array_new_with_free_func(g_free);
+    size_t i;
+
+    for (i = 0; i < VIR_ARCH_LAST; i++) {
+        char *binary = virQEMUCapsGetDefaultEmulator(hostarch, i);
+
+        if (!binary)
+            continue;
+
+        if (g_ptr_array_find_with_equal_func(binaries, binary,
+                                             g_str_equal, NULL)) {
+            g_free(binary);
+            continue;
+        }
+
+        g_ptr_array_add(binaries, binary);
+    }
+
+    if (binaries->len < 2)
+        return;
+
+    g_ptr_array_add(binaries, NULL);
+
+    priv->microcodeVersion = virHostCPUGetMicrocodeVersion(priv->hostArch);
+
+    virFileCachePrefetch(cache, (const char *const *) binaries->pdata,
+                         VIR_QEMU_CAPS_PROBE_MAX_WORKERS);
+}
+
+
 virQEMUCaps *
 virQEMUCapsCacheLookupCopy(virFileCache *cache,
                            const char *binary)
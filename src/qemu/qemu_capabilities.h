@@ -855,6 +855,8 @@ virFileCache *virQEMUCapsCacheNew(const char *libDir,
                                     const char *cacheDir,
                                     uid_t uid,
                                     gid_t gid);
+void virQEMUCapsCachePrefetch(virFileCache *cache,
+                              virArch hostarch);
 virQEMUCaps *virQEMUCapsCacheLookup(virFileCache *cache,
                                       const char *binary);
 virQEMUCaps *virQEMUCapsCacheLookupCopy(virFileCache *cache,
@@ -44,6 +44,13 @@ int virQEMUCapsLoadCache(virArch hostArch,
                          bool skipInvalidation);
 char *virQEMUCapsFormatCache(virQEMUCaps *qemuCaps);
 
+int virQEMUCapsLoadBinaryCache(virArch hostArch,
+                               virQEMUCaps *qemuCaps,
+                               const char *data,
+                               size_t len,
+                               bool skipInvalidation);
+GByteArray *virQEMUCapsFormatBinaryCache(virQEMUCaps *qemuCaps);
+
 int
 virQEMUCapsInitQMPMonitor(virQEMUCaps *qemuCaps,
                           qemuMonitor *mon);
@@ -8917,7 +8917,7 @@ qemuBuildInterfaceCommandLine(virQEMUDriver *driver,
     g_autoptr(virJSONValue) nicprops = NULL;
     g_autofree char *nic = NULL;
     virDomainNetType actualType = virDomainNetGetActualType(net);
-    const virNetDevBandwidth *actualBandwidth;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
     bool requireNicdev = false;
     g_autoptr(virJSONValue) hostnetprops = NULL;
     qemuDomainNetworkPrivate *netpriv = QEMU_DOMAIN_NETWORK_PRIVATE(net);
@@ -9028,29 +9028,8 @@ qemuBuildInterfaceCommandLine(virQEMUDriver *driver,
     qemuDomainInterfaceSetDefaultQDisc(driver, net);
 
     /* Set bandwidth or warn if requested and not supported. */
-    actualBandwidth = virDomainNetGetActualBandwidth(net);
-    if (actualBandwidth) {
-        if (virNetDevSupportsBandwidth(actualType)) {
-            if (virDomainNetDefIsOvsport(net)) {
-                if (virNetDevOpenvswitchInterfaceSetQos(net->ifname, actualBandwidth,
-                                                        def->uuid,
-                                                        !virDomainNetTypeSharesHostView(net)) < 0)
-                    goto cleanup;
-            } else {
-                unsigned int flags = VIR_NETDEV_BANDWIDTH_SET_CLEAR_ALL;
-
-                if (!virDomainNetTypeSharesHostView(net))
-                    flags |= VIR_NETDEV_BANDWIDTH_SET_DIR_SWAPPED;
-
-                if (virNetDevBandwidthSet(net->ifname, actualBandwidth, flags) < 0)
-                    goto cleanup;
-            }
-        } else {
-            VIR_WARN("setting bandwidth on interfaces of "
-                     "type '%s' is not implemented yet",
-                     virDomainNetTypeToString(actualType));
-        }
-    }
+    if (virDomainInterfaceSetQoS(def, net, cfg->bandwidthBackend) < 0)
+        goto cleanup;
 
     if (net->mtu && setBackendMTU && net->managed_tap != VIR_TRISTATE_BOOL_NO &&
         virNetDevSetMTU(net->ifname, net->mtu) < 0)
@@ -286,6 +286,9 @@ virQEMUDriverConfig *virQEMUDriverConfigNew(bool privileged,
 
     cfg->keepAliveInterval = 5;
     cfg->keepAliveCount = 5;
+
+    cfg->domainStatsWorkers = 8;
+    cfg->domainStatsTimeout = 5;
     cfg->seccompSandbox = -1;
 
     cfg->logTimestamp = true;
@@ -924,12 +927,27 @@ static int
 virQEMUDriverConfigLoadDeviceEntry(virQEMUDriverConfig *cfg,
                                    virConf *conf)
 {
+    g_autofree char *bandwidthBackend = NULL;
     bool tmp;
     int rv;
 
     if (virConfGetValueBool(conf, "mac_filter", &cfg->macFilter) < 0)
         return -1;
 
+    if (virConfGetValueString(conf, "bandwidth_backend", &bandwidthBackend) < 0)
+        return -1;
+    if (bandwidthBackend) {
+        int val = virNetDevBandwidthBackendTypeFromString(bandwidthBackend);
+
+        if (val < 0) {
+            virReportError(VIR_ERR_CONFIG_UNSUPPORTED,
+                           _("Unknown bandwidth_backend value %1$s"),
+                           bandwidthBackend);
+            return -1;
+        }
+        cfg->bandwidthBackend = val;
+    }
+
     if (virConfGetValueBool(conf, "relaxed_acs_check", &cfg->relaxedACS) < 0)
         return -1;
     if (virConfGetValueString(conf, "lock_manager", &cfg->lockManagerName) < 0)
@@ -956,6 +974,10 @@ virQEMUDriverConfigLoadRPCEntry(virQEMUDriverConfig *cfg,
         return -1;
     if (virConfGetValueUInt(conf, "keepalive_count", &cfg->keepAliveCount) < 0)
         return -1;
+    if (virConfGetValueUInt(conf, "domain_stats_workers", &cfg->domainStatsWorkers) < 0)
+        return -1;
+    if (virConfGetValueUInt(conf, "domain_stats_timeout", &cfg->domainStatsTimeout) < 0)
+        return -1;
 
     return 0;
 }
@@ -1474,6 +1496,9 @@ virQEMUDriverConfigValidate(virQEMUDriverConfig *cfg)
         return -1;
     }
 
+    if (virNetDevBandwidthCheckBackend(cfg->bandwidthBackend) < 0)
+        return -1;
+
     return 0;
 }
 
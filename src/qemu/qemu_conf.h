@@ -199,6 +199,7 @@ struct _virQEMUDriverConfig {
     char *qemuRdpName;
 
     bool macFilter;
+    virNetDevBandwidthBackend bandwidthBackend;
 
     bool relaxedACS;
     bool vncAllowHostAudio;
@@ -213,6 +214,9 @@ struct _virQEMUDriverConfig {
 
     unsigned int maxQueuedJobs;
 
+    unsigned int domainStatsWorkers;
+    unsigned int domainStatsTimeout;
+
     char **securityDriverNames;
     bool securityDefaultConfined;
     bool securityRequireConfined;
@@ -283,9 +287,21 @@ struct _virQEMUDriver {
     /* Immutable pointer, self-locking APIs */
     virThreadPool *workerPool;
 
+    /* Immutable pointer, self-locking APIs. NULL if parallel collection
+     * of domain stats is disabled */
+    virThreadPool *statsPool;
+
     /* Atomic increment only */
     int lastvmid;
 
+    /* Atomic access only. Number of domains qemuProcessReconnectAll is
+     * still reconnecting to, plus one while it's starting the threads */
+    int reconnectPending;
+
+    /* Immutable value once reconnecting started. Monotonic time in
+     * microseconds when qemuProcessReconnectAll was called */
+    long long reconnectStart;
+
     /* Immutable values */
     bool privileged;
     char *embeddedRoot;
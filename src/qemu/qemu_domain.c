@@ -1884,6 +1884,8 @@ qemuDomainObjPrivateDataClear(qemuDomainObjPrivate *priv)
 {
     g_clear_pointer(&priv->qemuDevices, g_strfreev);
     g_clear_pointer(&priv->cgroup, virCgroupFree);
+    g_clear_pointer(&priv->cpuacctSampler, virCgroupCpuacctSamplerFree);
+    g_clear_pointer(&priv->procSampler, virProcessStatSamplerFree);
     g_clear_pointer(&priv->perf, virPerfFree);
 
     VIR_FREE(priv->machineName);
@@ -1981,6 +1983,8 @@ qemuDomainObjPrivateFree(void *data)
         g_object_unref(priv->eventThread);
     }
 
+    g_clear_pointer(&priv->nsHelper, virProcessNamespaceHelperClose);
+
     if (priv->statsSchema)
         g_clear_pointer(&priv->statsSchema, g_hash_table_destroy);
 
@@ -11262,6 +11266,7 @@ qemuDomainSyncRxFilter(virDomainObj *vm,
 
     if (virDomainNetGetActualType(def) == VIR_DOMAIN_NET_TYPE_NETWORK) {
         const char *brname = virDomainNetGetActualBridgeName(def);
+        g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(priv->driver);
 
         /* For libivrt network connections, set the following TUN/TAP network
          * device attributes to match those of the guest network device:
@@ -11270,7 +11275,8 @@ qemuDomainSyncRxFilter(virDomainObj *vm,
         if (virDomainNetGetActualBandwidth(def) &&
             def->data.network.actual &&
             virNetDevBandwidthUpdateFilter(brname, &guestFilter->mac,
-                                           def->data.network.actual->class_id) < 0)
+                                           def->data.network.actual->class_id,
+                                           cfg->bandwidthBackend) < 0)
             return -1;
     }
 
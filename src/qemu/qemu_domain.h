@@ -24,6 +24,7 @@
 #include <glib-object.h>
 #include "vircgroup.h"
 #include "virperf.h"
+#include "virprocess.h"
 #include "domain_addr.h"
 #include "domain_conf.h"
 #include "domain_logcontext.h"
@@ -111,12 +112,20 @@ struct _qemuDomainObjPrivate {
 
     virEventThread *eventThread;
 
+    /* Runs operations inside the mount namespace of the domain, NULL
+     * if the namespace is disabled or the helper couldn't be started */
+    virProcessNamespaceHelper *nsHelper;
+
     qemuMonitor *mon;
     virDomainChrSourceDef *monConfig;
     bool monError;
     unsigned long long monStart;
     int agentTimeout;
 
+    /* Atomic access only. Number of parallel stats jobs given up by
+     * qemuConnectGetAllDomainStats which still occupy a stats worker */
+    int statsJobsAbandoned;
+
     qemuAgent *agent;
     bool agentError;
 
@@ -160,6 +169,11 @@ struct _qemuDomainObjPrivate {
 
     virCgroup *cgroup;
 
+    /* Keep the files read by the CPU and vCPU bulk stats open between
+     * polls, created on demand while holding the domain lock. */
+    virCgroupCpuacctSampler *cpuacctSampler;
+    virProcessStatSampler *procSampler;
+
     virPerf *perf;
 
     qemuDomainUnpluggingDevice unplug;
@@ -31,6 +31,8 @@
 #include <sys/ioctl.h>
 
 #include "qemu_driver.h"
+#define LIBVIRT_QEMU_DRIVERPRIV_H_ALLOW
+#include "qemu_driverpriv.h"
 #include "qemu_agent.h"
 #include "qemu_alias.h"
 #include "qemu_block.h"
@@ -92,6 +94,7 @@
 #include "virtypedparam.h"
 #include "virbitmap.h"
 #include "virstring.h"
+#include "virstatsstream.h"
 #include "viraccessapicheck.h"
 #include "viraccessapicheckqemu.h"
 #include "virhostdev.h"
@@ -518,6 +521,18 @@ qemuDomainFindMaxID(virDomainObj *vm,
 }
 
 
+static void
+qemuStateInitializePhaseDone(const char *phase,
+                             gint64 *start)
+{
+    gint64 now = g_get_monotonic_time();
+
+    VIR_INFO("Startup phase '%s' took %lld ms",
+             phase, (long long) (now - *start) / 1000);
+    *start = now;
+}
+
+
 /**
  * qemuStateInitialize:
  *
@@ -538,6 +553,7 @@ qemuStateInitialize(bool privileged,
     const char *defsecmodel = NULL;
     g_autoptr(virIdentity) identity = virIdentityGetCurrent();
     virDomainDriverAutoStartConfig autostartCfg;
+    gint64 phaseStart;
 
     qemu_driver = g_new0(virQEMUDriver, 1);
 
@@ -817,6 +833,8 @@ qemuStateInitialize(bool privileged,
         run_gid = cfg->group;
     }
 
+    phaseStart = g_get_monotonic_time();
+
     qemu_driver->qemuCapsCache = virQEMUCapsCacheNew(cfg->libDir,
                                                      cfg->cacheDir,
                                                      run_uid,
@@ -833,6 +851,8 @@ qemuStateInitialize(bool privileged,
 
     qemu_driver->nbdkitCapsCache = qemuNbdkitCapsCacheNew(cfg->cacheDir);
 
+    qemuStateInitializePhaseDone("capabilities", &phaseStart);
+
     /* If hugetlbfs is present, then we need to create a sub-directory within
      * it, since we can't assume the root mount point has permissions that
      * will let our spawned QEMU instances use it. */
@@ -846,6 +866,8 @@ qemuStateInitialize(bool privileged,
                           0, S_IXGRP | S_IXOTH) < 0)
         goto error;
 
+    phaseStart = g_get_monotonic_time();
+
     /* Get all the running persistent or transient configs first */
     if (virDomainObjListLoadAllConfigs(qemu_driver->domains,
                                        cfg->stateDir,
@@ -854,6 +876,8 @@ qemuStateInitialize(bool privileged,
                                        NULL, NULL) < 0)
         goto error;
 
+    qemuStateInitializePhaseDone("status parse", &phaseStart);
+
     /* find the maximum ID from active and transient configs to initialize
      * the driver with. This is to avoid race between autostart and reconnect
      * threads */
@@ -867,6 +891,8 @@ qemuStateInitialize(bool privileged,
                             qemuDomainNetsRestart,
                             NULL);
 
+    phaseStart = g_get_monotonic_time();
+
     /* Then inactive persistent configs */
     if (virDomainObjListLoadAllConfigs(qemu_driver->domains,
                                        cfg->configDir,
@@ -875,6 +901,8 @@ qemuStateInitialize(bool privileged,
                                        NULL, NULL) < 0)
         goto error;
 
+    qemuStateInitializePhaseDone("config parse", &phaseStart);
+
     virDomainObjListForEach(qemu_driver->domains,
                             false,
                             qemuDomainSnapshotLoad,
@@ -900,6 +928,14 @@ qemuStateInitialize(bool privileged,
     if (!qemu_driver->workerPool)
         goto error;
 
+    if (cfg->domainStatsWorkers > 0 &&
+        !(qemu_driver->statsPool = virThreadPoolNewFull(0, cfg->domainStatsWorkers, 0,
+                                                        qemuConnectGetAllDomainStatsWorker,
+                                                        "qemu-stats",
+                                                        identity,
+                                                        qemu_driver)))
+        goto error;
+
     qemuProcessReconnectAll(qemu_driver);
 
     autostartCfg = (virDomainDriverAutoStartConfig) {
@@ -978,6 +1014,8 @@ static int
 qemuStateShutdownPrepare(void)
 {
     virThreadPoolStop(qemu_driver->workerPool);
+    if (qemu_driver->statsPool)
+        virThreadPoolStop(qemu_driver->statsPool);
     return 0;
 }
 
@@ -999,6 +1037,8 @@ qemuStateShutdownWait(void)
     virDomainObjListForEach(qemu_driver->domains, false,
                             qemuDomainObjStopWorkerIter, NULL);
     virThreadPoolDrain(qemu_driver->workerPool);
+    if (qemu_driver->statsPool)
+        virThreadPoolDrain(qemu_driver->statsPool);
     return 0;
 }
 
@@ -1015,6 +1055,7 @@ qemuStateCleanup(void)
         return -1;
 
     virThreadPoolFree(qemu_driver->workerPool);
+    virThreadPoolFree(qemu_driver->statsPool);
     virObjectUnref(qemu_driver->migrationErrors);
     virLockManagerPluginUnref(qemu_driver->lockManager);
     virSysinfoDefFree(qemu_driver->hostsysinfo);
@@ -1273,7 +1314,8 @@ qemuDomainHelperGetVcpus(virDomainObj *vm,
                          unsigned long long *cpudelay,
                          int maxinfo,
                          unsigned char *cpumaps,
-                         int maplen)
+                         int maplen,
+                         virProcessStatSampler *sampler)
 {
     size_t ncpuinfo = 0;
     size_t i;
@@ -1302,13 +1344,23 @@ qemuDomainHelperGetVcpus(virDomainObj *vm,
             continue;
 
         if (info) {
+            int rc;
+
             vcpuinfo->number = i;
             vcpuinfo->state = VIR_VCPU_RUNNING;
 
-            if (virProcessGetStatInfo(&vcpuinfo->cpuTime,
-                                      NULL, NULL,
-                                      &vcpuinfo->cpu, NULL,
-                                      vm->pid, vcpupid) < 0) {
+            if (sampler)
+                rc = virProcessStatSamplerGetStatInfo(sampler, vcpupid,
+                                                      &vcpuinfo->cpuTime,
+                                                      NULL, NULL,
+                                                      &vcpuinfo->cpu);
+            else
+                rc = virProcessGetStatInfo(&vcpuinfo->cpuTime,
+                                           NULL, NULL,
+                                           &vcpuinfo->cpu, NULL,
+                                           vm->pid, vcpupid);
+
+            if (rc < 0) {
                 virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
                                _("cannot get vCPU placement & pCPU time"));
                 return -1;
@@ -1326,13 +1378,25 @@ qemuDomainHelperGetVcpus(virDomainObj *vm,
         }
 
         if (cpuwait) {
-            if (virProcessGetSchedInfo(&(cpuwait[ncpuinfo]), vm->pid, vcpupid) < 0)
-                return -1;
+            if (sampler) {
+                if (virProcessStatSamplerGetSchedInfo(sampler, vcpupid,
+                                                      &(cpuwait[ncpuinfo])) < 0)
+                    return -1;
+            } else {
+                if (virProcessGetSchedInfo(&(cpuwait[ncpuinfo]), vm->pid, vcpupid) < 0)
+                    return -1;
+            }
         }
 
         if (cpudelay) {
-            if (qemuGetSchedstatDelay(&(cpudelay[ncpuinfo]), vm->pid, vcpupid) < 0)
-                return -1;
+            if (sampler) {
+                if (virProcessStatSamplerGetSchedstatDelay(sampler, vcpupid,
+                                                           &(cpudelay[ncpuinfo])) < 0)
+                    return -1;
+            } else {
+                if (qemuGetSchedstatDelay(&(cpudelay[ncpuinfo]), vm->pid, vcpupid) < 0)
+                    return -1;
+            }
         }
 
         ncpuinfo++;
@@ -4669,7 +4733,8 @@ qemuDomainGetVcpus(virDomainPtr dom,
         goto cleanup;
     }
 
-    ret = qemuDomainHelperGetVcpus(vm, info, NULL, NULL, maxinfo, cpumaps, maplen);
+    ret = qemuDomainHelperGetVcpus(vm, info, NULL, NULL, maxinfo, cpumaps, maplen,
+                                   NULL);
 
  cleanup:
     virDomainObjEndAPI(&vm);
@@ -10067,11 +10132,15 @@ qemuDomainSetInterfaceParameters(virDomainPtr dom,
             if (!virDomainNetTypeSharesHostView(net))
                 bwflags |= VIR_NETDEV_BANDWIDTH_SET_DIR_SWAPPED;
 
-            if (virNetDevBandwidthSet(net->ifname, newBandwidth, bwflags) < 0) {
+            if (virNetDevBandwidthSet(net->ifname, newBandwidth,
+                                      cfg->bandwidthBackend,
+                                      bwflags) < 0) {
                 virErrorPtr orig_err;
 
                 virErrorPreserveLast(&orig_err);
-                ignore_value(virNetDevBandwidthSet(net->ifname, net->bandwidth, bwflags));
+                ignore_value(virNetDevBandwidthSet(net->ifname, net->bandwidth,
+                                                   cfg->bandwidthBackend,
+                                                   bwflags));
                 if (net->bandwidth)
                     ignore_value(virDomainNetBandwidthUpdate(net, net->bandwidth));
                 virErrorRestore(&orig_err);
@@ -17024,6 +17093,28 @@ qemuDomainGetStatsCpuCache(virQEMUDriver *driver,
 }
 
 
+/**
+ * qemuDomainGetStatsProcSampler:
+ * @vm: domain object, locked
+ *
+ * Returns the sampler of per-thread statistics of the running @vm,
+ * creating it on first use, or NULL if @vm is not running.
+ */
+static virProcessStatSampler *
+qemuDomainGetStatsProcSampler(virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+
+    if (!virDomainObjIsActive(vm) || vm->pid <= 0)
+        return NULL;
+
+    if (!priv->procSampler)
+        priv->procSampler = virProcessStatSamplerNew(vm->pid);
+
+    return priv->procSampler;
+}
+
+
 static void
 qemuDomainGetStatsCpuCgroup(virDomainObj *dom,
                             virTypedParamList *params)
@@ -17036,6 +17127,28 @@ qemuDomainGetStatsCpuCgroup(virDomainObj *dom,
     if (!priv->cgroup)
         return;
 
+    if (!priv->cpuacctSampler &&
+        !(priv->cpuacctSampler = virCgroupCpuacctSamplerNew(priv->cgroup)))
+        virResetLastError();
+
+    if (priv->cpuacctSampler) {
+        if (virCgroupCpuacctSamplerGet(priv->cpuacctSampler, &cpu_time,
+                                       &user_time, &sys_time) == 0) {
+            virTypedParamListAddULLong(params, cpu_time,
+                                       VIR_DOMAIN_STATS_CPU_TIME);
+            virTypedParamListAddULLong(params, user_time,
+                                       VIR_DOMAIN_STATS_CPU_USER);
+            virTypedParamListAddULLong(params, sys_time,
+                                       VIR_DOMAIN_STATS_CPU_SYSTEM);
+            return;
+        }
+
+        /* The files might have been replaced, e.g. by systemd; start over
+         * next time and let the code below report whatever is available */
+        g_clear_pointer(&priv->cpuacctSampler, virCgroupCpuacctSamplerFree);
+        virResetLastError();
+    }
+
     if (virCgroupGetCpuacctUsage(priv->cgroup, &cpu_time) == 0)
         virTypedParamListAddULLong(params, cpu_time,
                                    VIR_DOMAIN_STATS_CPU_TIME);
@@ -17053,12 +17166,20 @@ static void
 qemuDomainGetStatsCpuProc(virDomainObj *vm,
                           virTypedParamList *params)
 {
+    virProcessStatSampler *sampler = qemuDomainGetStatsProcSampler(vm);
     unsigned long long cpuTime = 0;
     unsigned long long userTime = 0;
     unsigned long long sysTime = 0;
+    int rc;
 
-    if (virProcessGetStatInfo(&cpuTime, &userTime, &sysTime,
-                              NULL, NULL, vm->pid, 0) < 0) {
+    if (sampler)
+        rc = virProcessStatSamplerGetStatInfo(sampler, 0, &cpuTime, &userTime,
+                                              &sysTime, NULL);
+    else
+        rc = virProcessGetStatInfo(&cpuTime, &userTime, &sysTime,
+                                   NULL, NULL, vm->pid, 0);
+
+    if (rc < 0) {
         /* ignore error */
         return;
     }
@@ -17316,6 +17437,7 @@ qemuDomainGetStatsVcpu(virQEMUDriver *driver G_GNUC_UNUSED,
     g_autofree unsigned long long *cpuwait = NULL;
     g_autofree unsigned long long *cpudelay = NULL;
     qemuDomainObjPrivate *priv = dom->privateData;
+    virProcessStatSampler *sampler = qemuDomainGetStatsProcSampler(dom);
     g_autoptr(virJSONValue) queried_stats = NULL;
 
     virTypedParamListAddUInt(params, virDomainDefGetVcpus(dom->def),
@@ -17336,11 +17458,15 @@ qemuDomainGetStatsVcpu(virQEMUDriver *driver G_GNUC_UNUSED,
 
     if (qemuDomainHelperGetVcpus(dom, cpuinfo, cpuwait, cpudelay,
                                  virDomainDefGetVcpus(dom->def),
-                                 NULL, 0) < 0) {
+                                 NULL, 0, sampler) < 0) {
         virResetLastError();
         return;
     }
 
+    /* drop files of vCPU threads which went away since the last poll */
+    if (sampler)
+        virProcessStatSamplerSweep(sampler);
+
     if (HAVE_JOB(privflags) && qemuDomainRefreshStatsSchema(dom) == 0) {
         qemuDomainObjEnterMonitor(dom);
         queried_stats = qemuMonitorQueryStats(priv->mon,
@@ -18243,6 +18369,475 @@ qemuDomainGetStats(virConnectPtr conn,
 }
 
 
+/* Collects stats of a single domain. @vm must be locked. If @jobTimeout
+ * is non-zero, the domain job is waited for at most @jobTimeout ms. */
+static int
+qemuConnectGetAllDomainStatsOne(virConnectPtr conn,
+                                virDomainObj *vm,
+                                unsigned int stats,
+                                virDomainStatsRecordPtr *record,
+                                unsigned long long jobTimeout,
+                                unsigned int flags)
+{
+    unsigned int privflags = 0;
+    unsigned int domflags = 0;
+    int rc;
+
+    if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING)
+        domflags |= QEMU_DOMAIN_STATS_BACKING;
+
+    if (qemuDomainGetStatsNeedMonitor(stats))
+        privflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+
+    if (HAVE_JOB(privflags)) {
+        int rv;
+
+        if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT)
+            rv = virDomainObjBeginJobNowait(vm, VIR_JOB_QUERY);
+        else if (jobTimeout)
+            rv = virDomainObjBeginJobTimeout(vm, VIR_JOB_QUERY, jobTimeout);
+        else
+            rv = virDomainObjBeginJob(vm, VIR_JOB_QUERY);
+
+        if (rv == 0)
+            domflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+    }
+    /* else: without a job it's still possible to gather some data */
+
+    rc = qemuDomainGetStats(conn, vm, stats, record, domflags);
+
+    if (HAVE_JOB(domflags))
+        virDomainObjEndJob(vm);
+
+    return rc;
+}
+
+
+static void
+qemuDomainStatsRecordFree(virDomainStatsRecordPtr record)
+{
+    if (!record)
+        return;
+
+    virTypedParamsFree(record->params, record->nparams);
+    virObjectUnref(record->dom);
+    g_free(record);
+}
+
+
+/*
+ * Parallel collection of domain stats: every domain is collected by a job
+ * in driver->statsPool. A job which doesn't finish within the time limit
+ * after a worker picked it up is abandoned by the caller and freed by the
+ * worker once it finishes. The worker waits for the domain job only until
+ * the same limit, so an abandoned job occupies the worker for longer only
+ * if it is stuck talking to QEMU. Domains with such a job are not queued
+ * again until it finishes.
+ */
+typedef struct _qemuDomainStatsBatch qemuDomainStatsBatch;
+struct _qemuDomainStatsBatch {
+    virObjectLockable parent;
+
+    virCond cond;
+    virConnectPtr conn;
+    unsigned int flags;
+    unsigned long long timeout; /* per domain limit in ms, 0 if unlimited */
+
+    /* protected by the lock */
+    unsigned long long progress; /* when a job last started or finished */
+};
+
+typedef struct _qemuDomainStatsJob qemuDomainStatsJob;
+struct _qemuDomainStatsJob {
+    qemuDomainStatsBatch *batch;
+    virDomainObj *vm;
+    char *name; /* copied when queued as @vm is used unlocked */
+    unsigned int stats;
+
+    /* the following are protected by the batch lock */
+    unsigned long long started; /* when a worker picked the job up */
+    bool done;
+    bool abandoned;
+    int rc;
+    virErrorPtr err;
+    virDomainStatsRecordPtr record;
+};
+
+static virClass *qemuDomainStatsBatchClass;
+
+static void
+qemuDomainStatsBatchDispose(void *obj)
+{
+    qemuDomainStatsBatch *batch = obj;
+
+    virCondDestroy(&batch->cond);
+    virObjectUnref(batch->conn);
+}
+
+static int
+qemuDomainStatsBatchOnceInit(void)
+{
+    if (!VIR_CLASS_NEW(qemuDomainStatsBatch, virClassForObjectLockable()))
+        return -1;
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(qemuDomainStatsBatch);
+
+
+static qemuDomainStatsBatch *
+qemuDomainStatsBatchNew(virConnectPtr conn,
+                        unsigned int flags)
+{
+    qemuDomainStatsBatch *batch;
+
+    if (qemuDomainStatsBatchInitialize() < 0)
+        return NULL;
+
+    if (!(batch = virObjectLockableNew(qemuDomainStatsBatchClass)))
+        return NULL;
+
+    if (virCondInit(&batch->cond) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot initialize condition"));
+        virObjectUnref(batch);
+        return NULL;
+    }
+
+    batch->conn = virObjectRef(conn);
+    batch->flags = flags;
+
+    return batch;
+}
+
+
+static void
+qemuDomainStatsJobFree(qemuDomainStatsJob *job)
+{
+    if (!job)
+        return;
+
+    qemuDomainStatsRecordFree(job->record);
+    virFreeError(job->err);
+    virObjectUnref(job->vm);
+    virObjectUnref(job->batch);
+    g_free(job->name);
+    g_free(job);
+}
+
+
+/* Gives up waiting for @job. The batch of @job must be locked. */
+static void
+qemuDomainStatsJobAbandon(qemuDomainStatsJob *job)
+{
+    qemuDomainObjPrivate *priv = job->vm->privateData;
+
+    VIR_WARN("Stats of domain '%s' were not collected in time", job->name);
+
+    job->abandoned = true;
+    g_atomic_int_inc(&priv->statsJobsAbandoned);
+}
+
+
+void
+qemuConnectGetAllDomainStatsWorker(void *data,
+                                   void *opaque G_GNUC_UNUSED)
+{
+    qemuDomainStatsJob *job = data;
+    qemuDomainStatsBatch *batch = job->batch;
+    qemuDomainObjPrivate *priv = job->vm->privateData;
+    virDomainStatsRecordPtr record = NULL;
+    virErrorPtr err = NULL;
+    unsigned long long now = 0;
+    bool abandoned;
+    int rc = 0;
+
+    ignore_value(virTimeMillisNow(&now));
+
+    virObjectLock(batch);
+    if (!(abandoned = job->abandoned))
+        job->started = batch->progress = now;
+    virObjectUnlock(batch);
+
+    /* don't bother collecting stats nobody is waiting for anymore */
+    if (!abandoned) {
+        virObjectLock(job->vm);
+        rc = qemuConnectGetAllDomainStatsOne(batch->conn, job->vm, job->stats,
+                                             &record, batch->timeout,
+                                             batch->flags);
+        virObjectUnlock(job->vm);
+
+        if (rc < 0)
+            virErrorPreserveLast(&err);
+    }
+
+    virObjectLock(batch);
+    if (!(abandoned = job->abandoned)) {
+        job->rc = rc;
+        job->record = g_steal_pointer(&record);
+        job->err = g_steal_pointer(&err);
+        job->done = true;
+        ignore_value(virTimeMillisNow(&batch->progress));
+    }
+    virCondSignal(&batch->cond);
+    virObjectUnlock(batch);
+
+    if (abandoned) {
+        g_atomic_int_add(&priv->statsJobsAbandoned, -1);
+        qemuDomainStatsRecordFree(record);
+        virFreeError(err);
+        qemuDomainStatsJobFree(job);
+    }
+}
+
+
+/**
+ * qemuConnectGetAllDomainStatsParallel:
+ *
+ * Collects stats of @vms using the stats thread pool. @stats contains the
+ * stats groups requested for each of the domains. Records are stored into
+ * @records in the order of @vms. Domains which didn't provide their stats
+ * within the configured time limit since a worker picked them up, or whose
+ * job wasn't picked up because all workers were stuck for that long, get a
+ * record containing only the stats not requiring a job.
+ *
+ * Returns the number of records on success, -1 on error.
+ */
+int
+qemuConnectGetAllDomainStatsParallel(virConnectPtr conn,
+                                     virDomainObj **vms,
+                                     unsigned int *stats,
+                                     size_t nvms,
+                                     virDomainStatsRecordPtr *records,
+                                     unsigned int flags)
+{
+    virQEMUDriver *driver = conn->privateData;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
+    g_autofree qemuDomainStatsJob **jobs = g_new0(qemuDomainStatsJob *, nvms);
+    g_autofree bool *timedout = g_new0(bool, nvms);
+    qemuDomainStatsBatch *batch = NULL;
+    int nrecords = 0;
+    size_t i;
+    int ret = -1;
+
+    if (!(batch = qemuDomainStatsBatchNew(conn, flags)))
+        return -1;
+
+    batch->timeout = cfg->domainStatsTimeout * 1000ull;
+
+    if (virTimeMillisNow(&batch->progress) < 0)
+        goto cleanup;
+
+    for (i = 0; i < nvms; i++) {
+        qemuDomainObjPrivate *priv = vms[i]->privateData;
+        qemuDomainStatsJob *job;
+        g_autofree char *name = NULL;
+
+        VIR_WITH_OBJECT_LOCK_GUARD(vms[i]) {
+            name = g_strdup(vms[i]->def->name);
+        }
+
+        /* don't let a hung domain occupy more than one worker */
+        if (g_atomic_int_get(&priv->statsJobsAbandoned) > 0) {
+            VIR_DEBUG("Stats of domain '%s' are still collected by an abandoned job",
+                      name);
+            timedout[i] = true;
+            continue;
+        }
+
+        job = g_new0(qemuDomainStatsJob, 1);
+        job->batch = virObjectRef(batch);
+        job->vm = virObjectRef(vms[i]);
+        job->name = g_steal_pointer(&name);
+        job->stats = stats[i];
+        jobs[i] = job;
+
+        /* the pool is stopped on daemon shutdown, collect inline then */
+        if (virThreadPoolSendJob(driver->statsPool, 0, job) < 0) {
+            virResetLastError();
+            qemuConnectGetAllDomainStatsWorker(job, driver);
+        }
+    }
+
+    virObjectLock(batch);
+
+    while (true) {
+        unsigned long long now;
+        unsigned long long deadline = 0;
+        bool waiting = false;
+        int rc;
+
+        if (virTimeMillisNow(&now) < 0)
+            break;
+
+        for (i = 0; i < nvms; i++) {
+            qemuDomainStatsJob *job = jobs[i];
+            unsigned long long jobDeadline;
+
+            if (!job || job->done)
+                continue;
+
+            if (batch->timeout) {
+                /* A job still in the queue is given up once no job has
+                 * started or finished for the whole limit, i.e. when all
+                 * workers are stuck. */
+                jobDeadline = batch->timeout;
+                jobDeadline += job->started ? job->started : batch->progress;
+
+                if (jobDeadline <= now) {
+                    qemuDomainStatsJobAbandon(job);
+                    jobs[i] = NULL;
+                    timedout[i] = true;
+                    continue;
+                }
+
+                if (!deadline || jobDeadline < deadline)
+                    deadline = jobDeadline;
+            }
+
+            waiting = true;
+        }
+
+        if (!waiting)
+            break;
+
+        if (deadline)
+            rc = virCondWaitUntil(&batch->cond, &batch->parent.lock, deadline);
+        else
+            rc = virCondWait(&batch->cond, &batch->parent.lock);
+
+        if (rc < 0 && errno != ETIMEDOUT) {
+            VIR_WARN("Failed to wait for domain stats: %s", g_strerror(errno));
+            break;
+        }
+    }
+
+    /* give up the remaining jobs if waiting failed */
+    for (i = 0; i < nvms; i++) {
+        if (jobs[i] && !jobs[i]->done) {
+            qemuDomainStatsJobAbandon(jobs[i]);
+            jobs[i] = NULL;
+            timedout[i] = true;
+        }
+    }
+
+    virObjectUnlock(batch);
+
+    for (i = 0; i < nvms; i++) {
+        virDomainStatsRecordPtr record = NULL;
+
+        if (timedout[i]) {
+            int rc;
+
+            virObjectLock(vms[i]);
+            rc = qemuDomainGetStats(conn, vms[i], stats[i], &record,
+                                    (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING) ?
+                                    QEMU_DOMAIN_STATS_BACKING : 0);
+            virObjectUnlock(vms[i]);
+
+            if (rc < 0)
+                goto cleanup;
+        } else {
+            if (jobs[i]->rc < 0) {
+                virErrorRestore(&jobs[i]->err);
+                goto cleanup;
+            }
+
+            record = g_steal_pointer(&jobs[i]->record);
+        }
+
+        records[nrecords++] = record;
+    }
+
+    ret = nrecords;
+
+ cleanup:
+    for (i = 0; i < nvms; i++)
+        qemuDomainStatsJobFree(jobs[i]);
+    virObjectUnref(batch);
+    return ret;
+}
+
+
+/**
+ * qemuConnectGetAllDomainStatsCollect:
+ * @conn: connection
+ * @vms: list of unlocked domain objects to gather stats for
+ * @nvms: number of elements in @vms
+ * @stats: requested stats groups
+ * @retStats: filled with the NULL terminated list of records
+ * @flags: VIR_CONNECT_GET_ALL_DOMAINS_STATS_* flags
+ *
+ * Gathers the requested stats for all of @vms. Returns the number of
+ * records stored in @retStats or -1 on error.
+ */
+static int
+qemuConnectGetAllDomainStatsCollect(virConnectPtr conn,
+                                    virDomainObj **vms,
+                                    size_t nvms,
+                                    unsigned int stats,
+                                    virDomainStatsRecordPtr **retStats,
+                                    unsigned int flags)
+{
+    virQEMUDriver *driver = conn->privateData;
+    virDomainStatsRecordPtr *tmpstats = NULL;
+    g_autofree unsigned int *requestedStats = NULL;
+    bool enforce = !!(flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS);
+    int nstats = 0;
+    size_t i;
+    int ret = -1;
+
+    tmpstats = g_new0(virDomainStatsRecordPtr, nvms + 1);
+    requestedStats = g_new0(unsigned int, nvms);
+
+    for (i = 0; i < nvms; i++) {
+        virDomainObj *vm = vms[i];
+        int rc;
+
+        requestedStats[i] = stats;
+
+        virObjectLock(vm);
+
+        if (qemuDomainGetStatsCheckSupport(&requestedStats[i], enforce, vm) < 0) {
+            virObjectUnlock(vm);
+            goto cleanup;
+        }
+
+        /* in parallel mode only the supported stats are checked upfront */
+        if ((flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_PARALLEL) &&
+            driver->statsPool) {
+            virObjectUnlock(vm);
+            continue;
+        }
+
+        rc = qemuConnectGetAllDomainStatsOne(conn, vm, requestedStats[i],
+                                             &tmpstats[nstats], 0, flags);
+
+        virObjectUnlock(vm);
+
+        if (rc < 0)
+            goto cleanup;
+
+        nstats++;
+    }
+
+    if ((flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_PARALLEL) &&
+        driver->statsPool &&
+        (nstats = qemuConnectGetAllDomainStatsParallel(conn, vms, requestedStats,
+                                                       nvms, tmpstats, flags)) < 0)
+        goto cleanup;
+
+    *retStats = g_steal_pointer(&tmpstats);
+
+    ret = nstats;
+
+ cleanup:
+    virDomainStatsRecordListFree(tmpstats);
+    return ret;
+}
+
+
 static int
 qemuConnectGetAllDomainStats(virConnectPtr conn,
                              virDomainPtr *doms,
@@ -18255,10 +18850,6 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
     virErrorPtr orig_err = NULL;
     virDomainObj **vms = NULL;
     size_t nvms;
-    virDomainStatsRecordPtr *tmpstats = NULL;
-    bool enforce = !!(flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS);
-    int nstats = 0;
-    size_t i;
     int ret = -1;
     unsigned int lflags = flags & (VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
                                    VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
@@ -18267,6 +18858,7 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
     virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
                   VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
                   VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_PARALLEL |
                   VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT |
                   VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING |
                   VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS, -1);
@@ -18285,62 +18877,139 @@ qemuConnectGetAllDomainStats(virConnectPtr conn,
                                 lflags);
     }
 
-    tmpstats = g_new0(virDomainStatsRecordPtr, nvms + 1);
+    ret = qemuConnectGetAllDomainStatsCollect(conn, vms, nvms, stats,
+                                              retStats, flags);
 
-    for (i = 0; i < nvms; i++) {
-        virDomainObj *vm = vms[i];
-        virDomainStatsRecordPtr tmp = NULL;
-        unsigned int privflags = 0;
-        unsigned int requestedStats = stats;
-        unsigned int domflags = 0;
-        int rc;
+    virErrorPreserveLast(&orig_err);
+    virObjectListFreeCount(vms, nvms);
+    virErrorRestore(&orig_err);
 
-        if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING)
-            domflags |= QEMU_DOMAIN_STATS_BACKING;
+    return ret;
+}
 
-        virObjectLock(vm);
 
-        if (qemuDomainGetStatsCheckSupport(&requestedStats, enforce, vm) < 0) {
-            virObjectUnlock(vm);
+typedef struct _qemuDomainStatsStreamData qemuDomainStatsStreamData;
+struct _qemuDomainStatsStreamData {
+    virDomainStatsRecordPtr *records;
+    int nrecords;
+    int fd;
+};
+
+
+/**
+ * qemuConnectGetAllDomainStatsStreamWriter:
+ * @opaque: qemuDomainStatsStreamData
+ *
+ * Encodes the gathered records one by one into the write end of the pipe
+ * backing the stream. The fdstream I/O thread passes the data on to the
+ * client while further records are encoded. A failure only closes the
+ * pipe early, which the client detects as a truncated stream.
+ */
+static void
+qemuConnectGetAllDomainStatsStreamWriter(void *opaque)
+{
+    qemuDomainStatsStreamData *data = opaque;
+    g_autoptr(virStatsStreamEncoder) enc = virStatsStreamEncoderNew();
+    g_autoptr(GByteArray) tail = NULL;
+    size_t i;
+
+    for (i = 0; i < data->nrecords; i++) {
+        virDomainPtr dom = data->records[i]->dom;
+
+        if (virStatsStreamEncoderAddRecord(enc, dom->name, dom->uuid, dom->id,
+                                           data->records[i]->params,
+                                           data->records[i]->nparams) < 0 ||
+            virStatsStreamEncoderFlush(enc, data->fd) < 0)
             goto cleanup;
-        }
+    }
 
-        if (qemuDomainGetStatsNeedMonitor(requestedStats))
-            privflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
+    tail = virStatsStreamEncoderFinish(enc);
 
-        if (HAVE_JOB(privflags)) {
-            int rv;
+    if (safewrite(data->fd, tail->data, tail->len) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to write domain statistics"));
+        goto cleanup;
+    }
 
-            if (flags & VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT)
-                rv = virDomainObjBeginJobNowait(vm, VIR_JOB_QUERY);
-            else
-                rv = virDomainObjBeginJob(vm, VIR_JOB_QUERY);
+ cleanup:
+    if (virGetLastErrorCode() != VIR_ERR_OK)
+        VIR_WARN("Unable to stream domain statistics: %s",
+                 virGetLastErrorMessage());
+    VIR_FORCE_CLOSE(data->fd);
+    virDomainStatsRecordListFree(data->records);
+    g_free(data);
+}
 
-            if (rv == 0)
-                domflags |= QEMU_DOMAIN_STATS_HAVE_JOB;
-        }
-        /* else: without a job it's still possible to gather some data */
 
-        rc = qemuDomainGetStats(conn, vm, requestedStats, &tmp, domflags);
+static int
+qemuConnectGetAllDomainStatsStream(virConnectPtr conn,
+                                   virStreamPtr st,
+                                   unsigned int stats,
+                                   unsigned int flags)
+{
+    virQEMUDriver *driver = conn->privateData;
+    g_autofree qemuDomainStatsStreamData *data = NULL;
+    virErrorPtr orig_err = NULL;
+    virDomainObj **vms = NULL;
+    size_t nvms;
+    virDomainStatsRecordPtr *records = NULL;
+    int nrecords;
+    int pipefd[2] = { -1, -1 };
+    virThread thread;
+    int ret = -1;
+    unsigned int lflags = flags & (VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
+                                   VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
+                                   VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE);
 
-        if (HAVE_JOB(domflags))
-            virDomainObjEndJob(vm);
+    virCheckFlags(VIR_CONNECT_LIST_DOMAINS_FILTERS_ACTIVE |
+                  VIR_CONNECT_LIST_DOMAINS_FILTERS_PERSISTENT |
+                  VIR_CONNECT_LIST_DOMAINS_FILTERS_STATE |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_PARALLEL |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_NOWAIT |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_BACKING |
+                  VIR_CONNECT_GET_ALL_DOMAINS_STATS_ENFORCE_STATS, -1);
 
-        virObjectUnlock(vm);
+    if (virConnectGetAllDomainStatsStreamEnsureACL(conn) < 0)
+        return -1;
 
-        if (rc < 0)
-            goto cleanup;
+    virDomainObjListCollect(driver->domains, conn, &vms, &nvms,
+                            virConnectGetAllDomainStatsStreamCheckACL,
+                            lflags);
 
-        tmpstats[nstats++] = tmp;
-    }
+    if ((nrecords = qemuConnectGetAllDomainStatsCollect(conn, vms, nvms, stats,
+                                                        &records, flags)) < 0)
+        goto cleanup;
 
-    *retStats = g_steal_pointer(&tmpstats);
+    if (virPipe(pipefd) < 0)
+        goto cleanup;
 
-    ret = nstats;
+    if (virFDStreamOpen(st, pipefd[0]) < 0)
+        goto cleanup;
+    pipefd[0] = -1; /* 'st' owns the FD now & will close it */
+
+    data = g_new0(qemuDomainStatsStreamData, 1);
+    data->records = g_steal_pointer(&records);
+    data->nrecords = nrecords;
+    data->fd = pipefd[1];
+
+    if (virThreadCreateFull(&thread, false,
+                            qemuConnectGetAllDomainStatsStreamWriter,
+                            "qemu-stats-stream", false, data) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to create domain statistics writer"));
+        records = g_steal_pointer(&data->records);
+        goto cleanup;
+    }
+    pipefd[1] = -1;
+    data = NULL;
+
+    ret = 0;
 
  cleanup:
     virErrorPreserveLast(&orig_err);
-    virDomainStatsRecordListFree(tmpstats);
+    VIR_FORCE_CLOSE(pipefd[0]);
+    VIR_FORCE_CLOSE(pipefd[1]);
+    virDomainStatsRecordListFree(records);
     virObjectListFreeCount(vms, nvms);
     virErrorRestore(&orig_err);
 
@@ -20817,6 +21486,7 @@ static virHypervisorDriver qemuHypervisorDriver = {
     .domainSetAutostartOnce = qemuDomainSetAutostartOnce, /* 11.2.0 */
     .domainSetThrottleGroup = qemuDomainSetThrottleGroup, /* 11.2.0 */
     .domainDelThrottleGroup = qemuDomainDelThrottleGroup, /* 11.2.0 */
+    .connectGetAllDomainStatsStream = qemuConnectGetAllDomainStatsStream, /* 12.1.0 */
 };
 
 
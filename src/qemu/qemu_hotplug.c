@@ -1190,7 +1190,6 @@ qemuDomainAttachNetDevice(virQEMUDriver *driver,
     bool iface_connected = false;
     bool adjustmemlock = false;
     virDomainNetType actualType;
-    const virNetDevBandwidth *actualBandwidth;
     g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
     virDomainCCWAddressSet *ccwaddrs = NULL;
     g_autofree char *charDevAlias = NULL;
@@ -1360,29 +1359,8 @@ qemuDomainAttachNetDevice(virQEMUDriver *driver,
     qemuDomainInterfaceSetDefaultQDisc(driver, net);
 
     /* Set bandwidth or warn if requested and not supported. */
-    actualBandwidth = virDomainNetGetActualBandwidth(net);
-    if (actualBandwidth) {
-        if (virNetDevSupportsBandwidth(actualType)) {
-            if (virDomainNetDefIsOvsport(net)) {
-                if (virNetDevOpenvswitchInterfaceSetQos(net->ifname, actualBandwidth,
-                                                        vm->def->uuid,
-                                                        !virDomainNetTypeSharesHostView(net)) < 0)
-                    goto cleanup;
-            } else {
-                int flags = VIR_NETDEV_BANDWIDTH_SET_CLEAR_ALL;
-
-                if (!virDomainNetTypeSharesHostView(net))
-                    flags |= VIR_NETDEV_BANDWIDTH_SET_DIR_SWAPPED;
-
-                if (virNetDevBandwidthSet(net->ifname, actualBandwidth, flags) < 0)
-                    goto cleanup;
-            }
-        } else {
-            VIR_WARN("setting bandwidth on interfaces of "
-                     "type '%s' is not implemented yet",
-                     virDomainNetTypeToString(actualType));
-        }
-    }
+    if (virDomainInterfaceSetQoS(vm->def, net, cfg->bandwidthBackend) < 0)
+        goto cleanup;
 
     if (net->mtu && net->managed_tap != VIR_TRISTATE_BOOL_NO &&
         virNetDevSetMTU(net->ifname, net->mtu) < 0)
@@ -3743,6 +3721,7 @@ qemuDomainChangeNet(virQEMUDriver *driver,
                     virDomainDeviceDef *dev)
 {
     qemuDomainObjPrivate *priv = vm->privateData;
+    g_autoptr(virQEMUDriverConfig) cfg = virQEMUDriverGetConfig(driver);
     virDomainNetDef *newdev = dev->data.net;
     virDomainNetDef **devslot = NULL;
     virDomainNetDef *olddev;
@@ -4247,11 +4226,14 @@ qemuDomainChangeNet(virQEMUDriver *driver,
                 if (!virDomainNetTypeSharesHostView(newdev))
                     flags |= VIR_NETDEV_BANDWIDTH_SET_DIR_SWAPPED;
 
-                if (virNetDevBandwidthSet(newdev->ifname, newb, flags) < 0)
+                if (virNetDevBandwidthSet(newdev->ifname, newb,
+                                          cfg->bandwidthBackend,
+                                          flags) < 0)
                     goto cleanup;
             }
         } else {
-            if (virDomainInterfaceClearQoS(vm->def, olddev) < 0)
+            if (virDomainInterfaceClearQoS(vm->def, olddev,
+                                           cfg->bandwidthBackend) < 0)
                 goto cleanup;
         }
 
@@ -5094,7 +5076,7 @@ qemuDomainRemoveNetDevice(virQEMUDriver *driver,
     if (!(charDevAlias = qemuAliasChardevFromDevAlias(net->info.alias)))
         return -1;
 
-    virDomainInterfaceClearQoS(vm->def, net);
+    virDomainInterfaceClearQoS(vm->def, net, cfg->bandwidthBackend);
 
     /* deactivate the tap/macvtap device on the host, which could also
      * affect the parent device (e.g. macvtap passthrough mode sets
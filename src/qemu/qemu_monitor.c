@@ -62,6 +62,14 @@ VIR_LOG_INIT("qemu.qemu_monitor");
  */
 #define QEMU_MONITOR_MAX_RESPONSE (10 * 1024 * 1024)
 
+/* Minimum amount of free space in the receive buffer when reading. The
+ * buffer grows geometrically from this size up to the limit above. */
+#define QEMU_MONITOR_READ_CHUNK 1024
+
+/* Receive buffers larger than this are released once all data in them
+ * was processed, smaller ones are kept for the next message. */
+#define QEMU_MONITOR_BUFFER_KEEP (64 * 1024)
+
 
 /**
  * QEMU_CHECK_MONITOR_FULL:
@@ -274,24 +282,42 @@ qemuMonitorIOProcess(qemuMonitor *mon)
 
 
     PROBE_QUIET(QEMU_MONITOR_IO_PROCESS, "mon=%p buf=%s len=%zu",
-                mon, mon->buffer, mon->bufferOffset);
-
-    len = qemuMonitorJSONIOProcess(mon,
-                                   mon->buffer, mon->bufferOffset,
-                                   msg);
-    if (len < 0)
-        return -1;
+                mon, mon->buffer + mon->bufferStart,
+                mon->bufferOffset - mon->bufferStart);
+
+    /* Every message is terminated by a line ending, so unless a newline
+     * arrived since the last pass there's nothing new to process. This
+     * avoids re-scanning the whole buffer on each read of a long reply. */
+    if (memchr(mon->buffer + mon->bufferScanned, '\n',
+               mon->bufferOffset - mon->bufferScanned)) {
+        len = qemuMonitorJSONIOProcess(mon,
+                                       mon->buffer + mon->bufferStart,
+                                       mon->bufferOffset - mon->bufferStart,
+                                       msg);
+        if (len < 0)
+            return -1;
+    } else {
+        len = 0;
+    }
 
     if (len && mon->waitGreeting)
         mon->waitGreeting = false;
 
-    if (len < mon->bufferOffset) {
-        memmove(mon->buffer, mon->buffer + len, mon->bufferOffset - len);
-        mon->bufferOffset -= len;
-    } else {
-        VIR_FREE(mon->buffer);
-        mon->bufferOffset = mon->bufferLength = 0;
+    /* Processed messages are just skipped here, the remaining data is
+     * moved to the start of the buffer only once more space is needed
+     * in qemuMonitorIOReserve. */
+    mon->bufferStart += len;
+    mon->bufferScanned = mon->bufferOffset;
+
+    if (mon->bufferStart == mon->bufferOffset) {
+        if (mon->bufferLength > QEMU_MONITOR_BUFFER_KEEP) {
+            VIR_FREE(mon->buffer);
+            mon->bufferLength = 0;
+        }
+
+        mon->bufferStart = mon->bufferScanned = mon->bufferOffset = 0;
     }
+
     /* As the monitor mutex was unlocked in qemuMonitorJSONIOProcess()
      * while dealing with qemu event, mon->msg could be changed which
      * means the above 'msg' may be invalid, thus we use 'mon->msg' here */
@@ -359,6 +385,57 @@ qemuMonitorIOWrite(qemuMonitor *mon)
 }
 
 
+/*
+ * Makes sure there's space to read more data into the receive buffer.
+ * Call this function while holding the monitor lock.
+ *
+ * Returns -1 on error, 0 on success
+ */
+static int
+qemuMonitorIOReserve(qemuMonitor *mon)
+{
+    size_t pending = mon->bufferOffset - mon->bufferStart;
+    size_t newLength;
+
+    if (mon->bufferLength - mon->bufferOffset >= QEMU_MONITOR_READ_CHUNK)
+        return 0;
+
+    /* Reclaim the space of already processed messages first */
+    if (mon->bufferStart > 0) {
+        memmove(mon->buffer, mon->buffer + mon->bufferStart, pending);
+        mon->statMovedBytes += pending;
+        mon->bufferScanned -= mon->bufferStart;
+        mon->bufferOffset = pending;
+        mon->bufferStart = 0;
+        mon->buffer[mon->bufferOffset] = '\0';
+
+        if (mon->bufferLength - mon->bufferOffset >= QEMU_MONITOR_READ_CHUNK)
+            goto done;
+    }
+
+    if (mon->bufferLength >= QEMU_MONITOR_MAX_RESPONSE) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("QEMU monitor reply exceeds buffer size (%1$d bytes)"),
+                       QEMU_MONITOR_MAX_RESPONSE);
+        return -1;
+    }
+
+    newLength = MAX(mon->bufferLength * 2, QEMU_MONITOR_READ_CHUNK);
+    newLength = MIN(newLength, QEMU_MONITOR_MAX_RESPONSE);
+
+    VIR_REALLOC_N(mon->buffer, newLength);
+    mon->bufferLength = newLength;
+    mon->statReallocs++;
+
+ done:
+    PROBE_QUIET(QEMU_MONITOR_IO_BUFFER,
+                "mon=%p length=%zu read=%llu reallocs=%llu moved=%llu",
+                mon, mon->bufferLength, mon->statBytesRead,
+                mon->statReallocs, mon->statMovedBytes);
+    return 0;
+}
+
+
 /*
  * Called when the monitor has incoming data to read
  * Call this function while holding the monitor lock.
@@ -368,20 +445,13 @@ qemuMonitorIOWrite(qemuMonitor *mon)
 static int
 qemuMonitorIORead(qemuMonitor *mon)
 {
-    size_t avail = mon->bufferLength - mon->bufferOffset;
+    size_t avail;
     int ret = 0;
 
-    if (avail < 1024) {
-        if (mon->bufferLength >= QEMU_MONITOR_MAX_RESPONSE) {
-            virReportError(VIR_ERR_INTERNAL_ERROR,
-                           _("QEMU monitor reply exceeds buffer size (%1$d bytes)"),
-                           QEMU_MONITOR_MAX_RESPONSE);
-            return -1;
-        }
-        VIR_REALLOC_N(mon->buffer, mon->bufferLength + 1024);
-        mon->bufferLength += 1024;
-        avail += 1024;
-    }
+    if (qemuMonitorIOReserve(mon) < 0)
+        return -1;
+
+    avail = mon->bufferLength - mon->bufferOffset;
 
     /* Read as much as we can get into our buffer,
        until we block on EAGAIN, or hit EOF */
@@ -405,6 +475,7 @@ qemuMonitorIORead(qemuMonitor *mon)
         avail -= got;
         mon->bufferOffset += got;
         mon->buffer[mon->bufferOffset] = '\0';
+        mon->statBytesRead += got;
     }
 
     return ret;
@@ -756,6 +827,11 @@ qemuMonitorClose(qemuMonitor *mon)
     virObjectLock(mon);
     PROBE(QEMU_MONITOR_CLOSE, "mon=%p", mon);
 
+    PROBE(QEMU_MONITOR_IO_BUFFER,
+          "mon=%p length=%zu read=%llu reallocs=%llu moved=%llu",
+          mon, mon->bufferLength, mon->statBytesRead,
+          mon->statReallocs, mon->statMovedBytes);
+
     qemuMonitorSetDomainLogLocked(mon, NULL, NULL, NULL);
 
     if (mon->socket) {
@@ -233,7 +233,7 @@ qemuMonitorJSONIOProcessLine(qemuMonitor *mon,
 
 int
 qemuMonitorJSONIOProcess(qemuMonitor *mon,
-                         const char *data,
+                         char *data,
                          size_t len,
                          qemuMonitorMessage *msg)
 {
@@ -241,19 +241,19 @@ qemuMonitorJSONIOProcess(qemuMonitor *mon,
     /*VIR_DEBUG("Data %d bytes [%s]", len, data);*/
 
     while (used < len) {
-        const char *nl = strstr(data + used, LINE_ENDING);
+        char *line = data + used;
+        char *nl = strstr(line, LINE_ENDING);
 
-        if (nl) {
-            int got = nl - (data + used);
-            g_autofree char *line = g_strndup(data + used, got);
-
-            used += got + strlen(LINE_ENDING);
-            line[got] = '\0'; /* kill \n */
-            if (qemuMonitorJSONIOProcessLine(mon, line, msg) < 0)
-                return -1;
-        } else {
+        if (!nl)
             break;
-        }
+
+        /* The processed part of the buffer is discarded by the caller so
+         * the line can be terminated and parsed in place. */
+        *nl = '\0';
+        used += nl - line + strlen(LINE_ENDING);
+
+        if (qemuMonitorJSONIOProcessLine(mon, line, msg) < 0)
+            return -1;
     }
 
     return used;
@@ -35,7 +35,7 @@ qemuMonitorJSONIOProcessLine(qemuMonitor *mon,
 
 int
 qemuMonitorJSONIOProcess(qemuMonitor *mon,
-                         const char *data,
+                         char *data,
                          size_t len,
                          qemuMonitorMessage *msg);
 
@@ -63,11 +63,20 @@ struct _qemuMonitor {
     qemuMonitorMessage *msg;
 
     /* Buffer incoming data ready for Text/QMP monitor
-     * code to process & find message boundaries */
+     * code to process & find message boundaries. Data between
+     * @bufferStart and @bufferOffset is not processed yet, and
+     * no line ending was seen in data before @bufferScanned. */
+    size_t bufferStart;
+    size_t bufferScanned;
     size_t bufferOffset;
     size_t bufferLength;
     char *buffer;
 
+    /* Statistics of the receive buffer handling */
+    unsigned long long statBytesRead;
+    unsigned long long statReallocs;
+    unsigned long long statMovedBytes;
+
     /* If anything went wrong, this will be fed back
      * the next monitor msg */
     virError lastError;
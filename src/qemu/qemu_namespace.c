@@ -1177,25 +1177,22 @@ qemuNamespaceMknodHelper(pid_t pid G_GNUC_UNUSED,
 {
     qemuNamespaceMknodData *data = opaque;
     size_t i;
-    int ret = -1;
     bool exists = false;
 
-    qemuSecurityPostFork(data->driver->securityManager);
-
+    /* This runs either in a forked child or in the namespace helper
+     * thread, so it must neither touch the security manager which the
+     * caller keeps locked nor free @data. */
     for (i = 0; i < data->nitems; i++) {
         int rc = 0;
 
         if ((rc = qemuNamespaceMknodOne(&data->items[i])) < 0)
-            goto cleanup;
+            return -1;
 
         if (rc > 0)
             exists = true;
     }
 
-    ret = exists;
- cleanup:
-    qemuNamespaceMknodDataClear(data);
-    return ret;
+    return exists;
 }
 
 
@@ -1384,8 +1381,8 @@ qemuNamespaceMknodPaths(virDomainObj *vm,
     if (qemuSecurityPreFork(driver->securityManager) < 0)
         goto cleanup;
 
-    ret = virProcessRunInMountNamespace(vm->pid, qemuNamespaceMknodHelper,
-                                        &data);
+    ret = virProcessRunInNamespaceHelper(vm->pid, qemuNamespaceMknodHelper,
+                                         &data);
     qemuSecurityPostFork(driver->securityManager);
 
     if (ret == 0 && created != NULL)
@@ -1424,7 +1421,7 @@ static int
 qemuNamespaceUnlinkHelper(pid_t pid G_GNUC_UNUSED,
                           void *opaque)
 {
-    g_autoptr(virGSListString) paths = opaque;
+    GSList *paths = opaque;
     GSList *next;
 
     for (next = paths; next; next = next->next) {
@@ -1493,9 +1490,9 @@ qemuNamespaceUnlinkPaths(virDomainObj *vm,
     }
 
     if (unlinkPaths &&
-        virProcessRunInMountNamespace(vm->pid,
-                                      qemuNamespaceUnlinkHelper,
-                                      unlinkPaths) < 0)
+        virProcessRunInNamespaceHelper(vm->pid,
+                                       qemuNamespaceUnlinkHelper,
+                                       unlinkPaths) < 0)
         return -1;
 
     return 0;
@@ -7879,6 +7879,32 @@ qemuProcessEnableDomainNamespaces(virQEMUDriver *driver,
 }
 
 
+/**
+ * qemuProcessStartNamespaceHelper:
+ * @vm: domain object
+ *
+ * Starts the helper running operations inside the mount namespace of @vm,
+ * so that relabeling and creating device nodes on hotplug doesn't need to
+ * fork a child every time. Failing to start it is not fatal as forking
+ * still works.
+ */
+static void
+qemuProcessStartNamespaceHelper(virDomainObj *vm)
+{
+    qemuDomainObjPrivate *priv = vm->privateData;
+
+    if (priv->nsHelper ||
+        !qemuDomainNamespaceEnabled(vm, QEMU_DOMAIN_NS_MOUNT))
+        return;
+
+    if (!(priv->nsHelper = virProcessNamespaceHelperNew(vm->pid))) {
+        VIR_WARN("Unable to start mount namespace helper for domain %s: %s",
+                 vm->def->name, virGetLastErrorMessage());
+        virResetLastError();
+    }
+}
+
+
 static int
 qemuProcessEnablePerf(virDomainObj *vm)
 {
@@ -8286,6 +8312,8 @@ qemuProcessLaunch(virConnectPtr conn,
     if (qemuDomainBuildNamespace(cfg, vm) < 0)
         goto cleanup;
 
+    qemuProcessStartNamespaceHelper(vm);
+
     VIR_DEBUG("Setting up domain cgroup (if required)");
     if (qemuSetupCgroup(vm, nnicindexes, nicindexes) < 0)
         goto cleanup;
@@ -9162,10 +9190,12 @@ qemuProcessStop(virDomainObj *vm,
     if (priv->eventThread)
         g_object_unref(g_steal_pointer(&priv->eventThread));
 
+    g_clear_pointer(&priv->nsHelper, virProcessNamespaceHelperClose);
+
     virInhibitorRelease(driver->inhibitor);
 
     /* Clear network bandwidth */
-    virDomainClearNetBandwidth(vm->def);
+    virDomainClearNetBandwidth(vm->def, cfg->bandwidthBackend);
 
     virDomainConfVMNWFilterTeardown(vm);
 
@@ -9645,6 +9675,18 @@ struct qemuProcessReconnectData {
     virDomainObj *obj;
     virIdentity *identity;
 };
+
+
+static void
+qemuProcessReconnectDone(virQEMUDriver *driver)
+{
+    if (!g_atomic_int_dec_and_test(&driver->reconnectPending))
+        return;
+
+    VIR_INFO("Startup phase 'reconnect' took %lld ms",
+             (g_get_monotonic_time() - driver->reconnectStart) / 1000);
+}
+
 /*
  * Open an existing VM's monitor, re-detect VCPU threads
  * and re-reserve the security labels in use
@@ -9727,6 +9769,8 @@ qemuProcessReconnect(void *opaque)
     if (qemuConnectMonitor(driver, obj, VIR_ASYNC_JOB_NONE, NULL, true) < 0)
         goto error;
 
+    qemuProcessStartNamespaceHelper(obj);
+
     priv->machineName = qemuDomainGetMachineName(obj);
     if (!priv->machineName)
         goto error;
@@ -9931,6 +9975,7 @@ qemuProcessReconnect(void *opaque)
         qemuDomainRemoveInactive(obj, 0, false);
     virDomainObjEndAPI(&obj);
     virIdentitySetCurrent(NULL);
+    qemuProcessReconnectDone(driver);
     return;
 
  error:
@@ -9964,8 +10009,9 @@ qemuProcessReconnect(void *opaque)
 
 static int
 qemuProcessReconnectHelper(virDomainObj *obj,
-                           void *opaque G_GNUC_UNUSED)
+                           void *opaque)
 {
+    virQEMUDriver *driver = opaque;
     virThread thread;
     struct qemuProcessReconnectData *data;
     g_autofree char *name = NULL;
@@ -9986,6 +10032,8 @@ qemuProcessReconnectHelper(virDomainObj *obj,
 
     name = g_strdup_printf("init-%s", obj->def->name);
 
+    g_atomic_int_inc(&driver->reconnectPending);
+
     if (virThreadCreateFull(&thread, false, qemuProcessReconnect,
                             name, false, data) < 0) {
         virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
@@ -10002,6 +10050,7 @@ qemuProcessReconnectHelper(virDomainObj *obj,
         virDomainObjEndAPI(&obj);
         g_clear_object(&data->identity);
         VIR_FREE(data);
+        qemuProcessReconnectDone(driver);
         return -1;
     }
 
@@ -10017,8 +10066,13 @@ qemuProcessReconnectHelper(virDomainObj *obj,
 void
 qemuProcessReconnectAll(virQEMUDriver *driver)
 {
+    driver->reconnectStart = g_get_monotonic_time();
+    g_atomic_int_set(&driver->reconnectPending, 1);
+
     virDomainObjListForEach(driver->domains, true,
-                            qemuProcessReconnectHelper, NULL);
+                            qemuProcessReconnectHelper, driver);
+
+    qemuProcessReconnectDone(driver);
 }
 
 
@@ -7935,6 +7935,7 @@ static virHypervisorDriver hypervisor_driver = {
     .domainGraphicsReload = remoteDomainGraphicsReload, /* 10.2.0 */
     .domainSetThrottleGroup = remoteDomainSetThrottleGroup, /* 11.2.0 */
     .domainDelThrottleGroup = remoteDomainDelThrottleGroup, /* 11.2.0 */
+    .connectGetAllDomainStatsStream = remoteConnectGetAllDomainStatsStream, /* 12.1.0 */
 };
 
 static virNetworkDriver network_driver = {
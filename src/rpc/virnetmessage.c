@@ -29,11 +29,164 @@
 #include "virfile.h"
 #include "virutil.h"
 #include "virsecureerase.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_RPC
 
 VIR_LOG_INIT("rpc.netmessage");
 
+/*
+ * Message buffers are recycled through a process wide pool with one free
+ * list per size class. The classes follow the growth of a message buffer,
+ * starting at VIR_NET_MESSAGE_INITIAL and doubling up to VIR_NET_MESSAGE_MAX
+ * (plus the length word). Since the pool is never trimmed, all classes
+ * together keep at most VIR_NET_MESSAGE_POOL_BYTES worth of buffers,
+ * anything beyond is freed.
+ */
+#define VIR_NET_MESSAGE_POOL_CLASSES 10
+#define VIR_NET_MESSAGE_POOL_BYTES (1024 * 1024)
+
+G_STATIC_ASSERT((VIR_NET_MESSAGE_INITIAL << (VIR_NET_MESSAGE_POOL_CLASSES - 1)) ==
+                VIR_NET_MESSAGE_MAX);
+
+typedef struct _virNetMessagePoolClass virNetMessagePoolClass;
+struct _virNetMessagePoolClass {
+    void *head; /* free buffers, linked through their first bytes */
+};
+
+static virMutex virNetMessagePoolLock = VIR_MUTEX_INITIALIZER;
+static virNetMessagePoolClass virNetMessagePool[VIR_NET_MESSAGE_POOL_CLASSES];
+static virNetMessageBufferStats virNetMessagePoolStats;
+
+
+static size_t
+virNetMessagePoolClassSize(size_t cls)
+{
+    return (VIR_NET_MESSAGE_INITIAL << cls) + VIR_NET_MESSAGE_LEN_MAX;
+}
+
+
+/* Returns the smallest size class holding @len bytes, or -1 if none does */
+static int
+virNetMessagePoolClassFind(size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < VIR_NET_MESSAGE_POOL_CLASSES; i++) {
+        if (len <= virNetMessagePoolClassSize(i))
+            return i;
+    }
+
+    return -1;
+}
+
+
+static char *
+virNetMessagePoolGet(size_t len,
+                     size_t *capacity)
+{
+    int cls = virNetMessagePoolClassFind(len);
+    char *buf = NULL;
+
+    *capacity = cls < 0 ? len : virNetMessagePoolClassSize(cls);
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&virNetMessagePoolLock) {
+        if (cls >= 0 && virNetMessagePool[cls].head) {
+            buf = virNetMessagePool[cls].head;
+            memcpy(&virNetMessagePool[cls].head, buf, sizeof(void *));
+            virNetMessagePoolStats.reused++;
+            virNetMessagePoolStats.cached--;
+            virNetMessagePoolStats.cachedBytes -= *capacity;
+        } else {
+            virNetMessagePoolStats.allocated++;
+        }
+    }
+
+    if (!buf)
+        return g_new0(char, *capacity);
+
+    memset(buf, 0, sizeof(void *));
+    return buf;
+}
+
+
+/* Callers must erase any sensitive contents of @buf beforehand */
+static void
+virNetMessagePoolPut(char *buf,
+                     size_t capacity)
+{
+    int cls = virNetMessagePoolClassFind(capacity);
+
+    if (cls >= 0 && virNetMessagePoolClassSize(cls) != capacity)
+        cls = -1;
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&virNetMessagePoolLock) {
+        if (cls >= 0 &&
+            virNetMessagePoolStats.cachedBytes + capacity <= VIR_NET_MESSAGE_POOL_BYTES) {
+            memcpy(buf, &virNetMessagePool[cls].head, sizeof(void *));
+            virNetMessagePool[cls].head = buf;
+            virNetMessagePoolStats.cached++;
+            virNetMessagePoolStats.cachedBytes += capacity;
+            return;
+        }
+
+        virNetMessagePoolStats.freed++;
+    }
+
+    g_free(buf);
+}
+
+
+/**
+ * virNetMessageGetBufferStats:
+ * @stats: filled with the counters of the message buffer pool
+ */
+void
+virNetMessageGetBufferStats(virNetMessageBufferStats *stats)
+{
+    VIR_LOCK_GUARD lock = virLockGuardLock(&virNetMessagePoolLock);
+
+    *stats = virNetMessagePoolStats;
+}
+
+
+/**
+ * virNetMessageReserveBuffer:
+ * @msg: the message
+ * @len: number of bytes the buffer must hold
+ *
+ * Grows the buffer of @msg to at least @len bytes, keeping its contents.
+ * The buffer is taken from the message buffer pool unless it was allocated
+ * by the caller, in which case it is reallocated.
+ */
+void
+virNetMessageReserveBuffer(virNetMessage *msg,
+                           size_t len)
+{
+    size_t capacity;
+    char *buf;
+
+    if (msg->buffer && msg->bufferCapacity == 0) {
+        VIR_REALLOC_N(msg->buffer, len);
+        return;
+    }
+
+    if (len <= msg->bufferCapacity)
+        return;
+
+    buf = virNetMessagePoolGet(len, &capacity);
+
+    if (msg->buffer) {
+        memcpy(buf, msg->buffer, msg->bufferCapacity);
+        virSecureErase(msg->buffer, msg->bufferCapacity);
+        virNetMessagePoolPut(msg->buffer, msg->bufferCapacity);
+    }
+
+    msg->buffer = buf;
+    msg->bufferCapacity = capacity;
+}
+
+
 virNetMessage *virNetMessageNew(bool tracked)
 {
     virNetMessage *msg;
@@ -69,7 +222,12 @@ virNetMessageClearPayload(virNetMessage *msg)
     virSecureErase(msg->buffer, msg->bufferLength);
     msg->bufferOffset = 0;
     msg->bufferLength = 0;
-    VIR_FREE(msg->buffer);
+
+    if (msg->bufferCapacity > 0)
+        virNetMessagePoolPut(g_steal_pointer(&msg->buffer), msg->bufferCapacity);
+    else
+        VIR_FREE(msg->buffer);
+    msg->bufferCapacity = 0;
 }
 
 
@@ -164,7 +322,18 @@ int virNetMessageDecodeLength(virNetMessage *msg)
     /* Extend our declared buffer length and carry
        on reading the header + payload */
     msg->bufferLength += len;
-    VIR_REALLOC_N(msg->buffer, msg->bufferLength);
+
+    if (msg->bufferCapacity == 0) {
+        /* The length word is read into a small buffer of its own, so that
+         * idle connections don't hold on to a pooled buffer. The message
+         * is read into one only now that its size is known. */
+        g_autofree char *lenbuf = g_steal_pointer(&msg->buffer);
+
+        virNetMessageReserveBuffer(msg, msg->bufferLength);
+        memcpy(msg->buffer, lenbuf, msg->bufferOffset);
+    } else {
+        virNetMessageReserveBuffer(msg, msg->bufferLength);
+    }
 
     VIR_DEBUG("Got length, now need %zu total (%u more)",
               msg->bufferLength, len);
@@ -239,8 +408,13 @@ int virNetMessageEncodeHeader(virNetMessage *msg)
     int ret = -1;
     unsigned int len = 0;
 
+    /* Replies reuse the buffer of the call, which may have been larger */
+    if (msg->bufferLength > VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX)
+        virSecureErase(msg->buffer + VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX,
+                       msg->bufferLength - VIR_NET_MESSAGE_INITIAL - VIR_NET_MESSAGE_LEN_MAX);
+
     msg->bufferLength = VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX;
-    VIR_REALLOC_N(msg->buffer, msg->bufferLength);
+    virNetMessageReserveBuffer(msg, msg->bufferLength);
     msg->bufferOffset = 0;
 
     /* Format the header. */
@@ -380,7 +554,7 @@ int virNetMessageEncodePayload(virNetMessage *msg,
 
         msg->bufferLength = newlen + VIR_NET_MESSAGE_LEN_MAX;
 
-        VIR_REALLOC_N(msg->buffer, msg->bufferLength);
+        virNetMessageReserveBuffer(msg, msg->bufferLength);
 
         xdrmem_create(&xdr, msg->buffer + msg->bufferOffset,
                       msg->bufferLength - msg->bufferOffset, XDR_ENCODE);
@@ -472,7 +646,7 @@ int virNetMessageEncodePayloadRaw(virNetMessage *msg,
 
             msg->bufferLength = msg->bufferOffset + len;
 
-            VIR_REALLOC_N(msg->buffer, msg->bufferLength);
+            virNetMessageReserveBuffer(msg, msg->bufferLength);
 
             VIR_DEBUG("Increased message buffer length = %zu", msg->bufferLength);
         }
@@ -33,6 +33,8 @@ struct _virNetMessage {
                   /* Maximum   VIR_NET_MESSAGE_MAX     + VIR_NET_MESSAGE_LEN_MAX */
     size_t bufferLength;
     size_t bufferOffset;
+    size_t bufferCapacity; /* size of a buffer taken from the pool, 0 if
+                            * the buffer was allocated by the caller */
 
     virNetMessageHeader header;
 
@@ -46,6 +48,15 @@ struct _virNetMessage {
     virNetMessage *next;
 };
 
+typedef struct _virNetMessageBufferStats virNetMessageBufferStats;
+struct _virNetMessageBufferStats {
+    unsigned long long allocated; /* buffers allocated from the heap */
+    unsigned long long reused;    /* buffers handed out from the pool */
+    unsigned long long freed;     /* buffers returned to the heap */
+    unsigned long long cached;    /* buffers currently kept in the pool */
+    unsigned long long cachedBytes;
+};
+
 
 virNetMessage *virNetMessageNew(bool tracked);
 
@@ -53,6 +64,12 @@ void virNetMessageClearFDs(virNetMessage *msg);
 void virNetMessageClearPayload(virNetMessage *msg);
 
 void virNetMessageClear(virNetMessage *);
+void virNetMessageReserveBuffer(virNetMessage *msg,
+                                size_t len)
+    ATTRIBUTE_NONNULL(1);
+
+void virNetMessageGetBufferStats(virNetMessageBufferStats *stats)
+    ATTRIBUTE_NONNULL(1);
 
 void virNetMessageFree(virNetMessage *msg);
 
@@ -39,6 +39,7 @@ struct _virNetServerJob {
     virNetServerClient *client;
     virNetMessage *msg;
     virNetServerProgram *prog;
+    long long received;
 };
 
 struct _virNetServer {
@@ -102,12 +103,18 @@ virNetServerNextClientID(virNetServer *srv)
 }
 
 
+/*
+ * @received: monotonic time at which @msg was received, in microseconds
+ */
 static int
 virNetServerProcessMsg(virNetServer *srv,
                        virNetServerClient *client,
                        virNetServerProgram *prog,
-                       virNetMessage *msg)
+                       virNetMessage *msg,
+                       long long received)
 {
+    virNetMessageHeader header = msg->header;
+
     if (!prog) {
         /* Only send back an error for type == CALL. Other
          * message types are not expecting replies, so we
@@ -138,6 +145,12 @@ virNetServerProcessMsg(virNetServer *srv,
                                     msg) < 0)
         return -1;
 
+    if (header.type == VIR_NET_CALL ||
+        header.type == VIR_NET_CALL_WITH_FDS) {
+        virNetServerClientRecordCall(client, header.prog, header.proc,
+                                     g_get_monotonic_time() - received);
+    }
+
     return 0;
 }
 
@@ -152,7 +165,8 @@ virNetServerHandleJob(void *jobOpaque,
     VIR_DEBUG("server=%p client=%p message=%p prog=%p",
               srv, job->client, job->msg, job->prog);
 
-    if (virNetServerProcessMsg(srv, job->client, job->prog, job->msg) < 0)
+    if (virNetServerProcessMsg(srv, job->client, job->prog, job->msg,
+                               job->received) < 0)
         goto error;
 
     virObjectUnref(job->prog);
@@ -191,6 +205,31 @@ virNetServerGetProgramLocked(virNetServer *srv,
 }
 
 
+/*
+ * Calls of high priority procedures don't block, so they may run
+ * concurrently with other calls of a client which reached its limit of
+ * requests, see virNetServerClientSetPriorityCheck.
+ */
+static bool
+virNetServerIsPriorityMessage(virNetServerClient *client G_GNUC_UNUSED,
+                              virNetMessage *msg,
+                              void *opaque)
+{
+    virNetServer *srv = opaque;
+    VIR_LOCK_GUARD lock = virObjectLockGuard(srv);
+    virNetServerProgram *prog;
+
+    if (msg->header.type != VIR_NET_CALL &&
+        msg->header.type != VIR_NET_CALL_WITH_FDS)
+        return false;
+
+    if (!(prog = virNetServerGetProgramLocked(srv, msg)))
+        return false;
+
+    return virNetServerProgramGetPriority(prog, msg->header.proc) > 0;
+}
+
+
 static void
 virNetServerDispatchNewMessage(virNetServerClient *client,
                                virNetMessage *msg,
@@ -199,6 +238,7 @@ virNetServerDispatchNewMessage(virNetServerClient *client,
     virNetServer *srv = opaque;
     virNetServerProgram *prog = NULL;
     unsigned int priority = 0;
+    long long received = g_get_monotonic_time();
 
     VIR_DEBUG("server=%p client=%p message=%p",
               srv, client, msg);
@@ -218,6 +258,7 @@ virNetServerDispatchNewMessage(virNetServerClient *client,
 
         job->client = virObjectRef(client);
         job->msg = msg;
+        job->received = received;
 
         if (prog) {
             job->prog = virObjectRef(prog);
@@ -231,7 +272,7 @@ virNetServerDispatchNewMessage(virNetServerClient *client,
             goto error;
         }
     } else {
-        if (virNetServerProcessMsg(srv, client, prog, msg) < 0)
+        if (virNetServerProcessMsg(srv, client, prog, msg, received) < 0)
             goto error;
     }
 
@@ -315,6 +356,8 @@ virNetServerAddClient(virNetServer *srv,
     virNetServerCheckLimits(srv);
 
     virNetServerClientSetDispatcher(client, virNetServerDispatchNewMessage, srv);
+    virNetServerClientSetPriorityCheck(client, virNetServerIsPriorityMessage,
+                                       virThreadPoolGetPriorityWorkers(srv->workers));
 
     if (virNetServerClientInitKeepAlive(client, srv->keepaliveInterval,
                                         srv->keepaliveCount) < 0)
@@ -96,9 +96,16 @@ struct _virNetServerClient
     /* True if we've warned about nrequests hittin
      * the server limit already */
     bool nrequests_warning;
+    /* Calls of high priority procedures may exceed
+     * nrequests_max by this many requests */
+    size_t nrequests_prio_max;
     /* Zero or one messages being received. Zero if
      * nrequests >= max_clients and throttling */
     virNetMessage *rx;
+    /* Zero or one message read beyond nrequests_max
+     * which is not of high priority, waiting for
+     * another request to complete */
+    virNetMessage *pending;
     /* Zero or many messages waiting for transmit
      * back to client, including async events */
     virNetMessage *tx;
@@ -109,8 +116,13 @@ struct _virNetServerClient
     int nextFilterID;
 
     virNetServerClientDispatchFunc dispatchFunc;
+    virNetServerClientPriorityFunc priorityFunc;
     void *dispatchOpaque;
 
+    /* Latencies of calls per procedure */
+    size_t ncallStats;
+    virNetServerClientCallStats *callStats;
+
     void *privateData;
     virFreeCallback privateDataFreeFunc;
     virNetServerClientPrivPreExecRestart privateDataPreExecRestart;
@@ -136,7 +148,8 @@ VIR_ONCE_GLOBAL_INIT(virNetServerClient);
 
 static void virNetServerClientDispatchEvent(virNetSocket *sock, int events, void *opaque);
 static void virNetServerClientUpdateEvent(virNetServerClient *client);
-static virNetMessage *virNetServerClientDispatchRead(virNetServerClient *client);
+static virNetMessage *virNetServerClientDispatchRead(virNetServerClient *client,
+                                                    bool *lookahead);
 static int virNetServerClientSendMessageLocked(virNetServerClient *client,
                                                virNetMessage *msg);
 
@@ -312,8 +325,46 @@ virNetServerClientCheckAccess(virNetServerClient *client)
 }
 
 
+/* Upper bounds of the buckets of the histogram of call latencies in
+ * microseconds, the last bucket is unbounded */
+static const unsigned long long
+virNetServerClientCallBucketLimits[VIR_NET_SERVER_CLIENT_CALL_BUCKETS - 1] = {
+    1000, 10000, 100000, 1000000, 10000000,
+};
+
+
+/*
+ * Whether another message can be received from @client. Once the client
+ * reached its limit of requests, messages are read one at a time for as long
+ * as they turn out to be calls of high priority procedures.
+ */
+static bool
+virNetServerClientCanReceiveLocked(virNetServerClient *client)
+{
+    if (client->nrequests < client->nrequests_max)
+        return true;
+
+    return !client->pending &&
+        client->nrequests < client->nrequests_max + client->nrequests_prio_max;
+}
+
+
+static void
+virNetServerClientNewRxLocked(virNetServerClient *client)
+{
+    client->rx = virNetMessageNew(true);
+    client->rx->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
+    client->rx->buffer = g_new0(char, client->rx->bufferLength);
+    client->nrequests++;
+}
+
+
+/*
+ * @lookahead: whether @msg was read beyond the limit of requests
+ */
 static void virNetServerClientDispatchMessage(virNetServerClient *client,
-                                              virNetMessage *msg)
+                                              virNetMessage *msg,
+                                              bool lookahead)
 {
     VIR_WITH_OBJECT_LOCK_GUARD(client) {
         if (!client->dispatchFunc) {
@@ -323,6 +374,26 @@ static void virNetServerClientDispatchMessage(virNetServerClient *client,
         }
     }
 
+    if (lookahead) {
+        bool priority = client->priorityFunc(client, msg, client->dispatchOpaque);
+
+        VIR_WITH_OBJECT_LOCK_GUARD(client) {
+            /* Other calls have to wait for a request to complete unless it
+             * happened in the meantime */
+            if (!priority &&
+                client->nrequests > client->nrequests_max) {
+                client->pending = msg;
+                return;
+            }
+
+            if (client->sock && !client->rx &&
+                virNetServerClientCanReceiveLocked(client)) {
+                virNetServerClientNewRxLocked(client);
+                virNetServerClientUpdateEvent(client);
+            }
+        }
+    }
+
     /* Accessing 'client' is safe, because virNetServerClientSetDispatcher
      * only permits setting 'dispatchFunc' once, so if non-NULL, it will
      * never change again
@@ -336,17 +407,18 @@ static void virNetServerClientSockTimerFunc(int timer,
 {
     virNetServerClient *client = opaque;
     virNetMessage *msg = NULL;
+    bool lookahead = false;
 
     VIR_WITH_OBJECT_LOCK_GUARD(client) {
         virEventUpdateTimeout(timer, -1);
         /* Although client->rx != NULL when this timer is enabled, it might have
          * changed since the client was unlocked in the meantime. */
         if (client->rx)
-            msg = virNetServerClientDispatchRead(client);
+            msg = virNetServerClientDispatchRead(client, &lookahead);
     }
 
     if (msg)
-        virNetServerClientDispatchMessage(client, msg);
+        virNetServerClientDispatchMessage(client, msg, lookahead);
 }
 
 
@@ -907,6 +979,32 @@ void virNetServerClientSetDispatcher(virNetServerClient *client,
 }
 
 
+/**
+ * virNetServerClientSetPriorityCheck:
+ * @client: client
+ * @func: callback identifying calls of high priority procedures
+ * @nrequests_prio_max: number of such calls allowed beyond the limit
+ *
+ * Lets @client keep reading messages once it reached its limit of requests
+ * and dispatch up to @nrequests_prio_max calls of high priority procedures
+ * concurrently with the already running ones, so that they don't wait
+ * behind slow calls. @func is called with the opaque data passed to
+ * virNetServerClientSetDispatcher.
+ */
+void virNetServerClientSetPriorityCheck(virNetServerClient *client,
+                                        virNetServerClientPriorityFunc func,
+                                        size_t nrequests_prio_max)
+{
+    VIR_LOCK_GUARD lock = virObjectLockGuard(client);
+
+    /* Same as for the dispatcher, it's accessed without locks held */
+    if (!client->priorityFunc) {
+        client->priorityFunc = func;
+        client->nrequests_prio_max = nrequests_prio_max;
+    }
+}
+
+
 const char *virNetServerClientLocalAddrStringSASL(virNetServerClient *client)
 {
     if (!client->sock)
@@ -938,6 +1036,8 @@ void virNetServerClientDispose(void *obj)
 
     if (client->rx)
         virNetMessageFree(client->rx);
+    virNetMessageFree(client->pending);
+    g_free(client->callStats);
     if (client->privateData)
         client->privateDataFreeFunc(client->privateData);
 
@@ -1012,6 +1112,7 @@ virNetServerClientCloseLocked(virNetServerClient *client)
             = virNetMessageQueueServe(&client->tx);
         virNetMessageFree(msg);
     }
+    g_clear_pointer(&client->pending, virNetMessageFree);
 
     if (client->sock) {
         g_clear_pointer(&client->sock, virObjectUnref);
@@ -1145,7 +1246,8 @@ static ssize_t virNetServerClientRead(virNetServerClient *client)
  * yet available, or an error occurred. On error, the wantClose
  * flag will be set.
  */
-static virNetMessage *virNetServerClientDispatchRead(virNetServerClient *client)
+static virNetMessage *virNetServerClientDispatchRead(virNetServerClient *client,
+                                                    bool *lookahead)
 {
  readmore:
     if (client->rx->nfds == 0) {
@@ -1257,13 +1359,15 @@ static virNetMessage *virNetServerClientDispatchRead(virNetServerClient *client)
             }
         }
 
+        /* Messages read beyond the limit are only followed by another one
+         * if they're of high priority, see virNetServerClientDispatchMessage */
+        *lookahead = msg && client->nrequests > client->nrequests_max;
+
         /* Possibly need to create another receive buffer */
-        if (client->nrequests < client->nrequests_max) {
-            client->rx = virNetMessageNew(true);
-            client->rx->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
-            client->rx->buffer = g_new0(char, client->rx->bufferLength);
-            client->nrequests++;
-        } else if (!client->nrequests_warning &&
+        if (!*lookahead && virNetServerClientCanReceiveLocked(client)) {
+            virNetServerClientNewRxLocked(client);
+        } else if (!*lookahead &&
+                   !client->nrequests_warning &&
                    client->nrequests_max > 1) {
             client->nrequests_warning = true;
             VIR_WARN("Client hit max requests limit %zd. This may result "
@@ -1313,10 +1417,13 @@ static ssize_t virNetServerClientWrite(virNetServerClient *client)
 
 /*
  * Process all queued client->tx messages until
- * we would block on I/O
+ * we would block on I/O. If this lets the pending
+ * message proceed, it's returned in @pending for
+ * dispatch by the caller.
  */
 static void
-virNetServerClientDispatchWrite(virNetServerClient *client)
+virNetServerClientDispatchWrite(virNetServerClient *client,
+                                virNetMessage **pending)
 {
     while (client->tx) {
         if (client->tx->bufferOffset < client->tx->bufferLength) {
@@ -1360,9 +1467,13 @@ virNetServerClientDispatchWrite(virNetServerClient *client)
 
             if (msg->tracked) {
                 client->nrequests--;
+                /* The pending message fits within the limit now */
+                if (client->pending &&
+                    client->nrequests <= client->nrequests_max)
+                    *pending = g_steal_pointer(&client->pending);
                 /* See if the recv queue is currently throttled */
                 if (!client->rx &&
-                    client->nrequests < client->nrequests_max) {
+                    virNetServerClientCanReceiveLocked(client)) {
                     /* Ready to recv more messages */
                     virNetMessageClear(msg);
                     msg->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
@@ -1416,6 +1527,8 @@ virNetServerClientDispatchEvent(virNetSocket *sock, int events, void *opaque)
 {
     virNetServerClient *client = opaque;
     virNetMessage *msg = NULL;
+    virNetMessage *pending = NULL;
+    bool lookahead = false;
 
     VIR_WITH_OBJECT_LOCK_GUARD(client) {
         if (client->sock != sock) {
@@ -1430,9 +1543,9 @@ virNetServerClientDispatchEvent(virNetSocket *sock, int events, void *opaque)
                 virNetServerClientDispatchHandshake(client);
             } else {
                 if (events & VIR_EVENT_HANDLE_WRITABLE)
-                    virNetServerClientDispatchWrite(client);
+                    virNetServerClientDispatchWrite(client, &pending);
                 if ((events & VIR_EVENT_HANDLE_READABLE) && client->rx)
-                    msg = virNetServerClientDispatchRead(client);
+                    msg = virNetServerClientDispatchRead(client, &lookahead);
             }
         }
 
@@ -1441,8 +1554,10 @@ virNetServerClientDispatchEvent(virNetSocket *sock, int events, void *opaque)
             client->wantClose = true;
     }
 
+    if (pending)
+        virNetServerClientDispatchMessage(client, pending, false);
     if (msg)
-        virNetServerClientDispatchMessage(client, msg);
+        virNetServerClientDispatchMessage(client, msg, lookahead);
 }
 
 
@@ -1603,6 +1718,91 @@ virNetServerClientGetInfo(virNetServerClient *client,
 }
 
 
+/**
+ * virNetServerClientCallBucketLimit:
+ * @bucket: index of a bucket of the histogram of call latencies
+ *
+ * Returns the upper bound of latencies counted in @bucket in microseconds
+ * or 0 if the bucket is unbounded.
+ */
+unsigned long long
+virNetServerClientCallBucketLimit(size_t bucket)
+{
+    if (bucket >= G_N_ELEMENTS(virNetServerClientCallBucketLimits))
+        return 0;
+
+    return virNetServerClientCallBucketLimits[bucket];
+}
+
+
+/**
+ * virNetServerClientRecordCall:
+ * @client: client
+ * @prog: program of the call
+ * @proc: procedure of the call
+ * @latency: time it took to process the call in microseconds
+ *
+ * Accounts a call of @client in the statistics of its procedure.
+ */
+void
+virNetServerClientRecordCall(virNetServerClient *client,
+                             unsigned int prog,
+                             unsigned int proc,
+                             unsigned long long latency)
+{
+    VIR_LOCK_GUARD lock = virObjectLockGuard(client);
+    virNetServerClientCallStats *stats = NULL;
+    size_t i;
+
+    for (i = 0; i < client->ncallStats; i++) {
+        if (client->callStats[i].prog == prog &&
+            client->callStats[i].proc == proc) {
+            stats = client->callStats + i;
+            break;
+        }
+    }
+
+    if (!stats) {
+        VIR_EXPAND_N(client->callStats, client->ncallStats, 1);
+        stats = client->callStats + client->ncallStats - 1;
+        stats->prog = prog;
+        stats->proc = proc;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(virNetServerClientCallBucketLimits); i++) {
+        if (latency <= virNetServerClientCallBucketLimits[i])
+            break;
+    }
+
+    stats->calls++;
+    stats->time += latency;
+    stats->buckets[i]++;
+}
+
+
+/**
+ * virNetServerClientGetCallStats:
+ * @client: client
+ * @stats: filled with a copy of the statistics of calls
+ * @nstats: filled with the number of items in @stats
+ *
+ * Retrieves the statistics of calls of @client, one item per procedure
+ * which was called at least once.
+ */
+void
+virNetServerClientGetCallStats(virNetServerClient *client,
+                               virNetServerClientCallStats **stats,
+                               size_t *nstats)
+{
+    VIR_LOCK_GUARD lock = virObjectLockGuard(client);
+
+    *stats = g_new0(virNetServerClientCallStats, client->ncallStats);
+    memcpy(*stats, client->callStats,
+           sizeof(virNetServerClientCallStats) * client->ncallStats);
+    *nstats = client->ncallStats;
+}
+
+
 /**
  * virNetServerClientSetQuietEOF:
  *
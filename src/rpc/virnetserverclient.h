@@ -40,6 +40,15 @@ typedef void (*virNetServerClientDispatchFunc)(virNetServerClient *client,
                                                virNetMessage *msg,
                                                void *opaque);
 
+/*
+ * Returns true if @msg is a call of a high priority procedure, i.e. one
+ * which never blocks. Called without @client being locked with the
+ * @opaque data passed to virNetServerClientSetDispatcher.
+ */
+typedef bool (*virNetServerClientPriorityFunc)(virNetServerClient *client,
+                                               virNetMessage *msg,
+                                               void *opaque);
+
 /*
  * @client is locked when this callback is called
  */
@@ -139,6 +148,9 @@ void virNetServerClientSetCloseHook(virNetServerClient *client,
 void virNetServerClientSetDispatcher(virNetServerClient *client,
                                      virNetServerClientDispatchFunc func,
                                      void *opaque);
+void virNetServerClientSetPriorityCheck(virNetServerClient *client,
+                                        virNetServerClientPriorityFunc func,
+                                        size_t nrequests_prio_max);
 void virNetServerClientClose(virNetServerClient *client);
 void virNetServerClientCloseLocked(virNetServerClient *client);
 bool virNetServerClientIsClosedLocked(virNetServerClient *client);
@@ -170,4 +182,26 @@ int virNetServerClientGetInfo(virNetServerClient *client,
                               bool *readonly, char **sock_addr,
                               virIdentity **identity);
 
+/* Number of buckets of the histogram of call latencies, see
+ * virNetServerClientCallBucketLimit */
+#define VIR_NET_SERVER_CLIENT_CALL_BUCKETS 6
+
+typedef struct _virNetServerClientCallStats virNetServerClientCallStats;
+struct _virNetServerClientCallStats {
+    unsigned int prog;
+    unsigned int proc;
+    unsigned long long calls;
+    unsigned long long time; /* total latency in microseconds */
+    unsigned long long buckets[VIR_NET_SERVER_CLIENT_CALL_BUCKETS];
+};
+
+unsigned long long virNetServerClientCallBucketLimit(size_t bucket);
+void virNetServerClientRecordCall(virNetServerClient *client,
+                                  unsigned int prog,
+                                  unsigned int proc,
+                                  unsigned long long latency);
+void virNetServerClientGetCallStats(virNetServerClient *client,
+                                    virNetServerClientCallStats **stats,
+                                    size_t *nstats);
+
 void virNetServerClientSetQuietEOF(virNetServerClient *client);
@@ -625,9 +625,9 @@ virSecurityDACTransactionCommit(virSecurityManager *mgr G_GNUC_UNUSED,
     list->lockMetadataException = lockMetadataException;
 
     if (pid != -1) {
-        rc = virProcessRunInMountNamespace(pid,
-                                           virSecurityDACTransactionRun,
-                                           list);
+        rc = virProcessRunInNamespaceHelper(pid,
+                                            virSecurityDACTransactionRun,
+                                            list);
         if (rc < 0) {
             if (virGetLastErrorCode() == VIR_ERR_SYSTEM_ERROR)
                 pid = -1;
@@ -1156,9 +1156,9 @@ virSecurityDACMoveImageMetadata(virSecurityManager *mgr,
     if (pid == -1) {
         rc = virProcessRunInFork(virSecurityDACMoveImageMetadataHelper, &data);
     } else {
-        rc = virProcessRunInMountNamespace(pid,
-                                           virSecurityDACMoveImageMetadataHelper,
-                                           &data);
+        rc = virProcessRunInNamespaceHelper(pid,
+                                            virSecurityDACMoveImageMetadataHelper,
+                                            &data);
     }
 
     return rc;
@@ -1324,8 +1324,8 @@ cmpstringp(const void *p1,
  * should be passed to virSecurityManagerMetadataUnlock.
  * Passed @paths must not be freed until the corresponding unlock call.
  *
- * NOTE: this function is not thread safe (because of usage of
- * POSIX locks).
+ * NOTE: this function is thread safe only where open file description
+ * locks are supported, otherwise POSIX locks are used.
  *
  * Returns: state on success,
  *          NULL on failure.
@@ -1426,8 +1426,8 @@ virSecurityManagerMetadataLock(virSecurityManager *mgr G_GNUC_UNUSED,
         }
 
         do {
-            if (virFileLock(fd, false,
-                            METADATA_OFFSET, METADATA_LEN, false) < 0) {
+            if (virFileLockOFD(fd, false,
+                               METADATA_OFFSET, METADATA_LEN, false) < 0) {
                 if (retries && (errno == EACCES || errno == EAGAIN)) {
                     /* File is locked. Try again. */
                     retries--;
@@ -1480,7 +1480,7 @@ virSecurityManagerMetadataUnlock(virSecurityManager *mgr G_GNUC_UNUSED,
 
         /* Technically, unlock is not needed because it will
          * happen on VIR_CLOSE() anyway. But let's play it nice. */
-        if (virFileUnlock(fd, METADATA_OFFSET, METADATA_LEN) < 0) {
+        if (virFileUnlockOFD(fd, METADATA_OFFSET, METADATA_LEN) < 0) {
             VIR_WARN("Unable to unlock fd %d path %s: %s",
                      fd, path, g_strerror(errno));
         }
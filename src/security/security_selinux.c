@@ -1225,9 +1225,9 @@ virSecuritySELinuxTransactionCommit(virSecurityManager *mgr G_GNUC_UNUSED,
     list->lockMetadataException = lockMetadataException;
 
     if (pid != -1) {
-        rc = virProcessRunInMountNamespace(pid,
-                                           virSecuritySELinuxTransactionRun,
-                                           list);
+        rc = virProcessRunInNamespaceHelper(pid,
+                                            virSecuritySELinuxTransactionRun,
+                                            list);
         if (rc < 0) {
             if (virGetLastErrorCode() == VIR_ERR_SYSTEM_ERROR)
                 pid = -1;
@@ -2133,9 +2133,9 @@ virSecuritySELinuxMoveImageMetadata(virSecurityManager *mgr,
         rc = virProcessRunInFork(virSecuritySELinuxMoveImageMetadataHelper,
                                  &data);
     } else {
-        rc = virProcessRunInMountNamespace(pid,
-                                           virSecuritySELinuxMoveImageMetadataHelper,
-                                           &data);
+        rc = virProcessRunInNamespaceHelper(pid,
+                                            virSecuritySELinuxMoveImageMetadataHelper,
+                                            &data);
     }
 
     return rc;
@@ -114,6 +114,56 @@ reflinkCloneFile(int dest_fd G_GNUC_UNUSED,
 #endif
 
 
+/*
+ * Copy up to @total bytes from the current position of @src_fd to the
+ * current position of @dest_fd within the kernel. Both file positions are
+ * advanced by the amount copied which is subtracted from @total, so that
+ * the caller can finish the copy by other means if the kernel can't
+ * handle the whole range.
+ * Returns 0 when done or the copy isn't supported, -1 on error with errno set.
+ */
+#if WITH_COPY_FILE_RANGE
+static int
+storageBackendCopyFileRange(int dest_fd,
+                            int src_fd,
+                            unsigned long long *total)
+{
+    while (*total > 0) {
+        ssize_t copied = copy_file_range(src_fd, NULL, dest_fd, NULL,
+                                         MIN(*total, SSIZE_MAX), 0);
+
+        if (copied < 0) {
+            if (errno == EINTR)
+                continue;
+
+            if (errno == EXDEV || errno == ENOSYS ||
+                errno == EOPNOTSUPP || errno == EINVAL) {
+                VIR_DEBUG("copy_file_range not usable: %s", g_strerror(errno));
+                return 0;
+            }
+
+            return -1;
+        }
+
+        if (copied == 0)
+            break;
+
+        *total -= copied;
+    }
+
+    return 0;
+}
+#else
+static int
+storageBackendCopyFileRange(int dest_fd G_GNUC_UNUSED,
+                            int src_fd G_GNUC_UNUSED,
+                            unsigned long long *total G_GNUC_UNUSED)
+{
+    return 0;
+}
+#endif
+
+
 static int ATTRIBUTE_NONNULL(2)
 virStorageBackendCopyToFD(virStorageVolDef *vol,
                           virStorageVolDef *inputvol,
@@ -163,6 +213,16 @@ virStorageBackendCopyToFD(virStorageVolDef *vol,
         }
     }
 
+    /* Let the kernel (or the storage) do the copy when the holes don't
+     * need to be preserved. Whatever remains is copied below. */
+    if (!want_sparse &&
+        storageBackendCopyFileRange(fd, inputfd, total) < 0) {
+        virReportSystemError(errno,
+                             _("failed copying from file '%1$s'"),
+                             inputvol->target.path);
+        return -1;
+    }
+
     while (amtread != 0) {
         int amtleft;
 
@@ -2551,18 +2611,181 @@ storageBackendVolZeroSparseFileLocal(const char *path,
 }
 
 
+/* Size of the buffer used for overwriting volumes. It's aligned so that it
+ * can be used for O_DIRECT writes which keep the wipe from evicting the
+ * whole page cache. */
+#define WIPE_BUFFER_SIZE (1024 * 1024)
+#define WIPE_BUFFER_ALIGN (64 * 1024)
+
+
+/**
+ * storageBackendWipeLocalOffload:
+ * @path: path of the volume
+ * @fd: file descriptor opened for writing
+ * @isblock: whether @fd refers to a block device
+ * @start: offset of the first byte to wipe
+ * @wipe_len: number of bytes to wipe
+ *
+ * Attempts to zero out the given range without transferring the data,
+ * using BLKZEROOUT for block devices (which lets the kernel use write
+ * zeroes or unmap offloads of the device) or FALLOC_FL_ZERO_RANGE for
+ * regular files.
+ *
+ * Returns 1 if the range was zeroed, 0 if the offload isn't supported and
+ * the caller needs to write the zeroes and -1 on error.
+ */
+static int
+storageBackendWipeLocalOffload(const char *path G_GNUC_UNUSED,
+                               int fd G_GNUC_UNUSED,
+                               bool isblock,
+                               off_t start G_GNUC_UNUSED,
+                               unsigned long long wipe_len G_GNUC_UNUSED)
+{
+    if (isblock) {
+#if defined(__linux__) && defined(BLKZEROOUT)
+        uint64_t range[2] = { start, wipe_len };
+
+        if (start % 512 != 0 || wipe_len % 512 != 0)
+            return 0;
+
+        if (ioctl(fd, BLKZEROOUT, range) == 0)
+            return 1;
+
+        if (errno != ENOTTY && errno != EOPNOTSUPP && errno != EINVAL) {
+            virReportSystemError(errno,
+                                 _("Failed to zero out %1$llu bytes of volume with path '%2$s'"),
+                                 wipe_len, path);
+            return -1;
+        }
+
+        VIR_DEBUG("BLKZEROOUT not supported on '%s': %s",
+                  path, g_strerror(errno));
+#endif
+        return 0;
+    }
+
+/* Avoid issues with older kernel's <linux/fs.h> namespace pollution. */
+#if WITH_FALLOCATE - 0 && defined(FALLOC_FL_ZERO_RANGE)
+    if (fallocate(fd, FALLOC_FL_ZERO_RANGE | FALLOC_FL_KEEP_SIZE,
+                  start, wipe_len) == 0)
+        return 1;
+
+    if (errno != ENOSYS && errno != EOPNOTSUPP && errno != EINVAL) {
+        virReportSystemError(errno,
+                             _("Failed to zero out %1$llu bytes of volume with path '%2$s'"),
+                             wipe_len, path);
+        return -1;
+    }
+
+    VIR_DEBUG("FALLOC_FL_ZERO_RANGE not supported on '%s': %s",
+              path, g_strerror(errno));
+#endif
+
+    return 0;
+}
+
+
+static int
+storageBackendWipeLocalWrite(const char *path,
+                             int fd,
+                             off_t start,
+                             unsigned long long wipe_len,
+                             size_t blksize)
+{
+    unsigned long long remaining = wipe_len;
+    off_t offset = start;
+    g_autofree void *base = NULL; /* Location to be freed */
+    char *writebuf = NULL; /* Aligned location within base */
+    size_t writebuf_length = VIR_ROUND_UP(WIPE_BUFFER_SIZE, blksize);
+    int directflag = virFileDirectFdFlag();
+    VIR_AUTOCLOSE directfd = -1;
+
+#if WITH_POSIX_MEMALIGN
+    if (posix_memalign(&base, WIPE_BUFFER_ALIGN, writebuf_length))
+        abort();
+    writebuf = base;
+    memset(writebuf, 0, writebuf_length);
+#else
+    writebuf = g_new0(char, writebuf_length + WIPE_BUFFER_ALIGN - 1);
+    base = writebuf;
+    writebuf = (char *) VIR_ROUND_UP((intptr_t) base, WIPE_BUFFER_ALIGN);
+#endif
+
+    /* The bulk of the volume is written bypassing the page cache; the
+     * unaligned tail, if any, is written through @fd. */
+    if (directflag > 0 && start % blksize == 0 && wipe_len >= blksize) {
+        if ((directfd = open(path, O_WRONLY | directflag)) < 0 ||
+            lseek(directfd, start, SEEK_SET) < 0) {
+            VIR_DEBUG("Not using O_DIRECT for wiping '%s': %s",
+                      path, g_strerror(errno));
+            VIR_FORCE_CLOSE(directfd);
+        }
+    }
+
+    while (directfd >= 0 && remaining >= blksize) {
+        size_t write_size = MIN(writebuf_length, remaining - remaining % blksize);
+
+        if (safewrite(directfd, writebuf, write_size) < 0) {
+            /* some filesystems accept O_DIRECT only to reject the I/O */
+            if (errno == EINVAL && offset == start) {
+                VIR_DEBUG("O_DIRECT write to '%s' rejected", path);
+                VIR_FORCE_CLOSE(directfd);
+                break;
+            }
+
+            virReportSystemError(errno,
+                                 _("Failed to write %1$zu bytes to storage volume with path '%2$s'"),
+                                 write_size, path);
+            return -1;
+        }
+
+        remaining -= write_size;
+        offset += write_size;
+    }
+
+    if (remaining > 0 && lseek(fd, offset, SEEK_SET) < 0) {
+        virReportSystemError(errno,
+                             _("Failed to seek to %1$jd in volume with path '%2$s'"),
+                             (intmax_t) offset, path);
+        return -1;
+    }
+
+    while (remaining > 0) {
+        size_t write_size = MIN(writebuf_length, remaining);
+        int written = safewrite(fd, writebuf, write_size);
+
+        if (written < 0) {
+            virReportSystemError(errno,
+                                 _("Failed to write %1$zu bytes to storage volume with path '%2$s'"),
+                                 write_size, path);
+
+            return -1;
+        }
+
+        remaining -= written;
+    }
+
+    if (directfd >= 0 && virFileDataSync(directfd) < 0) {
+        virReportSystemError(errno,
+                             _("cannot sync data to volume with path '%1$s'"),
+                             path);
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 storageBackendWipeLocal(const char *path,
                         int fd,
                         unsigned long long wipe_len,
-                        size_t writebuf_length,
+                        size_t blksize,
+                        bool isblock,
                         bool zero_end)
 {
-    unsigned long long remaining = 0;
     off_t size;
-    g_autofree char *writebuf = NULL;
-
-    writebuf = g_new0(char, writebuf_length);
+    int rc;
 
     if (!zero_end) {
         if ((size = lseek(fd, 0, SEEK_SET)) < 0) {
@@ -2582,21 +2805,16 @@ storageBackendWipeLocal(const char *path,
 
     VIR_DEBUG("wiping start: %zd len: %llu", (ssize_t)size, wipe_len);
 
-    remaining = wipe_len;
-    while (remaining > 0) {
-        size_t write_size = MIN(writebuf_length, remaining);
-        int written = safewrite(fd, writebuf, write_size);
-
-        if (written < 0) {
-            virReportSystemError(errno,
-                                 _("Failed to write %1$zu bytes to storage volume with path '%2$s'"),
-                                 write_size, path);
+    if (wipe_len == 0)
+        return 0;
 
-            return -1;
-        }
+    if ((rc = storageBackendWipeLocalOffload(path, fd, isblock,
+                                             size, wipe_len)) < 0)
+        return -1;
 
-        remaining -= written;
-    }
+    if (rc == 0 &&
+        storageBackendWipeLocalWrite(path, fd, size, wipe_len, blksize) < 0)
+        return -1;
 
     if (virFileDataSync(fd) < 0) {
         virReportSystemError(errno,
@@ -2688,8 +2906,9 @@ storageBackendVolWipeLocalFile(const char *path,
     if (S_ISREG(st.st_mode) && st.st_blocks < (st.st_size / DEV_BSIZE))
         return storageBackendVolZeroSparseFileLocal(path, st.st_size, fd);
 
-    return storageBackendWipeLocal(path, fd, allocation, st.st_blksize,
-                                   zero_end);
+    return storageBackendWipeLocal(path, fd, allocation,
+                                   st.st_blksize > 0 ? st.st_blksize : DEV_BSIZE,
+                                   S_ISBLK(st.st_mode), zero_end);
 }
 
 
@@ -22,19 +22,24 @@
 #include <config.h>
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include "internal.h"
 #include "storage_file_backend.h"
 #include "storage_file_probe.h"
 #include "storage_source.h"
+#define LIBVIRT_STORAGE_SOURCE_PRIV_H_ALLOW
+#include "storage_source_priv.h"
 #include "storage_source_backingstore.h"
 #include "viralloc.h"
 #include "virerror.h"
 #include "virfile.h"
+#include "virhash.h"
 #include "virlog.h"
 #include "virobject.h"
 #include "virstoragefile.h"
+#include "virthread.h"
 #include "virutil.h"
 
 #define VIR_FROM_THIS VIR_FROM_STORAGE
@@ -1332,6 +1337,120 @@ virStorageSourceReportBrokenChain(int errcode,
 }
 
 
+/* Images shared by many backing chains (e.g. common base images) would be
+ * re-read on every chain detection. Their headers are thus cached keyed by
+ * the identity, size and modification times of the file so that any change
+ * to the image invalidates the entry. Stale entries are never hit again and
+ * are eventually evicted as the least recently used ones. */
+typedef struct _virStorageSourceHeader virStorageSourceHeader;
+struct _virStorageSourceHeader {
+    char *key;
+    char *buf;
+    size_t len;
+    GList link; /* in virStorageSourceHeaderCacheLRU */
+};
+
+static virMutex virStorageSourceHeaderCacheLock = VIR_MUTEX_INITIALIZER;
+static GHashTable *virStorageSourceHeaderCache; /* key -> header */
+static GQueue virStorageSourceHeaderCacheLRU = G_QUEUE_INIT; /* most recent first */
+
+
+static void
+virStorageSourceHeaderFree(void *opaque)
+{
+    virStorageSourceHeader *header = opaque;
+
+    g_free(header->key);
+    g_free(header->buf);
+    g_free(header);
+}
+
+
+char *
+virStorageSourceHeaderCacheKey(virStorageSource *src,
+                               uid_t uid,
+                               gid_t gid,
+                               time_t now)
+{
+    struct stat sb;
+
+    if (virStorageSourceGetActualType(src) != VIR_STORAGE_TYPE_FILE ||
+        virStorageSourceStat(src, &sb) < 0 ||
+        !S_ISREG(sb.st_mode))
+        return NULL;
+
+    if (now - MAX(sb.st_mtime, sb.st_ctime) <
+        VIR_STORAGE_SOURCE_HEADER_CACHE_SETTLE)
+        return NULL;
+
+    return g_strdup_printf("%llu:%llu:%lld:%lld:%lld:%u:%u",
+                           (unsigned long long) sb.st_dev,
+                           (unsigned long long) sb.st_ino,
+                           (long long) sb.st_size,
+                           (long long) sb.st_mtime,
+                           (long long) sb.st_ctime,
+                           (unsigned int) uid, (unsigned int) gid);
+}
+
+
+bool
+virStorageSourceHeaderCacheLookup(const char *key,
+                                  char **buf,
+                                  size_t *len)
+{
+    VIR_LOCK_GUARD lock = virLockGuardLock(&virStorageSourceHeaderCacheLock);
+    virStorageSourceHeader *header;
+
+    if (!virStorageSourceHeaderCache ||
+        !(header = g_hash_table_lookup(virStorageSourceHeaderCache, key)))
+        return false;
+
+    g_queue_unlink(&virStorageSourceHeaderCacheLRU, &header->link);
+    g_queue_push_head_link(&virStorageSourceHeaderCacheLRU, &header->link);
+
+    *buf = g_memdup2(header->buf, header->len);
+    *len = header->len;
+    return true;
+}
+
+
+void
+virStorageSourceHeaderCacheInsert(const char *key,
+                                  const char *buf,
+                                  size_t len)
+{
+    VIR_LOCK_GUARD lock = virLockGuardLock(&virStorageSourceHeaderCacheLock);
+    virStorageSourceHeader *header;
+
+    if (!virStorageSourceHeaderCache)
+        virStorageSourceHeaderCache = g_hash_table_new_full(g_str_hash,
+                                                            g_str_equal,
+                                                            NULL,
+                                                            virStorageSourceHeaderFree);
+
+    /* another thread might have read the same image meanwhile */
+    if (g_hash_table_contains(virStorageSourceHeaderCache, key))
+        return;
+
+    if (g_hash_table_size(virStorageSourceHeaderCache) >=
+        VIR_STORAGE_SOURCE_HEADER_CACHE_MAX) {
+        GList *oldest = g_queue_pop_tail_link(&virStorageSourceHeaderCacheLRU);
+        virStorageSourceHeader *evicted = oldest->data;
+
+        g_hash_table_remove(virStorageSourceHeaderCache, evicted->key);
+    }
+
+    header = g_new0(virStorageSourceHeader, 1);
+    header->key = g_strdup(key);
+    header->buf = g_memdup2(buf, len);
+    header->len = len;
+    header->link.data = header;
+
+    g_queue_push_head_link(&virStorageSourceHeaderCacheLRU, &header->link);
+    g_hash_table_insert(virStorageSourceHeaderCache, header->key, header);
+}
+
+
 static int
 virStorageSourceGetMetadataRecurseReadHeader(virStorageSource *src,
                                              virStorageSource *parent,
@@ -1340,6 +1459,7 @@ virStorageSourceGetMetadataRecurseReadHeader(virStorageSource *src,
                                              char **buf,
                                              size_t *headerLen)
 {
+    g_autofree char *key = NULL;
     int ret = -1;
     ssize_t len;
 
@@ -1366,9 +1486,19 @@ virStorageSourceGetMetadataRecurseReadHeader(virStorageSource *src,
         goto cleanup;
     }
 
+    if ((key = virStorageSourceHeaderCacheKey(src, uid, gid, time(NULL))) &&
+        virStorageSourceHeaderCacheLookup(key, buf, headerLen)) {
+        VIR_DEBUG("using cached header of '%s'", src->path);
+        ret = 0;
+        goto cleanup;
+    }
+
     if ((len = virStorageSourceRead(src, 0, VIR_STORAGE_MAX_HEADER, buf)) < 0)
         goto cleanup;
 
+    if (key)
+        virStorageSourceHeaderCacheInsert(key, *buf, len);
+
     *headerLen = len;
     ret = 0;
 
@@ -0,0 +1,48 @@
+/*
+ * storage_source_priv.h: exposing some functions for testing
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBVIRT_STORAGE_SOURCE_PRIV_H_ALLOW
+# error "storage_source_priv.h may only be included by storage_source.c or test suites"
+#endif /* LIBVIRT_STORAGE_SOURCE_PRIV_H_ALLOW */
+
+#pragma once
+
+#include "storage_source_conf.h"
+
+/* Maximum number of cached image headers */
+#define VIR_STORAGE_SOURCE_HEADER_CACHE_MAX 512
+
+/* Files changed less than this many seconds ago are not cached as further
+ * modifications within the timestamp granularity could go unnoticed. */
+#define VIR_STORAGE_SOURCE_HEADER_CACHE_SETTLE 2
+
+char *
+virStorageSourceHeaderCacheKey(virStorageSource *src,
+                               uid_t uid,
+                               gid_t gid,
+                               time_t now);
+
+bool
+virStorageSourceHeaderCacheLookup(const char *key,
+                                  char **buf,
+                                  size_t *len);
+
+void
+virStorageSourceHeaderCacheInsert(const char *key,
+                                  const char *buf,
+                                  size_t len);
@@ -2901,6 +2901,187 @@ virCgroupGetCpuacctStat(virCgroup *group, unsigned long long *user,
 }
 
 
+struct _virCgroupCpuacctSampler {
+    virCgroupBackendType type;
+    int usageFd; /* cpuacct.usage for v1, cpu.stat for v2 */
+    int statFd; /* cpuacct.stat for v1 */
+    unsigned long long tick; /* length of a clock tick in nanoseconds */
+    char buf[1024];
+};
+
+
+static int
+virCgroupCpuacctSamplerOpen(virCgroup *group,
+                            const char *key,
+                            int *fd)
+{
+    g_autofree char *path = NULL;
+
+    if (virCgroupPathOfController(group, VIR_CGROUP_CONTROLLER_CPUACCT,
+                                  key, &path) < 0)
+        return -1;
+
+    if ((*fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+        virReportSystemError(errno, _("Unable to open '%1$s'"), path);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * virCgroupCpuacctSamplerNew:
+ * @group: the cgroup to sample
+ *
+ * Opens the files backing virCgroupGetCpuacctUsage() and
+ * virCgroupGetCpuacctStat() once, so that they can be sampled
+ * repeatedly by virCgroupCpuacctSamplerGet() without the cost of
+ * resolving and opening the paths every time.
+ *
+ * Returns the sampler or NULL on error.
+ */
+virCgroupCpuacctSampler *
+virCgroupCpuacctSamplerNew(virCgroup *group)
+{
+    virCgroup *parent = virCgroupGetNested(group);
+    virCgroupBackend *backend;
+    g_autoptr(virCgroupCpuacctSampler) sampler = g_new0(virCgroupCpuacctSampler, 1);
+    long ticks_per_sec;
+
+    sampler->usageFd = -1;
+    sampler->statFd = -1;
+
+    if (!(backend = virCgroupBackendForController(parent,
+                                                  VIR_CGROUP_CONTROLLER_CPUACCT))) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("failed to get cgroup backend for cpuacct controller"));
+        return NULL;
+    }
+
+    sampler->type = backend->type;
+
+    switch (sampler->type) {
+    case VIR_CGROUP_BACKEND_TYPE_V2:
+        if (virCgroupCpuacctSamplerOpen(parent, "cpu.stat", &sampler->usageFd) < 0)
+            return NULL;
+        break;
+
+    case VIR_CGROUP_BACKEND_TYPE_V1:
+        if ((ticks_per_sec = sysconf(_SC_CLK_TCK)) <= 0) {
+            virReportSystemError(errno, "%s",
+                                 _("Cannot determine system clock HZ"));
+            return NULL;
+        }
+        sampler->tick = 1000000000ull / ticks_per_sec;
+
+        if (virCgroupCpuacctSamplerOpen(parent, "cpuacct.usage", &sampler->usageFd) < 0 ||
+            virCgroupCpuacctSamplerOpen(parent, "cpuacct.stat", &sampler->statFd) < 0)
+            return NULL;
+        break;
+
+    case VIR_CGROUP_BACKEND_TYPE_LAST:
+    default:
+        virReportEnumRangeError(virCgroupBackendType, sampler->type);
+        return NULL;
+    }
+
+    return g_steal_pointer(&sampler);
+}
+
+
+void
+virCgroupCpuacctSamplerFree(virCgroupCpuacctSampler *sampler)
+{
+    if (!sampler)
+        return;
+
+    VIR_FORCE_CLOSE(sampler->usageFd);
+    VIR_FORCE_CLOSE(sampler->statFd);
+    g_free(sampler);
+}
+
+
+static int
+virCgroupCpuacctSamplerRead(virCgroupCpuacctSampler *sampler,
+                            int fd)
+{
+    int len;
+
+    if ((len = virFileRereadBufFD(fd, sampler->buf, sizeof(sampler->buf))) < 0) {
+        virReportSystemError(-len, "%s", _("Unable to read cpuacct statistics"));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+virCgroupCpuacctSamplerParse(const char *buf,
+                             const char *key,
+                             unsigned long long *value)
+{
+    const char *p;
+
+    if (!(p = strstr(buf, key)) ||
+        virStrToLong_ullp(p + strlen(key), NULL, 10, value) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("cannot parse cpuacct statistic '%1$s'"), key);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * virCgroupCpuacctSamplerGet:
+ * @sampler: the sampler
+ * @usage: filled with the total CPU time in nanoseconds
+ * @user: filled with the user CPU time in nanoseconds
+ * @sys: filled with the system CPU time in nanoseconds
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virCgroupCpuacctSamplerGet(virCgroupCpuacctSampler *sampler,
+                           unsigned long long *usage,
+                           unsigned long long *user,
+                           unsigned long long *sys)
+{
+    if (sampler->type == VIR_CGROUP_BACKEND_TYPE_V2) {
+        /* All three values come from a single read of cpu.stat */
+        if (virCgroupCpuacctSamplerRead(sampler, sampler->usageFd) < 0 ||
+            virCgroupCpuacctSamplerParse(sampler->buf, "usage_usec ", usage) < 0 ||
+            virCgroupCpuacctSamplerParse(sampler->buf, "user_usec ", user) < 0 ||
+            virCgroupCpuacctSamplerParse(sampler->buf, "system_usec ", sys) < 0)
+            return -1;
+
+        *usage *= 1000;
+        *user *= 1000;
+        *sys *= 1000;
+        return 0;
+    }
+
+    if (virCgroupCpuacctSamplerRead(sampler, sampler->usageFd) < 0 ||
+        virStrToLong_ullp(sampler->buf, NULL, 10, usage) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("cannot parse cpuacct.usage"));
+        return -1;
+    }
+
+    if (virCgroupCpuacctSamplerRead(sampler, sampler->statFd) < 0 ||
+        virCgroupCpuacctSamplerParse(sampler->buf, "user ", user) < 0 ||
+        virCgroupCpuacctSamplerParse(sampler->buf, "system ", sys) < 0)
+        return -1;
+
+    *user *= sampler->tick;
+    *sys *= sampler->tick;
+    return 0;
+}
+
+
 int
 virCgroupSetFreezerState(virCgroup *group, const char *state)
 {
@@ -3712,6 +3893,33 @@ virCgroupGetCpuacctStat(virCgroup *group G_GNUC_UNUSED,
 }
 
 
+virCgroupCpuacctSampler *
+virCgroupCpuacctSamplerNew(virCgroup *group G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("Control groups not supported on this platform"));
+    return NULL;
+}
+
+
+void
+virCgroupCpuacctSamplerFree(virCgroupCpuacctSampler *sampler G_GNUC_UNUSED)
+{
+}
+
+
+int
+virCgroupCpuacctSamplerGet(virCgroupCpuacctSampler *sampler G_GNUC_UNUSED,
+                           unsigned long long *usage G_GNUC_UNUSED,
+                           unsigned long long *user G_GNUC_UNUSED,
+                           unsigned long long *sys G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("Control groups not supported on this platform"));
+    return -1;
+}
+
+
 int
 virCgroupGetDomainTotalCpuStats(virCgroup *group G_GNUC_UNUSED,
                                 virTypedParameterPtr params G_GNUC_UNUSED,
@@ -254,6 +254,15 @@ int virCgroupGetCpuacctPercpuUsage(virCgroup *group, char **usage);
 int virCgroupGetCpuacctStat(virCgroup *group, unsigned long long *user,
                             unsigned long long *sys);
 
+typedef struct _virCgroupCpuacctSampler virCgroupCpuacctSampler;
+virCgroupCpuacctSampler *virCgroupCpuacctSamplerNew(virCgroup *group);
+void virCgroupCpuacctSamplerFree(virCgroupCpuacctSampler *sampler);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virCgroupCpuacctSampler, virCgroupCpuacctSamplerFree);
+int virCgroupCpuacctSamplerGet(virCgroupCpuacctSampler *sampler,
+                               unsigned long long *usage,
+                               unsigned long long *user,
+                               unsigned long long *sys);
+
 int virCgroupSetFreezerState(virCgroup *group, const char *state);
 int virCgroupGetFreezerState(virCgroup *group, char **state);
 
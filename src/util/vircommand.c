@@ -25,6 +25,9 @@
 # include <poll.h>
 #endif
 #include <signal.h>
+#ifdef WITH_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+# include <spawn.h>
+#endif
 #include <stdarg.h>
 #include <sys/stat.h>
 #ifndef WIN32
@@ -656,6 +659,123 @@ virCommandMassClose(virCommand *cmd,
 }
 
 
+# ifdef WITH_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+extern char **environ;
+
+/*
+ * virExecCanSpawn:
+ *
+ * Returns true if @cmd needs no setup in the child between fork and exec
+ * other than wiring up stdio, i.e. it can be started via posix_spawn()
+ * which avoids duplicating the page tables of the (possibly huge) daemon.
+ */
+static bool
+virExecCanSpawn(virCommand *cmd,
+                int childin,
+                int childout,
+                int childerr)
+{
+    if (cmd->hook || cmd->handshake || cmd->npassfd > 0 ||
+        cmd->pidfile || cmd->pwd || cmd->mask ||
+        cmd->uid != (uid_t)-1 || cmd->gid != (gid_t)-1 ||
+        cmd->capabilities || cmd->schedCore ||
+        cmd->setMaxMemLock || cmd->setMaxProcesses ||
+        cmd->setMaxFiles || cmd->setMaxCore ||
+        (cmd->flags & (VIR_EXEC_DAEMON | VIR_EXEC_CLEAR_CAPS)))
+        return false;
+
+#  if defined(WITH_SECDRIVER_SELINUX)
+    if (cmd->seLinuxLabel)
+        return false;
+#  endif
+#  if defined(WITH_SECDRIVER_APPARMOR)
+    if (cmd->appArmorProfile)
+        return false;
+#  endif
+
+    /* Not all implementations of posix_spawn_file_actions_adddup2() clear
+     * FD_CLOEXEC when an FD is duplicated onto itself. */
+    if (childin == STDIN_FILENO ||
+        childout == STDOUT_FILENO ||
+        childerr == STDERR_FILENO)
+        return false;
+
+    return true;
+}
+
+
+/*
+ * virExecSpawn:
+ *
+ * Starts @cmd via posix_spawn(), which on Linux uses
+ * clone(CLONE_VM|CLONE_VFORK) and thus doesn't need to copy the address
+ * space of the parent. Like virFork(), all signal handlers are reset and
+ * all signals are unblocked in the child. FDs other than stdio are closed.
+ *
+ * Returns the PID of the child, or -1 if it couldn't be started in which
+ * case no error is reported and the caller should fall back to virFork()
+ * to report the failure the usual way.
+ */
+static pid_t
+virExecSpawn(virCommand *cmd,
+             const char *binary,
+             int childin,
+             int childout,
+             int childerr)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t sigs;
+    pid_t pid = -1;
+    int rc;
+
+    if ((rc = posix_spawn_file_actions_init(&actions)) != 0)
+        goto error;
+
+    if ((rc = posix_spawnattr_init(&attr)) != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        goto error;
+    }
+
+    sigfillset(&sigs);
+    if ((rc = posix_spawnattr_setsigdefault(&attr, &sigs)) != 0)
+        goto cleanup;
+
+    sigemptyset(&sigs);
+    if ((rc = posix_spawnattr_setsigmask(&attr, &sigs)) != 0 ||
+        (rc = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF |
+                                              POSIX_SPAWN_SETSIGMASK)) != 0)
+        goto cleanup;
+
+    if ((rc = posix_spawn_file_actions_adddup2(&actions, childin,
+                                               STDIN_FILENO)) != 0 ||
+        (rc = posix_spawn_file_actions_adddup2(&actions, childout,
+                                               STDOUT_FILENO)) != 0 ||
+        (rc = posix_spawn_file_actions_adddup2(&actions, childerr,
+                                               STDERR_FILENO)) != 0 ||
+        (rc = posix_spawn_file_actions_addclosefrom_np(&actions,
+                                                       STDERR_FILENO + 1)) != 0)
+        goto cleanup;
+
+    rc = posix_spawn(&pid, binary, &actions, &attr, cmd->args,
+                     cmd->env ? cmd->env : environ);
+
+ cleanup:
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+ error:
+    if (rc != 0) {
+        VIR_DEBUG("Unable to spawn %s, falling back to fork: %s",
+                  binary, g_strerror(rc));
+        return -1;
+    }
+
+    return pid;
+}
+# endif /* WITH_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP */
+
+
 /*
  * virExec:
  * @cmd virCommand * containing all information about the program to
@@ -675,7 +795,7 @@ virExec(virCommand *cmd)
     const char *binary = NULL;
     int ret;
     g_autofree gid_t *groups = NULL;
-    int ngroups;
+    int ngroups = 0;
 
     if (!(binary = virCommandGetBinaryPath(cmd)))
         return -1;
@@ -732,12 +852,18 @@ virExec(virCommand *cmd)
         childerr = null;
     }
 
-    ngroups = virGetGroupList(cmd->uid, cmd->gid, &groups);
+    pid = -1;
+# ifdef WITH_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP
+    if (virExecCanSpawn(cmd, childin, childout, childerr))
+        pid = virExecSpawn(cmd, binary, childin, childout, childerr);
+# endif
 
-    pid = virFork();
+    if (pid < 0) {
+        ngroups = virGetGroupList(cmd->uid, cmd->gid, &groups);
 
-    if (pid < 0)
-        goto cleanup;
+        if ((pid = virFork()) < 0)
+            goto cleanup;
+    }
 
     if (pid) { /* parent */
         VIR_FORCE_CLOSE(null);
@@ -63,11 +63,13 @@ struct virEventGLibTimeout
 
 static GMutex *eventlock;
 
+/* Both tables are indexed by the watch/timer ID. Entries marked as
+ * removed stay in the table until the idle callback frees them. */
 static int nextwatch = 1;
-static GPtrArray *handles;
+static GHashTable *handles;
 
 static int nexttimer = 1;
-static GPtrArray *timeouts;
+static GHashTable *timeouts;
 
 static GIOCondition
 virEventGLibEventsToCondition(int events)
@@ -152,7 +154,7 @@ virEventGLibHandleAdd(int fd,
             fd, cond, NULL, virEventGLibHandleDispatch, data, NULL);
     }
 
-    g_ptr_array_add(handles, data);
+    g_hash_table_insert(handles, GINT_TO_POINTER(data->watch), data);
 
     ret = data->watch;
 
@@ -167,21 +169,14 @@ virEventGLibHandleAdd(int fd,
 static struct virEventGLibHandle *
 virEventGLibHandleFind(int watch)
 {
-    guint i;
+    struct virEventGLibHandle *h;
 
-    for (i = 0; i < handles->len; i++) {
-        struct virEventGLibHandle *h = g_ptr_array_index(handles, i);
+    h = g_hash_table_lookup(handles, GINT_TO_POINTER(watch));
 
-        if (h == NULL) {
-            g_warn_if_reached();
-            continue;
-        }
-
-        if ((h->watch == watch) && !h->removed)
-            return h;
-    }
+    if (!h || h->removed)
+        return NULL;
 
-    return NULL;
+    return h;
 }
 
 
@@ -248,7 +243,7 @@ virEventGLibHandleRemoveIdle(gpointer data)
         (h->ff)(h->opaque);
 
     g_mutex_lock(eventlock);
-    g_ptr_array_remove_fast(handles, h);
+    g_hash_table_remove(handles, GINT_TO_POINTER(h->watch));
     g_mutex_unlock(eventlock);
 
     return FALSE;
@@ -348,7 +343,7 @@ virEventGLibTimeoutAdd(int interval,
     if (interval >= 0)
         data->source = virEventGLibTimeoutCreate(interval, data);
 
-    g_ptr_array_add(timeouts, data);
+    g_hash_table_insert(timeouts, GINT_TO_POINTER(data->timer), data);
 
     VIR_DEBUG("Add timeout data=%p interval=%d ms cb=%p opaque=%p timer=%d",
               data, interval, cb, opaque, data->timer);
@@ -367,23 +362,16 @@ virEventGLibTimeoutAdd(int interval,
 static struct virEventGLibTimeout *
 virEventGLibTimeoutFind(int timer)
 {
-    guint i;
+    struct virEventGLibTimeout *t;
 
     g_return_val_if_fail(timeouts != NULL, NULL);
 
-    for (i = 0; i < timeouts->len; i++) {
-        struct virEventGLibTimeout *t = g_ptr_array_index(timeouts, i);
+    t = g_hash_table_lookup(timeouts, GINT_TO_POINTER(timer));
 
-        if (t == NULL) {
-            g_warn_if_reached();
-            continue;
-        }
-
-        if ((t->timer == timer) && !t->removed)
-            return t;
-    }
+    if (!t || t->removed)
+        return NULL;
 
-    return NULL;
+    return t;
 }
 
 
@@ -440,7 +428,7 @@ virEventGLibTimeoutRemoveIdle(gpointer data)
         (t->ff)(t->opaque);
 
     g_mutex_lock(eventlock);
-    g_ptr_array_remove_fast(timeouts, t);
+    g_hash_table_remove(timeouts, GINT_TO_POINTER(t->timer));
     g_mutex_unlock(eventlock);
 
     return FALSE;
@@ -490,8 +478,8 @@ virEventGLibTimeoutRemove(int timer)
 static gpointer virEventGLibRegisterOnce(gpointer data G_GNUC_UNUSED)
 {
     eventlock = g_new0(GMutex, 1);
-    timeouts = g_ptr_array_new_with_free_func(g_free);
-    handles = g_ptr_array_new_with_free_func(g_free);
+    timeouts = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    handles = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
     virEventRegisterImpl(virEventGLibHandleAdd,
                          virEventGLibHandleUpdate,
                          virEventGLibHandleRemove,
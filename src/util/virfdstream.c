@@ -26,6 +26,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #ifndef WIN32
+# include <signal.h>
 # include <termios.h>
 #endif
 
@@ -46,6 +47,9 @@
 VIR_LOG_INIT("fdstream");
 
 #ifndef WIN32
+/* Amount of data the helper thread moves at once */
+# define VIR_FDSTREAM_BUFFER_SIZE (1024 * 1024)
+
 typedef enum {
     VIR_FDSTREAM_MSG_TYPE_DATA,
     VIR_FDSTREAM_MSG_TYPE_HOLE,
@@ -105,6 +109,7 @@ struct virFDStreamData {
     bool threadQuit;
     bool threadAbort;
     bool threadDoRead;
+    bool threadSplice;  /* data is passed through the pipe, not in @msg */
     virFDStreamMsg *msg;
 };
 
@@ -394,6 +399,7 @@ struct _virFDStreamThreadData {
     bool doRead;
     bool sparse;
     bool isBlock;
+    bool splice;
     int fdin;
     char *fdinname;
     int fdout;
@@ -568,6 +574,7 @@ virFDStreamThreadDoWrite(virFDStreamData *fdst,
                 toWrite -= r;
             }
         } else {
+            struct stat sb;
             off_t off;
 
             off = lseek(fdout, got, SEEK_CUR);
@@ -578,7 +585,17 @@ virFDStreamThreadDoWrite(virFDStreamData *fdst,
                 return -1;
             }
 
-            if (ftruncate(fdout, off) < 0) {
+            if (fstat(fdout, &sb) < 0) {
+                virReportSystemError(errno,
+                                     _("unable to stat %1$s"),
+                                     fdoutname);
+                return -1;
+            }
+
+            /* Never shrink the file as other streams may be writing
+             * ranges past this one concurrently. */
+            if (sb.st_size < off &&
+                ftruncate(fdout, off) < 0) {
                 virReportSystemError(errno,
                                      _("unable to truncate %1$s"),
                                      fdoutname);
@@ -599,6 +616,117 @@ virFDStreamThreadDoWrite(virFDStreamData *fdst,
 }
 
 
+/* Splicing directly between the file and the pipe avoids copying the data
+ * to userspace and back, larger chunks need fewer wakeups of the thread. */
+static ssize_t
+virFDStreamSplice(int fdin,
+                  int fdout,
+                  size_t len)
+{
+# ifdef WITH_SPLICE
+    ssize_t ret;
+
+    do {
+        ret = splice(fdin, NULL, fdout, NULL, len,
+                     SPLICE_F_MOVE | SPLICE_F_MORE);
+    } while (ret < 0 && errno == EINTR);
+
+    return ret;
+# else /* !WITH_SPLICE */
+    errno = ENOSYS;
+    return -1;
+# endif /* !WITH_SPLICE */
+}
+
+
+/**
+ * virFDStreamThreadCopy:
+ *
+ * Moves the data of a non-sparse stream between the file and the pipe which
+ * the other end of the stream reads from or writes to directly. Falls back
+ * to read() and write() if the file doesn't support splice().
+ *
+ * Returns 0 on EOF, on reaching @length or when the stream is closed, -1 on
+ * error.
+ */
+static int
+virFDStreamThreadCopy(virFDStreamData *fdst,
+                      const int fdin,
+                      const int fdout,
+                      const char *fdinname,
+                      const char *fdoutname,
+                      size_t length)
+{
+    g_autofree char *buf = NULL;
+    size_t total = 0;
+    sigset_t sigpipe;
+
+    /* Writing to the pipe after its other end was closed by
+     * virFDStreamJoinWorker must fail with EPIPE, not kill us */
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    ignore_value(pthread_sigmask(SIG_BLOCK, &sigpipe, NULL));
+
+    while (!length || total < length) {
+        size_t want = VIR_FDSTREAM_BUFFER_SIZE;
+        ssize_t got = -1;
+
+        VIR_WITH_OBJECT_LOCK_GUARD(fdst) {
+            if (fdst->threadAbort)
+                return 0;
+        }
+
+        if (length && want > length - total)
+            want = length - total;
+
+        if (!buf) {
+            got = virFDStreamSplice(fdin, fdout, want);
+
+            if (got < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                VIR_DEBUG("Cannot splice %s to %s: %s",
+                          fdinname, fdoutname, g_strerror(errno));
+                buf = g_new0(char, VIR_FDSTREAM_BUFFER_SIZE);
+            }
+        }
+
+        if (buf) {
+            if ((got = saferead(fdin, buf, want)) < 0) {
+                virReportSystemError(errno,
+                                     _("Unable to read %1$s"),
+                                     fdinname);
+                return -1;
+            }
+
+            if (got > 0 &&
+                safewrite(fdout, buf, got) < 0)
+                got = -1;
+        }
+
+        if (got < 0) {
+            int err = errno;
+
+            VIR_WITH_OBJECT_LOCK_GUARD(fdst) {
+                /* the reader closed the stream before reaching EOF */
+                if (err == EPIPE && fdst->threadQuit)
+                    return 0;
+            }
+
+            virReportSystemError(err,
+                                 _("Unable to write %1$s"),
+                                 fdoutname);
+            return -1;
+        }
+
+        if (got == 0)
+            break;
+
+        total += got;
+    }
+
+    return 0;
+}
+
+
 static void
 virFDStreamThread(void *opaque)
 {
@@ -613,11 +741,22 @@ virFDStreamThread(void *opaque)
     char *fdoutname = data->fdoutname;
     virFDStreamData *fdst = st->privateData;
     bool doRead = fdst->threadDoRead;
-    size_t buflen = 256 * 1024;
+    size_t buflen = VIR_FDSTREAM_BUFFER_SIZE;
     size_t total = 0;
     size_t dataLen = 0;
 
     virObjectRef(fdst);
+
+    if (fdst->threadSplice) {
+        int rc = virFDStreamThreadCopy(fdst, fdin, fdout,
+                                       fdinname, fdoutname, length);
+
+        virObjectLock(fdst);
+        if (rc < 0)
+            goto error;
+        goto cleanup;
+    }
+
     virObjectLock(fdst);
 
     while (1) {
@@ -690,6 +829,11 @@ virFDStreamJoinWorker(virFDStreamData *fdst,
     fdst->threadQuit = true;
     virCondSignal(&fdst->threadCond);
 
+    /* The thread may be blocked on the pipe. Closing our end of it makes
+     * the thread see EOF or get EPIPE. */
+    if (fdst->threadSplice)
+        VIR_FORCE_CLOSE(fdst->fd);
+
     /* Give the thread a chance to lock the FD stream object. */
     virObjectUnlock(fdst);
     virThreadJoin(fdst->thread);
@@ -824,8 +968,6 @@ static int virFDStreamWrite(virStreamPtr st, const char *bytes, size_t nbytes)
     }
 
     if (fdst->thread) {
-        char *buf;
-
         if (fdst->threadQuit || fdst->threadErr) {
 
             /* virStreamSend will virResetLastError possibly set
@@ -836,13 +978,12 @@ static int virFDStreamWrite(virStreamPtr st, const char *bytes, size_t nbytes)
                 virReportSystemError(EBADF, "%s", _("cannot write to stream"));
             goto cleanup;
         }
+    }
 
+    if (fdst->thread && !fdst->threadSplice) {
         msg = g_new0(virFDStreamMsg, 1);
-        buf = g_new0(char, nbytes);
-
-        memcpy(buf, bytes, nbytes);
         msg->type = VIR_FDSTREAM_MSG_TYPE_DATA;
-        msg->stream.data.buf = buf;
+        msg->stream.data.buf = g_memdup2(bytes, nbytes);
         msg->stream.data.len = nbytes;
 
         virFDStreamMsgQueuePush(fdst, &msg, fdst->fd, "pipe");
@@ -903,7 +1044,7 @@ static int virFDStreamRead(virStreamPtr st, char *bytes, size_t nbytes)
             nbytes = fdst->length - fdst->offset;
     }
 
-    if (fdst->thread) {
+    if (fdst->thread && !fdst->threadSplice) {
         virFDStreamMsg *msg = NULL;
 
         while (!(msg = fdst->msg)) {
@@ -974,6 +1115,13 @@ static int virFDStreamRead(virStreamPtr st, char *bytes, size_t nbytes)
             }
             goto cleanup;
         }
+
+        /* the pipe is closed early if the thread failed */
+        if (ret == 0 && fdst->threadErr) {
+            virSetError(fdst->threadErr);
+            ret = -1;
+            goto cleanup;
+        }
     }
 
     if (fdst->length)
@@ -1005,7 +1153,11 @@ virFDStreamSendHole(virStreamPtr st,
         fdst->offset += length;
     }
 
-    if (fdst->thread) {
+    if (fdst->threadSplice) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("unexpected stream hole"));
+        goto cleanup;
+    } else if (fdst->thread) {
         /* Things are a bit complicated here. If FDStream is in a
          * read mode, then if the message at the queue head is
          * HOLE, just pop it. The thread has lseek()-ed anyway.
@@ -1041,6 +1193,8 @@ virFDStreamSendHole(virStreamPtr st,
             virFDStreamMsgQueuePush(fdst, &msg, fdst->fd, "pipe");
         }
     } else {
+        struct stat sb;
+
         off = lseek(fdst->fd, length, SEEK_CUR);
         if (off == (off_t) -1) {
             virReportSystemError(errno, "%s",
@@ -1048,7 +1202,14 @@ virFDStreamSendHole(virStreamPtr st,
             goto cleanup;
         }
 
-        if (ftruncate(fdst->fd, off) < 0) {
+        if (fstat(fdst->fd, &sb) < 0) {
+            virReportSystemError(errno, "%s",
+                                 _("unable to stat"));
+            goto cleanup;
+        }
+
+        if (sb.st_size < off &&
+            ftruncate(fdst->fd, off) < 0) {
             virReportSystemError(errno, "%s",
                                  _("unable to truncate"));
             goto cleanup;
@@ -1072,7 +1233,10 @@ virFDStreamInData(virStreamPtr st,
 
     virObjectLock(fdst);
 
-    if (fdst->thread) {
+    if (fdst->threadSplice) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("stream is not sparse"));
+    } else if (fdst->thread) {
         virFDStreamMsg *msg;
 
         if (fdst->threadErr)
@@ -1150,6 +1314,7 @@ static int virFDStreamOpenInternal(virStreamPtr st,
 
     if (threadData) {
         fdst->threadDoRead = threadData->doRead;
+        fdst->threadSplice = threadData->splice;
 
         /* Create the thread after fdst and st were initialized.
          * The thread worker expects them to be that way. */
@@ -1310,6 +1475,17 @@ virFDStreamOpenFileInternal(virStreamPtr st,
         threadData->length = length;
         threadData->sparse = sparse;
         threadData->isBlock = !!S_ISBLK(sb.st_mode);
+# ifdef WITH_SPLICE
+        /* Without holes, the data can travel through the pipe itself */
+        threadData->splice = !sparse;
+
+#  ifdef F_SETPIPE_SZ
+        if (threadData->splice &&
+            fcntl(pipefds[0], F_SETPIPE_SZ, VIR_FDSTREAM_BUFFER_SIZE) < 0)
+            VIR_DEBUG("Unable to enlarge pipe of %s: %s",
+                      path, g_strerror(errno));
+#  endif /* F_SETPIPE_SZ */
+# endif /* WITH_SPLICE */
 
         if ((oflags & O_ACCMODE) == O_RDONLY) {
             threadData->fdin = fd;
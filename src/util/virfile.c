@@ -624,6 +624,74 @@ int virFileUnlock(int fd, off_t start, off_t len)
 }
 
 
+/**
+ * virFileLockOFD:
+ * @fd: file descriptor to acquire the lock on
+ * @shared: type of lock to acquire
+ * @start: byte offset to start lock
+ * @len: length of lock (0 to acquire entire remaining file from @start)
+ * @waitForLock: wait for previously held lock or not
+ *
+ * Like virFileLock, but the lock is associated with the open file
+ * description of @fd rather than with the process. It thus conflicts with
+ * locks acquired by other threads via other file descriptors and isn't
+ * released when another file descriptor pointing to the same file is
+ * closed. Falls back to virFileLock where such locks are not supported.
+ *
+ * Returns 0 on success, or -errno otherwise
+ */
+int virFileLockOFD(int fd, bool shared, off_t start, off_t len, bool waitForLock)
+{
+# ifdef F_OFD_SETLK
+    struct flock fl = {
+        .l_type = shared ? F_RDLCK : F_WRLCK,
+        .l_whence = SEEK_SET,
+        .l_start = start,
+        .l_len = len,
+    };
+
+    int cmd = waitForLock ? F_OFD_SETLKW : F_OFD_SETLK;
+
+    if (fcntl(fd, cmd, &fl) < 0)
+        return -errno;
+
+    return 0;
+# else /* !F_OFD_SETLK */
+    return virFileLock(fd, shared, start, len, waitForLock);
+# endif /* !F_OFD_SETLK */
+}
+
+
+/**
+ * virFileUnlockOFD:
+ * @fd: file descriptor to release the lock on
+ * @start: byte offset to start unlock
+ * @len: length of lock (0 to release entire remaining file from @start)
+ *
+ * Release a lock previously acquired with virFileLockOFD().
+ *
+ * Returns 0 on success, or -errno on error
+ */
+int virFileUnlockOFD(int fd, off_t start, off_t len)
+{
+# ifdef F_OFD_SETLK
+    struct flock fl = {
+        .l_type = F_UNLCK,
+        .l_whence = SEEK_SET,
+        .l_start = start,
+        .l_len = len,
+    };
+
+    if (fcntl(fd, F_OFD_SETLK, &fl) < 0)
+        return -errno;
+
+    return 0;
+# else /* !F_OFD_SETLK */
+    return virFileUnlock(fd, start, len);
+# endif /* !F_OFD_SETLK */
+}
+
+
 #else /* WIN32 */
 
 
@@ -645,6 +713,24 @@ int virFileUnlock(int fd G_GNUC_UNUSED,
 }
 
 
+int virFileLockOFD(int fd G_GNUC_UNUSED,
+                   bool shared G_GNUC_UNUSED,
+                   off_t start G_GNUC_UNUSED,
+                   off_t len G_GNUC_UNUSED,
+                   bool waitForLock G_GNUC_UNUSED)
+{
+    return -ENOSYS;
+}
+
+
+int virFileUnlockOFD(int fd G_GNUC_UNUSED,
+                     off_t start G_GNUC_UNUSED,
+                     off_t len G_GNUC_UNUSED)
+{
+    return -ENOSYS;
+}
+
+
 #endif /* WIN32 */
 
 
@@ -1662,6 +1748,37 @@ virFileReadBufQuiet(const char *file, char *buf, int len)
     return sz;
 }
 
+/* Read the contents of an already opened @fd from offset 0 into
+ * preallocated buffer @buf of size @len, regardless of the current
+ * file offset. This allows keeping files from procfs or sysfs open
+ * and re-reading them without paying for open() and close() on
+ * every sample. Return value is -errno in case of errors and size
+ * of data read (no trailing zero) in case of success. If there is
+ * more data then @len - 1 then data will be truncated. */
+int
+virFileRereadBufFD(int fd, char *buf, int len)
+{
+    ssize_t nread = 0;
+
+    while (nread < len - 1) {
+        ssize_t r = pread(fd, buf + nread, len - 1 - nread, nread);
+
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+
+        if (r == 0)
+            break;
+
+        nread += r;
+    }
+
+    buf[nread] = '\0';
+    return nread;
+}
+
 /* Truncate @path and write @str to it.  If @mode is 0, ensure that
    @path exists; otherwise, use @mode if @path must be created.
    Return 0 for success, nonzero for failure.
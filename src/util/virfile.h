@@ -127,6 +127,10 @@ int virFileLock(int fd, bool shared, off_t start, off_t len, bool waitForLock)
     ATTRIBUTE_MOCKABLE;
 int virFileUnlock(int fd, off_t start, off_t len)
     ATTRIBUTE_MOCKABLE;
+int virFileLockOFD(int fd, bool shared, off_t start, off_t len, bool waitForLock)
+    ATTRIBUTE_MOCKABLE;
+int virFileUnlockOFD(int fd, off_t start, off_t len)
+    ATTRIBUTE_MOCKABLE;
 
 typedef int (*virFileRewriteFunc)(int fd,
                                   const char *path,
@@ -172,6 +176,8 @@ int virFileReadAllQuiet(const char *path, int maxlen, char **buf)
     G_GNUC_WARN_UNUSED_RESULT ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(3);
 int virFileReadBufQuiet(const char *file, char *buf, int len)
     G_GNUC_WARN_UNUSED_RESULT ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2);
+int virFileRereadBufFD(int fd, char *buf, int len)
+    G_GNUC_WARN_UNUSED_RESULT ATTRIBUTE_NONNULL(2);
 
 int virFileWriteStr(const char *path, const char *str, mode_t mode)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2) G_GNUC_WARN_UNUSED_RESULT;
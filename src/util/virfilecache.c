@@ -32,6 +32,7 @@
 #include "virhash.h"
 #include "virlog.h"
 #include "virobject.h"
+#include "virthread.h"
 
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -41,6 +42,22 @@
 
 VIR_LOG_INIT("util.filecache");
 
+/*
+ * Binary cache files consist of this header followed by the data formatted
+ * by the formatBinary() handler. They are only ever read by the host which
+ * wrote them, so native byte order is used.
+ */
+#define VIR_FILE_CACHE_BINARY_MAGIC "LVFCBIN"
+#define VIR_FILE_CACHE_BINARY_MAX_LEN (64 * 1024 * 1024)
+
+typedef struct _virFileCacheBinaryHeader virFileCacheBinaryHeader;
+struct _virFileCacheBinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t len;
+};
+
 
 struct _virFileCache {
     virObjectLockable parent;
@@ -96,7 +113,8 @@ VIR_ONCE_GLOBAL_INIT(virFileCache);
 
 static char *
 virFileCacheGetFileName(virFileCache *cache,
-                        const char *name)
+                        const char *name,
+                        bool binary)
 {
     g_autofree char *namehash = NULL;
     g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
@@ -113,13 +131,153 @@ virFileCacheGetFileName(virFileCache *cache,
 
     virBufferAsprintf(&buf, "%s/%s", cache->dir, namehash);
 
-    if (cache->suffix)
+    if (binary)
+        virBufferAddLit(&buf, ".bin");
+    else if (cache->suffix)
         virBufferAsprintf(&buf, ".%s", cache->suffix);
 
     return virBufferContentAndReset(&buf);
 }
 
 
+static int
+virFileCacheSaveBinaryHelper(int fd,
+                             const char *path,
+                             const void *opaque)
+{
+    const GByteArray *buf = opaque;
+
+    if (safewrite(fd, buf->data, buf->len) < 0) {
+        virReportSystemError(errno, _("cannot write data to file '%1$s'"),
+                             path);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ * virFileCacheSaveBinary:
+ *
+ * Stores the binary representation of @data if @cache supports one.
+ * Failures are not fatal as the regular cache file is still present.
+ */
+static void
+virFileCacheSaveBinary(virFileCache *cache,
+                       const char *name,
+                       void *data)
+{
+    virFileCacheBinaryHeader hdr = {
+        .magic = VIR_FILE_CACHE_BINARY_MAGIC,
+        .version = cache->handlers.binaryVersion,
+    };
+    g_autofree char *file = NULL;
+    g_autoptr(GByteArray) buf = NULL;
+
+    if (!cache->handlers.formatBinary)
+        return;
+
+    if (!(file = virFileCacheGetFileName(cache, name, true)) ||
+        !(buf = cache->handlers.formatBinary(data, cache->priv))) {
+        VIR_WARN("Failed to format binary cached data for '%s': %s",
+                 name, virGetLastErrorMessage());
+        virResetLastError();
+        return;
+    }
+
+    hdr.len = buf->len;
+    g_byte_array_prepend(buf, (const guint8 *) &hdr, sizeof(hdr));
+
+    if (virFileRewrite(file, 0600, -1, -1,
+                       virFileCacheSaveBinaryHelper, buf) < 0) {
+        VIR_WARN("Failed to save binary cached data '%s' for '%s': %s",
+                 file, name, virGetLastErrorMessage());
+        virResetLastError();
+        return;
+    }
+
+    VIR_DEBUG("Saved binary cached data '%s' for '%s'", file, name);
+}
+
+
+/**
+ * virFileCacheLoadBinary:
+ *
+ * Loads @data from its binary representation if @cache supports one.
+ *
+ * Returns 1 if valid data was loaded, 0 if the regular cache file needs to
+ * be used instead.
+ */
+static int
+virFileCacheLoadBinary(virFileCache *cache,
+                       const char *name,
+                       void **data)
+{
+    g_autofree char *file = NULL;
+    g_autofree char *buf = NULL;
+    virFileCacheBinaryHeader hdr;
+    void *loadData = NULL;
+    bool outdated = false;
+    int len;
+
+    *data = NULL;
+
+    if (!cache->handlers.loadBinary)
+        return 0;
+
+    if (!(file = virFileCacheGetFileName(cache, name, true))) {
+        virResetLastError();
+        return 0;
+    }
+
+    if (!virFileExists(file))
+        return 0;
+
+    if ((len = virFileReadAll(file, VIR_FILE_CACHE_BINARY_MAX_LEN, &buf)) < 0) {
+        VIR_WARN("Failed to read binary cached data '%s' for '%s': %s",
+                 file, name, virGetLastErrorMessage());
+        virResetLastError();
+        return 0;
+    }
+
+    if ((size_t) len < sizeof(hdr))
+        goto incompatible;
+
+    memcpy(&hdr, buf, sizeof(hdr));
+
+    if (memcmp(hdr.magic, VIR_FILE_CACHE_BINARY_MAGIC, sizeof(hdr.magic)) != 0 ||
+        hdr.version != cache->handlers.binaryVersion ||
+        hdr.len != (size_t) len - sizeof(hdr))
+        goto incompatible;
+
+    if (!(loadData = cache->handlers.loadBinary(buf + sizeof(hdr), hdr.len,
+                                                name, cache->priv,
+                                                &outdated))) {
+        if (!outdated) {
+            VIR_WARN("Failed to load binary cached data from '%s' for '%s': %s",
+                     file, name, virGetLastErrorMessage());
+            virResetLastError();
+        }
+        return 0;
+    }
+
+    if (!cache->handlers.isValid(loadData, cache->priv)) {
+        g_object_unref(loadData);
+        return 0;
+    }
+
+    VIR_DEBUG("Loaded binary cached data '%s' for '%s'", file, name);
+    *data = loadData;
+    return 1;
+
+ incompatible:
+    VIR_DEBUG("Ignoring incompatible binary cached data '%s' for '%s'",
+              file, name);
+    return 0;
+}
+
+
 static int
 virFileCacheLoad(virFileCache *cache,
                  const char *name,
@@ -132,7 +290,10 @@ virFileCacheLoad(virFileCache *cache,
 
     *data = NULL;
 
-    if (!(file = virFileCacheGetFileName(cache, name)))
+    if (virFileCacheLoadBinary(cache, name, data) > 0)
+        return 1;
+
+    if (!(file = virFileCacheGetFileName(cache, name, false)))
         return ret;
 
     if (!virFileExists(file)) {
@@ -166,6 +327,9 @@ virFileCacheLoad(virFileCache *cache,
 
     VIR_DEBUG("Loaded cached data '%s' for '%s'", file, name);
 
+    /* the binary data is missing or out of date */
+    virFileCacheSaveBinary(cache, name, loadData);
+
     ret = 1;
     *data = g_steal_pointer(&loadData);
 
@@ -181,17 +345,47 @@ virFileCacheSave(virFileCache *cache,
                  void *data)
 {
     g_autofree char *file = NULL;
+    g_autofree char *binaryFile = NULL;
 
-    if (!(file = virFileCacheGetFileName(cache, name)))
+    if (!(file = virFileCacheGetFileName(cache, name, false)))
         return -1;
 
+    /* make sure stale binary data doesn't take precedence over the new
+     * data if storing it fails */
+    if (cache->handlers.formatBinary) {
+        if (!(binaryFile = virFileCacheGetFileName(cache, name, true)))
+            return -1;
+
+        if (unlink(binaryFile) < 0 && errno != ENOENT)
+            VIR_WARN("Unable to remove '%s': %s", binaryFile, g_strerror(errno));
+    }
+
     if (cache->handlers.saveFile(data, file, cache->priv) < 0)
         return -1;
 
+    virFileCacheSaveBinary(cache, name, data);
+
     return 0;
 }
 
 
+static void *
+virFileCacheCreateData(virFileCache *cache,
+                       const char *name)
+{
+    void *data = NULL;
+
+    if (!(data = cache->handlers.newData(name, cache->priv)))
+        return NULL;
+
+    if (virFileCacheSave(cache, name, data) < 0) {
+        g_clear_object(&data);
+    }
+
+    return data;
+}
+
+
 static void *
 virFileCacheNewData(virFileCache *cache,
                     const char *name)
@@ -202,14 +396,8 @@ virFileCacheNewData(virFileCache *cache,
     if ((rv = virFileCacheLoad(cache, name, &data)) < 0)
         return NULL;
 
-    if (rv == 0) {
-        if (!(data = cache->handlers.newData(name, cache->priv)))
-            return NULL;
-
-        if (virFileCacheSave(cache, name, data) < 0) {
-            g_clear_object(&data);
-        }
-    }
+    if (rv == 0)
+        data = virFileCacheCreateData(cache, name);
 
     return data;
 }
@@ -340,6 +528,134 @@ virFileCacheLookupByFunc(virFileCache *cache,
 }
 
 
+typedef struct _virFileCachePrefetchJob virFileCachePrefetchJob;
+struct _virFileCachePrefetchJob {
+    const char *name;
+    void *data;
+};
+
+typedef struct _virFileCachePrefetchData virFileCachePrefetchData;
+struct _virFileCachePrefetchData {
+    virFileCache *cache;
+    virFileCachePrefetchJob *jobs;
+    size_t njobs;
+    int next; /* index of the next job to process, atomic */
+};
+
+
+static void
+virFileCachePrefetchWorker(void *opaque)
+{
+    virFileCachePrefetchData *data = opaque;
+    int i;
+
+    while ((i = g_atomic_int_add(&data->next, 1)) < (int) data->njobs) {
+        virFileCachePrefetchJob *job = &data->jobs[i];
+
+        VIR_DEBUG("Creating data for '%s'", job->name);
+
+        if (!(job->data = virFileCacheCreateData(data->cache, job->name))) {
+            VIR_DEBUG("Failed to prefetch data for '%s': %s",
+                      job->name, virGetLastErrorMessage());
+            virResetLastError();
+        }
+    }
+}
+
+
+/**
+ * virFileCachePrefetch:
+ * @cache: existing cache object
+ * @names: NULL terminated list of names of the data
+ * @maxWorkers: maximum number of threads to use
+ *
+ * Makes sure @cache holds valid data for all @names. Unlike a series of
+ * virFileCacheLookup() calls, data which can't be loaded from a file is
+ * created by up to @maxWorkers threads concurrently and without holding the
+ * lock of @cache, which requires the newData() and saveFile() handlers to be
+ * thread safe. Failures are ignored here, they are reported by
+ * a subsequent virFileCacheLookup().
+ */
+void
+virFileCachePrefetch(virFileCache *cache,
+                     const char *const *names,
+                     size_t maxWorkers)
+{
+    virFileCachePrefetchData data = { .cache = cache };
+    g_autofree virThread *workers = NULL;
+    size_t nworkers;
+    size_t nstarted = 0;
+    size_t i;
+
+    data.jobs = g_new0(virFileCachePrefetchJob, g_strv_length((char **) names));
+
+    VIR_WITH_OBJECT_LOCK_GUARD(cache) {
+        for (i = 0; names[i]; i++) {
+            void *cached = virHashLookup(cache->table, names[i]);
+
+            if (cached && cache->handlers.isValid(cached, cache->priv))
+                continue;
+
+            cached = NULL;
+            if (virFileCacheLoad(cache, names[i], &cached) < 0)
+                virResetLastError();
+
+            if (cached) {
+                if (virHashUpdateEntry(cache->table, names[i], cached) < 0)
+                    g_clear_pointer(&cached, g_object_unref);
+                continue;
+            }
+
+            data.jobs[data.njobs++].name = names[i];
+        }
+    }
+
+    nworkers = MIN(data.njobs, maxWorkers);
+    nworkers = MIN(nworkers, g_get_num_processors());
+
+    if (nworkers > 1) {
+        workers = g_new0(virThread, nworkers - 1);
+
+        for (nstarted = 0; nstarted < nworkers - 1; nstarted++) {
+            if (virThreadCreateFull(&workers[nstarted], true,
+                                    virFileCachePrefetchWorker,
+                                    "file-cache-prefetch", false, &data) < 0) {
+                VIR_WARN("Failed to create thread for prefetching cache data");
+                break;
+            }
+        }
+    }
+
+    virFileCachePrefetchWorker(&data);
+
+    for (i = 0; i < nstarted; i++)
+        virThreadJoin(&workers[i]);
+
+    VIR_WITH_OBJECT_LOCK_GUARD(cache) {
+        for (i = 0; i < data.njobs; i++) {
+            virFileCachePrefetchJob *job = &data.jobs[i];
+            void *cached;
+
+            if (!job->data)
+                continue;
+
+            /* somebody might have looked the data up in the meantime */
+            cached = virHashLookup(cache->table, job->name);
+            if (cached && cache->handlers.isValid(cached, cache->priv)) {
+                g_clear_pointer(&job->data, g_object_unref);
+                continue;
+            }
+
+            VIR_DEBUG("Caching data '%p' for '%s'", job->data, job->name);
+            if (virHashUpdateEntry(cache->table, job->name, job->data) < 0)
+                g_clear_pointer(&job->data, g_object_unref);
+        }
+    }
+
+    g_free(data.jobs);
+}
+
+
 /**
  * virFileCacheGetPriv:
  * @cache: existing cache object
@@ -91,6 +91,42 @@ typedef int
                            const char *filename,
                            void *priv);
 
+/**
+ * virFileCacheLoadBinaryPtr:
+ * @buf: binary representation of the cached data
+ * @len: length of @buf
+ * @name: name of the cached data
+ * @priv: private data created together with cache
+ * @outdated: set to true if data was outdated
+ *
+ * Loads the cached data from @buf formatted by virFileCacheFormatBinaryPtr
+ * of the same binaryVersion. If NULL is returned, then @outdated indicates
+ * whether this was due to the data being outdated, or an error loading
+ * the cache.
+ *
+ * Returns cached data object or NULL on outdated data or error.
+ */
+typedef void *
+(*virFileCacheLoadBinaryPtr)(const char *buf,
+                             size_t len,
+                             const char *name,
+                             void *priv,
+                             bool *outdated);
+
+/**
+ * virFileCacheFormatBinaryPtr:
+ * @data: data object to format
+ * @priv: private data created together with cache
+ *
+ * Formats @data into a compact binary representation which is loaded in
+ * preference to the file written by virFileCacheSaveFilePtr.
+ *
+ * Returns the binary representation of @data or NULL on error.
+ */
+typedef GByteArray *
+(*virFileCacheFormatBinaryPtr)(void *data,
+                               void *priv);
+
 /**
  * virFileCachePrivFreePtr:
  * @priv: private data created together with cache
@@ -108,6 +144,11 @@ struct _virFileCacheHandlers {
     virFileCacheLoadFilePtr loadFile;
     virFileCacheSaveFilePtr saveFile;
     virFileCachePrivFreePtr privFree;
+
+    /* Optional, a change of the binary format requires bumping the version */
+    unsigned int binaryVersion;
+    virFileCacheLoadBinaryPtr loadBinary;
+    virFileCacheFormatBinaryPtr formatBinary;
 };
 
 virFileCache *
@@ -124,6 +165,11 @@ virFileCacheLookupByFunc(virFileCache *cache,
                          virHashSearcher iter,
                          const void *iterData);
 
+void
+virFileCachePrefetch(virFileCache *cache,
+                     const char *const *names,
+                     size_t maxWorkers);
+
 void *
 virFileCacheGetPriv(virFileCache *cache);
 
@@ -561,6 +561,32 @@ virFirewallCmdToString(const char *cmd,
      STREQ(arg, "--append") || STREQ(arg, "-A"))
 
 
+static void
+virFirewallCmdIptablesAddRollback(virFirewall *firewall,
+                                  virFirewallCmd *fwCmd)
+{
+    virFirewallCmd *rollback
+        = virFirewallAddRollbackCmd(firewall, fwCmd->layer, NULL);
+    g_autofree char *rollbackStr = NULL;
+    size_t i;
+
+    for (i = 0; i < fwCmd->argsLen; i++) {
+        /* iptables --delete wants the entire commandline that
+         * was used for --insert but with s/insert/delete/
+         */
+        if (VIR_IPTABLES_ARG_IS_CREATE(fwCmd->args[i])) {
+            virFirewallCmdAddArg(firewall, rollback, "--delete");
+        } else {
+            virFirewallCmdAddArg(firewall, rollback, fwCmd->args[i]);
+        }
+    }
+
+    rollbackStr = virFirewallCmdToString(virFirewallLayerCommandTypeToString(fwCmd->layer),
+                                         rollback);
+    VIR_DEBUG("Recording Rollback command '%s'", NULLSTR(rollbackStr));
+}
+
+
 static int
 virFirewallCmdIptablesApply(virFirewall *firewall,
                             virFirewallCmd *fwCmd,
@@ -634,26 +660,8 @@ virFirewallCmdIptablesApply(virFirewall *firewall,
      * rollback command
      */
 
-    if (needRollback) {
-        virFirewallCmd *rollback
-            = virFirewallAddRollbackCmd(firewall, fwCmd->layer, NULL);
-        g_autofree char *rollbackStr = NULL;
-
-        for (i = 0; i < fwCmd->argsLen; i++) {
-            /* iptables --delete wants the entire commandline that
-             * was used for --insert but with s/insert/delete/
-             */
-            if (VIR_IPTABLES_ARG_IS_CREATE(fwCmd->args[i])) {
-                virFirewallCmdAddArg(firewall, rollback, "--delete");
-            } else {
-                virFirewallCmdAddArg(firewall, rollback, fwCmd->args[i]);
-            }
-        }
-
-        rollbackStr = virFirewallCmdToString(virFirewallLayerCommandTypeToString(fwCmd->layer),
-                                             rollback);
-        VIR_DEBUG("Recording Rollback command '%s'", NULLSTR(rollbackStr));
-    }
+    if (needRollback)
+        virFirewallCmdIptablesAddRollback(firewall, fwCmd);
 
     return 0;
 }
@@ -662,6 +670,48 @@ virFirewallCmdIptablesApply(virFirewall *firewall,
 #define VIR_NFTABLES_ARG_IS_CREATE(arg) \
     (STREQ(arg, "insert") || STREQ(arg, "add") || STREQ(arg, "create"))
 
+static void
+virFirewallCmdNftablesAddRollback(virFirewall *firewall,
+                                  virFirewallCmd *fwCmd,
+                                  size_t cmdIdx,
+                                  const char *handle)
+{
+    virFirewallCmd *rollback = virFirewallAddRollbackCmd(firewall, fwCmd->layer, NULL);
+    const char *objectType = fwCmd->args[cmdIdx + 1];
+    g_autofree char *rollbackStr = NULL;
+
+    /* The rollback command is created from the original command like this:
+     *
+     * 1) skip any leading options
+     * 2) replace add/insert with delete
+     * 3) keep the type of item being added (rule/chain/table)
+     * 4) keep the class (ip/ip6/inet)
+     * 5) for chain/rule, keep the table name
+     * 6) for rule, keep the chain name
+     * 7) add "handle n" where "n" is parsed from the
+     *    stdout of the original nft command
+     */
+    virFirewallCmdAddArgList(firewall, rollback, "delete", objectType,
+                             fwCmd->args[cmdIdx + 2], /* ip/ip6/inet */
+                             NULL);
+
+    if (STREQ_NULLABLE(objectType, "rule") ||
+        STREQ_NULLABLE(objectType, "chain")) {
+        /* include table name in command */
+        virFirewallCmdAddArg(firewall, rollback, fwCmd->args[cmdIdx + 3]);
+    }
+
+    if (STREQ_NULLABLE(objectType, "rule")) {
+        /* include chain name in command */
+        virFirewallCmdAddArg(firewall, rollback, fwCmd->args[cmdIdx + 4]);
+    }
+
+    virFirewallCmdAddArgList(firewall, rollback, "handle", handle, NULL);
+
+    rollbackStr = virFirewallCmdToString(NFT, rollback);
+    VIR_DEBUG("Recording Rollback command '%s'", NULLSTR(rollbackStr));
+}
+
 static int
 virFirewallCmdNftablesApply(virFirewall *firewall G_GNUC_UNUSED,
                             virFirewallCmd *fwCmd,
@@ -759,11 +809,9 @@ virFirewallCmdNftablesApply(virFirewall *firewall G_GNUC_UNUSED,
     }
 
     if (needRollback) {
-        virFirewallCmd *rollback = virFirewallAddRollbackCmd(firewall, fwCmd->layer, NULL);
         const char *handleStart = NULL;
         size_t handleLen = 0;
         g_autofree char *handleStr = NULL;
-        g_autofree char *rollbackStr = NULL;
 
         /* Search for "# handle n" in stdout of the nft add command -
          * that is the handle of the table/rule/chain that will later
@@ -784,36 +832,7 @@ virFirewallCmdNftablesApply(virFirewall *firewall G_GNUC_UNUSED,
 
         handleStr = g_strdup_printf("%.*s", (int)handleLen, handleStart);
 
-        /* The rollback command is created from the original command like this:
-         *
-         * 1) skip any leading options
-         * 2) replace add/insert with delete
-         * 3) keep the type of item being added (rule/chain/table)
-         * 4) keep the class (ip/ip6/inet)
-         * 5) for chain/rule, keep the table name
-         * 6) for rule, keep the chain name
-         * 7) add "handle n" where "n" is parsed from the
-         *    stdout of the original nft command
-         */
-        virFirewallCmdAddArgList(firewall, rollback, "delete", objectType,
-                                 fwCmd->args[cmdIdx + 2], /* ip/ip6/inet */
-                                 NULL);
-
-        if (STREQ_NULLABLE(objectType, "rule") ||
-            STREQ_NULLABLE(objectType, "chain")) {
-            /* include table name in command */
-            virFirewallCmdAddArg(firewall, rollback, fwCmd->args[cmdIdx + 3]);
-        }
-
-        if (STREQ_NULLABLE(objectType, "rule")) {
-            /* include chain name in command */
-            virFirewallCmdAddArg(firewall, rollback, fwCmd->args[cmdIdx + 4]);
-        }
-
-        virFirewallCmdAddArgList(firewall, rollback, "handle", handleStr, NULL);
-
-        rollbackStr = virFirewallCmdToString(NFT, rollback);
-        VIR_DEBUG("Recording Rollback command '%s'", NULLSTR(rollbackStr));
+        virFirewallCmdNftablesAddRollback(firewall, fwCmd, cmdIdx, handleStr);
     }
     return 0;
 }
@@ -875,21 +894,263 @@ virFirewallApplyCmd(virFirewall *firewall,
     return 0;
 }
 
+#define VIR_FIREWALL_BATCH_ECHO "echo"
+
+/**
+ * virFirewallCmdBatchKey:
+ * @firewall: the firewall ruleset
+ * @fwCmd: the command to check
+ *
+ * Commands can be applied in a batch only if they don't need their output
+ * or their individual exit status, and their arguments can be expressed in
+ * the input of iptables-restore or nft -f without change of meaning.
+ *
+ * Returns NULL if @fwCmd can't be batched, otherwise a string identifying
+ * the batch @fwCmd can be part of: the iptables table for the iptables
+ * backend, VIR_FIREWALL_BATCH_ECHO for nftables objects whose handle is
+ * needed for rollback, or an empty string for other nftables commands.
+ */
+static const char *
+virFirewallCmdBatchKey(virFirewall *firewall,
+                       virFirewallCmd *fwCmd)
+{
+    bool autoRollback = (virFirewallTransactionGetFlags(firewall) &
+                         VIR_FIREWALL_TRANSACTION_AUTO_ROLLBACK);
+    const char *table = "filter";
+    size_t i;
+
+    if (fwCmd->argsLen == 0 || fwCmd->queryCB || fwCmd->ignoreErrors)
+        return NULL;
+
+    for (i = 0; i < fwCmd->argsLen; i++) {
+        if (strchr(fwCmd->args[i], '\n'))
+            return NULL;
+    }
+
+    switch (virFirewallGetBackend(firewall)) {
+    case VIR_FIREWALL_BACKEND_IPTABLES:
+        if (fwCmd->layer != VIR_FIREWALL_LAYER_IPV4 &&
+            fwCmd->layer != VIR_FIREWALL_LAYER_IPV6)
+            return NULL;
+
+        for (i = 0; i < fwCmd->argsLen; i++) {
+            /* iptables-restore has no quoting rules we could rely on */
+            if (!*fwCmd->args[i] || strpbrk(fwCmd->args[i], " \t\"'\\#"))
+                return NULL;
+
+            /* the table is given by the section of the input */
+            if (STREQ(fwCmd->args[i], "-t") || STREQ(fwCmd->args[i], "--table")) {
+                if (++i == fwCmd->argsLen)
+                    return NULL;
+                table = fwCmd->args[i];
+            } else if (STRPREFIX(fwCmd->args[i], "--table=")) {
+                return NULL;
+            }
+        }
+        return table;
+
+    case VIR_FIREWALL_BACKEND_NFTABLES:
+        /* options can't be passed per command; 'list' can fail benignly */
+        if (fwCmd->layer == VIR_FIREWALL_LAYER_TC ||
+            fwCmd->args[0][0] == '-' ||
+            STREQ(fwCmd->args[0], "list"))
+            return NULL;
+
+        /* rollback of created objects needs their handle, which
+         * 'nft -ae' echoes in the order the objects were created */
+        if (autoRollback && VIR_NFTABLES_ARG_IS_CREATE(fwCmd->args[0])) {
+            if (fwCmd->argsLen > 1 &&
+                (STREQ(fwCmd->args[1], "rule") ||
+                 STREQ(fwCmd->args[1], "chain") ||
+                 STREQ(fwCmd->args[1], "table")))
+                return VIR_FIREWALL_BATCH_ECHO;
+            return NULL;
+        }
+
+        return "";
+
+    case VIR_FIREWALL_BACKEND_NONE:
+    case VIR_FIREWALL_BACKEND_PF:
+    case VIR_FIREWALL_BACKEND_LAST:
+        break;
+    }
+
+    return NULL;
+}
+
+
+/**
+ * virFirewallApplyBatch:
+ * @firewall: the firewall ruleset
+ * @cmds: commands to apply
+ * @ncmds: number of elements of @cmds
+ * @key: the batch key of @cmds as returned by virFirewallCmdBatchKey
+ *
+ * Applies all of @cmds by a single invocation of iptables-restore or nft.
+ * Both apply the whole input atomically.
+ *
+ * Returns 0 on success, 1 if the batch was rejected and thus none of @cmds
+ * was applied, and -1 on error.
+ */
+static int
+virFirewallApplyBatch(virFirewall *firewall,
+                      virFirewallCmd **cmds,
+                      size_t ncmds,
+                      const char *key)
+{
+    g_auto(virBuffer) input = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virCommand) cmd = NULL;
+    g_autofree char *inputStr = NULL;
+    g_autofree char *cmdStr = NULL;
+    g_autofree char *error = NULL;
+    g_autofree char *output = NULL;
+    bool iptables = virFirewallGetBackend(firewall) == VIR_FIREWALL_BACKEND_IPTABLES;
+    bool echo = !iptables && STREQ(key, VIR_FIREWALL_BATCH_ECHO);
+    const char *handleStart;
+    size_t i;
+    size_t j;
+    int status;
+
+    if (iptables) {
+        g_autofree char *bin = NULL;
+
+        bin = g_strdup_printf("%s-restore",
+                              virFirewallLayerCommandTypeToString(cmds[0]->layer));
+        cmd = virCommandNewArgList(bin, "-w", "--noflush", NULL);
+
+        virBufferAsprintf(&input, "*%s\n", key);
+    } else if (echo) {
+        cmd = virCommandNewArgList(NFT, "-ae", "-f", "-", NULL);
+        virCommandSetOutputBuffer(cmd, &output);
+    } else {
+        cmd = virCommandNewArgList(NFT, "-f", "-", NULL);
+    }
+
+    for (i = 0; i < ncmds; i++) {
+        for (j = 0; j < cmds[i]->argsLen; j++) {
+            const char *arg = cmds[i]->args[j];
+
+            if (iptables && (STREQ(arg, "-t") || STREQ(arg, "--table"))) {
+                j++;
+                continue;
+            }
+
+            virBufferAdd(&input, arg, -1);
+            virBufferAddChar(&input, ' ');
+        }
+        virBufferTrim(&input, " ");
+        virBufferAddChar(&input, '\n');
+    }
+
+    if (iptables)
+        virBufferAddLit(&input, "COMMIT\n");
+
+    inputStr = virBufferContentAndReset(&input);
+    cmdStr = virCommandToString(cmd, false);
+
+    VIR_INFO("Applying batch of %zu firewall commands with '%s':\n%s",
+             ncmds, NULLSTR(cmdStr), inputStr);
+
+    virCommandSetInputBuffer(cmd, inputStr);
+    virCommandSetErrorBuffer(cmd, &error);
+
+    if (virCommandRun(cmd, &status) < 0)
+        return -1;
+
+    if (status != 0) {
+        VIR_DEBUG("Batch of firewall commands rejected: %s", NULLSTR(error));
+        return 1;
+    }
+
+    if (iptables &&
+        (virFirewallTransactionGetFlags(firewall) &
+         VIR_FIREWALL_TRANSACTION_AUTO_ROLLBACK)) {
+        for (i = 0; i < ncmds; i++) {
+            for (j = 0; j < cmds[i]->argsLen; j++) {
+                if (VIR_IPTABLES_ARG_IS_CREATE(cmds[i]->args[j])) {
+                    virFirewallCmdIptablesAddRollback(firewall, cmds[i]);
+                    break;
+                }
+            }
+        }
+    }
+
+    /* nft echoes every created object followed by its handle */
+    handleStart = output;
+    for (i = 0; echo && i < ncmds; i++) {
+        g_autofree char *handleStr = NULL;
+        size_t handleLen = 0;
+
+        if (handleStart && (handleStart = strstr(handleStart, "# handle "))) {
+            handleStart += 9; /* move past "# handle " */
+            handleLen = strspn(handleStart, "0123456789");
+        }
+
+        if (!handleLen) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("couldn't register rollback command - command '%1$s' had no valid handle in output ('%2$s')"),
+                           NULLSTR(cmdStr), NULLSTR(output));
+            return -1;
+        }
+
+        handleStr = g_strndup(handleStart, handleLen);
+        handleStart += handleLen;
+
+        virFirewallCmdNftablesAddRollback(firewall, cmds[i], 0, handleStr);
+    }
+
+    return 0;
+}
+
+
 static int
 virFirewallApplyGroup(virFirewall *firewall,
                       size_t idx)
 {
     virFirewallGroup *group = firewall->groups[idx];
-
-    size_t i;
+    bool batch = group->actionFlags & VIR_FIREWALL_TRANSACTION_BATCH;
+    size_t i = 0;
 
     VIR_INFO("Starting transaction for firewall=%p group=%p flags=0x%x",
              firewall, group, group->actionFlags);
     firewall->currentGroup = idx;
     group->addingRollback = false;
-    for (i = 0; i < group->naction; i++) {
-        if (virFirewallApplyCmd(firewall, group->action[i]) < 0)
-            return -1;
+    while (i < group->naction) {
+        const char *key = NULL;
+        size_t n = 1;
+
+        if (batch &&
+            (key = virFirewallCmdBatchKey(firewall, group->action[i]))) {
+            virFirewallCmd *first = group->action[i];
+
+            for (; i + n < group->naction; n++) {
+                virFirewallCmd *next = group->action[i + n];
+                const char *nextKey = virFirewallCmdBatchKey(firewall, next);
+
+                if (next->layer != first->layer || STRNEQ_NULLABLE(key, nextKey))
+                    break;
+            }
+        }
+
+        if (n > 1) {
+            int rc = virFirewallApplyBatch(firewall, group->action + i, n, key);
+
+            if (rc < 0)
+                return -1;
+
+            if (rc == 0) {
+                i += n;
+                continue;
+            }
+
+            /* Nothing was applied; run the commands one by one to report
+             * the failing one and record rollback of the others. */
+        }
+
+        for (; n > 0; n--, i++) {
+            if (virFirewallApplyCmd(firewall, group->action[i]) < 0)
+                return -1;
+        }
     }
     return 0;
 }
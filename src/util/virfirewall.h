@@ -129,6 +129,9 @@ typedef enum {
     VIR_FIREWALL_TRANSACTION_IGNORE_ERRORS = (1 << 0),
     /* Set to auto-add a rollback rule for each rule that is applied */
     VIR_FIREWALL_TRANSACTION_AUTO_ROLLBACK = (1 << 1),
+    /* Apply consecutive rules using a single iptables-restore
+     * or nft invocation where possible */
+    VIR_FIREWALL_TRANSACTION_BATCH = (1 << 2),
 } virFirewallTransactionFlags;
 
 void virFirewallStartTransaction(virFirewall *firewall,
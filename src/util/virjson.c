@@ -53,9 +53,15 @@ struct _virJSONObjectPair {
     virJSONValue *value;
 };
 
+/* Objects with at least this many members get a hash table index
+ * mapping keys to their position in @pairs. The index is built lazily
+ * on first lookup and kept up to date when members are added or removed. */
+#define VIR_JSON_OBJECT_INDEX_THRESHOLD 16
+
 struct _virJSONObject {
     size_t npairs;
     virJSONObjectPair *pairs;
+    GHashTable *index; /* key (borrowed from @pairs) -> position + 1 */
 };
 
 struct _virJSONArray {
@@ -76,18 +82,22 @@ struct _virJSONValue {
 };
 
 
-typedef struct _virJSONParserState virJSONParserState;
-struct _virJSONParserState {
-    virJSONValue *value;
-    char *key;
-};
+/* When parsing we need to limit the nesting depth of JSON documents. Since
+ * we need to support at least 200 layers of snapshots (the limit is based
+ * on a conservative take on the 256 layer nesting limit for XML in libxml),
+ * for which we have internal checks, we also need to set the JSON limit to
+ * be able to parse qemu responses for such a deeply nested snapshot list.
+ * '300' is picked as a conservative buffer on top of the 200 layers plus
+ * some of the extra wrappers that qemu adds. */
+#define VIR_JSON_PARSER_MAX_DEPTH 300
 
 typedef struct _virJSONParser virJSONParser;
 struct _virJSONParser {
-    virJSONValue *head;
-    virJSONParserState *state;
-    size_t nstate;
-    int wrap;
+    const char *data;
+    size_t len;
+    size_t pos;
+    size_t depth;
+    const char *error; /* untranslated description of the first error */
 };
 
 
@@ -385,6 +395,7 @@ virJSONValueFree(virJSONValue *value)
             virJSONValueFree(value->data.object.pairs[i].value);
         }
         g_free(value->data.object.pairs);
+        g_clear_pointer(&value->data.object.index, g_hash_table_unref);
         break;
     case VIR_JSON_TYPE_ARRAY:
         for (i = 0; i < value->data.array.nvalues; i++)
@@ -538,6 +549,91 @@ virJSONValueNewObject(void)
 }
 
 
+static void
+virJSONValueObjectIndexDrop(virJSONObject *obj)
+{
+    g_clear_pointer(&obj->index, g_hash_table_unref);
+}
+
+
+/* Updates the index of @obj, if there's any, for the member at @pos
+ * being removed. Members following it move one position down. */
+static void
+virJSONValueObjectIndexRemove(virJSONObject *obj,
+                              size_t pos)
+{
+    size_t i;
+
+    if (!obj->index)
+        return;
+
+    g_hash_table_remove(obj->index, obj->pairs[pos].key);
+
+    for (i = pos + 1; i < obj->npairs; i++)
+        g_hash_table_insert(obj->index, obj->pairs[i].key, GSIZE_TO_POINTER(i));
+}
+
+
+/* Updates the index of @obj, if there's any, for @key being prepended.
+ * All existing members move one position up. */
+static void
+virJSONValueObjectIndexPrepend(virJSONObject *obj,
+                               char *key)
+{
+    size_t i;
+
+    if (!obj->index)
+        return;
+
+    for (i = 0; i < obj->npairs; i++)
+        g_hash_table_insert(obj->index, obj->pairs[i].key,
+                            GSIZE_TO_POINTER(i + 2));
+
+    g_hash_table_insert(obj->index, key, GSIZE_TO_POINTER(1));
+}
+
+
+/**
+ * virJSONValueObjectFindPair:
+ * @obj: JSON object
+ * @key: key to look up
+ *
+ * Returns the position of @key in @obj or -1 if it isn't present. Objects
+ * with VIR_JSON_OBJECT_INDEX_THRESHOLD or more members are looked up via a
+ * hash table index which is built on demand, smaller ones are scanned.
+ */
+static ssize_t
+virJSONValueObjectFindPair(virJSONObject *obj,
+                           const char *key)
+{
+    size_t i;
+
+    if (obj->npairs < VIR_JSON_OBJECT_INDEX_THRESHOLD) {
+        for (i = 0; i < obj->npairs; i++) {
+            if (STREQ(obj->pairs[i].key, key))
+                return i;
+        }
+
+        return -1;
+    }
+
+    if (!obj->index) {
+        obj->index = g_hash_table_new(g_str_hash, g_str_equal);
+
+        /* insert in reverse so that the first occurrence of a key wins
+         * in the (unexpected) case of duplicates to match the scan above */
+        for (i = obj->npairs; i > 0; i--)
+            g_hash_table_insert(obj->index, obj->pairs[i - 1].key,
+                                GSIZE_TO_POINTER(i));
+    }
+
+    if ((i = GPOINTER_TO_SIZE(g_hash_table_lookup(obj->index, key))) == 0)
+        return -1;
+
+    return i - 1;
+}
+
+
 static int
 virJSONValueObjectInsert(virJSONValue *object,
                          const char *key,
@@ -561,9 +657,14 @@ virJSONValueObjectInsert(virJSONValue *object,
     pair.key = g_strdup(key);
 
     if (prepend) {
+        virJSONValueObjectIndexPrepend(&object->data.object, pair.key);
         ret = VIR_INSERT_ELEMENT(object->data.object.pairs, 0,
                                  object->data.object.npairs, pair);
     } else {
+        if (object->data.object.index)
+            g_hash_table_insert(object->data.object.index, pair.key,
+                                GSIZE_TO_POINTER(object->data.object.npairs + 1));
+
         VIR_APPEND_ELEMENT(object->data.object.pairs,
                            object->data.object.npairs, pair);
         ret = 0;
@@ -783,17 +884,10 @@ bool
 virJSONValueObjectHasKey(virJSONValue *object,
                          const char *key)
 {
-    size_t i;
-
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return false;
 
-    for (i = 0; i < object->data.object.npairs; i++) {
-        if (STREQ(object->data.object.pairs[i].key, key))
-            return true;
-    }
-
-    return false;
+    return virJSONValueObjectFindPair(&object->data.object, key) >= 0;
 }
 
 
@@ -801,17 +895,15 @@ virJSONValue *
 virJSONValueObjectGet(virJSONValue *object,
                       const char *key)
 {
-    size_t i;
+    ssize_t i;
 
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return NULL;
 
-    for (i = 0; i < object->data.object.npairs; i++) {
-        if (STREQ(object->data.object.pairs[i].key, key))
-            return object->data.object.pairs[i].value;
-    }
+    if ((i = virJSONValueObjectFindPair(&object->data.object, key)) < 0)
+        return NULL;
 
-    return NULL;
+    return object->data.object.pairs[i].value;
 }
 
 
@@ -880,7 +972,7 @@ virJSONValueObjectRemoveKey(virJSONValue *object,
                             const char *key,
                             virJSONValue **value)
 {
-    size_t i;
+    ssize_t i;
 
     if (value)
         *value = NULL;
@@ -888,20 +980,19 @@ virJSONValueObjectRemoveKey(virJSONValue *object,
     if (object->type != VIR_JSON_TYPE_OBJECT)
         return -1;
 
-    for (i = 0; i < object->data.object.npairs; i++) {
-        if (STREQ(object->data.object.pairs[i].key, key)) {
-            if (value) {
-                *value = g_steal_pointer(&object->data.object.pairs[i].value);
-            }
-            VIR_FREE(object->data.object.pairs[i].key);
-            virJSONValueFree(object->data.object.pairs[i].value);
-            VIR_DELETE_ELEMENT(object->data.object.pairs, i,
-                               object->data.object.npairs);
-            return 1;
-        }
-    }
+    if ((i = virJSONValueObjectFindPair(&object->data.object, key)) < 0)
+        return 0;
 
-    return 0;
+    virJSONValueObjectIndexRemove(&object->data.object, i);
+
+    if (value)
+        *value = g_steal_pointer(&object->data.object.pairs[i].value);
+
+    VIR_FREE(object->data.object.pairs[i].key);
+    virJSONValueFree(object->data.object.pairs[i].value);
+    VIR_DELETE_ELEMENT(object->data.object.pairs, i,
+                       object->data.object.npairs);
+    return 1;
 }
 
 
@@ -1389,113 +1480,496 @@ virJSONValueCopy(const virJSONValue *in)
 
 
 #if WITH_JSON_C
-static virJSONValue *
-virJSONValueFromJsonC(json_object *jobj)
+/*
+ * The parser below builds the virJSONValue tree directly from the input
+ * string. Using json-c for parsing would mean building a full json_object
+ * tree first and then copying it, which doubles the allocations needed for
+ * every monitor and guest agent reply.
+ */
+static virJSONValue *virJSONParserValue(virJSONParser *parser);
+
+
+static void *
+virJSONParserFail(virJSONParser *parser,
+                  const char *msg)
 {
-    enum json_type type = json_object_get_type(jobj);
-    virJSONValue *ret = NULL;
+    if (!parser->error)
+        parser->error = msg;
 
-    switch (type) {
-    case json_type_null:
-        ret = virJSONValueNewNull();
-        break;
-    case json_type_boolean:
-        ret = virJSONValueNewBoolean(json_object_get_boolean(jobj));
-        break;
-    case json_type_double:
-    case json_type_int: {
-        ret = virJSONValueNewNumber(g_strdup(json_object_get_string(jobj)));
+    return NULL;
+}
+
+
+/* Skips whitespace and returns the next character or -1 at the end of input */
+static int
+virJSONParserPeek(virJSONParser *parser)
+{
+    while (parser->pos < parser->len) {
+        switch (parser->data[parser->pos]) {
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+            parser->pos++;
+            break;
+
+        default:
+            return (unsigned char) parser->data[parser->pos];
+        }
+    }
+
+    return -1;
+}
+
+
+static bool
+virJSONParserLiteral(virJSONParser *parser,
+                     const char *literal)
+{
+    size_t len = strlen(literal);
+
+    if (parser->len - parser->pos < len ||
+        memcmp(parser->data + parser->pos, literal, len) != 0)
+        return false;
+
+    parser->pos += len;
+    return true;
+}
+
+
+static int
+virJSONParserHex4(virJSONParser *parser)
+{
+    int ret = 0;
+    size_t i;
+
+    if (parser->len - parser->pos < 4)
+        return -1;
+
+    for (i = 0; i < 4; i++) {
+        int digit = g_ascii_xdigit_value(parser->data[parser->pos + i]);
+
+        if (digit < 0)
+            return -1;
+
+        ret = (ret << 4) | digit;
+    }
+
+    parser->pos += 4;
+    return ret;
+}
+
+
+/* Decodes the escape sequence following a backslash into @str */
+static int
+virJSONParserStringEscape(virJSONParser *parser,
+                          GString *str)
+{
+    int hex;
+    gunichar ch;
+
+    if (parser->pos >= parser->len) {
+        virJSONParserFail(parser, N_("unterminated string"));
+        return -1;
+    }
+
+    switch (parser->data[parser->pos++]) {
+    case '"':
+        g_string_append_c(str, '"');
+        return 0;
+    case '\\':
+        g_string_append_c(str, '\\');
+        return 0;
+    case '/':
+        g_string_append_c(str, '/');
+        return 0;
+    case 'b':
+        g_string_append_c(str, '\b');
+        return 0;
+    case 'f':
+        g_string_append_c(str, '\f');
+        return 0;
+    case 'n':
+        g_string_append_c(str, '\n');
+        return 0;
+    case 'r':
+        g_string_append_c(str, '\r');
+        return 0;
+    case 't':
+        g_string_append_c(str, '\t');
+        return 0;
+    case 'u':
         break;
+    default:
+        virJSONParserFail(parser, N_("invalid escape sequence"));
+        return -1;
     }
-    case json_type_object: {
-        json_object_iter iter;
 
-        ret = virJSONValueNewObject();
+    if ((hex = virJSONParserHex4(parser)) < 0) {
+        virJSONParserFail(parser, N_("invalid unicode escape"));
+        return -1;
+    }
+
+    ch = hex;
 
-        json_object_object_foreachC(jobj, iter) {
-            virJSONValue *cur = virJSONValueFromJsonC(iter.val);
+    if (ch >= 0xD800 && ch <= 0xDBFF) {
+        /* high surrogate which must be followed by an escaped low surrogate */
+        if (parser->len - parser->pos >= 6 &&
+            parser->data[parser->pos] == '\\' &&
+            parser->data[parser->pos + 1] == 'u') {
+            size_t pos = parser->pos;
 
-            if (virJSONValueObjectAppend(ret, iter.key, &cur) < 0) {
-                g_free(ret);
-                return NULL;
+            parser->pos += 2;
+            hex = virJSONParserHex4(parser);
+
+            if (hex >= 0xDC00 && hex <= 0xDFFF) {
+                ch = 0x10000 + ((ch - 0xD800) << 10) + (hex - 0xDC00);
+            } else {
+                /* leave the following escape to be decoded separately */
+                parser->pos = pos;
+                ch = 0xFFFD;
             }
+        } else {
+            ch = 0xFFFD;
         }
-        break;
+    } else if (ch >= 0xDC00 && ch <= 0xDFFF) {
+        ch = 0xFFFD;
+    }
+
+    g_string_append_unichar(str, ch);
+    return 0;
+}
+
+
+/* Parses a string starting at the opening quote and returns its unescaped
+ * contents. Strings without escape sequences are copied in one go. */
+static char *
+virJSONParserString(virJSONParser *parser)
+{
+    g_autoptr(GString) str = NULL;
+    const char *run;
+
+    parser->pos++;
+    run = parser->data + parser->pos;
+
+    while (parser->pos < parser->len) {
+        const char *cur = parser->data + parser->pos;
+
+        if (*cur != '"' && *cur != '\\') {
+            if ((unsigned char) *cur < 0x20)
+                return virJSONParserFail(parser, N_("control character in string"));
+
+            parser->pos++;
+            continue;
+        }
+
+        if (!g_utf8_validate(run, cur - run, NULL))
+            return virJSONParserFail(parser, N_("invalid UTF-8 in string"));
+
+        parser->pos++;
+
+        if (*cur == '"') {
+            if (!str)
+                return g_strndup(run, cur - run);
+
+            g_string_append_len(str, run, cur - run);
+            return g_string_free(g_steal_pointer(&str), FALSE);
+        }
+
+        if (!str)
+            str = g_string_sized_new(cur - run + 16);
+
+        g_string_append_len(str, run, cur - run);
+
+        if (virJSONParserStringEscape(parser, str) < 0)
+            return NULL;
+
+        run = parser->data + parser->pos;
     }
-    case json_type_array: {
-        size_t len;
-        size_t i;
 
-        ret = virJSONValueNewArray();
-        len = json_object_array_length(jobj);
+    return virJSONParserFail(parser, N_("unterminated string"));
+}
+
 
-        for (i = 0; i < len; i++) {
-            virJSONValue *cur = NULL;
-            json_object *val = NULL;
+/* Validates the number syntax. The textual representation is stored as is. */
+static virJSONValue *
+virJSONParserNumber(virJSONParser *parser)
+{
+    const char *data = parser->data;
+    size_t len = parser->len;
+    size_t pos = parser->pos;
 
-            val = json_object_array_get_idx(jobj, i);
+    if (pos < len && data[pos] == '-')
+        pos++;
 
-            cur = virJSONValueFromJsonC(val);
+    if (pos < len && data[pos] == '0') {
+        pos++;
+    } else if (pos < len && g_ascii_isdigit(data[pos])) {
+        while (pos < len && g_ascii_isdigit(data[pos]))
+            pos++;
+    } else {
+        return virJSONParserFail(parser, N_("invalid number"));
+    }
 
-            if (!cur) {
-                g_free(ret);
-                return NULL;
+    if (pos < len && data[pos] == '.') {
+        pos++;
+
+        if (pos >= len || !g_ascii_isdigit(data[pos]))
+            return virJSONParserFail(parser, N_("invalid number"));
+
+        while (pos < len && g_ascii_isdigit(data[pos]))
+            pos++;
+    }
+
+    if (pos < len && (data[pos] == 'e' || data[pos] == 'E')) {
+        pos++;
+
+        if (pos < len && (data[pos] == '+' || data[pos] == '-'))
+            pos++;
+
+        if (pos >= len || !g_ascii_isdigit(data[pos]))
+            return virJSONParserFail(parser, N_("invalid number"));
+
+        while (pos < len && g_ascii_isdigit(data[pos]))
+            pos++;
+    }
+
+    data += parser->pos;
+    len = pos - parser->pos;
+    parser->pos = pos;
+
+    return virJSONValueNewNumber(g_strndup(data, len));
+}
+
+
+/* Members are appended by the parser without looking for duplicate keys,
+ * which are rare enough not to slow down parsing of every key. This
+ * function resolves them once the whole object was read: the member keeps
+ * the position of the first occurrence of its key and gets the value of
+ * the last one. Large objects get their lookup index built along the way,
+ * so it doesn't have to be built again on first lookup. */
+static void
+virJSONParserObjectMergeDuplicates(virJSONObject *obj)
+{
+    size_t npairs = 0;
+    size_t i;
+
+    if (obj->npairs >= VIR_JSON_OBJECT_INDEX_THRESHOLD)
+        obj->index = g_hash_table_new(g_str_hash, g_str_equal);
+
+    for (i = 0; i < obj->npairs; i++) {
+        virJSONObjectPair pair = obj->pairs[i];
+        size_t pos = 0;
+
+        if (obj->index) {
+            pos = GPOINTER_TO_SIZE(g_hash_table_lookup(obj->index, pair.key));
+        } else {
+            size_t j;
+
+            for (j = 0; j < npairs && pos == 0; j++) {
+                if (STREQ(obj->pairs[j].key, pair.key))
+                    pos = j + 1;
             }
+        }
 
-            virJSONValueArrayAppend(ret, &cur);
+        if (pos > 0) {
+            virJSONValueFree(obj->pairs[pos - 1].value);
+            obj->pairs[pos - 1].value = pair.value;
+            g_free(pair.key);
+            continue;
         }
-        break;
+
+        if (obj->index)
+            g_hash_table_insert(obj->index, pair.key,
+                                GSIZE_TO_POINTER(npairs + 1));
+
+        obj->pairs[npairs++] = pair;
     }
-    case json_type_string:
-        ret = virJSONValueNewString(g_strdup(json_object_get_string(jobj)));
+
+    obj->npairs = npairs;
+}
+
+
+static virJSONValue *
+virJSONParserObject(virJSONParser *parser)
+{
+    g_autoptr(virJSONValue) ret = virJSONValueNewObject();
+    virJSONObject *obj = &ret->data.object;
+    size_t nalloc = 0;
+
+    if (++parser->depth > VIR_JSON_PARSER_MAX_DEPTH)
+        return virJSONParserFail(parser, N_("nesting too deep"));
+
+    parser->pos++;
+
+    if (virJSONParserPeek(parser) == '}') {
+        parser->pos++;
+        parser->depth--;
+        return g_steal_pointer(&ret);
+    }
+
+    while (true) {
+        g_autofree char *key = NULL;
+        virJSONValue *value;
+
+        if (virJSONParserPeek(parser) != '"')
+            return virJSONParserFail(parser, N_("expected object key"));
+
+        if (!(key = virJSONParserString(parser)))
+            return NULL;
+
+        if (virJSONParserPeek(parser) != ':')
+            return virJSONParserFail(parser, N_("expected ':' after object key"));
+
+        parser->pos++;
+
+        if (!(value = virJSONParserValue(parser)))
+            return NULL;
+
+        VIR_RESIZE_N(obj->pairs, nalloc, obj->npairs, 1);
+        obj->pairs[obj->npairs].key = g_steal_pointer(&key);
+        obj->pairs[obj->npairs].value = value;
+        obj->npairs++;
+
+        switch (virJSONParserPeek(parser)) {
+        case ',':
+            parser->pos++;
+            break;
+
+        case '}':
+            parser->pos++;
+            parser->depth--;
+            virJSONParserObjectMergeDuplicates(obj);
+            return g_steal_pointer(&ret);
+
+        default:
+            return virJSONParserFail(parser, N_("expected ',' or '}' in object"));
+        }
+    }
+}
+
+
+static virJSONValue *
+virJSONParserArray(virJSONParser *parser)
+{
+    g_autoptr(virJSONValue) ret = virJSONValueNewArray();
+    virJSONArray *arr = &ret->data.array;
+    size_t nalloc = 0;
+
+    if (++parser->depth > VIR_JSON_PARSER_MAX_DEPTH)
+        return virJSONParserFail(parser, N_("nesting too deep"));
+
+    parser->pos++;
+
+    if (virJSONParserPeek(parser) == ']') {
+        parser->pos++;
+        parser->depth--;
+        return g_steal_pointer(&ret);
+    }
+
+    while (true) {
+        virJSONValue *value;
+
+        if (!(value = virJSONParserValue(parser)))
+            return NULL;
+
+        VIR_RESIZE_N(arr->values, nalloc, arr->nvalues, 1);
+        arr->values[arr->nvalues++] = value;
+
+        switch (virJSONParserPeek(parser)) {
+        case ',':
+            parser->pos++;
+            break;
+
+        case ']':
+            parser->pos++;
+            parser->depth--;
+            return g_steal_pointer(&ret);
+
+        default:
+            return virJSONParserFail(parser, N_("expected ',' or ']' in array"));
+        }
+    }
+}
+
+
+static virJSONValue *
+virJSONParserValue(virJSONParser *parser)
+{
+    switch (virJSONParserPeek(parser)) {
+    case '{':
+        return virJSONParserObject(parser);
+
+    case '[':
+        return virJSONParserArray(parser);
+
+    case '"': {
+        char *str;
+
+        if (!(str = virJSONParserString(parser)))
+            return NULL;
+
+        return virJSONValueNewString(str);
+    }
+
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+        return virJSONParserNumber(parser);
+
+    case 't':
+        if (virJSONParserLiteral(parser, "true"))
+            return virJSONValueNewBoolean(true);
+        break;
+
+    case 'f':
+        if (virJSONParserLiteral(parser, "false"))
+            return virJSONValueNewBoolean(false);
+        break;
+
+    case 'n':
+        if (virJSONParserLiteral(parser, "null"))
+            return virJSONValueNewNull();
         break;
+
+    case -1:
+        return virJSONParserFail(parser, N_("unexpected end of data"));
     }
 
-    return ret;
+    return virJSONParserFail(parser, N_("unexpected character"));
 }
 
 
 virJSONValue *
 virJSONValueFromString(const char *jsonstring)
 {
-    json_object *jobj = NULL;
-    virJSONValue *ret = NULL;
-    json_tokener *tok = NULL;
-    enum json_tokener_error jerr;
-    int jsonflags = JSON_TOKENER_STRICT | JSON_TOKENER_VALIDATE_UTF8;
+    virJSONParser parser = { .data = jsonstring, .len = strlen(jsonstring) };
+    g_autoptr(virJSONValue) ret = NULL;
 
     VIR_DEBUG("string=%s", jsonstring);
 
-    /* When creating the tokener we need to specify the limit of the nesting
-     * depth of JSON objects. The default in json-c is 32. Since we need to
-     * support at least 200 layers of snapshots (the limit is based on a
-     * conservative take on the 256 layer nesting limit for XML in libxml), for
-     * which we have internal checks, we also need to set the JSON limit to
-     * be able to parse qemu responses for such a deeply nested snapshot list.
-     * '300' is picked a sa conservative buffer on top of the 200 layers plus
-     * some of the extra wrappers that qemu adds*/
-    tok = json_tokener_new_ex(300);
-    if (!tok) {
-        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
-                       _("failed to create JSON tokener"));
-        return NULL;
+    if ((ret = virJSONParserValue(&parser)) &&
+        virJSONParserPeek(&parser) != -1) {
+        g_clear_pointer(&ret, virJSONValueFree);
+        virJSONParserFail(&parser, N_("trailing garbage"));
     }
-    json_tokener_set_flags(tok, jsonflags);
-    jobj = json_tokener_parse_ex(tok, jsonstring, strlen(jsonstring));
-    jerr = json_tokener_get_error(tok);
-    if (jerr != json_tokener_success) {
+
+    if (!ret) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
-                       _("failed to parse JSON: %1$s"),
-                       json_tokener_error_desc(jerr));
-        goto cleanup;
+                       _("failed to parse JSON: %1$s at offset %2$zu"),
+                       _(parser.error), parser.pos);
+        return NULL;
     }
-    ret = virJSONValueFromJsonC(jobj);
 
- cleanup:
-    json_object_put(jobj);
-    if (tok)
-        json_tokener_free(tok);
-    return ret;
+    return g_steal_pointer(&ret);
 }
 
 static json_object *
@@ -1793,6 +2267,7 @@ virJSONValueObjectDeflattenArrays(virJSONValue *json)
         g_free(obj->pairs[i].key);
 
     g_free(json->data.object.pairs);
+    virJSONValueObjectIndexDrop(obj);
 
     i = obj->npairs;
     json->type = VIR_JSON_TYPE_ARRAY;
@@ -19,17 +19,32 @@
 #include <config.h>
 #include <unistd.h>
 
+#if defined(WITH_LIBNL)
+# include <linux/if_ether.h>
+# include <linux/pkt_cls.h>
+# include <linux/pkt_sched.h>
+# include <linux/rtnetlink.h>
+#endif /* WITH_LIBNL */
+
 #include "virnetdevbandwidth.h"
 #include "vircommand.h"
 #include "viralloc.h"
 #include "virerror.h"
 #include "virlog.h"
+#include "virnetdev.h"
+#include "virnetlink.h"
+#include "virstring.h"
 #include "virutil.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
 VIR_LOG_INIT("util.netdevbandwidth");
 
+VIR_ENUM_IMPL(virNetDevBandwidthBackend,
+              VIR_NETDEV_BANDWIDTH_BACKEND_LAST,
+              "tc",
+              "netlink");
+
 void
 virNetDevBandwidthFree(virNetDevBandwidth *def)
 {
@@ -41,9 +56,8 @@ virNetDevBandwidthFree(virNetDevBandwidth *def)
     g_free(def);
 }
 
-static void
-virNetDevBandwidthCmdAddOptimalQuantum(virCommand *cmd,
-                                       const virNetDevBandwidthRate *rate)
+static unsigned long long
+virNetDevBandwidthGetOptimalQuantum(const virNetDevBandwidthRate *rate)
 {
     const unsigned long long mtu = 1500;
     const unsigned long long r2q_limit = UINT32_MAX;
@@ -66,10 +80,758 @@ virNetDevBandwidthCmdAddOptimalQuantum(virCommand *cmd,
     if (r2q > r2q_limit)
         r2q = r2q_limit;
 
+    return r2q;
+}
+
+
+static void
+virNetDevBandwidthCmdAddOptimalQuantum(virCommand *cmd,
+                                       const virNetDevBandwidthRate *rate)
+{
     virCommandAddArg(cmd, "quantum");
-    virCommandAddArgFormat(cmd, "%llu", r2q);
+    virCommandAddArgFormat(cmd, "%llu",
+                           virNetDevBandwidthGetOptimalQuantum(rate));
+}
+
+
+/**
+ * virNetDevBandwidthCheckBackend:
+ * @backend: the way traffic control is programmed
+ *
+ * Check whether @backend can be passed to the functions below. With
+ * VIR_NETDEV_BANDWIDTH_BACKEND_TC QoS settings are applied by spawning
+ * tc, with VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK all the qdiscs, classes
+ * and filters needed by a single operation are sent to the kernel as
+ * one rtnetlink batch. Should the netlink socket be unusable, tc is
+ * used instead.
+ *
+ * Returns 0 on success, -1 if @backend is not supported (with error
+ * reported).
+ */
+int
+virNetDevBandwidthCheckBackend(virNetDevBandwidthBackend backend G_GNUC_UNUSED)
+{
+#if !defined(WITH_LIBNL)
+    if (backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) {
+        virReportError(VIR_ERR_CONFIG_UNSUPPORTED, "%s",
+                       _("netlink bandwidth backend is not supported on this platform"));
+        return -1;
+    }
+#endif /* !WITH_LIBNL */
+
+    return 0;
+}
+
+
+#if defined(WITH_LIBNL)
+
+/* The packet scheduler clock of the kernel ticks every 64ns, which is
+ * what tc reads from /proc/net/psched and uses to convert sizes into
+ * transmit times. The high resolution clock is assumed for computing
+ * the default HTB burst, just like tc does on any recent kernel. */
+# define VIR_NETDEV_BANDWIDTH_NL_TICKS_PER_USEC 15.625
+# define VIR_NETDEV_BANDWIDTH_NL_CLOCK_HZ 1000000000ULL
+
+/* Defaults tc uses for HTB classes and 'mtu 64kb' of the ingress policer */
+# define VIR_NETDEV_BANDWIDTH_NL_HTB_MTU 1600
+# define VIR_NETDEV_BANDWIDTH_NL_POLICE_MTU 65536
+
+# define VIR_NETDEV_BANDWIDTH_NL_RTAB_SIZE 256
+# define VIR_NETDEV_BANDWIDTH_NL_MAX_MSGS 16
+
+/* u32 filters created for guaranteed throughput live at this priority */
+# define VIR_NETDEV_BANDWIDTH_NL_FILTER_PRIO 2
+
+typedef struct _virNetDevBandwidthNlBatch virNetDevBandwidthNlBatch;
+struct _virNetDevBandwidthNlBatch {
+    const char *ifname;
+    int ifindex;
+
+    virNetlinkMsg *msgs[VIR_NETDEV_BANDWIDTH_NL_MAX_MSGS];
+    /* errno to ignore for each message, -1 to ignore any error */
+    int tolerate[VIR_NETDEV_BANDWIDTH_NL_MAX_MSGS];
+    size_t nmsgs;
+};
+
+
+static void
+virNetDevBandwidthNlBatchFree(virNetDevBandwidthNlBatch *batch)
+{
+    size_t i;
+
+    if (!batch)
+        return;
+
+    for (i = 0; i < batch->nmsgs; i++)
+        nlmsg_free(batch->msgs[i]);
+    g_free(batch);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virNetDevBandwidthNlBatch, virNetDevBandwidthNlBatchFree);
+
+
+static virNetDevBandwidthNlBatch *
+virNetDevBandwidthNlBatchNew(const char *ifname)
+{
+    g_autoptr(virNetDevBandwidthNlBatch) batch = g_new0(virNetDevBandwidthNlBatch, 1);
+
+    batch->ifname = ifname;
+
+    if (virNetDevGetIndex(ifname, &batch->ifindex) < 0)
+        return NULL;
+
+    return g_steal_pointer(&batch);
+}
+
+
+static void
+virNetDevBandwidthNlReportOverflow(void)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                   _("allocated netlink buffer is too small"));
+}
+
+
+/**
+ * virNetDevBandwidthNlBatchAdd:
+ * @batch: batch to append the message to
+ * @type: RTM_* message type
+ * @flags: NLM_F_* flags on top of NLM_F_REQUEST
+ * @parent: tcm_parent
+ * @handle: tcm_handle
+ * @info: tcm_info, i.e. priority and protocol of filters
+ * @kind: name of the qdisc, class or filter (may be NULL)
+ * @tolerate: errno to ignore, -1 to ignore any failure, 0 for none
+ *
+ * Appends a new traffic control message to @batch. Any options are to
+ * be added into the returned message by the caller.
+ *
+ * Returns: the message on success,
+ *          NULL otherwise (with error reported).
+ */
+static virNetlinkMsg *
+virNetDevBandwidthNlBatchAdd(virNetDevBandwidthNlBatch *batch,
+                             int type,
+                             int flags,
+                             uint32_t parent,
+                             uint32_t handle,
+                             uint32_t info,
+                             const char *kind,
+                             int tolerate)
+{
+    struct tcmsg tcm = {
+        .tcm_family = AF_UNSPEC,
+        .tcm_ifindex = batch->ifindex,
+        .tcm_parent = parent,
+        .tcm_handle = handle,
+        .tcm_info = info,
+    };
+    virNetlinkMsg *msg;
+
+    if (batch->nmsgs == VIR_NETDEV_BANDWIDTH_NL_MAX_MSGS) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("too many traffic control messages"));
+        return NULL;
+    }
+
+    msg = virNetlinkMsgNew(type, NLM_F_REQUEST | flags);
+    batch->msgs[batch->nmsgs] = msg;
+    batch->tolerate[batch->nmsgs] = tolerate;
+    batch->nmsgs++;
+
+    if (nlmsg_append(msg, &tcm, sizeof(tcm), NLMSG_ALIGNTO) < 0 ||
+        (kind && nla_put_string(msg, TCA_KIND, kind) < 0)) {
+        virNetDevBandwidthNlReportOverflow();
+        return NULL;
+    }
+
+    return msg;
 }
 
+
+/**
+ * virNetDevBandwidthNlBatchRun:
+ * @batch: messages to send
+ *
+ * Sends all messages of @batch to the kernel at once.
+ *
+ * Returns: 0 on success,
+ *         -1 if the kernel refused any of the requests (with error reported),
+ *         -2 if netlink can't be used and the caller should fall back
+ *            to tc (no error reported).
+ */
+static int
+virNetDevBandwidthNlBatchRun(virNetDevBandwidthNlBatch *batch)
+{
+    int errors[VIR_NETDEV_BANDWIDTH_NL_MAX_MSGS] = { 0 };
+    size_t i;
+
+    if (virNetlinkTalkBatch(batch->msgs, batch->nmsgs, errors) < 0) {
+        VIR_WARN("Unable to set traffic control on '%s' via netlink, falling back to tc: %s",
+                 batch->ifname, virGetLastErrorMessage());
+        virResetLastError();
+        return -2;
+    }
+
+    for (i = 0; i < batch->nmsgs; i++) {
+        if (errors[i] == 0 ||
+            batch->tolerate[i] == -1 ||
+            batch->tolerate[i] == -errors[i])
+            continue;
+
+        virReportSystemError(-errors[i],
+                             _("Unable to set traffic control on interface '%1$s'"),
+                             batch->ifname);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* Mirrors tc_calc_xmittime(): time in scheduler ticks needed to send
+ * @size bytes at @rate bytes per second. */
+static uint32_t
+virNetDevBandwidthNlXmitTime(unsigned long long rate,
+                             unsigned long long size)
+{
+    unsigned long long usec;
+    unsigned long long ticks;
+
+    if (!rate)
+        return 0;
+
+    usec = 1000000 * ((double) size / rate);
+    ticks = usec * VIR_NETDEV_BANDWIDTH_NL_TICKS_PER_USEC;
+
+    return MIN(ticks, UINT32_MAX);
+}
+
+
+/* Mirrors tc_calc_rtable(): @rtab[i] holds the time needed to send a
+ * packet of (i + 1) << cell_log bytes, where cell_log is picked so that
+ * the table covers @mtu. */
+static void
+virNetDevBandwidthNlRateTable(struct tc_ratespec *spec,
+                              uint32_t *rtab,
+                              unsigned long long rate,
+                              unsigned int mtu)
+{
+    unsigned int cell_log = 0;
+    size_t i;
+
+    while ((mtu >> cell_log) > 255)
+        cell_log++;
+
+    for (i = 0; i < VIR_NETDEV_BANDWIDTH_NL_RTAB_SIZE; i++)
+        rtab[i] = virNetDevBandwidthNlXmitTime(rate, (i + 1) << cell_log);
+
+    spec->rate = MIN(rate, UINT32_MAX);
+    spec->cell_log = cell_log;
+    spec->cell_align = -1;
+    spec->linklayer = TC_LINKLAYER_ETHERNET;
+}
+
+
+static int
+virNetDevBandwidthNlPutHTBQdisc(virNetlinkMsg *msg,
+                                uint32_t defcls)
+{
+    struct tc_htb_glob glob = {
+        .version = 3,
+        .rate2quantum = 10,
+        .defcls = defcls,
+    };
+    struct nlattr *options;
+
+    if (!(options = nla_nest_start(msg, TCA_OPTIONS)) ||
+        nla_put(msg, TCA_HTB_INIT, sizeof(glob), &glob) < 0) {
+        virNetDevBandwidthNlReportOverflow();
+        return -1;
+    }
+
+    nla_nest_end(msg, options);
+    return 0;
+}
+
+
+/**
+ * virNetDevBandwidthNlPutHTBClass:
+ * @msg: message to add options to
+ * @rate: guaranteed rate in bytes per second
+ * @ceil: maximum rate in bytes per second (0 to use @rate)
+ * @burst: burst size in bytes (0 for tc's default)
+ * @quantum: class quantum
+ *
+ * Equivalent of 'htb rate @rate [ceil @ceil] [burst @burst] quantum @quantum'.
+ */
+static int
+virNetDevBandwidthNlPutHTBClass(virNetlinkMsg *msg,
+                                unsigned long long rate,
+                                unsigned long long ceil,
+                                unsigned long long burst,
+                                unsigned int quantum)
+{
+    struct tc_htb_opt opt = { 0 };
+    uint32_t rtab[VIR_NETDEV_BANDWIDTH_NL_RTAB_SIZE];
+    uint32_t ctab[VIR_NETDEV_BANDWIDTH_NL_RTAB_SIZE];
+    unsigned long long cburst;
+    struct nlattr *options;
+
+    if (!ceil)
+        ceil = rate;
+
+    /* Unless told otherwise, tc allows bursts of one clock tick worth of
+     * data plus MTU */
+    if (!burst)
+        burst = rate / VIR_NETDEV_BANDWIDTH_NL_CLOCK_HZ + VIR_NETDEV_BANDWIDTH_NL_HTB_MTU;
+    cburst = ceil / VIR_NETDEV_BANDWIDTH_NL_CLOCK_HZ + VIR_NETDEV_BANDWIDTH_NL_HTB_MTU;
+
+    virNetDevBandwidthNlRateTable(&opt.rate, rtab, rate,
+                                  VIR_NETDEV_BANDWIDTH_NL_HTB_MTU);
+    virNetDevBandwidthNlRateTable(&opt.ceil, ctab, ceil,
+                                  VIR_NETDEV_BANDWIDTH_NL_HTB_MTU);
+    opt.buffer = virNetDevBandwidthNlXmitTime(rate, burst);
+    opt.cbuffer = virNetDevBandwidthNlXmitTime(ceil, cburst);
+    opt.quantum = quantum;
+
+    if (!(options = nla_nest_start(msg, TCA_OPTIONS)) ||
+        (rate > UINT32_MAX && nla_put_u64(msg, TCA_HTB_RATE64, rate) < 0) ||
+        (ceil > UINT32_MAX && nla_put_u64(msg, TCA_HTB_CEIL64, ceil) < 0) ||
+        nla_put(msg, TCA_HTB_PARMS, sizeof(opt), &opt) < 0 ||
+        nla_put(msg, TCA_HTB_RTAB, sizeof(rtab), rtab) < 0 ||
+        nla_put(msg, TCA_HTB_CTAB, sizeof(ctab), ctab) < 0) {
+        virNetDevBandwidthNlReportOverflow();
+        return -1;
+    }
+
+    nla_nest_end(msg, options);
+    return 0;
+}
+
+
+static int
+virNetDevBandwidthNlPutSFQ(virNetlinkMsg *msg)
+{
+    struct tc_sfq_qopt opt = { .perturb_period = 10 };
+
+    if (nla_put(msg, TCA_OPTIONS, sizeof(opt), &opt) < 0) {
+        virNetDevBandwidthNlReportOverflow();
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+virNetDevBandwidthNlPutFW(virNetlinkMsg *msg,
+                          uint32_t classid)
+{
+    struct nlattr *options;
+
+    if (!(options = nla_nest_start(msg, TCA_OPTIONS)) ||
+        nla_put_u32(msg, TCA_FW_CLASSID, classid) < 0) {
+        virNetDevBandwidthNlReportOverflow();
+        return -1;
+    }
+
+    nla_nest_end(msg, options);
+    return 0;
+}
+
+
+/**
+ * virNetDevBandwidthNlPutU32:
+ * @msg: message to add options to
+ * @classid: where to place matching traffic
+ * @keys: selector keys, already in the layout tc packs them into
+ * @nkeys: number of items in @keys
+ * @policeRate: rate in bytes per second to police traffic to (0 for none)
+ * @policeBurst: burst size of the policer in bytes
+ *
+ * Equivalent of 'u32 match ... [police rate @policeRate burst @policeBurst
+ * mtu 64kb drop] flowid @classid'.
+ */
+static int
+virNetDevBandwidthNlPutU32(virNetlinkMsg *msg,
+                           uint32_t classid,
+                           const struct tc_u32_key *keys,
+                           size_t nkeys,
+                           unsigned long long policeRate,
+                           unsigned long long policeBurst)
+{
+    g_autofree struct tc_u32_sel *sel = NULL;
+    size_t sellen = sizeof(*sel) + nkeys * sizeof(*keys);
+    struct nlattr *options;
+
+    sel = g_malloc0(sellen);
+    sel->flags = TC_U32_TERMINAL;
+    sel->nkeys = nkeys;
+    memcpy(sel->keys, keys, nkeys * sizeof(*keys));
+
+    if (!(options = nla_nest_start(msg, TCA_OPTIONS)))
+        goto overflow;
+
+    if (policeRate) {
+        struct tc_police police = {
+            .action = TC_POLICE_SHOT,
+            .mtu = VIR_NETDEV_BANDWIDTH_NL_POLICE_MTU,
+        };
+        uint32_t rtab[VIR_NETDEV_BANDWIDTH_NL_RTAB_SIZE];
+        struct nlattr *nest;
+
+        virNetDevBandwidthNlRateTable(&police.rate, rtab, policeRate,
+                                      police.mtu);
+        police.burst = virNetDevBandwidthNlXmitTime(policeRate, policeBurst);
+
+        if (!(nest = nla_nest_start(msg, TCA_U32_POLICE)) ||
+            nla_put(msg, TCA_POLICE_TBF, sizeof(police), &police) < 0 ||
+            nla_put(msg, TCA_POLICE_RATE, sizeof(rtab), rtab) < 0 ||
+            (policeRate > UINT32_MAX &&
+             nla_put_u64(msg, TCA_POLICE_RATE64, policeRate) < 0))
+            goto overflow;
+
+        nla_nest_end(msg, nest);
+    }
+
+    if (nla_put_u32(msg, TCA_U32_CLASSID, classid) < 0 ||
+        nla_put(msg, TCA_U32_SEL, sellen, sel) < 0)
+        goto overflow;
+
+    nla_nest_end(msg, options);
+    return 0;
+
+ overflow:
+    virNetDevBandwidthNlReportOverflow();
+    return -1;
+}
+
+
+/* 'qdisc del dev IFNAME root' and 'qdisc del dev IFNAME ingress', which are
+ * allowed to fail */
+static int
+virNetDevBandwidthNlAddClear(virNetDevBandwidthNlBatch *batch)
+{
+    if (!virNetDevBandwidthNlBatchAdd(batch, RTM_DELQDISC, 0,
+                                      TC_H_ROOT, 0, 0, NULL, -1) ||
+        !virNetDevBandwidthNlBatchAdd(batch, RTM_DELQDISC, 0,
+                                      TC_H_INGRESS, TC_H_MAKE(TC_H_INGRESS, 0),
+                                      0, "ingress", -1))
+        return -1;
+
+    return 0;
+}
+
+
+/* 'qdisc add dev IFNAME root handle 1: htb default N' unless there already
+ * is one. Since the kernel refuses to create a root qdisc with EEXIST both
+ * if 1: exists already and if there is another (non default) root qdisc,
+ * any class added under 1: in the same batch fails in the latter case. */
+static int
+virNetDevBandwidthNlAddRootQdisc(virNetDevBandwidthNlBatch *batch,
+                                 bool hierarchical_class)
+{
+    virNetlinkMsg *msg;
+
+    if (!(msg = virNetDevBandwidthNlBatchAdd(batch, RTM_NEWQDISC,
+                                             NLM_F_CREATE | NLM_F_EXCL,
+                                             TC_H_ROOT, TC_H_MAKE(1 << 16, 0),
+                                             0, "htb", EEXIST)))
+        return -1;
+
+    return virNetDevBandwidthNlPutHTBQdisc(msg, hierarchical_class ? 2 : 1);
+}
+
+
+/* Keep the handles identical to those tc creates from "800::<800 + id>",
+ * whose node ID is parsed as a hexadecimal number. */
+static int
+virNetDevBandwidthNlFilterHandle(unsigned int id,
+                                 uint32_t *handle)
+{
+    g_autofree char *node = g_strdup_printf("%u", 800 + id);
+    unsigned int nodeid;
+
+    if (virStrToLong_ui(node, NULL, 16, &nodeid) < 0 || nodeid >= 0x1000) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Invalid filter ID %1$u"), id);
+        return -1;
+    }
+
+    *handle = (0x800 << 20) | nodeid;
+    return 0;
+}
+
+
+/* Netlink counterpart of virNetDevBandwidthManipulateFilter() */
+static int
+virNetDevBandwidthNlAddMACFilter(virNetDevBandwidthNlBatch *batch,
+                                 const virMacAddr *ifmac_ptr,
+                                 unsigned int id,
+                                 uint32_t classid,
+                                 bool remove_old,
+                                 bool create_new)
+{
+    uint32_t prio = VIR_NETDEV_BANDWIDTH_NL_FILTER_PRIO << 16;
+    uint32_t handle;
+    virNetlinkMsg *msg;
+
+    if (virNetDevBandwidthNlFilterHandle(id, &handle) < 0)
+        return -1;
+
+    if (remove_old &&
+        !virNetDevBandwidthNlBatchAdd(batch, RTM_DELTFILTER, 0, 0, handle,
+                                      TC_H_MAKE(prio, 0), "u32", -1))
+        return -1;
+
+    if (create_new) {
+        unsigned char ifmac[VIR_MAC_BUFLEN];
+        struct tc_u32_key keys[3] = { 0 };
+
+        virMacAddrGetRaw(ifmac_ptr, ifmac);
+
+        /* match u16 0x0800 0xffff at -2 */
+        keys[0].val = htonl(0x0800);
+        keys[0].mask = htonl(0xffff);
+        keys[0].off = -4;
+        /* match u32 0x<mac[2..5]> 0xffffffff at -12 */
+        keys[1].val = htonl((uint32_t) ifmac[2] << 24 | ifmac[3] << 16 |
+                            ifmac[4] << 8 | ifmac[5]);
+        keys[1].mask = htonl(0xffffffff);
+        keys[1].off = -12;
+        /* match u16 0x<mac[0..1]> 0xffff at -14 */
+        keys[2].val = htonl(ifmac[0] << 8 | ifmac[1]);
+        keys[2].mask = htonl(0xffff);
+        keys[2].off = -16;
+
+        if (!(msg = virNetDevBandwidthNlBatchAdd(batch, RTM_NEWTFILTER,
+                                                 NLM_F_CREATE | NLM_F_EXCL,
+                                                 0, handle,
+                                                 TC_H_MAKE(prio, htons(ETH_P_IP)),
+                                                 "u32", 0)) ||
+            virNetDevBandwidthNlPutU32(msg, classid, keys,
+                                       G_N_ELEMENTS(keys), 0, 0) < 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+
+/* Netlink counterpart of virNetDevBandwidthSet(), see there for what
+ * gets created. */
+static int
+virNetDevBandwidthSetNetlink(const char *ifname,
+                             const virNetDevBandwidthRate *rx,
+                             const virNetDevBandwidthRate *tx,
+                             unsigned int flags)
+{
+    g_autoptr(virNetDevBandwidthNlBatch) batch = NULL;
+    bool hierarchical_class = flags & VIR_NETDEV_BANDWIDTH_SET_HIERARCHICAL_CLASS;
+    virNetlinkMsg *msg;
+
+    if (!(batch = virNetDevBandwidthNlBatchNew(ifname)))
+        return -1;
+
+    if (flags & VIR_NETDEV_BANDWIDTH_SET_CLEAR_ALL &&
+        virNetDevBandwidthNlAddClear(batch) < 0)
+        return -1;
+
+    if (tx && tx->average) {
+        unsigned long long average = tx->average * 1000;
+        unsigned long long peak = tx->peak * 1000;
+        unsigned int quantum = virNetDevBandwidthGetOptimalQuantum(tx);
+        uint32_t leaf = TC_H_MAKE(1 << 16, hierarchical_class ? 2 : 1);
+
+        if (virNetDevBandwidthNlAddRootQdisc(batch, hierarchical_class) < 0)
+            return -1;
+
+        if (hierarchical_class &&
+            (!(msg = virNetDevBandwidthNlBatchAdd(batch, RTM_NEWTCLASS,
+                                                  NLM_F_CREATE | NLM_F_EXCL,
+                                                  TC_H_MAKE(1 << 16, 0),
+                                                  TC_H_MAKE(1 << 16, 1),
+                                                  0, "htb", 0)) ||
+             virNetDevBandwidthNlPutHTBClass(msg, average,
+                                             peak ? peak : average,
+                                             0, quantum) < 0))
+            return -1;
+
+        if (!(msg = virNetDevBandwidthNlBatchAdd(batch, RTM_NEWTCLASS,
+                                                 NLM_F_CREATE | NLM_F_EXCL,
+                                                 TC_H_MAKE(1 << 16, hierarchical_class ? 1 : 0),
+                                                 leaf, 0, "htb", 0)) ||
+            virNetDevBandwidthNlPutHTBClass(msg, average, peak,
+                                            tx->burst * 1024, quantum) < 0)
+            return -1;
+
+        if (!(msg = virNetDevBandwidthNlBatchAdd(batch, RTM_NEWQDISC,
+                                                 NLM_F_CREATE | NLM_F_EXCL,
+                                                 leaf, TC_H_MAKE(2 << 16, 0),
+                                                 0, "sfq", 0)) ||
+            virNetDevBandwidthNlPutSFQ(msg) < 0)
+            return -1;
+
+        if (!(msg = virNetDevBandwidthNlBatchAdd(batch, RTM_NEWTFILTER,
+                                                 NLM_F_CREATE | NLM_F_EXCL,
+                                                 TC_H_MAKE(1 << 16, 0), 1,
+                                                 TC_H_MAKE(1 << 16, htons(ETH_P_ALL)),
+                                                 "fw", 0)) ||
+            virNetDevBandwidthNlPutFW(msg, 1) < 0)
+            return -1;
+    }
+
+    if (rx) {
+        struct tc_u32_key key = { 0 };
+        unsigned long long burst = rx->burst;
+
+        if (!burst)
+            burst = MIN(rx->average, UINT_MAX / 1024);
+
+        if (!virNetDevBandwidthNlBatchAdd(batch, RTM_NEWQDISC,
+                                          NLM_F_CREATE | NLM_F_EXCL,
+                                          TC_H_INGRESS, TC_H_MAKE(TC_H_INGRESS, 0),
+                                          0, "ingress", 0))
+            return -1;
+
+        if (!(msg = virNetDevBandwidthNlBatchAdd(batch, RTM_NEWTFILTER,
+                                                 NLM_F_CREATE | NLM_F_EXCL,
+                                                 TC_H_MAKE(TC_H_INGRESS, 0), 0,
+                                                 TC_H_MAKE(0, htons(ETH_P_ALL)),
+                                                 "u32", 0)) ||
+            virNetDevBandwidthNlPutU32(msg, 1, &key, 1,
+                                       rx->average * 1000, burst * 1024) < 0)
+            return -1;
+    }
+
+    return virNetDevBandwidthNlBatchRun(batch);
+}
+
+
+static int
+virNetDevBandwidthClearNetlink(const char *ifname)
+{
+    g_autoptr(virNetDevBandwidthNlBatch) batch = NULL;
+
+    if (!(batch = virNetDevBandwidthNlBatchNew(ifname)) ||
+        virNetDevBandwidthNlAddClear(batch) < 0)
+        return -1;
+
+    return virNetDevBandwidthNlBatchRun(batch);
+}
+
+
+static int
+virNetDevBandwidthPlugNetlink(const char *brname,
+                              virNetDevBandwidth *net_bandwidth,
+                              const virMacAddr *ifmac_ptr,
+                              virNetDevBandwidth *bandwidth,
+                              unsigned int id)
+{
+    g_autoptr(virNetDevBandwidthNlBatch) batch = NULL;
+    uint32_t classid = TC_H_MAKE(1 << 16, id);
+    unsigned long long ceil = net_bandwidth->in->peak ?
+                              net_bandwidth->in->peak :
+                              net_bandwidth->in->average;
+    virNetlinkMsg *msg;
+
+    if (!(batch = virNetDevBandwidthNlBatchNew(brname)))
+        return -1;
+
+    if (!(msg = virNetDevBandwidthNlBatchAdd(batch, RTM_NEWTCLASS,
+                                             NLM_F_CREATE | NLM_F_EXCL,
+                                             TC_H_MAKE(1 << 16, 1), classid,
+                                             0, "htb", 0)) ||
+        virNetDevBandwidthNlPutHTBClass(msg, bandwidth->in->floor * 1000,
+                                        ceil * 1000, 0,
+                                        virNetDevBandwidthGetOptimalQuantum(bandwidth->in)) < 0)
+        return -1;
+
+    if (!(msg = virNetDevBandwidthNlBatchAdd(batch, RTM_NEWQDISC,
+                                             NLM_F_CREATE | NLM_F_EXCL,
+                                             classid, TC_H_MAKE(id << 16, 0),
+                                             0, "sfq", 0)) ||
+        virNetDevBandwidthNlPutSFQ(msg) < 0)
+        return -1;
+
+    if (virNetDevBandwidthNlAddMACFilter(batch, ifmac_ptr, id, classid,
+                                         false, true) < 0)
+        return -1;
+
+    return virNetDevBandwidthNlBatchRun(batch);
+}
+
+
+static int
+virNetDevBandwidthUnplugNetlink(const char *brname,
+                                unsigned int id)
+{
+    g_autoptr(virNetDevBandwidthNlBatch) batch = NULL;
+
+    if (!(batch = virNetDevBandwidthNlBatchNew(brname)))
+        return -1;
+
+    /* Just like with tc, try to remove as much as possible */
+    if (!virNetDevBandwidthNlBatchAdd(batch, RTM_DELQDISC, 0,
+                                      0, TC_H_MAKE(id << 16, 0),
+                                      0, NULL, -1) ||
+        virNetDevBandwidthNlAddMACFilter(batch, NULL, id, 0, true, false) < 0 ||
+        !virNetDevBandwidthNlBatchAdd(batch, RTM_DELTCLASS, 0,
+                                      0, TC_H_MAKE(1 << 16, id),
+                                      0, NULL, -1))
+        return -1;
+
+    return virNetDevBandwidthNlBatchRun(batch);
+}
+
+
+static int
+virNetDevBandwidthUpdateRateNetlink(const char *ifname,
+                                    unsigned int id,
+                                    virNetDevBandwidth *bandwidth,
+                                    unsigned long long new_rate)
+{
+    g_autoptr(virNetDevBandwidthNlBatch) batch = NULL;
+    unsigned long long ceil = bandwidth->in->peak ?
+                              bandwidth->in->peak :
+                              bandwidth->in->average;
+    virNetlinkMsg *msg;
+
+    if (!(batch = virNetDevBandwidthNlBatchNew(ifname)))
+        return -1;
+
+    if (!(msg = virNetDevBandwidthNlBatchAdd(batch, RTM_NEWTCLASS, 0,
+                                             0, TC_H_MAKE(1 << 16, id),
+                                             0, "htb", 0)) ||
+        virNetDevBandwidthNlPutHTBClass(msg, new_rate * 1000, ceil * 1000, 0,
+                                        virNetDevBandwidthGetOptimalQuantum(bandwidth->in)) < 0)
+        return -1;
+
+    return virNetDevBandwidthNlBatchRun(batch);
+}
+
+
+static int
+virNetDevBandwidthUpdateFilterNetlink(const char *ifname,
+                                      const virMacAddr *ifmac_ptr,
+                                      unsigned int id)
+{
+    g_autoptr(virNetDevBandwidthNlBatch) batch = NULL;
+
+    if (!(batch = virNetDevBandwidthNlBatchNew(ifname)) ||
+        virNetDevBandwidthNlAddMACFilter(batch, ifmac_ptr, id,
+                                         TC_H_MAKE(1 << 16, id),
+                                         true, true) < 0)
+        return -1;
+
+    return virNetDevBandwidthNlBatchRun(batch);
+}
+
+
+#endif /* WITH_LIBNL */
+
+
 /**
  * virNetDevBandwidthManipulateFilter:
  * @ifname: interface to operate on
@@ -173,6 +935,7 @@ virNetDevBandwidthManipulateFilter(const char *ifname,
  * virNetDevBandwidthSet:
  * @ifname: on which interface
  * @bandwidth: rates to set (may be NULL)
+ * @backend: how to program traffic control
  * @flags: bits indicating certain optional actions
  *
 
@@ -216,6 +979,7 @@ virNetDevBandwidthManipulateFilter(const char *ifname,
 int
 virNetDevBandwidthSet(const char *ifname,
                       const virNetDevBandwidth *bandwidth,
+                      virNetDevBandwidthBackend backend G_GNUC_UNUSED,
                       unsigned int flags)
 {
     int ret = -1;
@@ -253,6 +1017,15 @@ virNetDevBandwidthSet(const char *ifname,
         tx = bandwidth->out;
     }
 
+#if defined(WITH_LIBNL)
+    if (backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) {
+        int rc = virNetDevBandwidthSetNetlink(ifname, rx, tx, flags);
+
+        if (rc != -2)
+            return rc;
+    }
+#endif /* WITH_LIBNL */
+
     /* Only if the caller requests, clear everything including root
      * qdisc and all filters before adding everything.
      */
@@ -430,6 +1203,7 @@ virNetDevBandwidthSet(const char *ifname,
 /**
  * virNetDevBandwidthClear:
  * @ifname: on which interface
+ * @backend: how to program traffic control
  *
  * This function tries to disable QoS on specified interface
  * by deleting root and ingress qdisc. However, this may fail
@@ -438,7 +1212,8 @@ virNetDevBandwidthSet(const char *ifname,
  * Return 0 on success, -1 otherwise.
  */
 int
-virNetDevBandwidthClear(const char *ifname)
+virNetDevBandwidthClear(const char *ifname,
+                        virNetDevBandwidthBackend backend G_GNUC_UNUSED)
 {
     int ret = 0;
     int dummy; /* for ignoring the exit status */
@@ -448,6 +1223,15 @@ virNetDevBandwidthClear(const char *ifname)
     if (!ifname)
        return 0;
 
+#if defined(WITH_LIBNL)
+    if (backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) {
+        int rc = virNetDevBandwidthClearNetlink(ifname);
+
+        if (rc != -2)
+            return rc;
+    }
+#endif /* WITH_LIBNL */
+
     rootcmd = virCommandNew("tc");
     virCommandAddArgList(rootcmd, "qdisc", "del", "dev", ifname, "root", NULL);
 
@@ -544,6 +1328,7 @@ virNetDevBandwidthEqual(const virNetDevBandwidth *a,
  * @ifmac_ptr: MAC of interface
  * @bandwidth: QoS settings for interface
  * @id: unique ID (MUST be greater than 2)
+ * @backend: how to program traffic control
  *
  * Set bridge part of interface QoS settings, e.g. guaranteed
  * bandwidth.  @id is an unique ID (among @brname) from which
@@ -562,7 +1347,8 @@ virNetDevBandwidthPlug(const char *brname,
                        virNetDevBandwidth *net_bandwidth,
                        const virMacAddr *ifmac_ptr,
                        virNetDevBandwidth *bandwidth,
-                       unsigned int id)
+                       unsigned int id,
+                       virNetDevBandwidthBackend backend G_GNUC_UNUSED)
 {
     g_autoptr(virCommand) cmd1 = NULL;
     g_autoptr(virCommand) cmd2 = NULL;
@@ -586,6 +1372,16 @@ virNetDevBandwidthPlug(const char *brname,
         return -1;
     }
 
+#if defined(WITH_LIBNL)
+    if (backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) {
+        int rc = virNetDevBandwidthPlugNetlink(brname, net_bandwidth, ifmac_ptr,
+                                               bandwidth, id);
+
+        if (rc != -2)
+            return rc;
+    }
+#endif /* WITH_LIBNL */
+
     class_id = g_strdup_printf("1:%x", id);
     qdisc_id = g_strdup_printf("%x:", id);
     floor = g_strdup_printf("%llukbps", bandwidth->in->floor);
@@ -621,6 +1417,7 @@ virNetDevBandwidthPlug(const char *brname,
  * virNetDevBandwidthUnplug:
  * @brname: from which bridge are we unplugging
  * @id: unique identifier (MUST be greater than 2)
+ * @backend: how to program traffic control
  *
  * Remove QoS settings from bridge.
  *
@@ -628,7 +1425,8 @@ virNetDevBandwidthPlug(const char *brname,
  */
 int
 virNetDevBandwidthUnplug(const char *brname,
-                         unsigned int id)
+                         unsigned int id,
+                         virNetDevBandwidthBackend backend G_GNUC_UNUSED)
 {
     int cmd_ret = 0;
     g_autoptr(virCommand) cmd1 = NULL;
@@ -641,6 +1439,15 @@ virNetDevBandwidthUnplug(const char *brname,
         return -1;
     }
 
+#if defined(WITH_LIBNL)
+    if (backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) {
+        int rc = virNetDevBandwidthUnplugNetlink(brname, id);
+
+        if (rc != -2)
+            return rc;
+    }
+#endif /* WITH_LIBNL */
+
     class_id = g_strdup_printf("1:%x", id);
     qdisc_id = g_strdup_printf("%x:", id);
 
@@ -673,6 +1480,7 @@ virNetDevBandwidthUnplug(const char *brname,
  * @id: unique identifier
  * @bandwidth: used to derive 'ceil' of class with @id
  * @new_rate: new rate
+ * @backend: how to program traffic control
  *
  * This function updates the 'rate' attribute of HTB class.
  * It can be used whenever a new interface is plugged to a
@@ -685,13 +1493,24 @@ int
 virNetDevBandwidthUpdateRate(const char *ifname,
                              unsigned int id,
                              virNetDevBandwidth *bandwidth,
-                             unsigned long long new_rate)
+                             unsigned long long new_rate,
+                             virNetDevBandwidthBackend backend G_GNUC_UNUSED)
 {
     g_autoptr(virCommand) cmd = NULL;
     g_autofree char *class_id = NULL;
     g_autofree char *rate = NULL;
     g_autofree char *ceil = NULL;
 
+#if defined(WITH_LIBNL)
+    if (backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) {
+        int rc = virNetDevBandwidthUpdateRateNetlink(ifname, id, bandwidth,
+                                                     new_rate);
+
+        if (rc != -2)
+            return rc;
+    }
+#endif /* WITH_LIBNL */
+
     class_id = g_strdup_printf("1:%x", id);
     rate = g_strdup_printf("%llukbps", new_rate);
     ceil = g_strdup_printf("%llukbps", bandwidth->in->peak ?
@@ -712,6 +1531,7 @@ virNetDevBandwidthUpdateRate(const char *ifname,
  * @ifname: interface to operate on
  * @ifmac_ptr: new MAC to update the filter with
  * @id: filter ID
+ * @backend: how to program traffic control
  *
  * Sometimes the host environment is so dynamic, that even a
  * guest's MAC addresses change on the fly. When that happens we
@@ -727,11 +1547,21 @@ virNetDevBandwidthUpdateRate(const char *ifname,
 int
 virNetDevBandwidthUpdateFilter(const char *ifname,
                                const virMacAddr *ifmac_ptr,
-                               unsigned int id)
+                               unsigned int id,
+                               virNetDevBandwidthBackend backend G_GNUC_UNUSED)
 {
     int ret = -1;
     char *class_id = NULL;
 
+#if defined(WITH_LIBNL)
+    if (backend == VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) {
+        int rc = virNetDevBandwidthUpdateFilterNetlink(ifname, ifmac_ptr, id);
+
+        if (rc != -2)
+            return rc;
+    }
+#endif /* WITH_LIBNL */
+
     class_id = g_strdup_printf("1:%x", id);
 
     if (virNetDevBandwidthManipulateFilter(ifname, ifmac_ptr, id,
@@ -769,9 +1599,6 @@ virNetDevBandwidthSetRootQDisc(const char *ifname,
     g_autofree char *errbuf = NULL;
     int status;
 
-    /* Ideally, we would have a netlink implementation and just
-     * call it here.  But honestly, I tried and failed miserably.
-     * Fallback to spawning tc. */
     cmd = virCommandNewArgList("tc", "qdisc", "add", "dev", ifname,
                                "root", "handle", "0:", qdisc,
                                NULL);
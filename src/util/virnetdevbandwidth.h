@@ -19,6 +19,7 @@
 #pragma once
 
 #include "internal.h"
+#include "virenum.h"
 #include "virmacaddr.h"
 
 typedef struct _virNetDevBandwidthRate virNetDevBandwidthRate;
@@ -45,12 +46,25 @@ typedef enum {
     VIR_NETDEV_BANDWIDTH_SET_CLEAR_ALL = (1 << 2),
 } virNetDevBandwidthSetFlags;
 
+typedef enum {
+    VIR_NETDEV_BANDWIDTH_BACKEND_TC = 0,
+    VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK,
+
+    VIR_NETDEV_BANDWIDTH_BACKEND_LAST
+} virNetDevBandwidthBackend;
+
+VIR_ENUM_DECL(virNetDevBandwidthBackend);
+
+int virNetDevBandwidthCheckBackend(virNetDevBandwidthBackend backend);
+
 int virNetDevBandwidthSet(const char *ifname,
                           const virNetDevBandwidth *bandwidth,
+                          virNetDevBandwidthBackend backend,
                           unsigned int flags)
     G_GNUC_WARN_UNUSED_RESULT;
 
-int virNetDevBandwidthClear(const char *ifname);
+int virNetDevBandwidthClear(const char *ifname,
+                            virNetDevBandwidthBackend backend);
 int virNetDevBandwidthCopy(virNetDevBandwidth **dest,
                            const virNetDevBandwidth *src)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
@@ -61,23 +75,27 @@ int virNetDevBandwidthPlug(const char *brname,
                            virNetDevBandwidth *net_bandwidth,
                            const virMacAddr *ifmac_ptr,
                            virNetDevBandwidth *bandwidth,
-                           unsigned int id)
+                           unsigned int id,
+                           virNetDevBandwidthBackend backend)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(3) ATTRIBUTE_NONNULL(4)
     G_GNUC_WARN_UNUSED_RESULT;
 
 int virNetDevBandwidthUnplug(const char *brname,
-                             unsigned int id)
+                             unsigned int id,
+                             virNetDevBandwidthBackend backend)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 
 int virNetDevBandwidthUpdateRate(const char *ifname,
                                  unsigned int id,
                                  virNetDevBandwidth *bandwidth,
-                                 unsigned long long new_rate)
+                                 unsigned long long new_rate,
+                                 virNetDevBandwidthBackend backend)
     ATTRIBUTE_NONNULL(1) G_GNUC_WARN_UNUSED_RESULT;
 
 int virNetDevBandwidthUpdateFilter(const char *ifname,
                                    const virMacAddr *ifmac_ptr,
-                                   unsigned int id)
+                                   unsigned int id,
+                                   virNetDevBandwidthBackend backend)
     ATTRIBUTE_NONNULL(1) ATTRIBUTE_NONNULL(2)
     G_GNUC_WARN_UNUSED_RESULT;
 
@@ -23,7 +23,9 @@
 
 #include <unistd.h>
 
-#include "virnetlink.h"
+#define LIBVIRT_VIRNETLINKPRIV_H_ALLOW
+
+#include "virnetlinkpriv.h"
 #include "virnetdev.h"
 #include "virlog.h"
 #include "virthread.h"
@@ -37,6 +39,10 @@ VIR_LOG_INIT("util.netlink");
 
 #define NETLINK_ACK_TIMEOUT_S  (2*1000)
 
+/* See virNetlinkSetDryRun for description of these variables */
+static virNetlinkDryRunCallback dryRunCallback;
+static void *dryRunOpaque;
+
 #if defined(WITH_LIBNL)
 
 # include <linux/veth.h>
@@ -430,6 +436,137 @@ virNetlinkTalk(const char *ifname,
 }
 
 
+/**
+ * virNetlinkTalkBatch:
+ * @msgs: array of netlink messages
+ * @nmsgs: number of messages in @msgs
+ * @errors: array of @nmsgs integers to store the result of each message
+ *
+ * Send all @msgs to the kernel over NETLINK_ROUTE in a single sendmsg()
+ * call and wait until each of them is acknowledged. The kernel processes
+ * the messages in order and carries on with the next one even if the
+ * previous one failed, therefore the result of each message (0 or
+ * -errno) is stored into the corresponding item of @errors and it is up
+ * to the caller to decide which failures are fatal.
+ *
+ * Returns: 0 if all messages were acknowledged,
+ *         -1 otherwise (with error reported).
+ */
+int
+virNetlinkTalkBatch(virNetlinkMsg **msgs,
+                    size_t nmsgs,
+                    int *errors)
+{
+    struct sockaddr_nl nladdr = {
+            .nl_family = AF_NETLINK,
+            .nl_pid    = 0,
+            .nl_groups = 0,
+    };
+    g_autoptr(virNetlinkHandle) nlhandle = NULL;
+    g_autofree unsigned char *buf = NULL;
+    g_autofree bool *acked = NULL;
+    struct pollfd fds[1] = { 0 };
+    struct nlmsgerr *err;
+    uint32_t firstSeq = 0;
+    size_t len = 0;
+    size_t nacked = 0;
+    size_t i;
+
+    if (nmsgs == 0)
+        return 0;
+
+    if (dryRunCallback) {
+        for (i = 0; i < nmsgs; i++) {
+            struct nlmsghdr *hdr = nlmsg_hdr(msgs[i]);
+
+            hdr->nlmsg_flags |= NLM_F_REQUEST | NLM_F_ACK;
+            hdr->nlmsg_seq = i + 1;
+            errors[i] = dryRunCallback(hdr, dryRunOpaque);
+        }
+        return 0;
+    }
+
+    if (!(nlhandle = virNetlinkCreateSocket(NETLINK_ROUTE)))
+        return -1;
+
+    /* Messages get consecutive sequence numbers which are then used to
+     * match the acknowledgments with the messages. */
+    for (i = 0; i < nmsgs; i++) {
+        nl_complete_msg(nlhandle, msgs[i]);
+        len += NLMSG_ALIGN(nlmsg_hdr(msgs[i])->nlmsg_len);
+    }
+
+    buf = g_new0(unsigned char, len);
+    len = 0;
+    for (i = 0; i < nmsgs; i++) {
+        struct nlmsghdr *hdr = nlmsg_hdr(msgs[i]);
+
+        memcpy(buf + len, hdr, hdr->nlmsg_len);
+        len += NLMSG_ALIGN(hdr->nlmsg_len);
+    }
+    firstSeq = nlmsg_hdr(msgs[0])->nlmsg_seq;
+
+    if (nl_sendto(nlhandle, buf, len) < 0) {
+        virReportSystemError(errno,
+                             "%s", _("cannot send to netlink socket"));
+        return -1;
+    }
+
+    acked = g_new0(bool, nmsgs);
+    fds[0].fd = nl_socket_get_fd(nlhandle);
+    fds[0].events = POLLIN;
+
+    while (nacked < nmsgs) {
+        g_autofree struct nlmsghdr *resp = NULL;
+        struct nlmsghdr *msg;
+        int n;
+
+        n = poll(fds, G_N_ELEMENTS(fds), NETLINK_ACK_TIMEOUT_S);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            virReportSystemError(errno, "%s",
+                                 _("error in poll call"));
+            return -1;
+        }
+        if (n == 0) {
+            virReportSystemError(ETIMEDOUT, "%s",
+                                 _("no valid netlink response was received"));
+            return -1;
+        }
+
+        n = nl_recv(nlhandle, &nladdr, (unsigned char **)&resp, NULL);
+        if (n <= 0) {
+            virReportSystemError(errno, "%s", _("nl_recv failed"));
+            return -1;
+        }
+
+        VIR_WARNINGS_NO_CAST_ALIGN
+        for (msg = resp; NLMSG_OK(msg, n); msg = NLMSG_NEXT(msg, n)) {
+            VIR_WARNINGS_RESET
+            uint32_t idx = msg->nlmsg_seq - firstSeq;
+
+            if (msg->nlmsg_type != NLMSG_ERROR ||
+                idx >= nmsgs || acked[idx])
+                continue;
+
+            if (msg->nlmsg_len < NLMSG_LENGTH(sizeof(*err))) {
+                virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                               _("malformed netlink response message"));
+                return -1;
+            }
+
+            err = (struct nlmsgerr *) NLMSG_DATA(msg);
+            errors[idx] = err->error;
+            acked[idx] = true;
+            nacked++;
+        }
+    }
+
+    return 0;
+}
+
+
 int
 virNetlinkDumpCommand(struct nl_msg *nl_msg,
                       virNetlinkDumpCallback callback,
@@ -1346,6 +1483,15 @@ int virNetlinkCommand(struct nl_msg *nl_msg G_GNUC_UNUSED,
     return -1;
 }
 
+int
+virNetlinkTalkBatch(struct nl_msg **msgs G_GNUC_UNUSED,
+                    size_t nmsgs G_GNUC_UNUSED,
+                    int *errors G_GNUC_UNUSED)
+{
+    virReportError(VIR_ERR_INTERNAL_ERROR, "%s", _(unsupported));
+    return -1;
+}
+
 int
 virNetlinkDumpCommand(struct nl_msg *nl_msg G_GNUC_UNUSED,
                       virNetlinkDumpCallback callback G_GNUC_UNUSED,
@@ -1505,3 +1651,25 @@ virNetlinkGetErrorCode(struct nlmsghdr *resp G_GNUC_UNUSED,
 }
 
 #endif /* WITH_LIBNL */
+
+
+/**
+ * virNetlinkSetDryRun:
+ * @cb: callback to process each message instead of the kernel
+ * @opaque: data passed to @cb
+ *
+ * This is useful for unit testing: when @cb is not NULL, messages passed
+ * to virNetlinkTalkBatch() are not sent to the kernel but handed to @cb
+ * one by one, in order. Whatever @cb returns (0 or -errno) is then used
+ * as the acknowledgment of the message. Call with @cb set to NULL to
+ * restore the normal behaviour.
+ *
+ * NB: this is not thread safe.
+ */
+void
+virNetlinkSetDryRun(virNetlinkDryRunCallback cb,
+                    void *opaque)
+{
+    dryRunCallback = cb;
+    dryRunOpaque = opaque;
+}
@@ -51,6 +51,10 @@ int virNetlinkCommand(struct nl_msg *nl_msg,
                       uint32_t src_pid, uint32_t dst_pid,
                       unsigned int protocol, unsigned int groups);
 
+int virNetlinkTalkBatch(struct nl_msg **msgs,
+                        size_t nmsgs,
+                        int *errors);
+
 typedef int (*virNetlinkDumpCallback)(struct nlmsghdr *resp,
                                       void *data);
 
@@ -73,6 +73,7 @@
 #include "virutil.h"
 #include "virstring.h"
 #include "vircommand.h"
+#include "virthread.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
@@ -1221,8 +1222,8 @@ struct _virProcessNamespaceHelperData {
     void *opaque;
 };
 
-static int virProcessNamespaceHelper(pid_t pid G_GNUC_UNUSED,
-                                     void *opaque)
+static int virProcessNamespaceEnterCallback(pid_t pid G_GNUC_UNUSED,
+                                            void *opaque)
 {
     virProcessNamespaceHelperData *data = opaque;
     int fd = -1;
@@ -1263,7 +1264,7 @@ virProcessRunInMountNamespace(pid_t pid,
 {
     virProcessNamespaceHelperData data = {.pid = pid, .cb = cb, .opaque = opaque};
 
-    return virProcessRunInFork(virProcessNamespaceHelper, &data);
+    return virProcessRunInFork(virProcessNamespaceEnterCallback, &data);
 }
 
 #else /* ! __linux__ */
@@ -1281,6 +1282,346 @@ virProcessRunInMountNamespace(pid_t pid G_GNUC_UNUSED,
 #endif /* ! __linux__ */
 
 
+#if defined(__linux__) && defined(F_OFD_SETLK)
+typedef struct _virProcessNamespaceHelperRequest virProcessNamespaceHelperRequest;
+
+struct _virProcessNamespaceHelper {
+    virObjectLockable parent;
+
+    pid_t pid;
+    virThread thread;
+    virCond cond;
+
+    bool started;
+    bool quit;
+    int startRC;
+    virErrorPtr startErr;
+
+    /* the request being processed, NULL if the helper is idle */
+    virProcessNamespaceHelperRequest *req;
+};
+
+struct _virProcessNamespaceHelperRequest {
+    virProcessNamespaceCallback cb;
+    void *opaque;
+    bool done;
+    int rc;
+    virErrorPtr err;
+};
+
+static virClass *virProcessNamespaceHelperClass;
+
+/* pid -> virProcessNamespaceHelper mapping, protected by
+ * virProcessNamespaceHelpersLock */
+static GHashTable *virProcessNamespaceHelpers;
+static virMutex virProcessNamespaceHelpersLock = VIR_MUTEX_INITIALIZER;
+
+static void
+virProcessNamespaceHelperDispose(void *obj)
+{
+    virProcessNamespaceHelper *helper = obj;
+
+    virCondDestroy(&helper->cond);
+    virFreeError(helper->startErr);
+}
+
+
+static int
+virProcessNamespaceHelperOnceInit(void)
+{
+    if (!VIR_CLASS_NEW(virProcessNamespaceHelper, virClassForObjectLockable()))
+        return -1;
+
+    virProcessNamespaceHelpers = g_hash_table_new(g_direct_hash, g_direct_equal);
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virProcessNamespaceHelper);
+
+
+static int
+virProcessNamespaceHelperEnter(pid_t pid)
+{
+    g_autofree char *path = g_strdup_printf("/proc/%lld/ns/mnt", (long long)pid);
+    VIR_AUTOCLOSE fd = -1;
+
+    /* Threads sharing their filesystem attributes with other threads
+     * can't change the mount namespace. */
+    if (unshare(CLONE_FS) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to unshare filesystem attributes"));
+        return -1;
+    }
+
+    if ((fd = open(path, O_RDONLY)) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Kernel does not provide mount namespace"));
+        return -1;
+    }
+
+    if (setns(fd, CLONE_NEWNS) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to enter mount namespace"));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void
+virProcessNamespaceHelperWorker(void *opaque)
+{
+    virProcessNamespaceHelper *helper = opaque;
+    int rc = virProcessNamespaceHelperEnter(helper->pid);
+
+    virObjectLock(helper);
+
+    helper->started = true;
+    helper->startRC = rc;
+    if (rc < 0)
+        virErrorPreserveLast(&helper->startErr);
+    virCondBroadcast(&helper->cond);
+
+    while (rc == 0) {
+        virProcessNamespaceHelperRequest *req;
+
+        while (!helper->req && !helper->quit) {
+            if (virCondWait(&helper->cond, &helper->parent.lock) < 0) {
+                VIR_WARN("Unable to wait on namespace helper condition");
+                helper->quit = true;
+            }
+        }
+
+        /* requests accepted before quitting are still processed */
+        if (!(req = helper->req))
+            break;
+
+        virObjectUnlock(helper);
+
+        req->rc = req->cb(helper->pid, req->opaque);
+        if (req->rc < 0)
+            virErrorPreserveLast(&req->err);
+
+        virObjectLock(helper);
+
+        req->done = true;
+        helper->req = NULL;
+        virCondBroadcast(&helper->cond);
+    }
+
+    virObjectUnlock(helper);
+}
+
+
+/**
+ * virProcessNamespaceHelperNew:
+ * @pid: process whose mount namespace to enter
+ *
+ * Starts a thread which stays in the mount namespace of @pid and runs
+ * callbacks passed to virProcessRunInNamespaceHelper for @pid, which
+ * saves forking a child for every operation. The helper is stopped by
+ * virProcessNamespaceHelperClose.
+ *
+ * Returns the helper on success, NULL on error (with error reported).
+ */
+virProcessNamespaceHelper *
+virProcessNamespaceHelperNew(pid_t pid)
+{
+    g_autoptr(virProcessNamespaceHelper) helper = NULL;
+    g_autofree char *name = NULL;
+
+    if (virProcessNamespaceHelperInitialize() < 0)
+        return NULL;
+
+    if (!(helper = virObjectLockableNew(virProcessNamespaceHelperClass)))
+        return NULL;
+
+    if (virCondInit(&helper->cond) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("cannot initialize condition variable"));
+        return NULL;
+    }
+
+    helper->pid = pid;
+    name = g_strdup_printf("ns-%lld", (long long)pid);
+
+    if (virThreadCreateFull(&helper->thread, true,
+                            virProcessNamespaceHelperWorker,
+                            name, false, virObjectRef(helper)) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("Unable to create namespace helper thread"));
+        virObjectUnref(helper);
+        return NULL;
+    }
+
+    virObjectLock(helper);
+    while (!helper->started)
+        ignore_value(virCondWait(&helper->cond, &helper->parent.lock));
+    virObjectUnlock(helper);
+
+    if (helper->startRC < 0) {
+        virThreadJoin(&helper->thread);
+        virObjectUnref(helper);
+        virErrorRestore(&helper->startErr);
+        return NULL;
+    }
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&virProcessNamespaceHelpersLock) {
+        g_hash_table_insert(virProcessNamespaceHelpers,
+                            GINT_TO_POINTER(pid), helper);
+    }
+
+    return g_steal_pointer(&helper);
+}
+
+
+/**
+ * virProcessNamespaceHelperClose:
+ * @helper: namespace helper
+ *
+ * Waits for callbacks running in @helper to finish, stops its thread
+ * and releases @helper.
+ */
+void
+virProcessNamespaceHelperClose(virProcessNamespaceHelper *helper)
+{
+    if (!helper)
+        return;
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&virProcessNamespaceHelpersLock) {
+        if (g_hash_table_lookup(virProcessNamespaceHelpers,
+                                GINT_TO_POINTER(helper->pid)) == helper)
+            g_hash_table_remove(virProcessNamespaceHelpers,
+                                GINT_TO_POINTER(helper->pid));
+    }
+
+    virObjectLock(helper);
+    helper->quit = true;
+    virCondBroadcast(&helper->cond);
+    virObjectUnlock(helper);
+
+    virThreadJoin(&helper->thread);
+
+    /* drop the reference held by the thread */
+    virObjectUnref(helper);
+    virObjectUnref(helper);
+}
+
+
+/* Runs @cb in @helper. If @helper is stopped or its thread quit, @stopped
+ * is set and -1 is returned without reporting an error. */
+static int
+virProcessNamespaceHelperRun(virProcessNamespaceHelper *helper,
+                             virProcessNamespaceCallback cb,
+                             void *opaque,
+                             bool *stopped)
+{
+    virProcessNamespaceHelperRequest req = { .cb = cb, .opaque = opaque };
+
+    *stopped = false;
+
+    VIR_WITH_OBJECT_LOCK_GUARD(helper) {
+        while (helper->req && !helper->quit) {
+            if (virCondWait(&helper->cond, &helper->parent.lock) < 0) {
+                virReportSystemError(errno, "%s",
+                                     _("Unable to wait on namespace helper condition"));
+                return -1;
+            }
+        }
+
+        if (helper->quit) {
+            *stopped = true;
+            return -1;
+        }
+
+        helper->req = &req;
+        virCondBroadcast(&helper->cond);
+
+        while (!req.done)
+            ignore_value(virCondWait(&helper->cond, &helper->parent.lock));
+    }
+
+    if (req.rc < 0) {
+        virErrorRestore(&req.err);
+        return -1;
+    }
+
+    return req.rc;
+}
+
+
+/**
+ * virProcessRunInNamespaceHelper:
+ * @pid: process whose mount namespace to run @cb in
+ * @cb: callback to run
+ * @opaque: data for @cb
+ *
+ * Runs @cb in the mount namespace of @pid, using the helper started for
+ * @pid by virProcessNamespaceHelperNew if there's one, or a forked child
+ * as virProcessRunInMountNamespace does otherwise. @cb thus has to be safe
+ * to run in both: it must only use async signal safe functions and must
+ * not rely on changes it does to memory being either visible or invisible
+ * to the caller. File locks it takes must be open file description locks
+ * (see virFileLockOFD) to not be shared with other threads. If the helper
+ * was stopped in the meantime, a forked child is used as well.
+ *
+ * Returns the same as virProcessRunInMountNamespace.
+ */
+int
+virProcessRunInNamespaceHelper(pid_t pid,
+                               virProcessNamespaceCallback cb,
+                               void *opaque)
+{
+    g_autoptr(virProcessNamespaceHelper) helper = NULL;
+    bool stopped = true;
+    int ret = -1;
+
+    if (virProcessNamespaceHelperInitialize() < 0)
+        return -1;
+
+    VIR_WITH_MUTEX_LOCK_GUARD(&virProcessNamespaceHelpersLock) {
+        helper = virObjectRef(g_hash_table_lookup(virProcessNamespaceHelpers,
+                                                  GINT_TO_POINTER(pid)));
+    }
+
+    if (helper)
+        ret = virProcessNamespaceHelperRun(helper, cb, opaque, &stopped);
+
+    if (stopped)
+        return virProcessRunInMountNamespace(pid, cb, opaque);
+
+    return ret;
+}
+
+#else /* ! (__linux__ && F_OFD_SETLK) */
+
+virProcessNamespaceHelper *
+virProcessNamespaceHelperNew(pid_t pid G_GNUC_UNUSED)
+{
+    virReportSystemError(ENOSYS, "%s",
+                         _("Namespace helpers are not supported on this platform"));
+    return NULL;
+}
+
+
+void
+virProcessNamespaceHelperClose(virProcessNamespaceHelper *helper G_GNUC_UNUSED)
+{
+}
+
+
+int
+virProcessRunInNamespaceHelper(pid_t pid,
+                               virProcessNamespaceCallback cb,
+                               void *opaque)
+{
+    return virProcessRunInMountNamespace(pid, cb, opaque);
+}
+
+#endif /* ! (__linux__ && F_OFD_SETLK) */
+
+
 #ifndef WIN32
 /* We assume that error messages will fit into 1024 chars */
 # define VIR_PROCESS_ERROR_MAX_LENGTH 1024
@@ -1973,6 +2314,498 @@ virProcessGetSchedInfo(unsigned long long *cpuWait,
 }
 #endif /* __linux__ */
 
+#ifdef __linux__
+/* Large enough for the whole of .../stat and .../schedstat and for the
+ * leading part of .../sched which contains wait_sum. */
+# define VIR_PROCESS_STAT_SAMPLER_BUFSIZE 4096
+
+typedef enum {
+    VIR_PROCESS_STAT_SAMPLER_FILE_STAT = 0,
+    VIR_PROCESS_STAT_SAMPLER_FILE_SCHED,
+    VIR_PROCESS_STAT_SAMPLER_FILE_SCHEDSTAT,
+
+    VIR_PROCESS_STAT_SAMPLER_FILE_LAST
+} virProcessStatSamplerFile;
+
+static const char *virProcessStatSamplerFileNames[] = {
+    "stat",
+    "sched",
+    "schedstat",
+};
+G_STATIC_ASSERT(G_N_ELEMENTS(virProcessStatSamplerFileNames) ==
+                VIR_PROCESS_STAT_SAMPLER_FILE_LAST);
+
+typedef struct _virProcessStatSamplerThread virProcessStatSamplerThread;
+struct _virProcessStatSamplerThread {
+    int fds[VIR_PROCESS_STAT_SAMPLER_FILE_LAST];
+    unsigned int generation; /* last sweep generation this thread was read in */
+};
+
+struct _virProcessStatSampler {
+    pid_t pid;
+    GHashTable *threads; /* tid -> virProcessStatSamplerThread */
+    unsigned int generation;
+    char buf[VIR_PROCESS_STAT_SAMPLER_BUFSIZE];
+};
+
+/* File descriptors kept open by all samplers together. The total is
+ * capped so that a host running many guests with many vCPUs can't
+ * exhaust the daemon's RLIMIT_NOFILE; files over the cap are simply
+ * opened and closed on every read as before. */
+static int virProcessStatSamplerFds;
+static int virProcessStatSamplerFdsMax;
+static unsigned long long virProcessStatSamplerJiff2nsec;
+
+
+static int
+virProcessStatSamplerOnceInit(void)
+{
+    unsigned long long nofile = 1024;
+# if WITH_SETRLIMIT
+    struct rlimit rlim;
+
+    if (getrlimit(RLIMIT_NOFILE, &rlim) == 0)
+        nofile = MIN(rlim.rlim_cur, 1024 * 1024);
+# endif /* WITH_SETRLIMIT */
+
+    /* Leave most of the descriptors to everything else */
+    virProcessStatSamplerFdsMax = nofile / 4;
+    virProcessStatSamplerJiff2nsec = 1000ull * 1000ull * 1000ull /
+                                     (unsigned long long) sysconf(_SC_CLK_TCK);
+
+    return 0;
+}
+
+VIR_ONCE_GLOBAL_INIT(virProcessStatSampler);
+
+
+static void
+virProcessStatSamplerThreadFree(void *opaque)
+{
+    virProcessStatSamplerThread *thread = opaque;
+    size_t i;
+
+    for (i = 0; i < VIR_PROCESS_STAT_SAMPLER_FILE_LAST; i++) {
+        if (thread->fds[i] < 0)
+            continue;
+
+        VIR_FORCE_CLOSE(thread->fds[i]);
+        g_atomic_int_add(&virProcessStatSamplerFds, -1);
+    }
+
+    g_free(thread);
+}
+
+
+/**
+ * virProcessStatSamplerNew:
+ * @pid: process to sample
+ *
+ * Create a sampler of per-thread CPU statistics of @pid which keeps the
+ * files under /proc/@pid open between samples, so that periodically
+ * polling the statistics of many threads costs a single pread() per
+ * file instead of open(), read() and close().
+ *
+ * The sampler is not thread safe, callers must serialize access to it.
+ *
+ * Returns the new sampler or NULL on error.
+ */
+virProcessStatSampler *
+virProcessStatSamplerNew(pid_t pid)
+{
+    virProcessStatSampler *sampler;
+
+    if (virProcessStatSamplerInitialize() < 0)
+        return NULL;
+
+    sampler = g_new0(virProcessStatSampler, 1);
+    sampler->pid = pid;
+    sampler->threads = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                             NULL,
+                                             virProcessStatSamplerThreadFree);
+
+    return sampler;
+}
+
+
+void
+virProcessStatSamplerFree(virProcessStatSampler *sampler)
+{
+    if (!sampler)
+        return;
+
+    g_clear_pointer(&sampler->threads, g_hash_table_unref);
+    g_free(sampler);
+}
+
+
+/*
+ * Read @file of thread @tid (or the process itself if @tid is 0) into
+ * sampler->buf. Returns the length of the data read or -errno.
+ */
+static int
+virProcessStatSamplerRead(virProcessStatSampler *sampler,
+                          pid_t tid,
+                          virProcessStatSamplerFile file)
+{
+    virProcessStatSamplerThread *thread;
+    g_autofree char *path = NULL;
+    VIR_AUTOCLOSE fd = -1;
+    int len;
+    size_t i;
+
+    if (!(thread = g_hash_table_lookup(sampler->threads, GINT_TO_POINTER(tid)))) {
+        thread = g_new0(virProcessStatSamplerThread, 1);
+        for (i = 0; i < VIR_PROCESS_STAT_SAMPLER_FILE_LAST; i++)
+            thread->fds[i] = -1;
+
+        g_hash_table_insert(sampler->threads, GINT_TO_POINTER(tid), thread);
+    }
+
+    thread->generation = sampler->generation;
+
+    if (thread->fds[file] >= 0) {
+        len = virFileRereadBufFD(thread->fds[file], sampler->buf,
+                                 sizeof(sampler->buf));
+        if (len >= 0)
+            return len;
+
+        /* The thread has exited, but its ID might have been reused */
+        VIR_FORCE_CLOSE(thread->fds[file]);
+        g_atomic_int_add(&virProcessStatSamplerFds, -1);
+    }
+
+    if (tid)
+        path = g_strdup_printf("/proc/%d/task/%d/%s", (int) sampler->pid,
+                               (int) tid, virProcessStatSamplerFileNames[file]);
+    else
+        path = g_strdup_printf("/proc/%d/%s", (int) sampler->pid,
+                               virProcessStatSamplerFileNames[file]);
+
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+        return -errno;
+
+    if ((len = virFileRereadBufFD(fd, sampler->buf, sizeof(sampler->buf))) < 0)
+        return len;
+
+    if (g_atomic_int_add(&virProcessStatSamplerFds, 1) < virProcessStatSamplerFdsMax) {
+        thread->fds[file] = fd;
+        fd = -1;
+    } else {
+        g_atomic_int_add(&virProcessStatSamplerFds, -1);
+    }
+
+    return len;
+}
+
+
+/*
+ * Parse a decimal number at *@str and move *@str past it. This
+ * is all that is needed for procfs files and avoids the locale
+ * and whitespace handling of strtoull().
+ */
+static int
+virProcessStatSamplerParseULL(const char **str,
+                              unsigned long long *value)
+{
+    const char *p = *str;
+    unsigned long long val = 0;
+
+    if (!g_ascii_isdigit(*p))
+        return -1;
+
+    for (; g_ascii_isdigit(*p); p++) {
+        unsigned int digit = *p - '0';
+
+        if (val > (ULLONG_MAX - digit) / 10)
+            return -1;
+
+        val = val * 10 + digit;
+    }
+
+    *str = p;
+    *value = val;
+    return 0;
+}
+
+
+static const char *
+virProcessStatSamplerSkipFields(const char *str,
+                                size_t nfields)
+{
+    for (; nfields > 0; nfields--) {
+        if (!(str = strchr(str, ' ')))
+            return NULL;
+        str++;
+    }
+
+    return str;
+}
+
+
+/**
+ * virProcessStatSamplerGetStatInfo:
+ * @sampler: sampler
+ * @tid: thread to sample, or 0 for the whole process
+ * @cpuTime: filled with the total CPU time in nanoseconds (optional)
+ * @userTime: filled with the user CPU time in nanoseconds (optional)
+ * @sysTime: filled with the system CPU time in nanoseconds (optional)
+ * @lastCpu: filled with the CPU the thread last ran on (optional)
+ *
+ * Equivalent of virProcessGetStatInfo(). Just like there, failure to
+ * read or parse the data is only logged and neutral values are
+ * reported.
+ *
+ * Returns 0.
+ */
+int
+virProcessStatSamplerGetStatInfo(virProcessStatSampler *sampler,
+                                 pid_t tid,
+                                 unsigned long long *cpuTime,
+                                 unsigned long long *userTime,
+                                 unsigned long long *sysTime,
+                                 int *lastCpu)
+{
+    unsigned long long utime = 0;
+    unsigned long long stime = 0;
+    unsigned long long cpu = 0;
+    const char *p = NULL;
+
+    /* The second field is the executable name in parentheses which may
+     * contain anything, so start counting from the last parenthesis. */
+    if (virProcessStatSamplerRead(sampler, tid, VIR_PROCESS_STAT_SAMPLER_FILE_STAT) < 0 ||
+        !(p = strrchr(sampler->buf, ')')) ||
+        !(p = virProcessStatSamplerSkipFields(p, VIR_PROCESS_STAT_UTIME -
+                                                 VIR_PROCESS_STAT_COMM)) ||
+        virProcessStatSamplerParseULL(&p, &utime) < 0 ||
+        !(p = virProcessStatSamplerSkipFields(p, 1)) ||
+        virProcessStatSamplerParseULL(&p, &stime) < 0 ||
+        !(p = virProcessStatSamplerSkipFields(p, VIR_PROCESS_STAT_PROCESSOR -
+                                                 VIR_PROCESS_STAT_STIME)) ||
+        virProcessStatSamplerParseULL(&p, &cpu) < 0 ||
+        cpu > INT_MAX) {
+        VIR_WARN("cannot parse process status data");
+        utime = stime = cpu = 0;
+    }
+
+    utime *= virProcessStatSamplerJiff2nsec;
+    stime *= virProcessStatSamplerJiff2nsec;
+    if (cpuTime)
+        *cpuTime = utime + stime;
+    if (userTime)
+        *userTime = utime;
+    if (sysTime)
+        *sysTime = stime;
+    if (lastCpu)
+        *lastCpu = cpu;
+
+    return 0;
+}
+
+
+/**
+ * virProcessStatSamplerGetSchedInfo:
+ * @sampler: sampler
+ * @tid: thread to sample, or 0 for the whole process
+ * @cpuWait: filled with the time spent waiting for a CPU in nanoseconds
+ *
+ * Equivalent of virProcessGetSchedInfo().
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virProcessStatSamplerGetSchedInfo(virProcessStatSampler *sampler,
+                                  pid_t tid,
+                                  unsigned long long *cpuWait)
+{
+    unsigned long long msec;
+    unsigned long long nsec = 0;
+    size_t ndigits = 0;
+    const char *p;
+    int len;
+
+    *cpuWait = 0;
+
+    /* Anything out of the ordinary is handed over to the generic code
+     * which also takes care of error reporting. */
+    if ((len = virProcessStatSamplerRead(sampler, tid,
+                                         VIR_PROCESS_STAT_SAMPLER_FILE_SCHED)) < 0)
+        return virProcessGetSchedInfo(cpuWait, sampler->pid, tid);
+
+    /* Matches all of wait_sum, se.statistics.wait_sum and se.wait_sum.
+     * The field needs CONFIG_SCHEDSTATS. */
+    if (!(p = strstr(sampler->buf, "wait_sum"))) {
+        if ((size_t) len >= sizeof(sampler->buf) - 1)
+            return virProcessGetSchedInfo(cpuWait, sampler->pid, tid);
+        return 0;
+    }
+
+    p += strlen("wait_sum");
+    while (*p == ' ')
+        p++;
+    if (*p != ':')
+        return virProcessGetSchedInfo(cpuWait, sampler->pid, tid);
+    p++;
+    while (*p == ' ')
+        p++;
+
+    /* The value is in milliseconds with (at most) six decimal places */
+    if (virProcessStatSamplerParseULL(&p, &msec) < 0 ||
+        msec > ULLONG_MAX / 1000000)
+        return virProcessGetSchedInfo(cpuWait, sampler->pid, tid);
+
+    if (*p == '.') {
+        for (p++; g_ascii_isdigit(*p) && ndigits < 6; p++, ndigits++)
+            nsec = nsec * 10 + (*p - '0');
+    }
+    for (; ndigits < 6; ndigits++)
+        nsec *= 10;
+
+    *cpuWait = msec * 1000000 + nsec;
+    return 0;
+}
+
+
+/**
+ * virProcessStatSamplerGetSchedstatDelay:
+ * @sampler: sampler
+ * @tid: thread to sample, or 0 for the whole process
+ * @cpuDelay: filled with the time spent waiting on a runqueue in nanoseconds
+ *
+ * Reads the second field of .../schedstat. The file needs
+ * CONFIG_SCHED_INFO, @cpuDelay is set to 0 if it does not exist.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virProcessStatSamplerGetSchedstatDelay(virProcessStatSampler *sampler,
+                                       pid_t tid,
+                                       unsigned long long *cpuDelay)
+{
+    unsigned long long runTime;
+    const char *p = sampler->buf;
+    int len;
+
+    *cpuDelay = 0;
+
+    if ((len = virProcessStatSamplerRead(sampler, tid,
+                                         VIR_PROCESS_STAT_SAMPLER_FILE_SCHEDSTAT)) < 0) {
+        if (len == -ENOENT)
+            return 0;
+
+        virReportSystemError(-len,
+                             _("Unable to read schedstat info of thread %1$d"),
+                             (int) tid);
+        return -1;
+    }
+
+    if (virProcessStatSamplerParseULL(&p, &runTime) < 0 ||
+        *p++ != ' ' ||
+        virProcessStatSamplerParseULL(&p, cpuDelay) < 0) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("Unable to parse schedstat info of thread %1$d"),
+                       (int) tid);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static gboolean
+virProcessStatSamplerThreadIsStale(gpointer key G_GNUC_UNUSED,
+                                   gpointer value,
+                                   gpointer opaque)
+{
+    virProcessStatSamplerThread *thread = value;
+    virProcessStatSampler *sampler = opaque;
+
+    return thread->generation != sampler->generation;
+}
+
+
+/**
+ * virProcessStatSamplerSweep:
+ * @sampler: sampler
+ *
+ * Close files of threads which were not sampled since the previous call,
+ * e.g. because they were unplugged vCPUs. Callers which sample all the
+ * threads they are interested in periodically should call this after
+ * each round.
+ */
+void
+virProcessStatSamplerSweep(virProcessStatSampler *sampler)
+{
+    g_hash_table_foreach_remove(sampler->threads,
+                                virProcessStatSamplerThreadIsStale,
+                                sampler);
+    sampler->generation++;
+}
+
+#else /* !__linux__ */
+
+struct _virProcessStatSampler {
+    pid_t pid;
+};
+
+
+virProcessStatSampler *
+virProcessStatSamplerNew(pid_t pid)
+{
+    virProcessStatSampler *sampler = g_new0(virProcessStatSampler, 1);
+
+    sampler->pid = pid;
+
+    return sampler;
+}
+
+
+void
+virProcessStatSamplerFree(virProcessStatSampler *sampler)
+{
+    g_free(sampler);
+}
+
+
+int
+virProcessStatSamplerGetStatInfo(virProcessStatSampler *sampler,
+                                 pid_t tid,
+                                 unsigned long long *cpuTime,
+                                 unsigned long long *userTime,
+                                 unsigned long long *sysTime,
+                                 int *lastCpu)
+{
+    return virProcessGetStatInfo(cpuTime, userTime, sysTime, lastCpu, NULL,
+                                 sampler->pid, tid);
+}
+
+
+int
+virProcessStatSamplerGetSchedInfo(virProcessStatSampler *sampler,
+                                  pid_t tid,
+                                  unsigned long long *cpuWait)
+{
+    return virProcessGetSchedInfo(cpuWait, sampler->pid, tid);
+}
+
+
+int
+virProcessStatSamplerGetSchedstatDelay(virProcessStatSampler *sampler G_GNUC_UNUSED,
+                                       pid_t tid G_GNUC_UNUSED,
+                                       unsigned long long *cpuDelay)
+{
+    *cpuDelay = 0;
+
+    return 0;
+}
+
+
+void
+virProcessStatSamplerSweep(virProcessStatSampler *sampler G_GNUC_UNUSED)
+{
+}
+#endif /* !__linux__ */
+
 #ifdef __linux__
 # ifndef PR_SCHED_CORE
 /* Copied from linux/prctl.h */
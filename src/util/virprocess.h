@@ -26,6 +26,7 @@
 #include "internal.h"
 #include "virbitmap.h"
 #include "virenum.h"
+#include "virobject.h"
 
 typedef enum {
     VIR_PROC_POLICY_NONE = 0,
@@ -96,6 +97,17 @@ int virProcessRunInMountNamespace(pid_t pid,
                                   virProcessNamespaceCallback cb,
                                   void *opaque);
 
+typedef struct _virProcessNamespaceHelper virProcessNamespaceHelper;
+
+virProcessNamespaceHelper *virProcessNamespaceHelperNew(pid_t pid);
+void virProcessNamespaceHelperClose(virProcessNamespaceHelper *helper);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virProcessNamespaceHelper, virObjectUnref);
+
+int virProcessRunInNamespaceHelper(pid_t pid,
+                                   virProcessNamespaceCallback cb,
+                                   void *opaque);
+
 /**
  * virProcessForkCallback:
  * @ppid: parent's pid
@@ -206,6 +218,26 @@ int virProcessGetSchedInfo(unsigned long long *cpuWait,
                            pid_t pid,
                            pid_t tid);
 
+typedef struct _virProcessStatSampler virProcessStatSampler;
+
+virProcessStatSampler *virProcessStatSamplerNew(pid_t pid);
+void virProcessStatSamplerFree(virProcessStatSampler *sampler);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virProcessStatSampler, virProcessStatSamplerFree);
+
+int virProcessStatSamplerGetStatInfo(virProcessStatSampler *sampler,
+                                     pid_t tid,
+                                     unsigned long long *cpuTime,
+                                     unsigned long long *userTime,
+                                     unsigned long long *sysTime,
+                                     int *lastCpu);
+int virProcessStatSamplerGetSchedInfo(virProcessStatSampler *sampler,
+                                      pid_t tid,
+                                      unsigned long long *cpuWait);
+int virProcessStatSamplerGetSchedstatDelay(virProcessStatSampler *sampler,
+                                           pid_t tid,
+                                           unsigned long long *cpuDelay);
+void virProcessStatSamplerSweep(virProcessStatSampler *sampler);
+
 int virProcessSchedCoreAvailable(void);
 
 int virProcessSchedCoreCreate(void);
@@ -0,0 +1,650 @@
+/*
+ * virstatsstream.c: compact binary encoding of bulk domain statistics
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include "virstatsstream.h"
+#include "virerror.h"
+#include "virfile.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+/*
+ * The stream starts with a header and is followed by items, each
+ * starting with a single byte virStatsStreamItem tag. All integers
+ * are little endian.
+ *
+ * Parameter names (keys) and the layout of records (shapes) are sent
+ * once, the first time they are needed, and numbered in the order
+ * they appear. Records then refer to a shape and carry just the
+ * values, so a host with many similarly configured domains sends
+ * each key string once per stream instead of once per domain.
+ */
+
+/* doubles are sent as their IEEE 754 bit pattern */
+G_STATIC_ASSERT(sizeof(uint64_t) == sizeof(double));
+
+struct _virStatsStreamEncoder {
+    GByteArray *data;
+    GHashTable *keys; /* name -> index + 1 */
+    GHashTable *shapes; /* GBytes with the shape item -> index + 1 */
+    unsigned int nkeys;
+    unsigned int nshapes;
+};
+
+
+static void
+virStatsStreamPutU8(GByteArray *data,
+                    uint8_t val)
+{
+    g_byte_array_append(data, &val, 1);
+}
+
+
+static void
+virStatsStreamPutU32(GByteArray *data,
+                     uint32_t val)
+{
+    val = GUINT32_TO_LE(val);
+    g_byte_array_append(data, (const guint8 *) &val, sizeof(val));
+}
+
+
+static void
+virStatsStreamPutU64(GByteArray *data,
+                     uint64_t val)
+{
+    val = GUINT64_TO_LE(val);
+    g_byte_array_append(data, (const guint8 *) &val, sizeof(val));
+}
+
+
+static void
+virStatsStreamPutString(GByteArray *data,
+                        const char *str)
+{
+    size_t len = strlen(str);
+
+    virStatsStreamPutU32(data, len);
+    g_byte_array_append(data, (const guint8 *) str, len);
+}
+
+
+virStatsStreamEncoder *
+virStatsStreamEncoderNew(void)
+{
+    virStatsStreamEncoder *enc = g_new0(virStatsStreamEncoder, 1);
+
+    enc->data = g_byte_array_new();
+    enc->keys = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    enc->shapes = g_hash_table_new_full(g_bytes_hash, g_bytes_equal,
+                                        (GDestroyNotify) g_bytes_unref, NULL);
+
+    g_byte_array_append(enc->data, (const guint8 *) VIR_STATS_STREAM_MAGIC,
+                        strlen(VIR_STATS_STREAM_MAGIC));
+    virStatsStreamPutU32(enc->data, VIR_STATS_STREAM_VERSION);
+
+    return enc;
+}
+
+
+void
+virStatsStreamEncoderFree(virStatsStreamEncoder *enc)
+{
+    if (!enc)
+        return;
+
+    if (enc->data)
+        g_byte_array_unref(enc->data);
+    g_clear_pointer(&enc->keys, g_hash_table_unref);
+    g_clear_pointer(&enc->shapes, g_hash_table_unref);
+    g_free(enc);
+}
+
+
+static unsigned int
+virStatsStreamEncoderKey(virStatsStreamEncoder *enc,
+                         const char *name)
+{
+    unsigned int idx = GPOINTER_TO_UINT(g_hash_table_lookup(enc->keys, name));
+
+    if (idx > 0)
+        return idx - 1;
+
+    virStatsStreamPutU8(enc->data, VIR_STATS_STREAM_ITEM_KEY);
+    virStatsStreamPutString(enc->data, name);
+
+    g_hash_table_insert(enc->keys, g_strdup(name),
+                        GUINT_TO_POINTER(++enc->nkeys));
+    return enc->nkeys - 1;
+}
+
+
+/**
+ * virStatsStreamEncoderAddRecord:
+ * @enc: encoder
+ * @name: name of the domain
+ * @uuid: raw UUID of the domain
+ * @id: ID of the domain, -1 if inactive
+ * @params: statistics
+ * @nparams: number of items in @params
+ *
+ * Appends a record to the stream, preceded by any key and shape
+ * definitions it needs.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virStatsStreamEncoderAddRecord(virStatsStreamEncoder *enc,
+                               const char *name,
+                               const unsigned char *uuid,
+                               int id,
+                               virTypedParameterPtr params,
+                               int nparams)
+{
+    g_autoptr(GByteArray) shape = g_byte_array_sized_new(5 + nparams * 5);
+    g_autoptr(GBytes) shapeKey = NULL;
+    unsigned int shapeIdx;
+    size_t i;
+
+    virStatsStreamPutU8(shape, VIR_STATS_STREAM_ITEM_SHAPE);
+    virStatsStreamPutU32(shape, nparams);
+
+    for (i = 0; i < nparams; i++) {
+        if (params[i].type < VIR_TYPED_PARAM_INT ||
+            params[i].type >= VIR_TYPED_PARAM_LAST) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("unexpected type %1$d for field '%2$s'"),
+                           params[i].type, params[i].field);
+            return -1;
+        }
+
+        virStatsStreamPutU32(shape, virStatsStreamEncoderKey(enc, params[i].field));
+        virStatsStreamPutU8(shape, params[i].type);
+    }
+
+    shapeKey = g_byte_array_free_to_bytes(g_steal_pointer(&shape));
+    shapeIdx = GPOINTER_TO_UINT(g_hash_table_lookup(enc->shapes, shapeKey));
+
+    if (shapeIdx == 0) {
+        gsize len;
+        const guint8 *buf = g_bytes_get_data(shapeKey, &len);
+
+        g_byte_array_append(enc->data, buf, len);
+        g_hash_table_insert(enc->shapes, g_bytes_ref(shapeKey),
+                            GUINT_TO_POINTER(++enc->nshapes));
+        shapeIdx = enc->nshapes;
+    }
+
+    virStatsStreamPutU8(enc->data, VIR_STATS_STREAM_ITEM_RECORD);
+    virStatsStreamPutU32(enc->data, shapeIdx - 1);
+    g_byte_array_append(enc->data, uuid, VIR_UUID_BUFLEN);
+    virStatsStreamPutU32(enc->data, (uint32_t) id);
+    virStatsStreamPutString(enc->data, name);
+
+    for (i = 0; i < nparams; i++) {
+        uint64_t dbl;
+
+        switch ((virTypedParameterType) params[i].type) {
+        case VIR_TYPED_PARAM_INT:
+            virStatsStreamPutU32(enc->data, (uint32_t) params[i].value.i);
+            break;
+        case VIR_TYPED_PARAM_UINT:
+            virStatsStreamPutU32(enc->data, params[i].value.ui);
+            break;
+        case VIR_TYPED_PARAM_LLONG:
+            virStatsStreamPutU64(enc->data, (uint64_t) params[i].value.l);
+            break;
+        case VIR_TYPED_PARAM_ULLONG:
+            virStatsStreamPutU64(enc->data, params[i].value.ul);
+            break;
+        case VIR_TYPED_PARAM_DOUBLE:
+            memcpy(&dbl, &params[i].value.d, sizeof(dbl));
+            virStatsStreamPutU64(enc->data, dbl);
+            break;
+        case VIR_TYPED_PARAM_BOOLEAN:
+            virStatsStreamPutU8(enc->data, !!params[i].value.b);
+            break;
+        case VIR_TYPED_PARAM_STRING:
+            virStatsStreamPutString(enc->data, NULLSTR_EMPTY(params[i].value.s));
+            break;
+        case VIR_TYPED_PARAM_LAST:
+            break;
+        }
+    }
+
+    return 0;
+}
+
+
+/**
+ * virStatsStreamEncoderFlush:
+ * @enc: encoder
+ * @fd: file descriptor to write to
+ *
+ * Writes the data encoded so far to @fd and discards it from @enc, so
+ * that a stream can be produced without keeping it in memory as a whole.
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virStatsStreamEncoderFlush(virStatsStreamEncoder *enc,
+                           int fd)
+{
+    if (enc->data->len == 0)
+        return 0;
+
+    if (safewrite(fd, enc->data->data, enc->data->len) < 0) {
+        virReportSystemError(errno, "%s",
+                             _("unable to write domain statistics"));
+        return -1;
+    }
+
+    g_byte_array_set_size(enc->data, 0);
+    return 0;
+}
+
+
+/**
+ * virStatsStreamEncoderFinish:
+ * @enc: encoder
+ *
+ * Terminates the stream. The encoder must not be used afterwards
+ * except for freeing it.
+ *
+ * Returns the encoded stream, to be released by g_byte_array_unref().
+ */
+GByteArray *
+virStatsStreamEncoderFinish(virStatsStreamEncoder *enc)
+{
+    virStatsStreamPutU8(enc->data, VIR_STATS_STREAM_ITEM_END);
+
+    return g_steal_pointer(&enc->data);
+}
+
+
+void
+virStatsStreamRecordFree(virStatsStreamRecord *record)
+{
+    if (!record)
+        return;
+
+    virTypedParamsFree(record->params, record->nparams);
+    g_free(record->name);
+    g_free(record);
+}
+
+
+void
+virStatsStreamRecordListFree(virStatsStreamRecord **records,
+                             size_t nrecords)
+{
+    size_t i;
+
+    if (!records)
+        return;
+
+    for (i = 0; i < nrecords; i++)
+        virStatsStreamRecordFree(records[i]);
+
+    g_free(records);
+}
+
+
+typedef struct _virStatsStreamShape virStatsStreamShape;
+struct _virStatsStreamShape {
+    unsigned int *keys;
+    int *types;
+    size_t nfields;
+};
+
+
+typedef struct _virStatsStreamDecoder virStatsStreamDecoder;
+struct _virStatsStreamDecoder {
+    const unsigned char *data;
+    size_t len;
+    size_t pos;
+
+    char **keys;
+    size_t nkeys;
+
+    virStatsStreamShape *shapes;
+    size_t nshapes;
+};
+
+
+static void
+virStatsStreamDecoderClear(virStatsStreamDecoder *dec)
+{
+    size_t i;
+
+    for (i = 0; i < dec->nkeys; i++)
+        g_free(dec->keys[i]);
+    g_free(dec->keys);
+
+    for (i = 0; i < dec->nshapes; i++) {
+        g_free(dec->shapes[i].keys);
+        g_free(dec->shapes[i].types);
+    }
+    g_free(dec->shapes);
+}
+
+
+static int
+virStatsStreamGet(virStatsStreamDecoder *dec,
+                  void *buf,
+                  size_t len)
+{
+    if (dec->len - dec->pos < len) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("truncated stats stream at offset %1$zu"), dec->pos);
+        return -1;
+    }
+
+    memcpy(buf, dec->data + dec->pos, len);
+    dec->pos += len;
+    return 0;
+}
+
+
+static int
+virStatsStreamGetU8(virStatsStreamDecoder *dec,
+                    uint8_t *val)
+{
+    return virStatsStreamGet(dec, val, sizeof(*val));
+}
+
+
+static int
+virStatsStreamGetU32(virStatsStreamDecoder *dec,
+                     uint32_t *val)
+{
+    if (virStatsStreamGet(dec, val, sizeof(*val)) < 0)
+        return -1;
+
+    *val = GUINT32_FROM_LE(*val);
+    return 0;
+}
+
+
+static int
+virStatsStreamGetU64(virStatsStreamDecoder *dec,
+                     uint64_t *val)
+{
+    if (virStatsStreamGet(dec, val, sizeof(*val)) < 0)
+        return -1;
+
+    *val = GUINT64_FROM_LE(*val);
+    return 0;
+}
+
+
+static char *
+virStatsStreamGetString(virStatsStreamDecoder *dec)
+{
+    uint32_t len;
+    char *str;
+
+    if (virStatsStreamGetU32(dec, &len) < 0)
+        return NULL;
+
+    if (dec->len - dec->pos < len) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("truncated stats stream at offset %1$zu"), dec->pos);
+        return NULL;
+    }
+
+    str = g_strndup((const char *) dec->data + dec->pos, len);
+    dec->pos += len;
+    return str;
+}
+
+
+static int
+virStatsStreamDecodeKey(virStatsStreamDecoder *dec)
+{
+    g_autofree char *key = NULL;
+
+    if (!(key = virStatsStreamGetString(dec)))
+        return -1;
+
+    if (strlen(key) >= VIR_TYPED_PARAM_FIELD_LENGTH) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("stats stream key '%1$s' too long"), key);
+        return -1;
+    }
+
+    VIR_APPEND_ELEMENT(dec->keys, dec->nkeys, key);
+    return 0;
+}
+
+
+static int
+virStatsStreamDecodeShape(virStatsStreamDecoder *dec)
+{
+    virStatsStreamShape shape = { 0 };
+    uint32_t nfields;
+    size_t i;
+
+    if (virStatsStreamGetU32(dec, &nfields) < 0)
+        return -1;
+
+    /* each field takes at least five bytes, don't trust the count blindly */
+    if (nfields > (dec->len - dec->pos) / 5) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("truncated stats stream at offset %1$zu"), dec->pos);
+        return -1;
+    }
+
+    shape.nfields = nfields;
+    shape.keys = g_new0(unsigned int, nfields);
+    shape.types = g_new0(int, nfields);
+
+    for (i = 0; i < nfields; i++) {
+        uint32_t key;
+        uint8_t type;
+
+        if (virStatsStreamGetU32(dec, &key) < 0 ||
+            virStatsStreamGetU8(dec, &type) < 0)
+            goto error;
+
+        if (key >= dec->nkeys ||
+            type < VIR_TYPED_PARAM_INT || type >= VIR_TYPED_PARAM_LAST) {
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("malformed stats stream shape at offset %1$zu"),
+                           dec->pos);
+            goto error;
+        }
+
+        shape.keys[i] = key;
+        shape.types[i] = type;
+    }
+
+    VIR_APPEND_ELEMENT(dec->shapes, dec->nshapes, shape);
+    return 0;
+
+ error:
+    g_free(shape.keys);
+    g_free(shape.types);
+    return -1;
+}
+
+
+static virStatsStreamRecord *
+virStatsStreamDecodeRecord(virStatsStreamDecoder *dec)
+{
+    g_autoptr(virStatsStreamRecord) record = g_new0(virStatsStreamRecord, 1);
+    virStatsStreamShape *shape;
+    uint32_t shapeIdx;
+    uint32_t id;
+    size_t i;
+
+    if (virStatsStreamGetU32(dec, &shapeIdx) < 0)
+        return NULL;
+
+    if (shapeIdx >= dec->nshapes) {
+        virReportError(VIR_ERR_INTERNAL_ERROR,
+                       _("unknown shape %1$u in stats stream"), shapeIdx);
+        return NULL;
+    }
+    shape = &dec->shapes[shapeIdx];
+
+    if (virStatsStreamGet(dec, record->uuid, VIR_UUID_BUFLEN) < 0 ||
+        virStatsStreamGetU32(dec, &id) < 0 ||
+        !(record->name = virStatsStreamGetString(dec)))
+        return NULL;
+
+    record->id = (int32_t) id;
+    record->params = g_new0(virTypedParameter, shape->nfields);
+
+    for (i = 0; i < shape->nfields; i++) {
+        virTypedParameterPtr param = &record->params[i];
+        uint32_t u32;
+        uint64_t u64;
+        uint8_t u8;
+
+        /* keys are length checked when decoded */
+        virStrcpyStatic(param->field, dec->keys[shape->keys[i]]);
+        param->type = shape->types[i];
+        record->nparams++;
+
+        switch ((virTypedParameterType) param->type) {
+        case VIR_TYPED_PARAM_INT:
+            if (virStatsStreamGetU32(dec, &u32) < 0)
+                return NULL;
+            param->value.i = (int32_t) u32;
+            break;
+        case VIR_TYPED_PARAM_UINT:
+            if (virStatsStreamGetU32(dec, &param->value.ui) < 0)
+                return NULL;
+            break;
+        case VIR_TYPED_PARAM_LLONG:
+            if (virStatsStreamGetU64(dec, &u64) < 0)
+                return NULL;
+            param->value.l = (int64_t) u64;
+            break;
+        case VIR_TYPED_PARAM_ULLONG:
+            if (virStatsStreamGetU64(dec, &u64) < 0)
+                return NULL;
+            param->value.ul = u64;
+            break;
+        case VIR_TYPED_PARAM_DOUBLE:
+            if (virStatsStreamGetU64(dec, &u64) < 0)
+                return NULL;
+            memcpy(&param->value.d, &u64, sizeof(u64));
+            break;
+        case VIR_TYPED_PARAM_BOOLEAN:
+            if (virStatsStreamGetU8(dec, &u8) < 0)
+                return NULL;
+            param->value.b = !!u8;
+            break;
+        case VIR_TYPED_PARAM_STRING:
+            if (!(param->value.s = virStatsStreamGetString(dec)))
+                return NULL;
+            break;
+        case VIR_TYPED_PARAM_LAST:
+            break;
+        }
+    }
+
+    return g_steal_pointer(&record);
+}
+
+
+/**
+ * virStatsStreamDecode:
+ * @data: complete stream as produced by virStatsStreamEncoderFinish()
+ * @len: length of @data
+ * @records: filled with the decoded records
+ * @nrecords: filled with the number of items in @records
+ *
+ * Returns 0 on success, -1 on error.
+ */
+int
+virStatsStreamDecode(const unsigned char *data,
+                     size_t len,
+                     virStatsStreamRecord ***records,
+                     size_t *nrecords)
+{
+    virStatsStreamDecoder dec = { .data = data, .len = len };
+    virStatsStreamRecord **recs = NULL;
+    size_t nrecs = 0;
+    char magic[sizeof(VIR_STATS_STREAM_MAGIC) - 1];
+    uint32_t version;
+    int ret = -1;
+
+    if (virStatsStreamGet(&dec, magic, sizeof(magic)) < 0 ||
+        virStatsStreamGetU32(&dec, &version) < 0)
+        goto cleanup;
+
+    if (memcmp(magic, VIR_STATS_STREAM_MAGIC, sizeof(magic)) != 0 ||
+        version != VIR_STATS_STREAM_VERSION) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                       _("unsupported stats stream format"));
+        goto cleanup;
+    }
+
+    while (true) {
+        virStatsStreamRecord *record;
+        uint8_t item;
+
+        if (virStatsStreamGetU8(&dec, &item) < 0)
+            goto cleanup;
+
+        switch ((virStatsStreamItem) item) {
+        case VIR_STATS_STREAM_ITEM_KEY:
+            if (virStatsStreamDecodeKey(&dec) < 0)
+                goto cleanup;
+            break;
+
+        case VIR_STATS_STREAM_ITEM_SHAPE:
+            if (virStatsStreamDecodeShape(&dec) < 0)
+                goto cleanup;
+            break;
+
+        case VIR_STATS_STREAM_ITEM_RECORD:
+            if (!(record = virStatsStreamDecodeRecord(&dec)))
+                goto cleanup;
+            VIR_APPEND_ELEMENT(recs, nrecs, record);
+            break;
+
+        case VIR_STATS_STREAM_ITEM_END:
+            if (dec.pos != dec.len) {
+                virReportError(VIR_ERR_INTERNAL_ERROR, "%s",
+                               _("trailing data after end of stats stream"));
+                goto cleanup;
+            }
+
+            *records = g_steal_pointer(&recs);
+            *nrecords = nrecs;
+            ret = 0;
+            goto cleanup;
+
+        default:
+            virReportError(VIR_ERR_INTERNAL_ERROR,
+                           _("unknown item 0x%1$02x in stats stream"), item);
+            goto cleanup;
+        }
+    }
+
+ cleanup:
+    virStatsStreamRecordListFree(recs, nrecs);
+    virStatsStreamDecoderClear(&dec);
+    return ret;
+}
@@ -0,0 +1,83 @@
+/*
+ * virstatsstream.h: compact binary encoding of bulk domain statistics
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include "internal.h"
+#include "virtypedparam.h"
+#include "viruuid.h"
+
+/* See virConnectGetAllDomainStatsStream for the description of the format */
+#define VIR_STATS_STREAM_MAGIC "LVST"
+#define VIR_STATS_STREAM_VERSION 1
+
+typedef enum {
+    VIR_STATS_STREAM_ITEM_KEY = 'K',
+    VIR_STATS_STREAM_ITEM_SHAPE = 'S',
+    VIR_STATS_STREAM_ITEM_RECORD = 'R',
+    VIR_STATS_STREAM_ITEM_END = 'E',
+} virStatsStreamItem;
+
+typedef struct _virStatsStreamEncoder virStatsStreamEncoder;
+
+virStatsStreamEncoder *
+virStatsStreamEncoderNew(void);
+
+void
+virStatsStreamEncoderFree(virStatsStreamEncoder *enc);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virStatsStreamEncoder, virStatsStreamEncoderFree);
+
+int
+virStatsStreamEncoderAddRecord(virStatsStreamEncoder *enc,
+                               const char *name,
+                               const unsigned char *uuid,
+                               int id,
+                               virTypedParameterPtr params,
+                               int nparams);
+
+int
+virStatsStreamEncoderFlush(virStatsStreamEncoder *enc,
+                           int fd);
+
+GByteArray *
+virStatsStreamEncoderFinish(virStatsStreamEncoder *enc);
+
+
+typedef struct _virStatsStreamRecord virStatsStreamRecord;
+struct _virStatsStreamRecord {
+    char *name;
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    int id;
+    virTypedParameterPtr params;
+    int nparams;
+};
+
+void
+virStatsStreamRecordFree(virStatsStreamRecord *record);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virStatsStreamRecord, virStatsStreamRecordFree);
+
+void
+virStatsStreamRecordListFree(virStatsStreamRecord **records,
+                             size_t nrecords);
+
+int
+virStatsStreamDecode(const unsigned char *data,
+                     size_t len,
+                     virStatsStreamRecord ***records,
+                     size_t *nrecords);
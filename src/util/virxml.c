@@ -38,6 +38,7 @@
 #include "virutil.h"
 #include "viruuid.h"
 #include "virthread.h"
+#include "virobject.h"
 #include "configmake.h"
 
 #define VIR_FROM_THIS VIR_FROM_XML
@@ -53,6 +54,42 @@ struct virParserData {
 };
 
 
+/*
+ * Compiling a RelaxNG schema is far more expensive than validating a
+ * document against it. A compiled schema is never modified by validation
+ * so it is shared by all validators of the same schema file, each using
+ * its own validation context. virXMLValidateAgainstSchema keeps compiled
+ * schemas in a process-wide cache keyed by the path of the schema, which
+ * is recompiled once the file is replaced or modified.
+ */
+struct _virXMLSchema {
+    virObject parent;
+
+    xmlRelaxNGPtr rng;
+
+    /* identifies the version of the schema file @rng was compiled from */
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime;
+};
+
+static virClass *virXMLSchemaClass;
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(virXMLSchema, virObjectUnref);
+
+static GHashTable *virXMLSchemaCache;
+static virMutex virXMLSchemaCacheLock = VIR_MUTEX_INITIALIZER;
+
+
+static void
+virXMLSchemaDispose(void *obj)
+{
+    virXMLSchema *schema = obj;
+
+    xmlRelaxNGFree(schema->rng);
+}
+
+
 static int
 virXMLSchemaOnceInit(void)
 {
@@ -70,6 +107,12 @@ virXMLSchemaOnceInit(void)
                        _("Unable to initialize libxml2 RelaxNG data"));
         return -1;
     }
+
+    if (!VIR_CLASS_NEW(virXMLSchema, virClassForObject()))
+        return -1;
+
+    virXMLSchemaCache = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                              g_free, virObjectUnref);
     return 0;
 }
 
@@ -1692,40 +1735,102 @@ virXMLValidatorRNGErrorIgnore(void *ctx G_GNUC_UNUSED,
 {}
 
 
-virXMLValidator *
-virXMLValidatorInit(const char *schemafile)
+static virXMLSchema *
+virXMLSchemaCompile(const char *schemafile)
 {
-    g_autoptr(virXMLValidator) validator = NULL;
+    g_autoptr(virXMLSchema) schema = NULL;
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    xmlRelaxNGParserCtxtPtr rngParser;
 
     if (virXMLSchemaInitialize() < 0)
         return NULL;
 
-    validator = g_new0(virXMLValidator, 1);
-
-    validator->schemafile = g_strdup(schemafile);
+    if (!(schema = virObjectNew(virXMLSchemaClass)))
+        return NULL;
 
-    if (!(validator->rngParser =
-          xmlRelaxNGNewParserCtxt(validator->schemafile))) {
+    if (!(rngParser = xmlRelaxNGNewParserCtxt(schemafile))) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Unable to create RelaxNG parser for schema '%1$s'"),
-                       validator->schemafile);
+                       schemafile);
         return NULL;
     }
 
-    xmlRelaxNGSetParserErrors(validator->rngParser,
+    xmlRelaxNGSetParserErrors(rngParser,
                               virXMLValidatorRNGErrorCatch,
                               virXMLValidatorRNGErrorIgnore,
-                              &validator->buf);
+                              &buf);
+
+    schema->rng = xmlRelaxNGParse(rngParser);
+    xmlRelaxNGFreeParserCtxt(rngParser);
 
-    if (!(validator->rng = xmlRelaxNGParse(validator->rngParser))) {
+    if (!schema->rng) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Unable to parse RelaxNG schema '%1$s': %2$s"),
-                       validator->schemafile,
-                       virBufferCurrentContent(&validator->buf));
+                       schemafile, virBufferCurrentContent(&buf));
         return NULL;
     }
 
-    if (!(validator->rngValid = xmlRelaxNGNewValidCtxt(validator->rng))) {
+    return g_steal_pointer(&schema);
+}
+
+
+static bool
+virXMLSchemaIsCurrent(virXMLSchema *schema,
+                      struct stat *sb)
+{
+    return schema->dev == sb->st_dev &&
+           schema->ino == sb->st_ino &&
+           schema->size == sb->st_size &&
+           schema->mtime == sb->st_mtime;
+}
+
+
+/* Returns a reference to the compiled @schemafile, compiling it if it's not
+ * cached yet or was changed since. Note that changes of schemas included
+ * by @schemafile are not noticed. */
+static virXMLSchema *
+virXMLSchemaGetCached(const char *schemafile)
+{
+    VIR_LOCK_GUARD lock = virLockGuardLock(&virXMLSchemaCacheLock);
+    virXMLSchema *schema;
+    struct stat sb;
+
+    /* let the parser report the error */
+    if (stat(schemafile, &sb) < 0)
+        return virXMLSchemaCompile(schemafile);
+
+    if (virXMLSchemaInitialize() < 0)
+        return NULL;
+
+    if ((schema = g_hash_table_lookup(virXMLSchemaCache, schemafile)) &&
+        virXMLSchemaIsCurrent(schema, &sb))
+        return virObjectRef(schema);
+
+    if (!(schema = virXMLSchemaCompile(schemafile)))
+        return NULL;
+
+    schema->dev = sb.st_dev;
+    schema->ino = sb.st_ino;
+    schema->size = sb.st_size;
+    schema->mtime = sb.st_mtime;
+
+    g_hash_table_insert(virXMLSchemaCache, g_strdup(schemafile),
+                        virObjectRef(schema));
+
+    return schema;
+}
+
+
+static virXMLValidator *
+virXMLValidatorNew(const char *schemafile,
+                   virXMLSchema *schema)
+{
+    g_autoptr(virXMLValidator) validator = g_new0(virXMLValidator, 1);
+
+    validator->schemafile = g_strdup(schemafile);
+    validator->schema = schema;
+
+    if (!(validator->rngValid = xmlRelaxNGNewValidCtxt(schema->rng))) {
         virReportError(VIR_ERR_INTERNAL_ERROR,
                        _("Unable to create RelaxNG validation context for schema '%1$s'"),
                        validator->schemafile);
@@ -1741,6 +1846,27 @@ virXMLValidatorInit(const char *schemafile)
 }
 
 
+/**
+ * virXMLValidatorInit:
+ * @schemafile: path to the RelaxNG schema
+ *
+ * Compiles @schemafile into a new validator. Unlike
+ * virXMLValidateAgainstSchema this always reads the schema from disk.
+ *
+ * Returns the validator or NULL on error (with error reported).
+ */
+virXMLValidator *
+virXMLValidatorInit(const char *schemafile)
+{
+    virXMLSchema *schema;
+
+    if (!(schema = virXMLSchemaCompile(schemafile)))
+        return NULL;
+
+    return virXMLValidatorNew(schemafile, schema);
+}
+
+
 int
 virXMLValidatorValidate(virXMLValidator *validator,
                         xmlDocPtr doc)
@@ -1762,8 +1888,12 @@ virXMLValidateAgainstSchema(const char *schemafile,
                             xmlDocPtr doc)
 {
     g_autoptr(virXMLValidator) validator = NULL;
+    virXMLSchema *schema;
+
+    if (!(schema = virXMLSchemaGetCached(schemafile)))
+        return -1;
 
-    if (!(validator = virXMLValidatorInit(schemafile)))
+    if (!(validator = virXMLValidatorNew(schemafile, schema)))
         return -1;
 
     if (virXMLValidatorValidate(validator, doc) < 0)
@@ -1794,9 +1924,8 @@ virXMLValidatorFree(virXMLValidator *validator)
 
     g_free(validator->schemafile);
     virBufferFreeAndReset(&validator->buf);
-    xmlRelaxNGFreeParserCtxt(validator->rngParser);
     xmlRelaxNGFreeValidCtxt(validator->rngValid);
-    xmlRelaxNGFree(validator->rng);
+    virObjectUnref(validator->schema);
     g_free(validator);
 }
 
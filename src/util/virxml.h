@@ -314,9 +314,10 @@ virXMLCheckIllegalChars(const char *nodeName,
                         const char *str,
                         const char *illegal);
 
+typedef struct _virXMLSchema virXMLSchema;
+
 struct _virXMLValidator {
-    xmlRelaxNGParserCtxtPtr rngParser;
-    xmlRelaxNGPtr rng;
+    virXMLSchema *schema; /* compiled schema, possibly shared with others */
     xmlRelaxNGValidCtxtPtr rngValid;
     virBuffer buf;
     char *schemafile;
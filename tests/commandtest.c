@@ -1231,6 +1231,85 @@ test29(const void *unused G_GNUC_UNUSED)
 }
 
 
+static int
+test30Hook(void *opaque G_GNUC_UNUSED)
+{
+    return 0;
+}
+
+
+static int
+test30Run(bool hook,
+          unsigned long long *count)
+{
+    g_autoptr(virCommand) cmd = virCommandNew("true");
+
+    /* a pre-exec hook disables the posix_spawn() fast path */
+    if (hook)
+        virCommandSetPreExecHook(cmd, test30Hook, NULL);
+
+    if (virCommandRun(cmd, NULL) < 0) {
+        fprintf(stderr, "Cannot run child %s\n", virGetLastErrorMessage());
+        return -1;
+    }
+
+    (*count)++;
+    return 0;
+}
+
+
+static int
+test30Spawn(void *opaque G_GNUC_UNUSED,
+            unsigned long long *count)
+{
+    return test30Run(false, count);
+}
+
+
+static int
+test30Fork(void *opaque G_GNUC_UNUSED,
+           unsigned long long *count)
+{
+    return test30Run(true, count);
+}
+
+
+/*
+ * Reports the rate of starting a trivial command with and without
+ * having to fork() the test process, for increasing amounts of memory
+ * mapped by it.
+ */
+static int
+test30(const void *unused G_GNUC_UNUSED)
+{
+    size_t sizes[] = { 0, 256, 1024 };
+    size_t i;
+    int rc;
+
+    /* don't bother allocating the memory if the benchmark is skipped anyway */
+    if (!virTestGetExpensive())
+        return EXIT_AM_SKIP;
+
+    for (i = 0; i < G_N_ELEMENTS(sizes); i++) {
+        size_t len = sizes[i] * 1024 * 1024;
+        g_autofree char *mem = NULL;
+        g_autofree char *spawnWhat = g_strdup_printf("%zu MiB RSS spawn", sizes[i]);
+        g_autofree char *forkWhat = g_strdup_printf("%zu MiB RSS fork", sizes[i]);
+
+        if (len > 0) {
+            mem = g_malloc(len);
+            memset(mem, 1, len);
+        }
+
+        if ((rc = virTestBenchmark(spawnWhat, "commands", test30Spawn, NULL)) != 0 ||
+            (rc = virTestBenchmark(forkWhat, "commands", test30Fork, NULL)) != 0)
+            return rc;
+    }
+
+    return 0;
+}
+
+
 static int
 mymain(void)
 {
@@ -1333,6 +1412,8 @@ mymain(void)
     DO_TEST(test28);
     DO_TEST(test29);
 
+    DO_TEST(test30);
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
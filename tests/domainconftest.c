@@ -19,7 +19,9 @@
 #include <config.h>
 
 #include "testutils.h"
+#include "virfile.h"
 #include "virlog.h"
+#include "virutil.h"
 
 #include "domain_conf.h"
 
@@ -68,6 +70,208 @@ static int testGetFilesystem(const void *opaque)
     return 0;
 }
 
+#define COPY_NDISKS 100
+
+static char *
+testDefCopyXML(size_t ndisks)
+{
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    size_t i;
+
+    virBufferAddLit(&buf, "<domain type='test'>\n");
+    virBufferAddLit(&buf, "  <name>copy</name>\n");
+    virBufferAddLit(&buf, "  <uuid>a3f1c5d2-7e44-4e5a-9c2b-1d0f8e6b5a47</uuid>\n");
+    virBufferAddLit(&buf, "  <memory>1048576</memory>\n");
+    virBufferAddLit(&buf, "  <os><type arch='x86_64'>hvm</type></os>\n");
+    virBufferAddLit(&buf, "  <devices>\n");
+
+    for (i = 0; i < ndisks; i++) {
+        g_autofree char *dst = virIndexToDiskName(0, i, "vd");
+
+        virBufferAddLit(&buf, "    <disk type='file' device='disk'>\n");
+        virBufferAddLit(&buf, "      <driver name='qemu' type='qcow2' cache='none'/>\n");
+        virBufferAsprintf(&buf, "      <source file='/var/lib/libvirt/images/disk%zu.qcow2'/>\n", i);
+        virBufferAddLit(&buf, "      <backingStore type='file'>\n");
+        virBufferAddLit(&buf, "        <format type='raw'/>\n");
+        virBufferAddLit(&buf, "        <source file='/var/lib/libvirt/images/base.img'/>\n");
+        virBufferAddLit(&buf, "        <backingStore/>\n");
+        virBufferAddLit(&buf, "      </backingStore>\n");
+        virBufferAsprintf(&buf, "      <target dev='%s' bus='virtio'/>\n", dst);
+        virBufferAsprintf(&buf, "      <serial>serial%zu</serial>\n", i);
+        if (i == 0)
+            virBufferAddLit(&buf, "      <boot order='1'/>\n");
+        virBufferAddLit(&buf, "    </disk>\n");
+    }
+
+    virBufferAddLit(&buf, "  </devices>\n");
+    virBufferAddLit(&buf, "</domain>\n");
+
+    return virBufferContentAndReset(&buf);
+}
+
+
+/* Copy the definition the way virDomainDefCopy did before disks were
+ * copied directly */
+static virDomainDef *
+testDefCopyRoundTrip(virDomainDef *def)
+{
+    g_autofree char *xml = NULL;
+
+    if (!(xml = virDomainDefFormat(def, xmlopt, VIR_DOMAIN_DEF_FORMAT_SECURE)))
+        return NULL;
+
+    return virDomainDefParseString(xml, xmlopt, NULL,
+                                   VIR_DOMAIN_DEF_PARSE_INACTIVE |
+                                   VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE);
+}
+
+
+static int
+testDefCopy(const void *opaque G_GNUC_UNUSED)
+{
+    g_autofree char *xml = testDefCopyXML(COPY_NDISKS);
+    g_autoptr(virDomainDef) def = NULL;
+    g_autoptr(virDomainDef) expectdef = NULL;
+    g_autoptr(virDomainDef) copydef = NULL;
+    g_autofree char *expected = NULL;
+    g_autofree char *actual = NULL;
+
+    if (!(def = virDomainDefParseString(xml, xmlopt, NULL, 0)))
+        return -1;
+
+    if (!(expectdef = testDefCopyRoundTrip(def)) ||
+        !(copydef = virDomainDefCopy(def, xmlopt, NULL, false)))
+        return -1;
+
+    if (!(expected = virDomainDefFormat(expectdef, xmlopt, VIR_DOMAIN_DEF_FORMAT_SECURE)) ||
+        !(actual = virDomainDefFormat(copydef, xmlopt, VIR_DOMAIN_DEF_FORMAT_SECURE)))
+        return -1;
+
+    return virTestCompareToString(expected, actual);
+}
+
+
+static int
+testDefCopyBenchRoundTrip(void *opaque,
+                          unsigned long long *count)
+{
+    g_autoptr(virDomainDef) tmp = NULL;
+
+    if (!(tmp = testDefCopyRoundTrip(opaque)))
+        return -1;
+
+    (*count)++;
+    return 0;
+}
+
+
+static int
+testDefCopyBenchCopy(void *opaque,
+                     unsigned long long *count)
+{
+    g_autoptr(virDomainDef) tmp = NULL;
+
+    if (!(tmp = virDomainDefCopy(opaque, xmlopt, NULL, false)))
+        return -1;
+
+    (*count)++;
+    return 0;
+}
+
+
+/* Reports the rate of virDomainDefCopy compared to a full round-trip
+ * through XML for a definition with many disks. */
+static int
+testDefCopyBench(const void *opaque G_GNUC_UNUSED)
+{
+    g_autofree char *xml = testDefCopyXML(COPY_NDISKS);
+    g_autoptr(virDomainDef) def = NULL;
+    int rc;
+
+    if (!(def = virDomainDefParseString(xml, xmlopt, NULL, 0)))
+        return -1;
+
+    if ((rc = virTestBenchmark("round-trip through XML", "copies",
+                               testDefCopyBenchRoundTrip, def)) != 0)
+        return rc;
+
+    return virTestBenchmark("virDomainDefCopy", "copies",
+                            testDefCopyBenchCopy, def);
+}
+
+
+static int
+testDefParseBenchRound(void *opaque,
+                       unsigned long long *count)
+{
+    GPtrArray *xmls = opaque;
+    size_t i;
+
+    for (i = 0; i < xmls->len; i++) {
+        g_autoptr(virDomainDef) def = NULL;
+
+        if (!(def = virDomainDefParseString(g_ptr_array_index(xmls, i),
+                                            xmlopt, NULL,
+                                            VIR_DOMAIN_DEF_PARSE_INACTIVE |
+                                            VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE)))
+            return -1;
+    }
+
+    *count += xmls->len;
+    return 0;
+}
+
+
+/* Reports the throughput of parsing the XMLs in tests/qemuxmlconfdata.
+ * Files not accepted by the generic XML config are skipped. */
+static int
+testDefParseBench(const void *opaque G_GNUC_UNUSED)
+{
+    g_autofree char *dir_path = g_strdup_printf("%s/qemuxmlconfdata", abs_srcdir);
+    g_autoptr(GPtrArray) xmls = g_ptr_array_new_with_free_func(g_free);
+    g_autoptr(DIR) dir = NULL;
+    struct dirent *ent;
+    int rc;
+
+    /* don't bother loading the XMLs if the benchmark is skipped anyway */
+    if (!virTestGetExpensive())
+        return EXIT_AM_SKIP;
+
+    if (virDirOpen(&dir, dir_path) < 0)
+        return -1;
+
+    while ((rc = virDirRead(dir, &ent, dir_path)) > 0) {
+        g_autofree char *xml_path = NULL;
+        g_autofree char *xml = NULL;
+        g_autoptr(virDomainDef) def = NULL;
+
+        if (!virStringHasSuffix(ent->d_name, ".xml"))
+            continue;
+
+        xml_path = g_strdup_printf("%s/%s", dir_path, ent->d_name);
+
+        if (virFileReadAll(xml_path, 1024 * 1024, &xml) < 0)
+            return -1;
+
+        if (!(def = virDomainDefParseString(xml, xmlopt, NULL,
+                                            VIR_DOMAIN_DEF_PARSE_INACTIVE |
+                                            VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE)))
+            continue;
+
+        g_ptr_array_add(xmls, g_steal_pointer(&xml));
+    }
+
+    virResetLastError();
+
+    if (rc < 0)
+        return -1;
+
+    VIR_TEST_DEBUG("Parsing %u documents", xmls->len);
+
+    return virTestBenchmark("Domain XML parsing", "documents",
+                            testDefParseBenchRound, xmls);
+}
+
 static int
 mymain(void)
 {
@@ -95,6 +299,15 @@ mymain(void)
     DO_TEST_GET_FS("/dev/pts", false);
     DO_TEST_GET_FS("/doesnotexist", false);
 
+    if (virTestRun("Copy", testDefCopy, NULL) < 0)
+        ret = -1;
+
+    if (virTestRun("Copy benchmark", testDefCopyBench, NULL) < 0)
+        ret = -1;
+
+    if (virTestRun("Parse benchmark", testDefParseBench, NULL) < 0)
+        ret = -1;
+
     virObjectUnref(caps);
     virObjectUnref(xmlopt);
 
@@ -38,6 +38,8 @@ VIR_LOG_INIT("tests.eventtest");
 
 #define NUM_FDS 31
 #define NUM_TIME 31
+#define NUM_MASS 200
+#define NUM_MASS_EXPENSIVE 20000
 
 static pthread_mutex_t eventThreadMutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t eventThreadCond = PTHREAD_COND_INITIALIZER;
@@ -317,6 +319,78 @@ resetAll(void)
     pthread_mutex_unlock(&eventThreadMutex);
 }
 
+static void
+testMassPipeReader(int watch G_GNUC_UNUSED,
+                   int fd G_GNUC_UNUSED,
+                   int events G_GNUC_UNUSED,
+                   void *data G_GNUC_UNUSED)
+{
+}
+
+
+static void
+testMassTimer(int timer G_GNUC_UNUSED,
+              void *data G_GNUC_UNUSED)
+{
+}
+
+
+/* Registers a large number of handles and timers and measures how long
+ * updating them takes, which must not depend on the number of them. Only
+ * expensive tests use enough of them for the time to be meaningful. */
+static int
+testMassUpdate(const void *opaque G_GNUC_UNUSED)
+{
+    size_t nmass = virTestGetExpensive() ? NUM_MASS_EXPENSIVE : NUM_MASS;
+    g_autofree int *watches = g_new0(int, nmass);
+    g_autofree int *timeouts = g_new0(int, nmass);
+    VIR_AUTOCLOSE rfd = -1;
+    VIR_AUTOCLOSE wfd = -1;
+    int fds[2];
+    gint64 start;
+    size_t i;
+    int ret = -1;
+
+    if (virPipeQuiet(fds) < 0)
+        return -1;
+
+    rfd = fds[0];
+    wfd = fds[1];
+
+    for (i = 0; i < nmass; i++) {
+        if ((watches[i] = virEventAddHandle(rfd, 0, testMassPipeReader,
+                                            NULL, NULL)) < 0 ||
+            (timeouts[i] = virEventAddTimeout(-1, testMassTimer,
+                                              NULL, NULL)) < 0)
+            goto cleanup;
+    }
+
+    start = g_get_monotonic_time();
+
+    for (i = 0; i < nmass; i++) {
+        virEventUpdateHandle(watches[i], VIR_EVENT_HANDLE_READABLE);
+        virEventUpdateHandle(watches[i], 0);
+        virEventUpdateTimeout(timeouts[i], 60 * 1000);
+        virEventUpdateTimeout(timeouts[i], -1);
+    }
+
+    VIR_TEST_DEBUG("%zu handle and timer updates took %lld us",
+                   nmass * 4, (long long) (g_get_monotonic_time() - start));
+
+    ret = 0;
+
+ cleanup:
+    for (i = 0; i < nmass; i++) {
+        if (watches[i] > 0)
+            virEventRemoveHandle(watches[i]);
+        if (timeouts[i] > 0)
+            virEventRemoveTimeout(timeouts[i]);
+    }
+
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -472,6 +546,9 @@ mymain(void)
     }
 
 
+    if (virTestRun("Mass update", testMassUpdate, NULL) < 0)
+        return EXIT_FAILURE;
+
     /* Final test, register same FD twice, once with no
      * events, and make sure the right callback runs */
     handles[0].pipeFD[0] = handles[1].pipeFD[0];
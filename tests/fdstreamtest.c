@@ -33,6 +33,11 @@ VIR_LOG_INIT("tests.fdstreamtest");
 
 #define PATTERN_LEN 256
 
+#define BENCH_FILE_LEN (64 * 1024 * 1024)
+#define BENCH_CHUNK_LEN (256 * 1024) /* VIR_NET_MESSAGE_LEGACY_PAYLOAD_MAX */
+#define BENCH_EXTENT_LEN (1024 * 1024)
+#define BENCH_EXTENT_STRIDE (8 * 1024 * 1024)
+
 static int testFDStreamReadCommon(const char *scratchdir, bool blocking)
 {
     VIR_AUTOCLOSE fd = -1;
@@ -297,12 +302,354 @@ static int testFDStreamWriteNonblock(const void *data)
     return testFDStreamWriteCommon(data, false);
 }
 
+
+static int
+testFDStreamWriteRange(virConnectPtr conn,
+                       const char *file,
+                       bool blocking,
+                       unsigned long long offset,
+                       const char *pattern,
+                       long long hole)
+{
+    virStreamPtr st = NULL;
+    int flags = 0;
+    int ret = -1;
+
+    if (!blocking)
+        flags |= VIR_STREAM_NONBLOCK;
+
+    if (!(st = virStreamNew(conn, flags)))
+        return -1;
+
+    if (virFDStreamOpenBlockDevice(st, file, offset, PATTERN_LEN + hole,
+                                   true, O_WRONLY) < 0)
+        goto cleanup;
+
+    if (st->driver->streamSend(st, pattern, PATTERN_LEN) != PATTERN_LEN) {
+        fprintf(stderr, "Failed to write stream: %s\n",
+                virGetLastErrorMessage());
+        goto cleanup;
+    }
+
+    if (hole > 0 &&
+        st->driver->streamSendHole(st, hole, 0) < 0) {
+        fprintf(stderr, "Failed to send hole: %s\n",
+                virGetLastErrorMessage());
+        goto cleanup;
+    }
+
+    if (st->driver->streamFinish(st) != 0) {
+        fprintf(stderr, "Failed to finish stream: %s\n",
+                virGetLastErrorMessage());
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virStreamFree(st);
+    return ret;
+}
+
+
+/* Writes two disjoint ranges of one file using separate streams. The range
+ * finished last ends with a hole which must not truncate the other one. */
+static int testFDStreamWriteRangesCommon(const char *scratchdir, bool blocking)
+{
+    VIR_AUTOCLOSE fd = -1;
+    g_autofree char *file = NULL;
+    g_autofree char *pattern = NULL;
+    g_autofree char *zeroes = NULL;
+    g_autofree char *buf = NULL;
+    virConnectPtr conn = NULL;
+    struct stat sb;
+    size_t i;
+    int ret = -1;
+
+    if (!(conn = virConnectOpen("test:///default")))
+        goto cleanup;
+
+    pattern = g_new0(char, PATTERN_LEN);
+    zeroes = g_new0(char, PATTERN_LEN);
+    buf = g_new0(char, PATTERN_LEN);
+
+    for (i = 0; i < PATTERN_LEN; i++)
+        pattern[i] = i;
+
+    file = g_strdup_printf("%s/ranges.data", scratchdir);
+
+    if ((fd = open(file, O_CREAT|O_WRONLY|O_EXCL, 0600)) < 0 ||
+        VIR_CLOSE(fd) < 0)
+        goto cleanup;
+
+    if (testFDStreamWriteRange(conn, file, blocking, PATTERN_LEN * 2,
+                               pattern, 0) < 0 ||
+        testFDStreamWriteRange(conn, file, blocking, 0,
+                               pattern, PATTERN_LEN) < 0)
+        goto cleanup;
+
+    if ((fd = open(file, O_RDONLY)) < 0 ||
+        fstat(fd, &sb) < 0)
+        goto cleanup;
+
+    if (sb.st_size != PATTERN_LEN * 3) {
+        fprintf(stderr, "Unexpected file size %lld\n", (long long) sb.st_size);
+        goto cleanup;
+    }
+
+    for (i = 0; i < 3; i++) {
+        const char *expect = i == 1 ? zeroes : pattern;
+
+        if (saferead(fd, buf, PATTERN_LEN) != PATTERN_LEN ||
+            memcmp(buf, expect, PATTERN_LEN) != 0) {
+            fprintf(stderr, "Mismatched data in range %zu\n", i);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+ cleanup:
+    if (file != NULL)
+        unlink(file);
+    if (conn)
+        virConnectClose(conn);
+    return ret;
+}
+
+
+static int testFDStreamWriteRangesBlock(const void *data)
+{
+    return testFDStreamWriteRangesCommon(data, true);
+}
+static int testFDStreamWriteRangesNonblock(const void *data)
+{
+    return testFDStreamWriteRangesCommon(data, false);
+}
+
+
+/* The sparse benchmark file has a data extent at the start of every
+ * BENCH_EXTENT_STRIDE bytes, the rest of it is a hole. */
+static int
+testFDStreamBenchCreateFile(const char *file,
+                            bool sparse)
+{
+    VIR_AUTOCLOSE fd = -1;
+    g_autofree char *data = g_new0(char, BENCH_EXTENT_LEN);
+    size_t i;
+
+    memset(data, 0x55, BENCH_EXTENT_LEN);
+
+    if ((fd = open(file, O_CREAT|O_WRONLY|O_TRUNC, 0600)) < 0)
+        return -1;
+
+    for (i = 0; i < BENCH_FILE_LEN; i += BENCH_EXTENT_LEN) {
+        if (sparse && i % BENCH_EXTENT_STRIDE != 0)
+            continue;
+
+        if (lseek(fd, i, SEEK_SET) < 0 ||
+            safewrite(fd, data, BENCH_EXTENT_LEN) != BENCH_EXTENT_LEN)
+            return -1;
+    }
+
+    if (ftruncate(fd, BENCH_FILE_LEN) < 0)
+        return -1;
+
+    return VIR_CLOSE(fd);
+}
+
+
+/* Downloads @file like the storage driver does for virStorageVolDownload,
+ * skipping holes if @sparse. */
+static int
+testFDStreamBenchRead(virConnectPtr conn,
+                      const char *file,
+                      bool sparse,
+                      unsigned long long *bytes)
+{
+    g_autofree char *buf = g_new0(char, BENCH_CHUNK_LEN);
+    virStreamPtr st = NULL;
+    int ret = -1;
+
+    if (!(st = virStreamNew(conn, VIR_STREAM_NONBLOCK)))
+        return -1;
+
+    if (virFDStreamOpenBlockDevice(st, file, 0, 0, sparse, O_RDONLY) < 0)
+        goto cleanup;
+
+    while (true) {
+        long long want = BENCH_CHUNK_LEN;
+        int got;
+
+        if (sparse) {
+            int inData;
+            long long len;
+
+            if (st->driver->streamInData(st, &inData, &len) < 0)
+                goto cleanup;
+
+            if (!inData && !len)
+                break;
+
+            if (!inData) {
+                if (st->driver->streamSendHole(st, len, 0) < 0)
+                    goto cleanup;
+                *bytes += len;
+                continue;
+            }
+
+            want = MIN(want, len);
+        }
+
+        if ((got = st->driver->streamRecv(st, buf, want)) == -2) {
+            g_usleep(100);
+            continue;
+        }
+
+        if (got < 0)
+            goto cleanup;
+
+        if (got == 0)
+            break;
+
+        *bytes += got;
+    }
+
+    if (st->driver->streamFinish(st) < 0)
+        goto cleanup;
+
+    ret = 0;
+ cleanup:
+    if (ret < 0)
+        fprintf(stderr, "Failed to read stream: %s\n", virGetLastErrorMessage());
+    virStreamFree(st);
+    return ret;
+}
+
+
+/* Uploads the contents of the benchmark file to @file like the storage
+ * driver does for virStorageVolUpload, sending holes if @sparse. */
+static int
+testFDStreamBenchWrite(virConnectPtr conn,
+                       const char *file,
+                       bool sparse,
+                       unsigned long long *bytes)
+{
+    g_autofree char *buf = g_new0(char, BENCH_CHUNK_LEN);
+    virStreamPtr st = NULL;
+    size_t off = 0;
+    int ret = -1;
+
+    memset(buf, 0x55, BENCH_CHUNK_LEN);
+
+    if (truncate(file, 0) < 0 ||
+        !(st = virStreamNew(conn, VIR_STREAM_NONBLOCK)))
+        return -1;
+
+    if (virFDStreamOpenBlockDevice(st, file, 0, 0, sparse, O_WRONLY) < 0)
+        goto cleanup;
+
+    while (off < BENCH_FILE_LEN) {
+        int got;
+
+        if (sparse && off % BENCH_EXTENT_STRIDE == BENCH_EXTENT_LEN) {
+            long long len = BENCH_EXTENT_STRIDE - BENCH_EXTENT_LEN;
+
+            if (st->driver->streamSendHole(st, len, 0) < 0)
+                goto cleanup;
+            off += len;
+            continue;
+        }
+
+        if ((got = st->driver->streamSend(st, buf, BENCH_CHUNK_LEN)) == -2) {
+            g_usleep(100);
+            continue;
+        }
+
+        if (got < 0)
+            goto cleanup;
+
+        off += got;
+    }
+
+    if (st->driver->streamFinish(st) < 0)
+        goto cleanup;
+
+    *bytes += off;
+    ret = 0;
+ cleanup:
+    if (ret < 0)
+        fprintf(stderr, "Failed to write stream: %s\n", virGetLastErrorMessage());
+    virStreamFree(st);
+    return ret;
+}
+
+
+struct testFDStreamBenchData {
+    const char *scratchdir;
+    bool sparse;
+    bool write;
+
+    virConnectPtr conn;
+    const char *file;
+};
+
+
+static int
+testFDStreamBenchRound(void *opaque,
+                       unsigned long long *bytes)
+{
+    struct testFDStreamBenchData *data = opaque;
+
+    if (data->write)
+        return testFDStreamBenchWrite(data->conn, data->file, data->sparse, bytes);
+
+    return testFDStreamBenchRead(data->conn, data->file, data->sparse, bytes);
+}
+
+
+/* Reports the throughput of a volume download or upload through the
+ * helper thread of a non-blocking stream. */
+static int
+testFDStreamBench(const void *opaque)
+{
+    struct testFDStreamBenchData data = *(const struct testFDStreamBenchData *) opaque;
+    g_autofree char *file = g_strdup_printf("%s/bench.data", data.scratchdir);
+    int ret = -1;
+
+    /* don't bother creating the file if the benchmark is skipped anyway */
+    if (!virTestGetExpensive())
+        return EXIT_AM_SKIP;
+
+    data.file = file;
+
+    if (!(data.conn = virConnectOpen("test:///default")))
+        goto cleanup;
+
+    if (testFDStreamBenchCreateFile(file, data.sparse) < 0)
+        goto cleanup;
+
+    ret = virTestBenchmark(data.write ? "stream write" : "stream read",
+                           "bytes", testFDStreamBenchRound, &data);
+
+ cleanup:
+    unlink(file);
+    if (data.conn)
+        virConnectClose(data.conn);
+    return ret;
+}
+
 #define SCRATCHDIRTEMPLATE abs_builddir "/fdstreamdir-XXXXXX"
 
 static int
 mymain(void)
 {
     char scratchdir[] = SCRATCHDIRTEMPLATE;
+    struct testFDStreamBenchData bench[] = {
+        { scratchdir, false, false, NULL, NULL },
+        { scratchdir, true, false, NULL, NULL },
+        { scratchdir, false, true, NULL, NULL },
+        { scratchdir, true, true, NULL, NULL },
+    };
+    size_t i;
     int ret = 0;
 
     if (!g_mkdtemp(scratchdir)) {
@@ -318,6 +665,19 @@ mymain(void)
         ret = -1;
     if (virTestRun("Stream write non-blocking ", testFDStreamWriteNonblock, scratchdir) < 0)
         ret = -1;
+    if (virTestRun("Stream write ranges blocking ", testFDStreamWriteRangesBlock, scratchdir) < 0)
+        ret = -1;
+    if (virTestRun("Stream write ranges non-blocking ", testFDStreamWriteRangesNonblock, scratchdir) < 0)
+        ret = -1;
+
+    for (i = 0; i < G_N_ELEMENTS(bench); i++) {
+        g_autofree char *name = g_strdup_printf("Stream %s benchmark %s",
+                                                bench[i].write ? "write" : "read",
+                                                bench[i].sparse ? "sparse" : "dense");
+
+        if (virTestRun(name, testFDStreamBench, &bench[i]) < 0)
+            ret = -1;
+    }
 
     if (getenv("LIBVIRT_SKIP_CLEANUP") == NULL)
         virFileDeleteTree(scratchdir);
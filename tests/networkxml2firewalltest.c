@@ -72,21 +72,37 @@ VIR_MOCK_WRAP_RET_ARGS(g_dbus_connection_call_sync,
 static void
 testCommandDryRun(const char *const*args G_GNUC_UNUSED,
                   const char *const*env G_GNUC_UNUSED,
-                  const char *input G_GNUC_UNUSED,
+                  const char *input,
                   char **output,
                   char **error,
                   int *status,
-                  void *opaque G_GNUC_UNUSED)
+                  void *opaque)
 {
+    virBuffer *buf = opaque;
+
+    /* record the commands applied in a batch by
+     * iptables-restore or nft -f */
+    if (input)
+        virBufferAdd(buf, input, -1);
+
     *status = 0;
     /* if arg[1] is -ae then this is an nft command,
      * and the caller requested to get the handle
-     * of the newly added object in stdout
+     * of the newly added object in stdout; a batch
+     * read from stdin adds one object per line
      */
-    if (STREQ_NULLABLE(args[1], "-ae"))
-        *output = g_strdup("# handle 5309");
-    else
+    if (STREQ_NULLABLE(args[1], "-ae")) {
+        g_auto(virBuffer) handles = VIR_BUFFER_INITIALIZER;
+        const char *line = input;
+
+        do {
+            virBufferAddLit(&handles, "# handle 5309\n");
+        } while (line && (line = strchr(line, '\n')) && *++line);
+
+        *output = virBufferContentAndReset(&handles);
+    } else {
         *output = g_strdup("");
+    }
     *error = g_strdup("");
 }
 
@@ -101,7 +117,7 @@ static int testCompareXMLToArgvFiles(const char *xml,
     char *actual;
     g_autoptr(virCommandDryRunToken) dryRunToken = virCommandDryRunTokenNew();
 
-    virCommandSetDryRun(dryRunToken, &buf, true, true, testCommandDryRun, NULL);
+    virCommandSetDryRun(dryRunToken, &buf, true, true, testCommandDryRun, &buf);
 
     if (!(def = virNetworkDefParse(NULL, xml, NULL, false)))
         return -1;
@@ -0,0 +1,236 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "virbuffer.h"
+#include "virfile.h"
+
+#define LIBVIRT_NWFILTER_DHCPSNOOPPRIV_H_ALLOW
+#include "nwfilter/nwfilter_dhcpsnooppriv.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define VM_MAC "52:54:00:12:34:56"
+
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_HEADER_LEN 24
+#define PCAP_RECORD_HEADER_LEN 16
+#define PCAP_MAX_LEN (1024 * 1024)
+
+static const char *testPcapFiles[] = {
+    "dora",
+    "foreign",
+    "malformed",
+};
+
+
+/* Reads the packets of a capture file in the classic pcap format. */
+static GPtrArray *
+testDHCPSnoopReadPcap(const char *name)
+{
+    g_autofree char *path = g_strdup_printf("%s/nwfilterdhcpsnoopdata/%s.pcap",
+                                            abs_srcdir, name);
+    g_autoptr(GPtrArray) packets = g_ptr_array_new_with_free_func((GDestroyNotify) g_bytes_unref);
+    g_autofree char *data = NULL;
+    uint32_t magic = 0;
+    size_t off = PCAP_HEADER_LEN;
+    int len;
+
+    if ((len = virFileReadAll(path, PCAP_MAX_LEN, &data)) < 0)
+        return NULL;
+
+    if (len >= PCAP_HEADER_LEN)
+        memcpy(&magic, data, sizeof(magic));
+
+    if (len < PCAP_HEADER_LEN || GUINT32_FROM_LE(magic) != PCAP_MAGIC) {
+        VIR_TEST_VERBOSE("%s: not a pcap file", path);
+        return NULL;
+    }
+
+    while (off < len) {
+        uint32_t caplen;
+
+        if (off + PCAP_RECORD_HEADER_LEN > len) {
+            VIR_TEST_VERBOSE("%s: truncated record header", path);
+            return NULL;
+        }
+
+        memcpy(&caplen, data + off + 8, sizeof(caplen));
+        caplen = GUINT32_FROM_LE(caplen);
+        off += PCAP_RECORD_HEADER_LEN;
+
+        if (off + caplen > len) {
+            VIR_TEST_VERBOSE("%s: truncated packet", path);
+            return NULL;
+        }
+
+        g_ptr_array_add(packets, g_bytes_new(data + off, caplen));
+        off += caplen;
+    }
+
+    return g_steal_pointer(&packets);
+}
+
+
+static int
+testDHCPSnoopFormat(virBuffer *buf,
+                    const char *dir,
+                    virNWFilterSnoopDHCPMsg *msg)
+{
+    g_autofree char *ipAddress = NULL;
+    g_autofree char *ipServer = NULL;
+
+    if (!(ipAddress = virSocketAddrFormat(&msg->ipAddress)) ||
+        !(ipServer = virSocketAddrFormat(&msg->ipServer)))
+        return -1;
+
+    virBufferAsprintf(buf, "%s type=%u lease=%u yiaddr=%s siaddr=%s\n",
+                      dir, msg->mtype, msg->leasetime, ipAddress, ipServer);
+    return 0;
+}
+
+
+static int
+testDHCPSnoopReplay(const void *opaque)
+{
+    const char *name = opaque;
+    g_autofree char *expected = g_strdup_printf("%s/nwfilterdhcpsnoopdata/%s.txt",
+                                                abs_srcdir, name);
+    g_autoptr(GPtrArray) packets = NULL;
+    g_auto(virBuffer) buf = VIR_BUFFER_INITIALIZER;
+    g_autofree char *actual = NULL;
+    virMacAddr mac;
+    size_t i;
+
+    if (virMacAddrParse(VM_MAC, &mac) < 0)
+        return -1;
+
+    if (!(packets = testDHCPSnoopReadPcap(name)))
+        return -1;
+
+    for (i = 0; i < packets->len; i++) {
+        size_t len;
+        const unsigned char *packet = g_bytes_get_data(packets->pdata[i], &len);
+        virNWFilterSnoopDHCPMsg msg = { 0 };
+
+        virBufferAsprintf(&buf, "%zu: ", i + 1);
+
+        if (virNWFilterSnoopDHCPParse(packet, len, true, &mac, &msg) == 0) {
+            if (testDHCPSnoopFormat(&buf, "from-vm", &msg) < 0)
+                return -1;
+        } else if (virNWFilterSnoopDHCPParse(packet, len, false, &mac, &msg) == 0) {
+            if (testDHCPSnoopFormat(&buf, "to-vm", &msg) < 0)
+                return -1;
+        } else {
+            virBufferAddLit(&buf, "ignored\n");
+        }
+    }
+
+    actual = virBufferContentAndReset(&buf);
+
+    return virTestCompareToFile(actual, expected);
+}
+
+
+struct testDHCPSnoopBenchData {
+    GPtrArray *packets;
+    virMacAddr mac;
+    unsigned long long npackets;
+    unsigned long long ndecoded;
+};
+
+
+static int
+testDHCPSnoopBenchRound(void *opaque,
+                        unsigned long long *count)
+{
+    struct testDHCPSnoopBenchData *data = opaque;
+    size_t i;
+
+    for (i = 0; i < data->packets->len; i++) {
+        size_t len;
+        const unsigned char *packet = g_bytes_get_data(data->packets->pdata[i], &len);
+        virNWFilterSnoopDHCPMsg msg;
+        bool fromVM = data->npackets % 2;
+
+        if (virNWFilterSnoopDHCPMatch(packet, len, fromVM, &data->mac) &&
+            virNWFilterSnoopDHCPParse(packet, len, fromVM, &data->mac, &msg) == 0)
+            data->ndecoded++;
+
+        data->npackets++;
+    }
+
+    *count += data->packets->len;
+    return 0;
+}
+
+
+/* Reports the rate at which captured packets can be matched and decoded,
+ * i.e. the rate the snooping thread and its workers can keep up with. */
+static int
+testDHCPSnoopBench(const void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(GPtrArray) packets = g_ptr_array_new_with_free_func((GDestroyNotify) g_bytes_unref);
+    struct testDHCPSnoopBenchData data = { .packets = packets };
+    size_t i;
+    int rc;
+
+    if (virMacAddrParse(VM_MAC, &data.mac) < 0)
+        return -1;
+
+    for (i = 0; i < G_N_ELEMENTS(testPcapFiles); i++) {
+        g_autoptr(GPtrArray) file = testDHCPSnoopReadPcap(testPcapFiles[i]);
+        size_t j;
+
+        if (!file)
+            return -1;
+
+        for (j = 0; j < file->len; j++)
+            g_ptr_array_add(packets, g_bytes_ref(file->pdata[j]));
+    }
+
+    if ((rc = virTestBenchmark("DHCP packet decoding", "packets",
+                               testDHCPSnoopBenchRound, &data)) != 0)
+        return rc;
+
+    VIR_TEST_DEBUG("%llu of %llu packets decoded", data.ndecoded, data.npackets);
+
+    return 0;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS(testPcapFiles); i++) {
+        g_autofree char *testname = g_strdup_printf("Replay %s", testPcapFiles[i]);
+
+        if (virTestRun(testname, testDHCPSnoopReplay, testPcapFiles[i]) < 0)
+            ret = -1;
+    }
+
+    if (virTestRun("Replay benchmark", testDHCPSnoopBench, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
@@ -99,15 +99,17 @@ static const char *commonRules[] = {
     "iptables \\\n-w \\\n-I FORWARD 3 \\\n-j libvirt-in-post\n"
     "iptables \\\n-w \\\n-N libvirt-host-in\n"
     "iptables \\\n-w \\\n-D INPUT \\\n-j libvirt-host-in\n"
-    "iptables \\\n-w \\\n-I INPUT 1 \\\n-j libvirt-host-in\n"
-    "iptables \\\n-w \\\n-N FP-vnet0\n"
-    "iptables \\\n-w \\\n-N FJ-vnet0\n"
-    "iptables \\\n-w \\\n-N HJ-vnet0\n"
-    "iptables \\\n-w \\\n-A libvirt-out \\\n-m physdev \\\n--physdev-is-bridged \\\n--physdev-out vnet0 \\\n-g FP-vnet0\n"
-    "iptables \\\n-w \\\n-A libvirt-in \\\n-m physdev \\\n--physdev-in vnet0 \\\n-g FJ-vnet0\n"
-    "iptables \\\n-w \\\n-A libvirt-host-in \\\n-m physdev \\\n--physdev-in vnet0 \\\n-g HJ-vnet0\n"
-    "iptables \\\n-w \\\n-D libvirt-in-post \\\n-m physdev \\\n--physdev-in vnet0 \\\n-j ACCEPT\n"
-    "iptables \\\n-w \\\n-A libvirt-in-post \\\n-m physdev \\\n--physdev-in vnet0 \\\n-j ACCEPT\n",
+    "iptables-restore \\\n-w \\\n--noflush\n"
+    "*filter\n"
+    "-I INPUT 1 -j libvirt-host-in\n"
+    "-N FP-vnet0\n"
+    "-N FJ-vnet0\n"
+    "-N HJ-vnet0\n"
+    "-A libvirt-out -m physdev --physdev-is-bridged --physdev-out vnet0 -g FP-vnet0\n"
+    "-A libvirt-in -m physdev --physdev-in vnet0 -g FJ-vnet0\n"
+    "-A libvirt-host-in -m physdev --physdev-in vnet0 -g HJ-vnet0\n"
+    "COMMIT\n"
+    "iptables \\\n-w \\\n-D libvirt-in-post \\\n-m physdev \\\n--physdev-in vnet0 \\\n-j ACCEPT\n",
 
     /* Dropping ip6tables rules */
     "ip6tables \\\n-w \\\n-D libvirt-out \\\n-m physdev \\\n--physdev-is-bridged \\\n--physdev-out vnet0 \\\n-g FP-vnet0\n"
@@ -133,15 +135,17 @@ static const char *commonRules[] = {
     "ip6tables \\\n-w \\\n-I FORWARD 3 \\\n-j libvirt-in-post\n"
     "ip6tables \\\n-w \\\n-N libvirt-host-in\n"
     "ip6tables \\\n-w \\\n-D INPUT \\\n-j libvirt-host-in\n"
-    "ip6tables \\\n-w \\\n-I INPUT 1 \\\n-j libvirt-host-in\n"
-    "ip6tables \\\n-w \\\n-N FP-vnet0\n"
-    "ip6tables \\\n-w \\\n-N FJ-vnet0\n"
-    "ip6tables \\\n-w \\\n-N HJ-vnet0\n"
-    "ip6tables \\\n-w \\\n-A libvirt-out \\\n-m physdev \\\n--physdev-is-bridged \\\n--physdev-out vnet0 \\\n-g FP-vnet0\n"
-    "ip6tables \\\n-w \\\n-A libvirt-in \\\n-m physdev \\\n--physdev-in vnet0 \\\n-g FJ-vnet0\n"
-    "ip6tables \\\n-w \\\n-A libvirt-host-in \\\n-m physdev \\\n--physdev-in vnet0 \\\n-g HJ-vnet0\n"
-    "ip6tables \\\n-w \\\n-D libvirt-in-post \\\n-m physdev \\\n--physdev-in vnet0 \\\n-j ACCEPT\n"
-    "ip6tables \\\n-w \\\n-A libvirt-in-post \\\n-m physdev \\\n--physdev-in vnet0 \\\n-j ACCEPT\n",
+    "ip6tables-restore \\\n-w \\\n--noflush\n"
+    "*filter\n"
+    "-I INPUT 1 -j libvirt-host-in\n"
+    "-N FP-vnet0\n"
+    "-N FJ-vnet0\n"
+    "-N HJ-vnet0\n"
+    "-A libvirt-out -m physdev --physdev-is-bridged --physdev-out vnet0 -g FP-vnet0\n"
+    "-A libvirt-in -m physdev --physdev-in vnet0 -g FJ-vnet0\n"
+    "-A libvirt-host-in -m physdev --physdev-in vnet0 -g HJ-vnet0\n"
+    "COMMIT\n"
+    "ip6tables \\\n-w \\\n-D libvirt-in-post \\\n-m physdev \\\n--physdev-in vnet0 \\\n-j ACCEPT\n",
 };
 
 
@@ -349,12 +353,18 @@ static int testSetDefaultParameters(GHashTable *vars)
 static void
 testCommandDryRunCallback(const char *const*args,
                           const char *const*env G_GNUC_UNUSED,
-                          const char *input G_GNUC_UNUSED,
+                          const char *input,
                           char **output,
                           char **error G_GNUC_UNUSED,
                           int *status,
-                          void *opaque G_GNUC_UNUSED)
+                          void *opaque)
 {
+    virBuffer *buf = opaque;
+
+    /* record the rules applied in a batch by iptables-restore */
+    if (input)
+        virBufferAdd(buf, input, -1);
+
     if (STRNEQ(args[0], "iptables") && STRNEQ(args[0], "ip6tables")) {
         return;
     }
@@ -376,7 +386,7 @@ static int testCompareXMLToArgvFiles(const char *xml,
     int ret = -1;
     g_autoptr(virCommandDryRunToken) dryRunToken = virCommandDryRunTokenNew();
 
-    virCommandSetDryRun(dryRunToken, &buf, true, true, testCommandDryRunCallback, NULL);
+    virCommandSetDryRun(dryRunToken, &buf, true, true, testCommandDryRunCallback, &buf);
 
     if (testSetDefaultParameters(vars) < 0)
         goto cleanup;
@@ -174,6 +174,128 @@ testQemuCapsCopy(const void *opaque)
 }
 
 
+static int
+testQemuCapsBinary(const void *opaque)
+{
+    const testQemuData *data = opaque;
+    virArch arch = virArchFromString(data->archName);
+    g_autofree char *capsFile = NULL;
+    g_autofree char *binary = NULL;
+    g_autoptr(virQEMUCaps) orig = NULL;
+    g_autoptr(virQEMUCaps) loaded = NULL;
+    g_autoptr(GByteArray) buf = NULL;
+    g_autofree char *actual = NULL;
+
+    capsFile = g_strdup_printf("%s/%s_%s_%s%s.xml",
+                               data->outputDir, data->prefix, data->version,
+                               data->archName, data->variant);
+    binary = g_strdup_printf("/usr/bin/qemu-system-%s", virArchToString(arch));
+
+    if (!(orig = qemuTestParseCapabilitiesArch(arch, capsFile)))
+        return -1;
+
+    if (!(buf = virQEMUCapsFormatBinaryCache(orig)))
+        return -1;
+
+    loaded = virQEMUCapsNewBinary(binary);
+
+    if (virQEMUCapsLoadBinaryCache(arch, loaded, (const char *) buf->data,
+                                   buf->len, true) < 0)
+        return -1;
+
+    if (!(actual = virQEMUCapsFormatCache(loaded)))
+        return -1;
+
+    if (virTestCompareToFile(actual, capsFile) < 0)
+        return -1;
+
+    return 0;
+}
+
+
+struct testQemuCapsBenchData {
+    virArch arch;
+    const char *binary;
+    const char *capsFile;
+    GByteArray *buf;
+};
+
+
+static int
+testQemuCapsBenchXML(void *opaque,
+                     unsigned long long *count)
+{
+    struct testQemuCapsBenchData *data = opaque;
+    g_autoptr(virQEMUCaps) qemuCaps = virQEMUCapsNewBinary(data->binary);
+
+    if (virQEMUCapsLoadCache(data->arch, qemuCaps, data->capsFile, true) < 0)
+        return -1;
+
+    (*count)++;
+    return 0;
+}
+
+
+static int
+testQemuCapsBenchBinary(void *opaque,
+                        unsigned long long *count)
+{
+    struct testQemuCapsBenchData *data = opaque;
+    g_autoptr(virQEMUCaps) qemuCaps = virQEMUCapsNewBinary(data->binary);
+
+    if (virQEMUCapsLoadBinaryCache(data->arch, qemuCaps,
+                                   (const char *) data->buf->data,
+                                   data->buf->len, true) < 0)
+        return -1;
+
+    (*count)++;
+    return 0;
+}
+
+
+/* Reports how fast the capabilities load from their XML and binary
+ * representations. */
+static int
+testQemuCapsBinaryBench(const void *opaque)
+{
+    const testQemuData *data = opaque;
+    virArch arch = virArchFromString(data->archName);
+    g_autofree char *capsFile = NULL;
+    g_autofree char *binary = NULL;
+    g_autoptr(virQEMUCaps) orig = NULL;
+    g_autoptr(GByteArray) buf = NULL;
+    struct testQemuCapsBenchData bench = { .arch = arch };
+    int rc;
+
+    /* don't bother parsing the capabilities if the benchmark is skipped anyway */
+    if (!virTestGetExpensive())
+        return EXIT_AM_SKIP;
+
+    capsFile = g_strdup_printf("%s/%s_%s_%s%s.xml",
+                               data->outputDir, data->prefix, data->version,
+                               data->archName, data->variant);
+    binary = g_strdup_printf("/usr/bin/qemu-system-%s", virArchToString(arch));
+
+    if (!(orig = qemuTestParseCapabilitiesArch(arch, capsFile)) ||
+        !(buf = virQEMUCapsFormatBinaryCache(orig)))
+        return -1;
+
+    bench.binary = binary;
+    bench.capsFile = capsFile;
+    bench.buf = buf;
+
+    VIR_TEST_DEBUG("%s_%s%s: binary cache is %u bytes",
+                   data->version, data->archName, data->variant, buf->len);
+
+    if ((rc = virTestBenchmark("XML cache load", "loads",
+                               testQemuCapsBenchXML, &bench)) != 0)
+        return rc;
+
+    return virTestBenchmark("binary cache load", "loads",
+                            testQemuCapsBenchBinary, &bench);
+}
+
+
 static int
 doCapsTest(const char *inputDir,
            const char *prefix,
@@ -186,9 +308,13 @@ doCapsTest(const char *inputDir,
     testQemuData *data = (testQemuData *) opaque;
     g_autofree char *title = NULL;
     g_autofree char *copyTitle = NULL;
+    g_autofree char *binaryTitle = NULL;
+    g_autofree char *benchTitle = NULL;
 
     title = g_strdup_printf("%s (%s)", version, archName);
     copyTitle = g_strdup_printf("copy %s (%s)", version, archName);
+    binaryTitle = g_strdup_printf("binary %s (%s)", version, archName);
+    benchTitle = g_strdup_printf("binary benchmark %s (%s)", version, archName);
 
     data->inputDir = inputDir;
     data->prefix = prefix;
@@ -203,6 +329,12 @@ doCapsTest(const char *inputDir,
     if (virTestRun(copyTitle, testQemuCapsCopy, data) < 0)
         data->ret = -1;
 
+    if (virTestRun(binaryTitle, testQemuCapsBinary, data) < 0)
+        data->ret = -1;
+
+    if (virTestRun(benchTitle, testQemuCapsBinaryBench, data) < 0)
+        data->ret = -1;
+
     return 0;
 }
 
@@ -0,0 +1,188 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+
+#ifdef WITH_QEMU
+
+# include "datatypes.h"
+# include "internal.h"
+# include "qemu/qemu_domain.h"
+# include "virthreadpool.h"
+# include "viruuid.h"
+
+# define LIBVIRT_QEMU_DRIVERPRIV_H_ALLOW
+# include "qemu/qemu_driverpriv.h"
+
+# include "testutilsqemu.h"
+
+# define VIR_FROM_THIS VIR_FROM_QEMU
+
+static virQEMUDriver driver;
+
+static const char *testDomains[] = { "first", "stall", "third" };
+
+
+static virDomainObj *
+testDomainStatsObjNew(const char *name)
+{
+    g_autoptr(virDomainObj) vm = NULL;
+
+    if (!(vm = virDomainObjNew(driver.xmlopt)) ||
+        !(vm->def = virDomainDefNew(driver.xmlopt)))
+        return NULL;
+
+    vm->def->name = g_strdup(name);
+    vm->def->id = -1;
+    virDomainDefSetMemoryTotal(vm->def, 1024 * 1024);
+
+    if (virUUIDGenerate(vm->def->uuid) < 0)
+        return NULL;
+
+    virObjectUnlock(vm);
+    return g_steal_pointer(&vm);
+}
+
+
+static int
+testDomainStatsCheck(virDomainObj **vms,
+                     virDomainStatsRecordPtr *records,
+                     int nrecords,
+                     int abandoned)
+{
+    qemuDomainObjPrivate *priv = vms[1]->privateData;
+    size_t i;
+
+    if (nrecords != G_N_ELEMENTS(testDomains)) {
+        VIR_TEST_DEBUG("Expected %zu records, got %d",
+                       G_N_ELEMENTS(testDomains), nrecords);
+        return -1;
+    }
+
+    for (i = 0; i < nrecords; i++) {
+        if (STRNEQ(records[i]->dom->name, testDomains[i])) {
+            VIR_TEST_DEBUG("Expected record of '%s', got '%s'",
+                           testDomains[i], records[i]->dom->name);
+            return -1;
+        }
+    }
+
+    if (g_atomic_int_get(&priv->statsJobsAbandoned) != abandoned) {
+        VIR_TEST_DEBUG("Expected %d abandoned jobs, got %d",
+                       abandoned, g_atomic_int_get(&priv->statsJobsAbandoned));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* A domain whose stats take longer than the time limit must neither
+ * delay nor fail the stats of the other domains. */
+static int
+testDomainStatsStall(const void *opaque G_GNUC_UNUSED)
+{
+    virDomainObj *vms[G_N_ELEMENTS(testDomains)] = { 0 };
+    unsigned int stats[G_N_ELEMENTS(testDomains)];
+    virDomainStatsRecordPtr *records = g_new0(virDomainStatsRecordPtr,
+                                              G_N_ELEMENTS(testDomains) + 1);
+    virConnectPtr conn = NULL;
+    qemuDomainObjPrivate *priv;
+    int nrecords;
+    size_t i;
+    int ret = -1;
+
+    for (i = 0; i < G_N_ELEMENTS(testDomains); i++) {
+        if (!(vms[i] = testDomainStatsObjNew(testDomains[i])))
+            goto cleanup;
+        stats[i] = VIR_DOMAIN_STATS_STATE | VIR_DOMAIN_STATS_BALLOON;
+    }
+    priv = vms[1]->privateData;
+
+    if (!(conn = virGetConnect()))
+        goto cleanup;
+    conn->privateData = &driver;
+
+    driver.config->domainStatsTimeout = 1;
+    if (!(driver.statsPool = virThreadPoolNewFull(0, 2, 0,
+                                                  qemuConnectGetAllDomainStatsWorker,
+                                                  "qemu-stats", NULL, &driver)))
+        goto cleanup;
+
+    nrecords = qemuConnectGetAllDomainStatsParallel(conn, vms, stats,
+                                                    G_N_ELEMENTS(testDomains),
+                                                    records, 0);
+    if (testDomainStatsCheck(vms, records, nrecords, 1) < 0)
+        goto cleanup;
+    virDomainStatsRecordListFree(records);
+    records = g_new0(virDomainStatsRecordPtr, G_N_ELEMENTS(testDomains) + 1);
+
+    /* the stalled domain must not take up another worker */
+    nrecords = qemuConnectGetAllDomainStatsParallel(conn, vms, stats,
+                                                    G_N_ELEMENTS(testDomains),
+                                                    records, 0);
+    if (testDomainStatsCheck(vms, records, nrecords, 1) < 0)
+        goto cleanup;
+
+    /* waits for the abandoned job to finish */
+    g_clear_pointer(&driver.statsPool, virThreadPoolFree);
+
+    if (g_atomic_int_get(&priv->statsJobsAbandoned) != 0) {
+        VIR_TEST_DEBUG("Abandoned job wasn't released");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    g_clear_pointer(&driver.statsPool, virThreadPoolFree);
+    virDomainStatsRecordListFree(records);
+    for (i = 0; i < G_N_ELEMENTS(testDomains); i++)
+        virObjectUnref(vms[i]);
+    virObjectUnref(conn);
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (qemuTestDriverInit(&driver) < 0)
+        return EXIT_FAILURE;
+
+    if (virTestRun("Stalled domain stats", testDomainStatsStall, NULL) < 0)
+        ret = -1;
+
+    qemuTestDriverFree(&driver);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN_PRELOAD(mymain, VIR_TEST_MOCK("qemudomainstats"))
+
+#else
+
+int
+main(void)
+{
+    return EXIT_AM_SKIP;
+}
+
+#endif /* WITH_QEMU */
@@ -388,6 +388,24 @@ int virFileUnlock(int fd G_GNUC_UNUSED,
 }
 
 
+int virFileLockOFD(int fd G_GNUC_UNUSED,
+                   bool shared G_GNUC_UNUSED,
+                   off_t start G_GNUC_UNUSED,
+                   off_t len G_GNUC_UNUSED,
+                   bool waitForLock G_GNUC_UNUSED)
+{
+    return 0;
+}
+
+
+int virFileUnlockOFD(int fd G_GNUC_UNUSED,
+                     off_t start G_GNUC_UNUSED,
+                     off_t len G_GNUC_UNUSED)
+{
+    return 0;
+}
+
+
 bool virFileExists(const char *path)
 {
     VIR_LOCK_GUARD lock = virLockGuardLock(&m);
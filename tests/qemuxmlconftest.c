@@ -841,6 +841,42 @@ testCompareOutXML2XML(const void *data)
 }
 
 
+/* virDomainDefCopy copies some devices directly rather than via XML. The
+ * result must be identical to a full round-trip through XML. */
+static int
+testCompareDefCopy(const void *data)
+{
+    testQemuInfo *info = (void *) data;
+    unsigned int format_flags = VIR_DOMAIN_DEF_FORMAT_SECURE;
+    g_autofree char *xml = NULL;
+    g_autofree char *expected = NULL;
+    g_autofree char *actual = NULL;
+    g_autoptr(virDomainDef) expectdef = NULL;
+    g_autoptr(virDomainDef) copydef = NULL;
+    int rc = 0;
+
+    if (!testQemuConfXMLCommon(info, &rc))
+        return rc;
+
+    if (!(xml = virDomainDefFormat(info->def, driver.xmlopt, format_flags)))
+        return -1;
+
+    if (!(expectdef = virDomainDefParseString(xml, driver.xmlopt, NULL,
+                                              VIR_DOMAIN_DEF_PARSE_INACTIVE |
+                                              VIR_DOMAIN_DEF_PARSE_SKIP_VALIDATE)))
+        return -1;
+
+    if (!(copydef = virDomainDefCopy(info->def, driver.xmlopt, NULL, false)))
+        return -1;
+
+    if (!(expected = virDomainDefFormat(expectdef, driver.xmlopt, format_flags)) ||
+        !(actual = virDomainDefFormat(copydef, driver.xmlopt, format_flags)))
+        return -1;
+
+    return virTestCompareToString(expected, actual);
+}
+
+
 static int
 testExtDeviceArgv(testQemuInfo *info,
                   virCommand *cmd,
@@ -1121,6 +1157,7 @@ testRun(const char *name,
     g_autofree char *name_parse = g_strdup_printf("QEMU XML def parse %s%s", name, suffix);
     g_autofree char *name_xml = g_strdup_printf("QEMU XML def -> XML %s%s", name, suffix);
     g_autofree char *name_outxml = g_strdup_printf("QEMU XML OUT -> XML %s%s", name, suffix);
+    g_autofree char *name_copy = g_strdup_printf("QEMU XML def copy %s%s", name, suffix);
     g_autofree char *name_argv = g_strdup_printf("QEMU XML def -> ARGV %s%s", name, suffix);
     g_autoptr(testQemuInfo) info = g_new0(testQemuInfo, 1);
     va_list ap;
@@ -1150,6 +1187,7 @@ testRun(const char *name,
     virTestRunLog(ret, name_parse, testXMLParse, info);
     virTestRunLog(ret, name_xml, testCompareDef2XML, info);
     virTestRunLog(ret, name_outxml, testCompareOutXML2XML, info);
+    virTestRunLog(ret, name_copy, testCompareDefCopy, info);
     virTestRunLog(ret, name_argv, testCompareXMLToArgv, info);
 
     /* clear overriden host cpu */
@@ -744,6 +744,51 @@ virTestGetRegenerate(void)
 }
 
 
+/* How long virTestBenchmark keeps calling the measured function */
+#define VIR_TEST_BENCHMARK_MS 500
+
+/**
+ * virTestBenchmark:
+ * @what: description of the measured operation
+ * @unit: name of the things counted by @func
+ * @func: function doing one round of the measured operation
+ * @opaque: data passed to @func
+ *
+ * Calls @func repeatedly for VIR_TEST_BENCHMARK_MS milliseconds. Each call
+ * adds the number of @unit it processed to its @count argument and the
+ * resulting rate is reported with VIR_TEST_DEBUG.
+ *
+ * Returns EXIT_AM_SKIP without calling @func unless expensive tests are
+ * enabled, -1 if @func failed, 0 otherwise.
+ */
+int
+virTestBenchmark(const char *what,
+                 const char *unit,
+                 virTestBenchmarkFunc func,
+                 void *opaque)
+{
+    unsigned long long count = 0;
+    gint64 start;
+    gint64 elapsed;
+
+    if (!virTestGetExpensive())
+        return EXIT_AM_SKIP;
+
+    start = g_get_monotonic_time();
+
+    do {
+        if (func(opaque, &count) < 0)
+            return -1;
+
+        elapsed = g_get_monotonic_time() - start;
+    } while (elapsed < VIR_TEST_BENCHMARK_MS * 1000);
+
+    VIR_TEST_DEBUG("%s: %.1f %s/s", what, count * 1e6 / elapsed, unit);
+
+    return 0;
+}
+
+
 /**
  * virTestHasRangeBitmap:
  *
@@ -84,6 +84,13 @@ void virTestPropagateLibvirtError(void);
 
 bool virTestHasRangeBitmap(void);
 
+typedef int (*virTestBenchmarkFunc)(void *opaque,
+                                    unsigned long long *count);
+int virTestBenchmark(const char *what,
+                     const char *unit,
+                     virTestBenchmarkFunc func,
+                     void *opaque);
+
 #define VIR_TEST_DEBUG(fmt, ...) \
     do { \
         if (virTestGetDebug()) \
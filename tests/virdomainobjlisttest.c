@@ -0,0 +1,512 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "virdomainobjlist.h"
+#include "virfile.h"
+#include "virthread.h"
+
+#define LIBVIRT_VIRDOMAINOBJLISTPRIV_H_ALLOW
+#include "virdomainobjlistpriv.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#define NDOMAINS 500
+#define BENCH_LOOKUPS 10000 /* per thread and round */
+#define NCONFIGS 50
+
+static virDomainXMLOption *xmlopt;
+
+
+static void
+testDomainObjListUUID(size_t idx,
+                      unsigned char *uuid)
+{
+    memset(uuid, 0, VIR_UUID_BUFLEN);
+    uuid[0] = 0x42;
+    uuid[VIR_UUID_BUFLEN - 2] = idx >> 8;
+    uuid[VIR_UUID_BUFLEN - 1] = idx & 0xff;
+}
+
+
+static virDomainObj *
+testDomainObjListAdd(virDomainObjList *doms,
+                     size_t idx,
+                     int id)
+{
+    g_autoptr(virDomainDef) def = virDomainDefNew(xmlopt);
+    virDomainObj *vm;
+
+    def->virtType = VIR_DOMAIN_VIRT_TEST;
+    def->name = g_strdup_printf("dom%zu", idx);
+    testDomainObjListUUID(idx, def->uuid);
+
+    if (!(vm = virDomainObjListAdd(doms, &def, xmlopt, 0, NULL)))
+        return NULL;
+
+    vm->def->id = id;
+    return vm;
+}
+
+
+static virDomainObjList *
+testDomainObjListNew(size_t ndomains)
+{
+    g_autoptr(virDomainObjList) doms = virDomainObjListNew();
+    size_t i;
+
+    if (!doms)
+        return NULL;
+
+    for (i = 0; i < ndomains; i++) {
+        virDomainObj *vm;
+
+        /* every other domain is running */
+        if (!(vm = testDomainObjListAdd(doms, i, i % 2 ? i : -1)))
+            return NULL;
+
+        virDomainObjEndAPI(&vm);
+    }
+
+    return g_steal_pointer(&doms);
+}
+
+
+static int
+testDomainObjListCheck(virDomainObj *vm,
+                       const char *lookup,
+                       const char *expected)
+{
+    g_autoptr(virDomainObj) obj = vm;
+
+    if (!vm) {
+        if (expected) {
+            VIR_TEST_VERBOSE("%s: expected '%s', got nothing", lookup, expected);
+            return -1;
+        }
+        return 0;
+    }
+
+    virObjectUnlock(vm);
+
+    if (!expected) {
+        VIR_TEST_VERBOSE("%s: expected nothing, got '%s'", lookup, vm->def->name);
+        return -1;
+    }
+
+    if (STRNEQ(vm->def->name, expected)) {
+        VIR_TEST_VERBOSE("%s: expected '%s', got '%s'",
+                         lookup, expected, vm->def->name);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+testDomainObjListLookup(const void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(virDomainObjList) doms = testDomainObjListNew(10);
+    unsigned char uuid[VIR_UUID_BUFLEN];
+
+    if (!doms)
+        return -1;
+
+    testDomainObjListUUID(4, uuid);
+
+    if (testDomainObjListCheck(virDomainObjListFindByID(doms, 3), "id 3", "dom3") < 0 ||
+        testDomainObjListCheck(virDomainObjListFindByID(doms, 3), "id 3", "dom3") < 0 ||
+        testDomainObjListCheck(virDomainObjListFindByID(doms, 4), "id 4", NULL) < 0 ||
+        testDomainObjListCheck(virDomainObjListFindByName(doms, "dom7"), "name dom7", "dom7") < 0 ||
+        testDomainObjListCheck(virDomainObjListFindByName(doms, "dom10"), "name dom10", NULL) < 0 ||
+        testDomainObjListCheck(virDomainObjListFindByUUID(doms, uuid), "uuid 4", "dom4") < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+testDomainObjListIDReuse(const void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(virDomainObjList) doms = testDomainObjListNew(10);
+    virDomainObj *vm;
+
+    if (!doms)
+        return -1;
+
+    /* populate the ID index */
+    if (testDomainObjListCheck(virDomainObjListFindByID(doms, 5), "id 5", "dom5") < 0)
+        return -1;
+
+    /* dom5 stops and its ID is handed to dom6 */
+    if (!(vm = virDomainObjListFindByName(doms, "dom5")))
+        return -1;
+    vm->def->id = -1;
+    virDomainObjEndAPI(&vm);
+
+    if (testDomainObjListCheck(virDomainObjListFindByID(doms, 5), "id 5", NULL) < 0)
+        return -1;
+
+    if (!(vm = virDomainObjListFindByName(doms, "dom6")))
+        return -1;
+    vm->def->id = 5;
+    virDomainObjEndAPI(&vm);
+
+    if (testDomainObjListCheck(virDomainObjListFindByID(doms, 5), "id 5", "dom6") < 0)
+        return -1;
+
+    /* removed domains must not be found via the index */
+    if (!(vm = virDomainObjListFindByID(doms, 5)))
+        return -1;
+    virDomainObjListRemove(doms, vm);
+    virDomainObjEndAPI(&vm);
+
+    return testDomainObjListCheck(virDomainObjListFindByID(doms, 5), "id 5", NULL);
+}
+
+
+static int
+testDomainObjListRenameCallback(virDomainObj *vm,
+                                const char *new_name,
+                                unsigned int flags G_GNUC_UNUSED,
+                                void *opaque G_GNUC_UNUSED)
+{
+    g_free(vm->def->name);
+    vm->def->name = g_strdup(new_name);
+    return 0;
+}
+
+
+static int
+testDomainObjListRename(const void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(virDomainObjList) doms = testDomainObjListNew(10);
+    virDomainObj *vm;
+    int rc;
+
+    if (!doms)
+        return -1;
+
+    if (!(vm = virDomainObjListFindByName(doms, "dom2")))
+        return -1;
+
+    rc = virDomainObjListRename(doms, vm, "renamed", 0,
+                                testDomainObjListRenameCallback, NULL);
+    virDomainObjEndAPI(&vm);
+    if (rc < 0)
+        return -1;
+
+    if (testDomainObjListCheck(virDomainObjListFindByName(doms, "dom2"), "name dom2", NULL) < 0 ||
+        testDomainObjListCheck(virDomainObjListFindByName(doms, "renamed"), "name renamed", "renamed") < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static const char *testDomainObjListConfigXML =
+    "<domain type='qemu'>\n"
+    "  <name>dom%zu</name>\n"
+    "  <uuid>4200%04zx-0000-0000-0000-000000000000</uuid>\n"
+    "  <memory unit='KiB'>%zu</memory>\n"
+    "  <os>\n"
+    "    <type arch='i686' machine='pc'>hvm</type>\n"
+    "  </os>\n"
+    "</domain>\n";
+
+
+static virDomainObjList *
+testDomainObjListLoad(const char *configDir,
+                      const char *autostartDir,
+                      size_t nworkers)
+{
+    g_autoptr(virDomainObjList) doms = virDomainObjListNew();
+
+    if (!doms)
+        return NULL;
+
+    if (virDomainObjListLoadAllConfigsFull(doms, configDir, autostartDir,
+                                           false, xmlopt, NULL, NULL,
+                                           nworkers) < 0)
+        return NULL;
+
+    /* errors of the broken config are reported, but don't fail loading */
+    virResetLastError();
+
+    return g_steal_pointer(&doms);
+}
+
+
+static int
+testDomainObjListLoadCompare(virDomainObjList *serial,
+                             virDomainObjList *parallel,
+                             const char *name)
+{
+    g_autoptr(virDomainObj) a = virDomainObjListFindByName(serial, name);
+    g_autoptr(virDomainObj) b = virDomainObjListFindByName(parallel, name);
+    g_autofree char *xmlA = NULL;
+    g_autofree char *xmlB = NULL;
+
+    if (a)
+        virObjectUnlock(a);
+    if (b)
+        virObjectUnlock(b);
+
+    if (!a || !b) {
+        VIR_TEST_VERBOSE("%s: loaded serially: %s, in parallel: %s",
+                         name, a ? "yes" : "no", b ? "yes" : "no");
+        return -1;
+    }
+
+    if (!(xmlA = virDomainDefFormat(a->def, xmlopt, 0)) ||
+        !(xmlB = virDomainDefFormat(b->def, xmlopt, 0)))
+        return -1;
+
+    if (virTestCompareToString(xmlA, xmlB) < 0)
+        return -1;
+
+    if (!a->persistent || !b->persistent ||
+        a->autostart != b->autostart) {
+        VIR_TEST_VERBOSE("%s: state of the loaded domains differs", name);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/* Loading configs in parallel must give the same result as loading them
+ * one after another, and a broken config must be skipped either way. */
+static int
+testDomainObjListLoadAll(const void *opaque G_GNUC_UNUSED)
+{
+    g_autofree char *dir = g_strdup(abs_builddir "/virdomainobjlistdata-XXXXXX");
+    g_autofree char *configDir = NULL;
+    g_autofree char *autostartDir = NULL;
+    g_autofree char *autostartFile = NULL;
+    g_autofree char *autostartLink = NULL;
+    g_autofree char *brokenFile = NULL;
+    g_autoptr(virDomainObjList) serial = NULL;
+    g_autoptr(virDomainObjList) parallel = NULL;
+    g_autoptr(virDomainObj) broken = NULL;
+    g_autoptr(virDomainObj) autostarted = NULL;
+    size_t i;
+    int ret = -1;
+
+    if (!g_mkdtemp(dir)) {
+        VIR_TEST_DEBUG("Cannot create temporary directory");
+        return -1;
+    }
+
+    configDir = g_strdup_printf("%s/config", dir);
+    autostartDir = g_strdup_printf("%s/autostart", dir);
+
+    if (g_mkdir_with_parents(configDir, 0777) < 0 ||
+        g_mkdir_with_parents(autostartDir, 0777) < 0)
+        goto cleanup;
+
+    for (i = 0; i < NCONFIGS; i++) {
+        g_autofree char *name = g_strdup_printf("dom%zu", i);
+        g_autofree char *file = virDomainConfigFile(configDir, name);
+        g_autofree char *xml = g_strdup_printf(testDomainObjListConfigXML,
+                                               i, i, 1024 * (i + 1));
+
+        if (virFileWriteStr(file, xml, 0600) < 0)
+            goto cleanup;
+    }
+
+    brokenFile = virDomainConfigFile(configDir, "broken");
+    if (virFileWriteStr(brokenFile, "<domain type='qemu'><name>broken", 0600) < 0)
+        goto cleanup;
+
+    autostartFile = virDomainConfigFile(configDir, "dom3");
+    autostartLink = virDomainConfigFile(autostartDir, "dom3");
+    if (symlink(autostartFile, autostartLink) < 0)
+        goto cleanup;
+
+    if (!(serial = testDomainObjListLoad(configDir, autostartDir, 1)) ||
+        !(parallel = testDomainObjListLoad(configDir, autostartDir, 8)))
+        goto cleanup;
+
+    if (virDomainObjListNumOfDomains(serial, false, NULL, NULL) != NCONFIGS ||
+        virDomainObjListNumOfDomains(parallel, false, NULL, NULL) != NCONFIGS) {
+        VIR_TEST_VERBOSE("Expected %d domains, loaded %d serially and %d in parallel",
+                         NCONFIGS,
+                         virDomainObjListNumOfDomains(serial, false, NULL, NULL),
+                         virDomainObjListNumOfDomains(parallel, false, NULL, NULL));
+        goto cleanup;
+    }
+
+    if ((broken = virDomainObjListFindByName(parallel, "broken"))) {
+        virObjectUnlock(broken);
+        VIR_TEST_VERBOSE("Broken config was loaded");
+        goto cleanup;
+    }
+
+    if (!(autostarted = virDomainObjListFindByName(serial, "dom3")))
+        goto cleanup;
+    virObjectUnlock(autostarted);
+
+    if (!autostarted->autostart) {
+        VIR_TEST_VERBOSE("Autostart link of dom3 was ignored");
+        goto cleanup;
+    }
+
+    for (i = 0; i < NCONFIGS; i++) {
+        g_autofree char *name = g_strdup_printf("dom%zu", i);
+
+        if (testDomainObjListLoadCompare(serial, parallel, name) < 0)
+            goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    if (getenv("LIBVIRT_SKIP_CLEANUP") == NULL)
+        virFileDeleteTree(dir);
+    return ret;
+}
+
+
+typedef struct _testDomainObjListBenchData testDomainObjListBenchData;
+struct _testDomainObjListBenchData {
+    virDomainObjList *doms;
+    size_t nthreads;
+};
+
+typedef struct _testDomainObjListBenchThread testDomainObjListBenchThread;
+struct _testDomainObjListBenchThread {
+    virThread thread;
+    virDomainObjList *doms;
+    size_t seed;
+};
+
+
+static void
+testDomainObjListBenchWorker(void *opaque)
+{
+    testDomainObjListBenchThread *data = opaque;
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    char name[32];
+    size_t i;
+
+    for (i = 0; i < BENCH_LOOKUPS; i++) {
+        size_t idx = (i * 7919 + data->seed) % NDOMAINS;
+        virDomainObj *vm;
+
+        switch (i % 3) {
+        case 0:
+            testDomainObjListUUID(idx, uuid);
+            vm = virDomainObjListFindByUUID(data->doms, uuid);
+            break;
+        case 1:
+            g_snprintf(name, sizeof(name), "dom%zu", idx);
+            vm = virDomainObjListFindByName(data->doms, name);
+            break;
+        default:
+            vm = virDomainObjListFindByID(data->doms, idx | 1);
+            break;
+        }
+
+        virDomainObjEndAPI(&vm);
+    }
+}
+
+
+static int
+testDomainObjListBenchRound(void *opaque,
+                            unsigned long long *count)
+{
+    testDomainObjListBenchData *data = opaque;
+    g_autofree testDomainObjListBenchThread *threads = NULL;
+    size_t started;
+    size_t i;
+
+    threads = g_new0(testDomainObjListBenchThread, data->nthreads);
+
+    for (started = 0; started < data->nthreads; started++) {
+        threads[started].doms = data->doms;
+        threads[started].seed = started;
+
+        if (virThreadCreate(&threads[started].thread, true,
+                            testDomainObjListBenchWorker,
+                            &threads[started]) < 0)
+            break;
+    }
+
+    for (i = 0; i < started; i++)
+        virThreadJoin(&threads[i].thread);
+
+    *count += started * BENCH_LOOKUPS;
+
+    return started == data->nthreads ? 0 : -1;
+}
+
+
+/* Reports the throughput of concurrent lookups of domains by UUID, name
+ * and ID for increasing numbers of threads. */
+static int
+testDomainObjListBench(const void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(virDomainObjList) doms = testDomainObjListNew(NDOMAINS);
+    testDomainObjListBenchData data = { .doms = doms };
+
+    if (!doms)
+        return -1;
+
+    for (data.nthreads = 1; data.nthreads <= 16; data.nthreads *= 2) {
+        g_autofree char *what = g_strdup_printf("%zu threads", data.nthreads);
+        int rc;
+
+        if ((rc = virTestBenchmark(what, "lookups",
+                                   testDomainObjListBenchRound, &data)) != 0)
+            return rc;
+    }
+
+    return 0;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (!(xmlopt = virTestGenericDomainXMLConfInit()))
+        return EXIT_FAILURE;
+
+    if (virTestRun("Lookup", testDomainObjListLookup, NULL) < 0)
+        ret = -1;
+    if (virTestRun("ID reuse", testDomainObjListIDReuse, NULL) < 0)
+        ret = -1;
+    if (virTestRun("Rename", testDomainObjListRename, NULL) < 0)
+        ret = -1;
+    if (virTestRun("Load all configs", testDomainObjListLoadAll, NULL) < 0)
+        ret = -1;
+
+    if (virTestRun("Lookup benchmark", testDomainObjListBench, NULL) < 0)
+        ret = -1;
+
+    virObjectUnref(xmlopt);
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
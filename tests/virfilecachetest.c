@@ -192,6 +192,51 @@ testFileCache(const void *opaque)
 }
 
 
+static int
+testFileCachePrefetch(const void *opaque)
+{
+    virFileCache *cache = (virFileCache *) opaque;
+    testFileCachePriv *testPriv = virFileCacheGetPriv(cache);
+    const char *const names[] = { "cachePrefetch1", "cachePrefetch2", NULL };
+    size_t i;
+
+    testPriv->newData = "ddd\n";
+    testPriv->expectData = "ddd\n";
+
+    virFileCachePrefetch(cache, names, 2);
+
+    /* the lookups must not need to create the data anymore */
+    testPriv->dataSaved = false;
+    testPriv->newData = "eee\n";
+
+    for (i = 0; names[i]; i++) {
+        testFileCacheObj *obj = NULL;
+        bool match;
+
+        if (!(obj = virFileCacheLookup(cache, names[i]))) {
+            fprintf(stderr, "Getting cached data failed.\n");
+            return -1;
+        }
+
+        match = STREQ_NULLABLE(obj->data, "ddd\n");
+        if (!match)
+            fprintf(stderr, "Expect data 'ddd', loaded data '%s'.\n",
+                    NULLSTR(obj->data));
+
+        virObjectUnref(obj);
+        if (!match)
+            return -1;
+    }
+
+    if (testPriv->dataSaved) {
+        fprintf(stderr, "Prefetched data was created again.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static int
 mymain(void)
 {
@@ -220,6 +265,9 @@ mymain(void)
     TEST_RUN("cacheInvalid", "bbb\n", "bbb\n", true);
     TEST_RUN("cacheMissing", "ccc\n", "ccc\n", true);
 
+    if (virTestRun("cachePrefetch", testFileCachePrefetch, cache) < 0)
+        ret = -1;
+
     virObjectUnref(cache);
 
     return ret != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
@@ -603,6 +603,147 @@ testFirewallChainedRollback(const void *opaque G_GNUC_UNUSED)
 }
 
 
+static void
+testFirewallBatchHook(const char *const*args,
+                      const char *const*env G_GNUC_UNUSED,
+                      const char *input,
+                      char **output G_GNUC_UNUSED,
+                      char **error G_GNUC_UNUSED,
+                      int *status,
+                      void *opaque)
+{
+    virBuffer *inputbuf = opaque;
+
+    if (input)
+        virBufferAdd(inputbuf, input, -1);
+
+    /* Fake failure of any command touching this IP addr */
+    if (input && strstr(input, "192.168.122.255"))
+        *status = 1;
+
+    for (; *args; args++) {
+        if (STREQ(*args, "192.168.122.255"))
+            *status = 127;
+    }
+}
+
+
+static int
+testFirewallBatch(const void *opaque G_GNUC_UNUSED)
+{
+    g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
+    g_auto(virBuffer) inputbuf = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virFirewall) fw = virFirewallNew(VIR_FIREWALL_BACKEND_IPTABLES);
+    const char *expected =
+        IPTABLES "-restore -w --noflush\n"
+        IPTABLES "-restore -w --noflush\n"
+        IP6TABLES " -w -A INPUT --jump DROP\n";
+    const char *expectedInput =
+        "*filter\n"
+        "-A INPUT --source 192.168.122.1 --jump ACCEPT\n"
+        "-A INPUT --source !192.168.122.1 --jump REJECT\n"
+        "COMMIT\n"
+        "*nat\n"
+        "-A POSTROUTING --jump MASQUERADE\n"
+        "-A POSTROUTING --source 10.0.0.1 --jump RETURN\n"
+        "COMMIT\n";
+    g_autoptr(virCommandDryRunToken) dryRunToken = virCommandDryRunTokenNew();
+
+    virCommandSetDryRun(dryRunToken, &cmdbuf, false, false,
+                        testFirewallBatchHook, &inputbuf);
+
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_BATCH);
+
+    virFirewallAddCmd(fw, VIR_FIREWALL_LAYER_IPV4,
+                      "-A", "INPUT",
+                      "--source", "192.168.122.1",
+                      "--jump", "ACCEPT", NULL);
+
+    virFirewallAddCmd(fw, VIR_FIREWALL_LAYER_IPV4,
+                      "-A", "INPUT",
+                      "--source", "!192.168.122.1",
+                      "--jump", "REJECT", NULL);
+
+    virFirewallAddCmd(fw, VIR_FIREWALL_LAYER_IPV4,
+                      "--table", "nat",
+                      "-A", "POSTROUTING",
+                      "--jump", "MASQUERADE", NULL);
+
+    virFirewallAddCmd(fw, VIR_FIREWALL_LAYER_IPV4,
+                      "-t", "nat",
+                      "-A", "POSTROUTING",
+                      "--source", "10.0.0.1",
+                      "--jump", "RETURN", NULL);
+
+    virFirewallAddCmd(fw, VIR_FIREWALL_LAYER_IPV6,
+                      "-A", "INPUT",
+                      "--jump", "DROP", NULL);
+
+    if (virFirewallApply(fw) < 0)
+        return -1;
+
+    if (virTestCompareToString(expected, virBufferCurrentContent(&cmdbuf)) < 0) {
+        fprintf(stderr, "Unexpected command execution\n");
+        return -1;
+    }
+
+    if (virTestCompareToString(expectedInput, virBufferCurrentContent(&inputbuf)) < 0) {
+        fprintf(stderr, "Unexpected batch input\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+testFirewallBatchRollback(const void *opaque G_GNUC_UNUSED)
+{
+    g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
+    g_auto(virBuffer) inputbuf = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virFirewall) fw = virFirewallNew(VIR_FIREWALL_BACKEND_IPTABLES);
+    const char *expected =
+        IPTABLES "-restore -w --noflush\n"
+        IPTABLES " -w -A INPUT --source 192.168.122.1 --jump ACCEPT\n"
+        IPTABLES " -w -A INPUT --source 192.168.122.255 --jump REJECT\n"
+        IPTABLES " -w -D INPUT --source 192.168.122.1 --jump ACCEPT\n";
+    g_autoptr(virCommandDryRunToken) dryRunToken = virCommandDryRunTokenNew();
+
+    virCommandSetDryRun(dryRunToken, &cmdbuf, false, false,
+                        testFirewallBatchHook, &inputbuf);
+
+    virFirewallStartTransaction(fw, VIR_FIREWALL_TRANSACTION_BATCH |
+                                    VIR_FIREWALL_TRANSACTION_AUTO_ROLLBACK);
+
+    virFirewallAddCmd(fw, VIR_FIREWALL_LAYER_IPV4,
+                      "-A", "INPUT",
+                      "--source", "192.168.122.1",
+                      "--jump", "ACCEPT", NULL);
+
+    virFirewallAddCmd(fw, VIR_FIREWALL_LAYER_IPV4,
+                      "-A", "INPUT",
+                      "--source", "192.168.122.255",
+                      "--jump", "REJECT", NULL);
+
+    virFirewallAddCmd(fw, VIR_FIREWALL_LAYER_IPV4,
+                      "-A", "INPUT",
+                      "--source", "!192.168.122.1",
+                      "--jump", "REJECT", NULL);
+
+    if (virFirewallApply(fw) == 0) {
+        fprintf(stderr, "Firewall apply unexpectedly worked\n");
+        return -1;
+    }
+
+    if (virTestCompareToString(expected, virBufferCurrentContent(&cmdbuf)) < 0) {
+        fprintf(stderr, "Unexpected command execution\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+
 static const char *expectedLines[] = {
     "Chain INPUT (policy ACCEPT)",
     "target     prot opt source               destination",
@@ -893,6 +1034,8 @@ mymain(void)
     RUN_TEST("single rollback", testFirewallSingleRollback);
     RUN_TEST("many rollback", testFirewallManyRollback);
     RUN_TEST("chained rollback", testFirewallChainedRollback);
+    RUN_TEST("batch", testFirewallBatch);
+    RUN_TEST("batch rollback", testFirewallBatchRollback);
     RUN_TEST("query transaction", testFirewallQuery);
     RUN_TEST("setup private chains", testIPtablesSetupPrivateChains);
 
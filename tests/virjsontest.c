@@ -4,10 +4,14 @@
 
 #include "internal.h"
 #include "virjson.h"
+#include "virstring.h"
 #include "testutils.h"
 
 #define VIR_FROM_THIS VIR_FROM_NONE
 
+/* members of objects at least this big are looked up by the benchmark */
+#define BENCH_OBJECT_MIN_KEYS 100
+
 struct testInfo {
     const char *name;
     const char *doc;
@@ -468,6 +472,220 @@ testJSONObjectFormatSteal(const void *opaque G_GNUC_UNUSED)
 }
 
 
+static int
+testJSONLargeObjectCheck(virJSONValue *json,
+                         size_t first,
+                         size_t last)
+{
+    size_t i;
+
+    for (i = first; i < last; i++) {
+        g_autofree char *key = g_strdup_printf("key%zu", i);
+        unsigned long long val;
+
+        if (virJSONValueObjectGetNumberUlong(json, key, &val) < 0 ||
+            val != i) {
+            VIR_TEST_VERBOSE("lookup of '%s' failed", key);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int
+testJSONLargeObject(const void *opaque G_GNUC_UNUSED)
+{
+    g_autoptr(virJSONValue) json = virJSONValueNewObject();
+    g_autoptr(virJSONValue) copy = NULL;
+    g_autoptr(virJSONValue) removed = NULL;
+    g_autofree char *actual = NULL;
+    const size_t nkeys = 100;
+    size_t i;
+
+    for (i = 0; i < nkeys; i++) {
+        g_autofree char *key = g_strdup_printf("key%zu", i);
+
+        if (virJSONValueObjectAppendNumberUlong(json, key, i) < 0)
+            return -1;
+    }
+
+    if (testJSONLargeObjectCheck(json, 0, nkeys) < 0)
+        return -1;
+
+    if (virJSONValueObjectAppendNumberUlong(json, "key42", 42) == 0) {
+        VIR_TEST_VERBOSE("%s", "duplicate key was accepted");
+        return -1;
+    }
+
+    if (virJSONValueObjectHasKey(json, "key100")) {
+        VIR_TEST_VERBOSE("%s", "unexpected key 'key100' found");
+        return -1;
+    }
+
+    if (virJSONValueObjectRemoveKey(json, "key0", &removed) != 1 ||
+        virJSONValueObjectHasKey(json, "key0")) {
+        VIR_TEST_VERBOSE("%s", "failed to remove 'key0'");
+        return -1;
+    }
+
+    if (testJSONLargeObjectCheck(json, 1, nkeys) < 0)
+        return -1;
+
+    if (virJSONValueObjectPrependString(json, "first", "value") < 0 ||
+        virJSONValueObjectAppendNumberUlong(json, "key0", 0) < 0)
+        return -1;
+
+    if (STRNEQ_NULLABLE(virJSONValueObjectGetKey(json, 0), "first") ||
+        STRNEQ_NULLABLE(virJSONValueObjectGetString(json, "first"), "value")) {
+        VIR_TEST_VERBOSE("%s", "prepended key not found");
+        return -1;
+    }
+
+    if (testJSONLargeObjectCheck(json, 0, nkeys) < 0)
+        return -1;
+
+    copy = virJSONValueCopy(json);
+
+    if (testJSONLargeObjectCheck(copy, 0, nkeys) < 0)
+        return -1;
+
+    if (virJSONValueObjectRemoveKey(json, "key50", NULL) != 1 ||
+        virJSONValueObjectHasKey(json, "key50")) {
+        VIR_TEST_VERBOSE("%s", "failed to remove 'key50'");
+        return -1;
+    }
+
+    if (testJSONLargeObjectCheck(json, 0, 50) < 0 ||
+        testJSONLargeObjectCheck(json, 51, nkeys) < 0)
+        return -1;
+
+    if (!(actual = virJSONValueToString(json, false)) ||
+        !STRPREFIX(actual, "{\"first\":\"value\",\"key1\":1,\"key2\":2,") ||
+        !g_str_has_suffix(actual, "\"key99\":99,\"key0\":0}")) {
+        VIR_TEST_VERBOSE("unexpected member ordering: '%s'", NULLSTR(actual));
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static void
+testJSONBenchCollect(virJSONValue *json,
+                     GPtrArray *objects)
+{
+    size_t n;
+    size_t i;
+
+    switch (virJSONValueGetType(json)) {
+    case VIR_JSON_TYPE_OBJECT:
+        n = virJSONValueObjectKeysNumber(json);
+
+        if (n >= BENCH_OBJECT_MIN_KEYS)
+            g_ptr_array_add(objects, json);
+
+        for (i = 0; i < n; i++)
+            testJSONBenchCollect(virJSONValueObjectGetValue(json, i), objects);
+        break;
+
+    case VIR_JSON_TYPE_ARRAY:
+        n = virJSONValueArraySize(json);
+
+        for (i = 0; i < n; i++)
+            testJSONBenchCollect(virJSONValueArrayGet(json, i), objects);
+        break;
+
+    case VIR_JSON_TYPE_STRING:
+    case VIR_JSON_TYPE_NUMBER:
+    case VIR_JSON_TYPE_BOOLEAN:
+    case VIR_JSON_TYPE_NULL:
+        break;
+    }
+}
+
+
+struct testJSONBenchData {
+    const char *file;
+    GStrv docs;
+};
+
+
+/* Looks up every member of the large objects found in captured monitor
+ * replies (e.g. the properties returned by query-cpu-model-expansion).
+ * The replies are parsed again in every round so that building the lookup
+ * index is accounted for. */
+static int
+testJSONBenchLookupRound(void *opaque,
+                         unsigned long long *count)
+{
+    struct testJSONBenchData *data = opaque;
+    g_autoptr(GPtrArray) replies = NULL;
+    g_autoptr(GPtrArray) objects = g_ptr_array_new();
+    char **doc;
+    size_t i;
+    size_t j;
+
+    replies = g_ptr_array_new_with_free_func((GDestroyNotify) virJSONValueFree);
+
+    for (doc = data->docs; *doc; doc++) {
+        virJSONValue *json;
+
+        if (virStringIsEmpty(*doc))
+            continue;
+
+        if (!(json = virJSONValueFromString(*doc)))
+            return -1;
+
+        g_ptr_array_add(replies, json);
+        testJSONBenchCollect(json, objects);
+    }
+
+    if (objects->len == 0) {
+        VIR_TEST_VERBOSE("no object with at least %d members in '%s'",
+                         BENCH_OBJECT_MIN_KEYS, data->file);
+        return -1;
+    }
+
+    for (i = 0; i < objects->len; i++) {
+        virJSONValue *obj = g_ptr_array_index(objects, i);
+        size_t n = virJSONValueObjectKeysNumber(obj);
+
+        for (j = 0; j < n; j++) {
+            const char *key = virJSONValueObjectGetKey(obj, j);
+
+            if (virJSONValueObjectGet(obj, key) !=
+                virJSONValueObjectGetValue(obj, j)) {
+                VIR_TEST_VERBOSE("lookup of '%s' failed", key);
+                return -1;
+            }
+        }
+
+        *count += n;
+    }
+
+    return 0;
+}
+
+
+static int
+testJSONBenchLookup(const void *opaque)
+{
+    g_autofree char *content = NULL;
+    g_auto(GStrv) docs = NULL;
+    struct testJSONBenchData data = { .file = opaque };
+
+    if (virTestLoadFile(data.file, &content) < 0)
+        return -1;
+
+    data.docs = docs = g_strsplit(content, "\n\n", -1);
+
+    return virTestBenchmark("JSON object member lookup", "lookups",
+                            testJSONBenchLookupRound, &data);
+}
+
+
 static int
 mymain(void)
 {
@@ -574,6 +792,25 @@ mymain(void)
     DO_TEST_PARSE_FAIL("array of an object with an array as a key",
                        "[ {[\"key1\", \"key2\"]: \"value\"} ]");
     DO_TEST_PARSE_FAIL("object with unterminated key", "{ \"key:7 }");
+    DO_TEST_PARSE_FAIL("number with leading zero", "[ 01 ]");
+    DO_TEST_PARSE_FAIL("number with empty fraction", "[ 1. ]");
+    DO_TEST_PARSE_FAIL("trailing comma in array", "[ 1, ]");
+    DO_TEST_PARSE_FAIL("trailing comma in object", "{ \"a\": 1, }");
+    DO_TEST_PARSE_FAIL("unescaped control character", "[ \"a\tb\" ]");
+    DO_TEST_PARSE_FAIL("invalid escape", "[ \"\\x41\" ]");
+
+    DO_TEST_PARSE("unicode escapes", "[\"\\u00e9\\ud83d\\ude00\"]",
+                  "[\"\xc3\xa9\xf0\x9f\x98\x80\"]");
+    DO_TEST_PARSE("duplicate key", "{\"a\":1,\"b\":2,\"a\":3}",
+                  "{\"a\":3,\"b\":2}");
+    DO_TEST_PARSE("duplicate key in large object",
+                  "{\"k0\":0,\"k1\":1,\"k2\":2,\"k3\":3,\"k4\":4,\"k5\":5,"
+                  "\"k6\":6,\"k7\":7,\"k8\":8,\"k9\":9,\"k10\":10,\"k11\":11,"
+                  "\"k12\":12,\"k13\":13,\"k14\":14,\"k15\":15,\"k16\":16,\"k17\":17,"
+                  "\"k3\":42,\"k17\":43}",
+                  "{\"k0\":0,\"k1\":1,\"k2\":2,\"k3\":42,\"k4\":4,\"k5\":5,"
+                  "\"k6\":6,\"k7\":7,\"k8\":8,\"k9\":9,\"k10\":10,\"k11\":11,"
+                  "\"k12\":12,\"k13\":13,\"k14\":14,\"k15\":15,\"k16\":16,\"k17\":43}");
 
     DO_TEST_FULL("lookup on array", Lookup,
                  "[ 1 ]", NULL, false);
@@ -591,6 +828,7 @@ mymain(void)
                  NULL, NULL, true);
     DO_TEST_FULL("stealing of attributes while creating objects",
                  ObjectFormatSteal, NULL, NULL, true);
+    DO_TEST_FULL("lookup in large object", LargeObject, NULL, NULL, true);
 
 #define DO_TEST_DEFLATTEN(name, pass) \
     DO_TEST_FULL(name, Deflatten, NULL, NULL, pass)
@@ -607,6 +845,10 @@ mymain(void)
     DO_TEST_DEFLATTEN("qemu-sheepdog", true);
     DO_TEST_DEFLATTEN("dotted-array", true);
 
+    if (virTestRun("lookup benchmark", testJSONBenchLookup,
+                   abs_srcdir "/qemucapabilitiesdata/caps_9.2.0_x86_64.replies") < 0)
+        ret = -1;
+
     return (ret == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
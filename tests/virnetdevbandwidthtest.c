@@ -23,8 +23,18 @@
 #include "vircommandpriv.h"
 #include "virnetdevbandwidth.h"
 #include "virnetdevopenvswitch.h"
+#include "domain_interface.h"
 #include "netdev_bandwidth_conf.c"
 
+#if defined(WITH_LIBNL)
+# include <linux/pkt_cls.h>
+# include <linux/pkt_sched.h>
+# include <linux/rtnetlink.h>
+
+# define LIBVIRT_VIRNETLINKPRIV_H_ALLOW
+# include "virnetlinkpriv.h"
+#endif
+
 #define VIR_FROM_THIS VIR_FROM_NONE
 
 struct testSetStruct {
@@ -90,7 +100,8 @@ testVirNetDevBandwidthSet(const void *data)
 
         exp_cmd = info->exp_cmd_tc;
 
-        if (virNetDevBandwidthSet(iface, band, flags) < 0)
+        if (virNetDevBandwidthSet(iface, band,
+                                  VIR_NETDEV_BANDWIDTH_BACKEND_TC, flags) < 0)
             return -1;
     }
 
@@ -106,6 +117,397 @@ testVirNetDevBandwidthSet(const void *data)
     return 0;
 }
 
+#if defined(WITH_LIBNL)
+
+typedef struct _testNetlinkData testNetlinkData;
+struct _testNetlinkData {
+    virBuffer buf;
+    int failType; /* message type the kernel refuses, 0 for none */
+};
+
+
+static void
+testNetlinkFormatHandle(virBuffer *buf,
+                        const char *name,
+                        uint32_t handle)
+{
+    virBufferAsprintf(buf, " %s ", name);
+
+    if (handle == TC_H_ROOT)
+        virBufferAddLit(buf, "root");
+    else if (handle == TC_H_INGRESS)
+        virBufferAddLit(buf, "ingress");
+    else
+        virBufferAsprintf(buf, "%x:%x", TC_H_MAJ(handle) >> 16, TC_H_MIN(handle));
+}
+
+
+static void
+testNetlinkFormatRateTable(virBuffer *buf,
+                           const char *name,
+                           const struct tc_ratespec *spec,
+                           struct nlattr *table)
+{
+    const uint32_t *rtab;
+
+    if (!table || nla_len(table) != 256 * sizeof(uint32_t)) {
+        virBufferAsprintf(buf, " %s missing", name);
+        return;
+    }
+
+    rtab = nla_data(table);
+    virBufferAsprintf(buf, " %s %u/%u..%u", name, spec->cell_log,
+                      rtab[0], rtab[255]);
+}
+
+
+static void
+testNetlinkFormatHTB(virBuffer *buf,
+                     struct nlattr *options)
+{
+    struct nlattr *tb[TCA_HTB_MAX + 1];
+    const struct tc_htb_opt *opt;
+    unsigned long long rate;
+    unsigned long long ceil;
+
+    if (!options || nla_parse_nested(tb, TCA_HTB_MAX, options, NULL) < 0)
+        return;
+
+    if (tb[TCA_HTB_INIT]) {
+        const struct tc_htb_glob *glob = nla_data(tb[TCA_HTB_INIT]);
+
+        virBufferAsprintf(buf, " default %x r2q %u", glob->defcls, glob->rate2quantum);
+        return;
+    }
+
+    if (!tb[TCA_HTB_PARMS])
+        return;
+
+    opt = nla_data(tb[TCA_HTB_PARMS]);
+    rate = tb[TCA_HTB_RATE64] ? nla_get_u64(tb[TCA_HTB_RATE64]) : opt->rate.rate;
+    ceil = tb[TCA_HTB_CEIL64] ? nla_get_u64(tb[TCA_HTB_CEIL64]) : opt->ceil.rate;
+
+    virBufferAsprintf(buf, " rate %llu ceil %llu buffer %u cbuffer %u quantum %u",
+                      rate, ceil, opt->buffer, opt->cbuffer, opt->quantum);
+    testNetlinkFormatRateTable(buf, "rtab", &opt->rate, tb[TCA_HTB_RTAB]);
+    testNetlinkFormatRateTable(buf, "ctab", &opt->ceil, tb[TCA_HTB_CTAB]);
+}
+
+
+static void
+testNetlinkFormatU32(virBuffer *buf,
+                     struct nlattr *options)
+{
+    struct nlattr *tb[TCA_U32_MAX + 1];
+    size_t i;
+
+    if (!options || nla_parse_nested(tb, TCA_U32_MAX, options, NULL) < 0)
+        return;
+
+    if (tb[TCA_U32_SEL]) {
+        const struct tc_u32_sel *sel = nla_data(tb[TCA_U32_SEL]);
+
+        for (i = 0; i < sel->nkeys; i++) {
+            virBufferAsprintf(buf, " match %08x/%08x at %d",
+                              ntohl(sel->keys[i].val), ntohl(sel->keys[i].mask),
+                              sel->keys[i].off);
+        }
+
+        if (sel->flags & TC_U32_TERMINAL)
+            virBufferAddLit(buf, " terminal");
+    }
+
+    if (tb[TCA_U32_POLICE]) {
+        struct nlattr *police[TCA_POLICE_MAX + 1];
+        const struct tc_police *p;
+        unsigned long long rate;
+
+        if (nla_parse_nested(police, TCA_POLICE_MAX, tb[TCA_U32_POLICE], NULL) < 0 ||
+            !police[TCA_POLICE_TBF])
+            return;
+
+        p = nla_data(police[TCA_POLICE_TBF]);
+        rate = police[TCA_POLICE_RATE64] ?
+               nla_get_u64(police[TCA_POLICE_RATE64]) : p->rate.rate;
+
+        virBufferAsprintf(buf, " police rate %llu burst %u mtu %u action %d",
+                          rate, p->burst, p->mtu, p->action);
+        testNetlinkFormatRateTable(buf, "rtab", &p->rate, police[TCA_POLICE_RATE]);
+    }
+
+    if (tb[TCA_U32_CLASSID])
+        testNetlinkFormatHandle(buf, "flowid", nla_get_u32(tb[TCA_U32_CLASSID]));
+}
+
+
+/* Records @msg in a tc like notation so that tests can compare what
+ * would have been sent to the kernel. */
+static int
+testNetlinkRecord(struct nlmsghdr *msg,
+                  void *opaque)
+{
+    testNetlinkData *data = opaque;
+    struct nlattr *tb[TCA_MAX + 1];
+    struct tcmsg *tcm = nlmsg_data(msg);
+    const char *object = NULL;
+    const char *kind = NULL;
+
+    switch (msg->nlmsg_type) {
+    case RTM_NEWQDISC:
+    case RTM_DELQDISC:
+        object = "qdisc";
+        break;
+    case RTM_NEWTCLASS:
+    case RTM_DELTCLASS:
+        object = "class";
+        break;
+    case RTM_NEWTFILTER:
+    case RTM_DELTFILTER:
+        object = "filter";
+        break;
+    default:
+        return -EOPNOTSUPP;
+    }
+
+    if (nlmsg_parse(msg, sizeof(*tcm), tb, TCA_MAX, NULL) < 0)
+        return -EINVAL;
+
+    virBufferAsprintf(&data->buf, "%s ", object);
+    if (msg->nlmsg_type == RTM_DELQDISC ||
+        msg->nlmsg_type == RTM_DELTCLASS ||
+        msg->nlmsg_type == RTM_DELTFILTER)
+        virBufferAddLit(&data->buf, "del");
+    else if (msg->nlmsg_flags & NLM_F_CREATE)
+        virBufferAddLit(&data->buf, "add");
+    else
+        virBufferAddLit(&data->buf, "change");
+
+    virBufferAsprintf(&data->buf, " dev %d", tcm->tcm_ifindex);
+    testNetlinkFormatHandle(&data->buf, "parent", tcm->tcm_parent);
+
+    if (STREQ(object, "filter")) {
+        virBufferAsprintf(&data->buf, " handle %x prio %u protocol 0x%04x",
+                          tcm->tcm_handle, TC_H_MAJ(tcm->tcm_info) >> 16,
+                          ntohs(TC_H_MIN(tcm->tcm_info)));
+    } else {
+        testNetlinkFormatHandle(&data->buf, "handle", tcm->tcm_handle);
+    }
+
+    if (tb[TCA_KIND]) {
+        kind = nla_get_string(tb[TCA_KIND]);
+        virBufferAsprintf(&data->buf, " %s", kind);
+    }
+
+    if (STREQ_NULLABLE(kind, "htb")) {
+        testNetlinkFormatHTB(&data->buf, tb[TCA_OPTIONS]);
+    } else if (STREQ_NULLABLE(kind, "sfq") && tb[TCA_OPTIONS]) {
+        const struct tc_sfq_qopt *opt = nla_data(tb[TCA_OPTIONS]);
+
+        virBufferAsprintf(&data->buf, " perturb %d", opt->perturb_period);
+    } else if (STREQ_NULLABLE(kind, "fw") && tb[TCA_OPTIONS]) {
+        struct nlattr *fw[TCA_FW_MAX + 1];
+
+        if (nla_parse_nested(fw, TCA_FW_MAX, tb[TCA_OPTIONS], NULL) == 0 &&
+            fw[TCA_FW_CLASSID])
+            testNetlinkFormatHandle(&data->buf, "flowid",
+                                    nla_get_u32(fw[TCA_FW_CLASSID]));
+    } else if (STREQ_NULLABLE(kind, "u32")) {
+        testNetlinkFormatU32(&data->buf, tb[TCA_OPTIONS]);
+    }
+
+    virBufferAddLit(&data->buf, "\n");
+
+    /* Deleting from a pristine interface fails, just like it would in
+     * real world. */
+    if (msg->nlmsg_type == RTM_DELQDISC ||
+        msg->nlmsg_type == RTM_DELTCLASS ||
+        msg->nlmsg_type == RTM_DELTFILTER)
+        return -ENOENT;
+
+    if (msg->nlmsg_type == data->failType)
+        return -EINVAL;
+
+    return 0;
+}
+
+
+struct testNetlinkStruct {
+    const char *band;
+    const char *exp;
+    bool hierarchical_class;
+    int failType;
+};
+
+static int
+testVirNetDevBandwidthSetNetlink(const void *data)
+{
+    const struct testNetlinkStruct *info = data;
+    unsigned int flags = VIR_NETDEV_BANDWIDTH_SET_DIR_SWAPPED |
+                         VIR_NETDEV_BANDWIDTH_SET_CLEAR_ALL;
+    g_autoptr(virNetDevBandwidth) band = NULL;
+    g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virCommandDryRunToken) dryRunToken = virCommandDryRunTokenNew();
+    testNetlinkData nl = { VIR_BUFFER_INITIALIZER, info->failType };
+    g_autofree char *actual = NULL;
+    int rc;
+
+    if (testVirNetDevBandwidthParse(&band, info->band) < 0)
+        return -1;
+
+    if (info->hierarchical_class)
+        flags |= VIR_NETDEV_BANDWIDTH_SET_HIERARCHICAL_CLASS;
+
+    /* Any tc invocation means we have fallen back */
+    virCommandSetDryRun(dryRunToken, &cmdbuf, false, false, NULL, NULL);
+    virNetlinkSetDryRun(testNetlinkRecord, &nl);
+
+    rc = virNetDevBandwidthSet("eth0", band,
+                               VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK, flags);
+
+    virNetlinkSetDryRun(NULL, NULL);
+    actual = virBufferContentAndReset(&nl.buf);
+
+    if (info->failType) {
+        if (rc == 0) {
+            VIR_TEST_VERBOSE("kernel failure was not detected");
+            return -1;
+        }
+        virResetLastError();
+    } else if (rc < 0) {
+        return -1;
+    }
+
+    if (virBufferUse(&cmdbuf) > 0) {
+        VIR_TEST_VERBOSE("unexpected tc invocation: %s",
+                         virBufferCurrentContent(&cmdbuf));
+        return -1;
+    }
+
+    return virTestCompareToString(info->exp, actual);
+}
+
+static int
+testVirNetDevBandwidthPlugNetlink(const void *data G_GNUC_UNUSED)
+{
+    g_autoptr(virNetDevBandwidth) net_band = NULL;
+    g_autoptr(virNetDevBandwidth) band = NULL;
+    testNetlinkData nl = { VIR_BUFFER_INITIALIZER, 0 };
+    g_autofree char *actual = NULL;
+    virMacAddr mac;
+    int rc = -1;
+    const char *exp =
+        "class add dev 42 parent 1:1 handle 1:3 htb rate 200000 ceil 5000000"
+            " buffer 125000 cbuffer 5000 quantum 1 rtab 3/625..160000 ctab 3/15..6390\n"
+        "qdisc add dev 42 parent 1:3 handle 3:0 sfq perturb 10\n"
+        "filter add dev 42 parent 0:0 handle 80000803 prio 2 protocol 0x0800 u32"
+            " match 00000800/0000ffff at -4 match 00123456/ffffffff at -12"
+            " match 00005254/0000ffff at -16 terminal flowid 1:3\n"
+        "class change dev 42 parent 0:0 handle 1:3 htb rate 500000 ceil 5000000"
+            " buffer 50000 cbuffer 5000 quantum 85 rtab 3/250..64000 ctab 3/15..6390\n"
+        "filter del dev 42 parent 0:0 handle 80000803 prio 2 protocol 0x0000 u32\n"
+        "filter add dev 42 parent 0:0 handle 80000803 prio 2 protocol 0x0800 u32"
+            " match 00000800/0000ffff at -4 match 00123456/ffffffff at -12"
+            " match 00005254/0000ffff at -16 terminal flowid 1:3\n"
+        "qdisc del dev 42 parent 0:0 handle 3:0\n"
+        "filter del dev 42 parent 0:0 handle 80000803 prio 2 protocol 0x0000 u32\n"
+        "class del dev 42 parent 0:0 handle 1:3\n";
+
+    if (testVirNetDevBandwidthParse(&net_band,
+                                    "<bandwidth>"
+                                    "  <inbound average='1000' peak='5000'/>"
+                                    "</bandwidth>") < 0 ||
+        testVirNetDevBandwidthParse(&band,
+                                    "<bandwidth>"
+                                    "  <inbound floor='200'/>"
+                                    "</bandwidth>") < 0 ||
+        virMacAddrParse("52:54:00:12:34:56", &mac) < 0)
+        return -1;
+
+    virNetlinkSetDryRun(testNetlinkRecord, &nl);
+
+    if (virNetDevBandwidthPlug("br0", net_band, &mac, band, 3,
+                               VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) < 0 ||
+        virNetDevBandwidthUpdateRate("br0", 3, net_band, 500,
+                                     VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) < 0 ||
+        virNetDevBandwidthUpdateFilter("br0", &mac, 3,
+                                       VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) < 0 ||
+        virNetDevBandwidthUnplug("br0", 3,
+                                 VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) < 0)
+        goto cleanup;
+
+    rc = 0;
+
+ cleanup:
+    virNetlinkSetDryRun(NULL, NULL);
+    actual = virBufferContentAndReset(&nl.buf);
+
+    if (rc < 0)
+        return -1;
+
+    return virTestCompareToString(exp, actual);
+}
+
+
+/* QoS of guest interfaces follows the bandwidth_backend of the
+ * hypervisor driver, without ever spawning tc. */
+static int
+testVirDomainInterfaceQoSNetlink(const void *data G_GNUC_UNUSED)
+{
+    g_autoptr(virDomainDef) def = virDomainDefNew(NULL);
+    g_autoptr(virDomainNetDef) net = g_new0(virDomainNetDef, 1);
+    g_auto(virBuffer) cmdbuf = VIR_BUFFER_INITIALIZER;
+    g_autoptr(virCommandDryRunToken) dryRunToken = virCommandDryRunTokenNew();
+    testNetlinkData nl = { VIR_BUFFER_INITIALIZER, 0 };
+    g_autofree char *actual = NULL;
+    int rc = -1;
+    const char *exp =
+        "qdisc del dev 42 parent root handle 0:0\n"
+        "qdisc del dev 42 parent ingress handle ffff:0 ingress\n"
+        "qdisc add dev 42 parent root handle 1:0 htb default 1 r2q 10\n"
+        "class add dev 42 parent 1:0 handle 1:1 htb rate 1024000 ceil 1024000"
+           " buffer 24406 cbuffer 24406 quantum 87 rtab 3/109..31250 ctab 3/109..31250\n"
+        "qdisc add dev 42 parent 1:1 handle 2:0 sfq perturb 10\n"
+        "filter add dev 42 parent 1:0 handle 1 prio 1 protocol 0x0003 fw flowid 0:1\n"
+        "qdisc del dev 42 parent root handle 0:0\n"
+        "qdisc del dev 42 parent ingress handle ffff:0 ingress\n";
+
+    net->type = VIR_DOMAIN_NET_TYPE_BRIDGE;
+    net->ifname = g_strdup("vnet0");
+
+    if (testVirNetDevBandwidthParse(&net->bandwidth,
+                                    "<bandwidth>"
+                                    "  <inbound average='1024'/>"
+                                    "</bandwidth>") < 0)
+        return -1;
+
+    virCommandSetDryRun(dryRunToken, &cmdbuf, false, false, NULL, NULL);
+    virNetlinkSetDryRun(testNetlinkRecord, &nl);
+
+    if (virDomainInterfaceSetQoS(def, net,
+                                 VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) < 0 ||
+        virDomainInterfaceClearQoS(def, net,
+                                   VIR_NETDEV_BANDWIDTH_BACKEND_NETLINK) < 0)
+        goto cleanup;
+
+    rc = 0;
+
+ cleanup:
+    virNetlinkSetDryRun(NULL, NULL);
+    actual = virBufferContentAndReset(&nl.buf);
+
+    if (rc < 0)
+        return -1;
+
+    if (virBufferUse(&cmdbuf) > 0) {
+        VIR_TEST_VERBOSE("unexpected tc invocation: %s",
+                         virBufferCurrentContent(&cmdbuf));
+        return -1;
+    }
+
+    return virTestCompareToString(exp, actual);
+}
+#endif /* defined(WITH_LIBNL) */
+
 static int
 mymain(void)
 {
@@ -219,6 +621,108 @@ mymain(void)
                            " 'external-ids:ifname=\"eth0\"'\n"
                 "ovs-vsctl --timeout=5 set Interface eth0 ingress_policing_rate=34359738360\n");
 
+#if defined(WITH_LIBNL)
+# define DO_TEST_SET_NETLINK(Band, Exp, ...) \
+    do { \
+        struct testNetlinkStruct data = {.band = Band, \
+                                         .exp = Exp, \
+                                         __VA_ARGS__}; \
+        if (virTestRun("virNetDevBandwidthSet netlink", \
+                       testVirNetDevBandwidthSetNetlink, \
+                       &data) < 0) { \
+            ret = -1; \
+        } \
+    } while (0)
+
+    DO_TEST_SET_NETLINK("<bandwidth>"
+                        "  <inbound average='1024'/>"
+                        "</bandwidth>",
+                        "qdisc del dev 42 parent root handle 0:0\n"
+                        "qdisc del dev 42 parent ingress handle ffff:0 ingress\n"
+                        "qdisc add dev 42 parent root handle 1:0 htb default 1 r2q 10\n"
+                        "class add dev 42 parent 1:0 handle 1:1 htb rate 1024000 ceil 1024000"
+                           " buffer 24406 cbuffer 24406 quantum 87 rtab 3/109..31250 ctab 3/109..31250\n"
+                        "qdisc add dev 42 parent 1:1 handle 2:0 sfq perturb 10\n"
+                        "filter add dev 42 parent 1:0 handle 1 prio 1 protocol 0x0003 fw flowid 0:1\n");
+
+    DO_TEST_SET_NETLINK("<bandwidth>"
+                        "  <outbound average='1024'/>"
+                        "</bandwidth>",
+                        "qdisc del dev 42 parent root handle 0:0\n"
+                        "qdisc del dev 42 parent ingress handle ffff:0 ingress\n"
+                        "qdisc add dev 42 parent ingress handle ffff:0 ingress\n"
+                        "filter add dev 42 parent ffff:0 handle 0 prio 0 protocol 0x0003 u32"
+                           " match 00000000/00000000 at 0 terminal police rate 1024000 burst 16000000"
+                           " mtu 65536 action 2 rtab 9/7812..2000000 flowid 0:1\n");
+
+    DO_TEST_SET_NETLINK("<bandwidth>"
+                        "  <inbound average='1' peak='2' floor='3' burst='4'/>"
+                        "  <outbound average='5' peak='6' burst='7'/>"
+                        "</bandwidth>",
+                        "qdisc del dev 42 parent root handle 0:0\n"
+                        "qdisc del dev 42 parent ingress handle ffff:0 ingress\n"
+                        "qdisc add dev 42 parent root handle 1:0 htb default 1 r2q 10\n"
+                        "class add dev 42 parent 1:0 handle 1:1 htb rate 1000 ceil 2000"
+                           " buffer 64000000 cbuffer 12500000 quantum 1"
+                           " rtab 3/125000..32000000 ctab 3/62500..16000000\n"
+                        "qdisc add dev 42 parent 1:1 handle 2:0 sfq perturb 10\n"
+                        "filter add dev 42 parent 1:0 handle 1 prio 1 protocol 0x0003 fw flowid 0:1\n"
+                        "qdisc add dev 42 parent ingress handle ffff:0 ingress\n"
+                        "filter add dev 42 parent ffff:0 handle 0 prio 0 protocol 0x0003 u32"
+                           " match 00000000/00000000 at 0 terminal police rate 5000 burst 22400000"
+                           " mtu 65536 action 2 rtab 9/1600000..409600000 flowid 0:1\n");
+
+    DO_TEST_SET_NETLINK("<bandwidth>"
+                        "  <inbound average='4294967295'/>"
+                        "  <outbound average='4294967295'/>"
+                        "</bandwidth>",
+                        "qdisc del dev 42 parent root handle 0:0\n"
+                        "qdisc del dev 42 parent ingress handle ffff:0 ingress\n"
+                        "qdisc add dev 42 parent root handle 1:0 htb default 1 r2q 10\n"
+                        "class add dev 42 parent 1:0 handle 1:1 htb rate 4294967295000 ceil 4294967295000"
+                           " buffer 0 cbuffer 0 quantum 366503875 rtab 3/0..0 ctab 3/0..0\n"
+                        "qdisc add dev 42 parent 1:1 handle 2:0 sfq perturb 10\n"
+                        "filter add dev 42 parent 1:0 handle 1 prio 1 protocol 0x0003 fw flowid 0:1\n"
+                        "qdisc add dev 42 parent ingress handle ffff:0 ingress\n"
+                        "filter add dev 42 parent ffff:0 handle 0 prio 0 protocol 0x0003 u32"
+                           " match 00000000/00000000 at 0 terminal police rate 4294967295000 burst 15609"
+                           " mtu 65536 action 2 rtab 9/0..0 flowid 0:1\n");
+
+    DO_TEST_SET_NETLINK("<bandwidth>"
+                        "  <inbound average='1000' peak='5000'/>"
+                        "</bandwidth>",
+                        "qdisc del dev 42 parent root handle 0:0\n"
+                        "qdisc del dev 42 parent ingress handle ffff:0 ingress\n"
+                        "qdisc add dev 42 parent root handle 1:0 htb default 2 r2q 10\n"
+                        "class add dev 42 parent 1:0 handle 1:1 htb rate 1000000 ceil 5000000"
+                           " buffer 25000 cbuffer 5000 quantum 85 rtab 3/125..32000 ctab 3/15..6390\n"
+                        "class add dev 42 parent 1:1 handle 1:2 htb rate 1000000 ceil 5000000"
+                           " buffer 25000 cbuffer 5000 quantum 85 rtab 3/125..32000 ctab 3/15..6390\n"
+                        "qdisc add dev 42 parent 1:2 handle 2:0 sfq perturb 10\n"
+                        "filter add dev 42 parent 1:0 handle 1 prio 1 protocol 0x0003 fw flowid 0:1\n",
+                        .hierarchical_class = true);
+
+    /* The whole batch is processed even if the kernel refuses a message */
+    DO_TEST_SET_NETLINK("<bandwidth>"
+                        "  <inbound average='1024'/>"
+                        "</bandwidth>",
+                        "qdisc del dev 42 parent root handle 0:0\n"
+                        "qdisc del dev 42 parent ingress handle ffff:0 ingress\n"
+                        "qdisc add dev 42 parent root handle 1:0 htb default 1 r2q 10\n"
+                        "class add dev 42 parent 1:0 handle 1:1 htb rate 1024000 ceil 1024000"
+                           " buffer 24406 cbuffer 24406 quantum 87 rtab 3/109..31250 ctab 3/109..31250\n"
+                        "qdisc add dev 42 parent 1:1 handle 2:0 sfq perturb 10\n"
+                        "filter add dev 42 parent 1:0 handle 1 prio 1 protocol 0x0003 fw flowid 0:1\n",
+                        .failType = RTM_NEWTCLASS);
+
+    if (virTestRun("virNetDevBandwidthPlug netlink",
+                   testVirNetDevBandwidthPlugNetlink, NULL) < 0)
+        ret = -1;
+    if (virTestRun("virDomainInterfaceSetQoS netlink",
+                   testVirDomainInterfaceQoSNetlink, NULL) < 0)
+        ret = -1;
+#endif /* defined(WITH_LIBNL) */
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
@@ -510,6 +510,153 @@ static int testMessagePayloadStreamEncode(const void *args G_GNUC_UNUSED)
     return ret;
 }
 
+static int testMessageBufferReuse(const void *args G_GNUC_UNUSED)
+{
+    g_autofree char *data = g_new0(char, VIR_NET_MESSAGE_INITIAL);
+    virNetMessageBufferStats before;
+    virNetMessageBufferStats after;
+    virNetMessage *msg = virNetMessageNew(true);
+    char *buffer;
+    int ret = -1;
+
+    virNetMessageGetBufferStats(&before);
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    /* A freed buffer is handed out again for the next message */
+    buffer = msg->buffer;
+    virNetMessageFree(msg);
+    msg = virNetMessageNew(true);
+    msg->header.prog = 0x11223344;
+
+    if (virNetMessageEncodeHeader(msg) < 0)
+        goto cleanup;
+
+    if (msg->buffer != buffer) {
+        VIR_DEBUG("Expected buffer %p to be reused, got %p", buffer, msg->buffer);
+        goto cleanup;
+    }
+
+    /* Growing the buffer keeps the header */
+    memset(data, 'x', VIR_NET_MESSAGE_INITIAL);
+    if (virNetMessageEncodePayloadRaw(msg, data, VIR_NET_MESSAGE_INITIAL) < 0)
+        goto cleanup;
+
+    if (msg->bufferCapacity != 2 * VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX ||
+        msg->buffer[VIR_NET_MESSAGE_LEN_MAX] != 0x11 ||
+        msg->buffer[msg->bufferLength - 1] != 'x') {
+        VIR_DEBUG("Unexpected buffer capacity %zu or contents",
+                  msg->bufferCapacity);
+        goto cleanup;
+    }
+
+    /* The length word of an incoming message is read outside the pool,
+     * the message itself goes into a pooled buffer */
+    virNetMessageClear(msg);
+    msg->bufferLength = VIR_NET_MESSAGE_LEN_MAX;
+    msg->buffer = g_new0(char, msg->bufferLength);
+    msg->buffer[3] = 0x1c;
+
+    if (virNetMessageDecodeLength(msg) < 0)
+        goto cleanup;
+
+    if (msg->bufferCapacity != VIR_NET_MESSAGE_INITIAL + VIR_NET_MESSAGE_LEN_MAX ||
+        msg->bufferLength != 0x1c || msg->bufferOffset != VIR_NET_MESSAGE_LEN_MAX ||
+        msg->buffer[3] != 0x1c) {
+        VIR_DEBUG("Unexpected buffer capacity %zu or contents",
+                  msg->bufferCapacity);
+        goto cleanup;
+    }
+
+    virNetMessageFree(g_steal_pointer(&msg));
+    virNetMessageGetBufferStats(&after);
+
+    if (after.reused - before.reused < 1 ||
+        after.cached - before.cached > 2) {
+        VIR_DEBUG("Unexpected buffer stats: reused %llu cached %llu",
+                  after.reused - before.reused, after.cached - before.cached);
+        goto cleanup;
+    }
+
+    ret = 0;
+ cleanup:
+    virNetMessageFree(msg);
+    return ret;
+}
+
+
+struct testMessageBufferBenchData {
+    const char *data;
+    size_t len;
+    bool pooled;
+};
+
+
+static int testMessageBufferBenchRound(void *opaque,
+                                       unsigned long long *count)
+{
+    struct testMessageBufferBenchData *data = opaque;
+    virNetMessage *msg = virNetMessageNew(true);
+    int rc;
+
+    if (!data->pooled)
+        msg->buffer = g_new0(char, VIR_NET_MESSAGE_LEN_MAX);
+
+    msg->header.type = VIR_NET_STREAM;
+    rc = virNetMessageEncodeHeader(msg);
+    if (rc == 0)
+        rc = virNetMessageEncodePayloadRaw(msg, data->data, data->len);
+    virNetMessageFree(msg);
+
+    if (rc < 0)
+        return -1;
+
+    (*count)++;
+    return 0;
+}
+
+
+/* Reports the rate at which messages can be encoded and freed, with the
+ * buffers taken from the pool and with buffers allocated by the caller,
+ * which are reallocated like before the pool existed. */
+static int testMessageBufferBench(const void *args G_GNUC_UNUSED)
+{
+    static const size_t sizes[] = { 1024, 256 * 1024 };
+    size_t i;
+
+    for (i = 0; i < G_N_ELEMENTS(sizes); i++) {
+        g_autofree char *payload = g_new0(char, sizes[i]);
+        struct testMessageBufferBenchData data = { payload, sizes[i], false };
+        size_t pooled;
+
+        for (pooled = 0; pooled < 2; pooled++) {
+            g_autofree char *what = NULL;
+            virNetMessageBufferStats before;
+            virNetMessageBufferStats after;
+            int rc;
+
+            data.pooled = pooled;
+            what = g_strdup_printf("%zu bytes %s", sizes[i],
+                                   pooled ? "pooled" : "unpooled");
+
+            virNetMessageGetBufferStats(&before);
+
+            if ((rc = virTestBenchmark(what, "msgs",
+                                       testMessageBufferBenchRound, &data)) != 0)
+                return rc;
+
+            virNetMessageGetBufferStats(&after);
+
+            VIR_TEST_DEBUG("%s: %llu allocated, %llu reused", what,
+                           after.allocated - before.allocated,
+                           after.reused - before.reused);
+        }
+    }
+
+    return 0;
+}
+
 
 static int
 mymain(void)
@@ -535,6 +682,12 @@ mymain(void)
     if (virTestRun("Message Payload Stream Encode", testMessagePayloadStreamEncode, NULL) < 0)
         ret = -1;
 
+    if (virTestRun("Message Buffer Reuse", testMessageBufferReuse, NULL) < 0)
+        ret = -1;
+
+    if (virTestRun("Message Buffer Benchmark", testMessageBufferBench, NULL) < 0)
+        ret = -1;
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
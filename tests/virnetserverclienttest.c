@@ -142,6 +142,85 @@ static int testIdentity(const void *opaque G_GNUC_UNUSED)
 }
 
 
+static int testCallStats(const void *opaque G_GNUC_UNUSED)
+{
+    int sv[2];
+    int ret = -1;
+    virNetSocket *sock = NULL;
+    virNetServerClient *client = NULL;
+    g_autofree virNetServerClientCallStats *stats = NULL;
+    size_t nstats = 0;
+    unsigned long long expected[][VIR_NET_SERVER_CLIENT_CALL_BUCKETS] = {
+        { 2, 0, 0, 0, 0, 1 },
+        { 0, 0, 1, 0, 0, 0 },
+    };
+    size_t i;
+    size_t j;
+
+    if (socketpair(PF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        virReportSystemError(errno, "%s",
+                             "Cannot create socket pair");
+        return -1;
+    }
+
+    if (virNetSocketNewConnectSockFD(sv[0], &sock) < 0) {
+        virDispatchError(NULL);
+        goto cleanup;
+    }
+    sv[0] = -1;
+
+    if (!(client = virNetServerClientNew(1, sock, 0, false, 1,
+                                         NULL,
+                                         testClientNew,
+                                         NULL,
+                                         testClientFree,
+                                         NULL))) {
+        virDispatchError(NULL);
+        goto cleanup;
+    }
+
+    virNetServerClientRecordCall(client, 1, 2, 10);
+    virNetServerClientRecordCall(client, 1, 3, 50000);
+    virNetServerClientRecordCall(client, 1, 2, 1000);
+    virNetServerClientRecordCall(client, 1, 2, 3600000000ULL);
+
+    virNetServerClientGetCallStats(client, &stats, &nstats);
+
+    if (nstats != 2 ||
+        stats[0].prog != 1 || stats[0].proc != 2 ||
+        stats[1].prog != 1 || stats[1].proc != 3) {
+        fprintf(stderr, "Unexpected procedures in call statistics\n");
+        goto cleanup;
+    }
+
+    if (stats[0].calls != 3 || stats[0].time != 3600001010ULL) {
+        fprintf(stderr, "Want 3 calls taking 3600001010 us, got %llu taking %llu us\n",
+                stats[0].calls, stats[0].time);
+        goto cleanup;
+    }
+
+    for (i = 0; i < nstats; i++) {
+        for (j = 0; j < VIR_NET_SERVER_CLIENT_CALL_BUCKETS; j++) {
+            if (stats[i].buckets[j] != expected[i][j]) {
+                fprintf(stderr, "Want %llu calls in bucket %zu of proc %u, got %llu\n",
+                        expected[i][j], j, stats[i].proc, stats[i].buckets[j]);
+                goto cleanup;
+            }
+        }
+    }
+
+    ret = 0;
+ cleanup:
+    virObjectUnref(sock);
+    if (client)
+        virNetServerClientClose(client);
+    virObjectUnref(client);
+    VIR_FORCE_CLOSE(sv[0]);
+    VIR_FORCE_CLOSE(sv[1]);
+    return ret;
+}
+
+
 static int
 mymain(void)
 {
@@ -152,6 +231,10 @@ mymain(void)
                    testIdentity, NULL) < 0)
         ret = -1;
 
+    if (virTestRun("Call statistics",
+                   testCallStats, NULL) < 0)
+        ret = -1;
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 VIR_TEST_MAIN_PRELOAD(mymain, VIR_TEST_MOCK("virnetserverclient"))
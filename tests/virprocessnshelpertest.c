@@ -0,0 +1,335 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include "testutils.h"
+
+#include "virfile.h"
+#include "virprocess.h"
+#include "virthread.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+#if defined(__linux__) && defined(F_OFD_SETLK)
+
+typedef struct _testNsData testNsData;
+struct _testNsData {
+    unsigned long long thread; /* thread the callback ran in */
+    int ret;
+    bool fail;
+};
+
+
+static int
+testNsCallback(pid_t pid G_GNUC_UNUSED,
+               void *opaque)
+{
+    testNsData *data = opaque;
+
+    data->thread = virThreadSelfID();
+
+    if (data->fail) {
+        virReportError(VIR_ERR_INTERNAL_ERROR, "%s", "callback failed");
+        return -1;
+    }
+
+    return data->ret;
+}
+
+
+static int
+testNsHelperRun(const void *opaque G_GNUC_UNUSED)
+{
+    virProcessNamespaceHelper *helper = NULL;
+    testNsData data = { .ret = 7 };
+    int rc;
+    int ret = -1;
+
+    if (!(helper = virProcessNamespaceHelperNew(getpid())))
+        return -1;
+
+    if ((rc = virProcessRunInNamespaceHelper(getpid(), testNsCallback, &data)) != 7) {
+        VIR_TEST_DEBUG("Unexpected return value %d", rc);
+        goto cleanup;
+    }
+
+    /* A forked child would not change @data of the caller */
+    if (data.thread == 0 || data.thread == virThreadSelfID()) {
+        VIR_TEST_DEBUG("Callback didn't run in the helper thread");
+        goto cleanup;
+    }
+
+    data.fail = true;
+    if (virProcessRunInNamespaceHelper(getpid(), testNsCallback, &data) != -1) {
+        VIR_TEST_DEBUG("Failure of the callback not reported");
+        goto cleanup;
+    }
+
+    if (!strstr(virGetLastErrorMessage(), "callback failed")) {
+        VIR_TEST_DEBUG("Unexpected error: %s", virGetLastErrorMessage());
+        goto cleanup;
+    }
+    virResetLastError();
+
+    ret = 0;
+
+ cleanup:
+    virProcessNamespaceHelperClose(helper);
+    return ret;
+}
+
+
+static int
+testNsLockCallback(pid_t pid G_GNUC_UNUSED,
+                   void *opaque)
+{
+    const char *path = opaque;
+    VIR_AUTOCLOSE fd = -1;
+    int rc;
+
+    if ((fd = open(path, O_RDWR)) < 0)
+        return -1;
+
+    /* closing @fd releases the lock */
+    if ((rc = virFileLockOFD(fd, false, 0, 1, false)) < 0)
+        return rc == -EAGAIN || rc == -EACCES ? 1 : -1;
+
+    return 0;
+}
+
+
+/* The metadata lock taken by a thread of the daemon must exclude the
+ * helper thread, which a process-wide POSIX lock would not do. */
+static int
+testNsHelperLock(const void *opaque G_GNUC_UNUSED)
+{
+    virProcessNamespaceHelper *helper = NULL;
+    char path[] = abs_builddir "/virprocessnshelper-lock.XXXXXX";
+    VIR_AUTOCLOSE fd = -1;
+    int rc;
+    int ret = -1;
+
+    if ((fd = g_mkstemp_full(path, O_RDWR | O_CLOEXEC, S_IRUSR | S_IWUSR)) < 0)
+        return -1;
+
+    if (!(helper = virProcessNamespaceHelperNew(getpid())))
+        goto cleanup;
+
+    if (virFileLockOFD(fd, false, 0, 1, false) < 0) {
+        VIR_TEST_DEBUG("Unable to lock %s", path);
+        goto cleanup;
+    }
+
+    if ((rc = virProcessRunInNamespaceHelper(getpid(), testNsLockCallback, path)) != 1) {
+        VIR_TEST_DEBUG("Lock held by the caller didn't block the helper: %d", rc);
+        goto cleanup;
+    }
+
+    if (virFileUnlockOFD(fd, 0, 1) < 0) {
+        VIR_TEST_DEBUG("Unable to unlock %s", path);
+        goto cleanup;
+    }
+
+    if ((rc = virProcessRunInNamespaceHelper(getpid(), testNsLockCallback, path)) != 0) {
+        VIR_TEST_DEBUG("Helper couldn't lock the released file: %d", rc);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    virProcessNamespaceHelperClose(helper);
+    unlink(path);
+    return ret;
+}
+
+
+typedef struct _testNsBlockData testNsBlockData;
+struct _testNsBlockData {
+    int started[2];
+    int release[2];
+    int rc;
+};
+
+
+static int
+testNsBlockCallback(pid_t pid G_GNUC_UNUSED,
+                    void *opaque)
+{
+    testNsBlockData *data = opaque;
+    char c = 0;
+
+    if (safewrite(data->started[1], &c, 1) != 1 ||
+        saferead(data->release[0], &c, 1) != 1)
+        return -1;
+
+    return 0;
+}
+
+
+static void
+testNsBlockRunner(void *opaque)
+{
+    testNsBlockData *data = opaque;
+
+    data->rc = virProcessRunInNamespaceHelper(getpid(), testNsBlockCallback, data);
+}
+
+
+static void
+testNsBlockCloser(void *opaque)
+{
+    virProcessNamespaceHelperClose(opaque);
+}
+
+
+/* Stopping the helper lets the running callback finish, and callbacks
+ * run afterwards fall back to a forked child. */
+static int
+testNsHelperStop(const void *opaque G_GNUC_UNUSED)
+{
+    virProcessNamespaceHelper *helper = NULL;
+    testNsBlockData block = { .started = { -1, -1 }, .release = { -1, -1 }, .rc = -1 };
+    testNsData data = { .ret = 7 };
+    virThread runner;
+    virThread closer;
+    bool stopping = false;
+    char c = 0;
+    int rc;
+    int ret = -1;
+
+    if (virPipe(block.started) < 0 ||
+        virPipe(block.release) < 0)
+        goto cleanup;
+
+    if (!(helper = virProcessNamespaceHelperNew(getpid())))
+        goto cleanup;
+
+    if (virThreadCreate(&runner, true, testNsBlockRunner, &block) < 0) {
+        virProcessNamespaceHelperClose(helper);
+        goto cleanup;
+    }
+
+    /* stop the helper while the callback is running */
+    if (saferead(block.started[0], &c, 1) == 1 &&
+        virThreadCreate(&closer, true, testNsBlockCloser, helper) == 0)
+        stopping = true;
+
+    ignore_value(safewrite(block.release[1], &c, 1));
+    virThreadJoin(&runner);
+
+    if (!stopping) {
+        VIR_TEST_DEBUG("Unable to stop the helper");
+        virProcessNamespaceHelperClose(helper);
+        goto cleanup;
+    }
+
+    virThreadJoin(&closer);
+
+    if (block.rc != 0) {
+        VIR_TEST_DEBUG("Callback running while stopping the helper failed");
+        goto cleanup;
+    }
+
+    if ((rc = virProcessRunInNamespaceHelper(getpid(), testNsCallback, &data)) != 7) {
+        VIR_TEST_DEBUG("Unexpected return value %d", rc);
+        goto cleanup;
+    }
+
+    if (data.thread != 0) {
+        VIR_TEST_DEBUG("Callback didn't run in a forked child");
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    VIR_FORCE_CLOSE(block.started[0]);
+    VIR_FORCE_CLOSE(block.started[1]);
+    VIR_FORCE_CLOSE(block.release[0]);
+    VIR_FORCE_CLOSE(block.release[1]);
+    return ret;
+}
+
+
+/* The helper can't be started for a process which is gone, and running
+ * callbacks for it fails rather than using a helper of another process. */
+static int
+testNsHelperDeadProcess(const void *opaque G_GNUC_UNUSED)
+{
+    virProcessNamespaceHelper *helper = NULL;
+    testNsData data = { .ret = 7 };
+    pid_t child;
+
+    if ((child = fork()) < 0)
+        return -1;
+
+    if (child == 0)
+        _exit(EXIT_SUCCESS);
+
+    if (waitpid(child, NULL, 0) != child)
+        return -1;
+
+    if ((helper = virProcessNamespaceHelperNew(child))) {
+        VIR_TEST_DEBUG("Helper started for a process which doesn't exist");
+        virProcessNamespaceHelperClose(helper);
+        return -1;
+    }
+    virResetLastError();
+
+    if (virProcessRunInNamespaceHelper(child, testNsCallback, &data) != -1) {
+        VIR_TEST_DEBUG("Callback ran for a process which doesn't exist");
+        return -1;
+    }
+    virResetLastError();
+
+    return 0;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virTestRun("Run callback in helper", testNsHelperRun, NULL) < 0)
+        ret = -1;
+    if (virTestRun("Lock file in helper", testNsHelperLock, NULL) < 0)
+        ret = -1;
+    if (virTestRun("Stop helper running callback", testNsHelperStop, NULL) < 0)
+        ret = -1;
+    if (virTestRun("Helper of dead process", testNsHelperDeadProcess, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN_PRELOAD(mymain, VIR_TEST_MOCK("virprocessnshelper"))
+
+#else /* ! (__linux__ && F_OFD_SETLK) */
+
+int
+main(void)
+{
+    return EXIT_AM_SKIP;
+}
+
+#endif /* ! (__linux__ && F_OFD_SETLK) */
@@ -60,6 +60,70 @@ test_virProcessGetStat(const void *opaque)
 }
 
 
+#ifdef __linux__
+static int
+test_virProcessStatSampler(const void *opaque G_GNUC_UNUSED)
+{
+    g_autofree char *data_dir = NULL;
+    g_autoptr(virProcessStatSampler) sampler = NULL;
+    unsigned long long jiff2nsec = 1000ull * 1000ull * 1000ull /
+                                   (unsigned long long) sysconf(_SC_CLK_TCK);
+    size_t i;
+    int ret = -1;
+
+    data_dir = g_strdup_printf("%s/virprocessstatdata/complex/", abs_srcdir);
+    virFileWrapperAddPrefix("/proc/-1/task/-1/", data_dir);
+
+    if (!(sampler = virProcessStatSamplerNew(-1)))
+        goto cleanup;
+
+    /* the second round is served from the already open files */
+    for (i = 0; i < 2; i++) {
+        unsigned long long cpuTime = 0;
+        unsigned long long userTime = 0;
+        unsigned long long sysTime = 0;
+        unsigned long long cpuWait = 0;
+        unsigned long long cpuDelay = 0;
+        int lastCpu = 0;
+
+        if (virProcessStatSamplerGetStatInfo(sampler, -1, &cpuTime, &userTime,
+                                             &sysTime, &lastCpu) < 0 ||
+            virProcessStatSamplerGetSchedInfo(sampler, -1, &cpuWait) < 0 ||
+            virProcessStatSamplerGetSchedstatDelay(sampler, -1, &cpuDelay) < 0)
+            goto cleanup;
+
+        if (userTime != 14 * jiff2nsec ||
+            sysTime != 15 * jiff2nsec ||
+            cpuTime != userTime + sysTime ||
+            lastCpu != 39) {
+            fprintf(stderr,
+                    "Unexpected stat info: cpu=%llu user=%llu sys=%llu last=%d\n",
+                    cpuTime, userTime, sysTime, lastCpu);
+            goto cleanup;
+        }
+
+        if (cpuWait != 1234567891) {
+            fprintf(stderr, "Unexpected wait time %llu\n", cpuWait);
+            goto cleanup;
+        }
+
+        if (cpuDelay != 3000) {
+            fprintf(stderr, "Unexpected delay %llu\n", cpuDelay);
+            goto cleanup;
+        }
+
+        virProcessStatSamplerSweep(sampler);
+    }
+
+    ret = 0;
+
+ cleanup:
+    virFileWrapperClearPrefixes();
+    return ret;
+}
+#endif /* __linux__ */
+
+
 static int
 mymain(void)
 {
@@ -82,6 +146,11 @@ mymain(void)
     DO_TEST("simple", "command", 5, true);
     DO_TEST("complex", "this) is ( a \t weird )\n)( (command ( ", 100, false);
 
+#ifdef __linux__
+    if (virTestRun("Sampling process stat", test_virProcessStatSampler, NULL) < 0)
+        ret = -1;
+#endif /* __linux__ */
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
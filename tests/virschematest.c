@@ -21,6 +21,7 @@
 
 #include "testutils.h"
 
+#include "virfile.h"
 #include "virlog.h"
 #include "virxml.h"
 
@@ -373,6 +374,153 @@ static const struct testSchemaEntry schemaSysinfo[] = {
     { .dir = "tests/sysinfodata" },
 };
 
+#define TEST_SCHEMA_RNG(element) \
+    "<element name='" element "' xmlns='http://relaxng.org/ns/structure/1.0'>" \
+    "<empty/>" \
+    "</element>\n"
+
+
+/* Replacing a schema must not leave the previously compiled version in
+ * the cache of virXMLValidateAgainstSchema. */
+static int
+testSchemaCache(const void *opaque G_GNUC_UNUSED)
+{
+    g_autofree char *dir = g_strdup(abs_builddir "/schemacachedir-XXXXXX");
+    g_autofree char *schema = NULL;
+    g_autoptr(xmlDoc) doc = NULL;
+    int ret = -1;
+
+    if (!g_mkdtemp(dir))
+        return -1;
+
+    schema = g_strdup_printf("%s/test.rng", dir);
+
+    if (!(doc = virXMLParseStringCtxt("<foo/>", "(test)", NULL)))
+        goto cleanup;
+
+    if (virFileWriteStr(schema, TEST_SCHEMA_RNG("foo"), 0600) < 0 ||
+        virXMLValidateAgainstSchema(schema, doc) < 0 ||
+        virXMLValidateAgainstSchema(schema, doc) < 0)
+        goto cleanup;
+
+    if (virFileWriteStr(schema, TEST_SCHEMA_RNG("foobar"), 0600) < 0)
+        goto cleanup;
+
+    if (virXMLValidateAgainstSchema(schema, doc) == 0) {
+        VIR_TEST_VERBOSE("validated against outdated schema");
+        goto cleanup;
+    }
+    virResetLastError();
+
+    ret = 0;
+
+ cleanup:
+    if (getenv("LIBVIRT_SKIP_CLEANUP") == NULL)
+        virFileDeleteTree(dir);
+    return ret;
+}
+
+
+struct testSchemaCacheBenchData {
+    const char *schema;
+    GPtrArray *docs;
+    size_t next;
+};
+
+
+/* the outcome of the validation doesn't matter in the benchmarks */
+static int
+testSchemaCacheBenchUncached(void *opaque,
+                             unsigned long long *count)
+{
+    struct testSchemaCacheBenchData *data = opaque;
+    g_autoptr(virXMLValidator) validator = NULL;
+    xmlDocPtr doc = g_ptr_array_index(data->docs, data->next++ % data->docs->len);
+
+    if (!(validator = virXMLValidatorInit(data->schema)))
+        return -1;
+
+    ignore_value(virXMLValidatorValidate(validator, doc));
+
+    (*count)++;
+    return 0;
+}
+
+
+static int
+testSchemaCacheBenchCached(void *opaque,
+                           unsigned long long *count)
+{
+    struct testSchemaCacheBenchData *data = opaque;
+    xmlDocPtr doc = g_ptr_array_index(data->docs, data->next++ % data->docs->len);
+
+    ignore_value(virXMLValidateAgainstSchema(data->schema, doc));
+
+    (*count)++;
+    return 0;
+}
+
+
+/* Reports the rate of validating the XMLs in tests/qemuxmlconfdata against
+ * the domain schema, compiling the schema for each document as
+ * virXMLValidatorInit does and reusing the cached compiled schema as
+ * virXMLValidateAgainstSchema does. */
+static int
+testSchemaCacheBench(const void *opaque)
+{
+    const char *schema = opaque;
+    g_autofree char *dir_path = g_strdup_printf("%s/tests/qemuxmlconfdata",
+                                                abs_top_srcdir);
+    g_autoptr(GPtrArray) docs = g_ptr_array_new_with_free_func((GDestroyNotify) xmlFreeDoc);
+    g_autoptr(DIR) dir = NULL;
+    struct testSchemaCacheBenchData data = { .schema = schema, .docs = docs };
+    struct dirent *ent;
+    int rc;
+
+    /* don't bother parsing the XMLs if the benchmark is skipped anyway */
+    if (!virTestGetExpensive())
+        return EXIT_AM_SKIP;
+
+    if (virDirOpen(&dir, dir_path) < 0)
+        return -1;
+
+    while ((rc = virDirRead(dir, &ent, dir_path)) > 0) {
+        g_autofree char *xml_path = NULL;
+        xmlDocPtr doc;
+
+        if (!virStringHasSuffix(ent->d_name, ".xml") ||
+            ent->d_name[0] == '.')
+            continue;
+
+        xml_path = g_strdup_printf("%s/%s", dir_path, ent->d_name);
+
+        if (!(doc = virXMLParseFileCtxt(xml_path, NULL)))
+            return -1;
+
+        g_ptr_array_add(docs, doc);
+    }
+
+    if (rc < 0)
+        return -1;
+
+    if (docs->len == 0) {
+        VIR_TEST_DEBUG("No documents found in %s", dir_path);
+        return -1;
+    }
+
+    if ((rc = virTestBenchmark("uncached schema", "documents",
+                               testSchemaCacheBenchUncached, &data)) != 0)
+        return rc;
+
+    rc = virTestBenchmark("cached schema", "documents",
+                          testSchemaCacheBenchCached, &data);
+
+    virResetLastError();
+
+    return rc;
+}
+
+
 static int
 mymain(void)
 {
@@ -406,6 +554,13 @@ mymain(void)
     DO_TEST(INTERNAL_SCHEMAS_PATH "cpu-baseline.rng", testsCpuBaseline);
     DO_TEST(INTERNAL_SCHEMAS_PATH "device.rng", testDevice);
 
+    if (virTestRun("Schema cache", testSchemaCache, NULL) < 0)
+        ret = -1;
+
+    if (virTestRun("Schema cache benchmark", testSchemaCacheBench,
+                   SCHEMAS_PATH "domain.rng") < 0)
+        ret = -1;
+
     return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
@@ -0,0 +1,304 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include "testutils.h"
+#include "virfile.h"
+#include "virstatsstream.h"
+
+#define VIR_FROM_THIS VIR_FROM_NONE
+
+typedef struct _testStatsRecord testStatsRecord;
+struct _testStatsRecord {
+    const char *name;
+    const char *uuid;
+    int id;
+    virTypedParameterPtr params;
+    int nparams;
+};
+
+
+static void
+testStatsRecordClear(testStatsRecord *records,
+                     size_t nrecords)
+{
+    size_t i;
+
+    for (i = 0; i < nrecords; i++)
+        virTypedParamsFree(records[i].params, records[i].nparams);
+}
+
+
+static int
+testStatsRecordsFill(testStatsRecord *records)
+{
+    int maxparams = 0;
+    size_t i;
+
+    /* the first two share their layout, the third one is inactive */
+    for (i = 0; i < 2; i++) {
+        testStatsRecord *rec = &records[i];
+
+        maxparams = 0;
+        if (virTypedParamsAddInt(&rec->params, &rec->nparams, &maxparams,
+                                 "state.state", 1) < 0 ||
+            virTypedParamsAddUInt(&rec->params, &rec->nparams, &maxparams,
+                                  "vcpu.current", 4 + i) < 0 ||
+            virTypedParamsAddLLong(&rec->params, &rec->nparams, &maxparams,
+                                   "net.0.rx.drop", -5 - (long long) i) < 0 ||
+            virTypedParamsAddULLong(&rec->params, &rec->nparams, &maxparams,
+                                    "cpu.time", 18446744073709551615ULL - i) < 0 ||
+            virTypedParamsAddDouble(&rec->params, &rec->nparams, &maxparams,
+                                    "dirtyrate.megabytes_per_second", 0.5 + i) < 0 ||
+            virTypedParamsAddBoolean(&rec->params, &rec->nparams, &maxparams,
+                                     "vcpu.0.halted", i) < 0 ||
+            virTypedParamsAddString(&rec->params, &rec->nparams, &maxparams,
+                                    "block.0.name", i ? "vdb" : "vda") < 0)
+            return -1;
+    }
+
+    maxparams = 0;
+    if (virTypedParamsAddInt(&records[2].params, &records[2].nparams, &maxparams,
+                             "state.state", 5) < 0 ||
+        virTypedParamsAddString(&records[2].params, &records[2].nparams,
+                                &maxparams, "block.0.name", "") < 0)
+        return -1;
+
+    return 0;
+}
+
+
+static int
+testStatsStreamCompare(testStatsRecord *expected,
+                       virStatsStreamRecord *actual)
+{
+    unsigned char uuid[VIR_UUID_BUFLEN];
+    size_t i;
+
+    ignore_value(virUUIDParse(expected->uuid, uuid));
+
+    if (STRNEQ(expected->name, actual->name) ||
+        memcmp(uuid, actual->uuid, VIR_UUID_BUFLEN) != 0 ||
+        expected->id != actual->id ||
+        expected->nparams != actual->nparams) {
+        VIR_TEST_VERBOSE("record of '%s' doesn't match", expected->name);
+        return -1;
+    }
+
+    for (i = 0; i < expected->nparams; i++) {
+        virTypedParameterPtr e = &expected->params[i];
+        virTypedParameterPtr a = &actual->params[i];
+        bool match = false;
+
+        if (STRNEQ(e->field, a->field) || e->type != a->type) {
+            VIR_TEST_VERBOSE("field '%s' of '%s' doesn't match",
+                             e->field, expected->name);
+            return -1;
+        }
+
+        switch ((virTypedParameterType) e->type) {
+        case VIR_TYPED_PARAM_INT:
+            match = e->value.i == a->value.i;
+            break;
+        case VIR_TYPED_PARAM_UINT:
+            match = e->value.ui == a->value.ui;
+            break;
+        case VIR_TYPED_PARAM_LLONG:
+            match = e->value.l == a->value.l;
+            break;
+        case VIR_TYPED_PARAM_ULLONG:
+            match = e->value.ul == a->value.ul;
+            break;
+        case VIR_TYPED_PARAM_DOUBLE:
+            match = memcmp(&e->value.d, &a->value.d, sizeof(double)) == 0;
+            break;
+        case VIR_TYPED_PARAM_BOOLEAN:
+            match = e->value.b == a->value.b;
+            break;
+        case VIR_TYPED_PARAM_STRING:
+            match = STREQ(e->value.s, a->value.s);
+            break;
+        case VIR_TYPED_PARAM_LAST:
+            break;
+        }
+
+        if (!match) {
+            VIR_TEST_VERBOSE("value of '%s' of '%s' doesn't match",
+                             e->field, expected->name);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+static int
+testStatsStreamRoundTrip(const void *opaque G_GNUC_UNUSED)
+{
+    testStatsRecord records[] = {
+        { "first", "c7a5fdbd-edaf-9455-926a-d65c16db1809", 1, NULL, 0 },
+        { "second", "c7a5fdbd-edaf-9455-926a-d65c16db1810", 2, NULL, 0 },
+        { "third", "c7a5fdbd-edaf-9455-926a-d65c16db1811", -1, NULL, 0 },
+    };
+    g_autoptr(virStatsStreamEncoder) enc = virStatsStreamEncoderNew();
+    g_autoptr(GByteArray) data = NULL;
+    virStatsStreamRecord **decoded = NULL;
+    size_t ndecoded = 0;
+    size_t i;
+    int ret = -1;
+
+    if (testStatsRecordsFill(records) < 0)
+        goto cleanup;
+
+    for (i = 0; i < G_N_ELEMENTS(records); i++) {
+        unsigned char uuid[VIR_UUID_BUFLEN];
+
+        ignore_value(virUUIDParse(records[i].uuid, uuid));
+
+        if (virStatsStreamEncoderAddRecord(enc, records[i].name, uuid,
+                                           records[i].id, records[i].params,
+                                           records[i].nparams) < 0)
+            goto cleanup;
+    }
+
+    data = virStatsStreamEncoderFinish(enc);
+
+    VIR_TEST_DEBUG("encoded %zu records into %u bytes",
+                   G_N_ELEMENTS(records), data->len);
+
+    if (virStatsStreamDecode(data->data, data->len, &decoded, &ndecoded) < 0)
+        goto cleanup;
+
+    if (ndecoded != G_N_ELEMENTS(records)) {
+        VIR_TEST_VERBOSE("expected %zu records, got %zu",
+                         G_N_ELEMENTS(records), ndecoded);
+        goto cleanup;
+    }
+
+    for (i = 0; i < ndecoded; i++) {
+        if (testStatsStreamCompare(&records[i], decoded[i]) < 0)
+            goto cleanup;
+    }
+
+    /* any truncation must be detected */
+    for (i = 0; i < data->len; i++) {
+        virStatsStreamRecord **partial = NULL;
+        size_t npartial = 0;
+
+        if (virStatsStreamDecode(data->data, i, &partial, &npartial) == 0) {
+            VIR_TEST_VERBOSE("stream truncated to %zu bytes was accepted", i);
+            virStatsStreamRecordListFree(partial, npartial);
+            goto cleanup;
+        }
+    }
+
+    ret = 0;
+
+ cleanup:
+    virStatsStreamRecordListFree(decoded, ndecoded);
+    testStatsRecordClear(records, G_N_ELEMENTS(records));
+    return ret;
+}
+
+
+/* Flushing after each record must produce the same stream as encoding it
+ * in memory as a whole. */
+static int
+testStatsStreamFlush(const void *opaque G_GNUC_UNUSED)
+{
+    testStatsRecord records[] = {
+        { "first", "c7a5fdbd-edaf-9455-926a-d65c16db1809", 1, NULL, 0 },
+        { "second", "c7a5fdbd-edaf-9455-926a-d65c16db1810", 2, NULL, 0 },
+        { "third", "c7a5fdbd-edaf-9455-926a-d65c16db1811", -1, NULL, 0 },
+    };
+    g_autoptr(virStatsStreamEncoder) whole = virStatsStreamEncoderNew();
+    g_autoptr(virStatsStreamEncoder) flushed = virStatsStreamEncoderNew();
+    g_autoptr(GByteArray) expected = NULL;
+    g_autoptr(GByteArray) tail = NULL;
+    g_autofree char *actual = NULL;
+    int pipefd[2] = { -1, -1 };
+    ssize_t len;
+    size_t i;
+    int ret = -1;
+
+    if (testStatsRecordsFill(records) < 0 ||
+        virPipe(pipefd) < 0)
+        goto cleanup;
+
+    for (i = 0; i < G_N_ELEMENTS(records); i++) {
+        unsigned char uuid[VIR_UUID_BUFLEN];
+
+        ignore_value(virUUIDParse(records[i].uuid, uuid));
+
+        if (virStatsStreamEncoderAddRecord(whole, records[i].name, uuid,
+                                           records[i].id, records[i].params,
+                                           records[i].nparams) < 0 ||
+            virStatsStreamEncoderAddRecord(flushed, records[i].name, uuid,
+                                           records[i].id, records[i].params,
+                                           records[i].nparams) < 0 ||
+            virStatsStreamEncoderFlush(flushed, pipefd[1]) < 0)
+            goto cleanup;
+    }
+
+    expected = virStatsStreamEncoderFinish(whole);
+    tail = virStatsStreamEncoderFinish(flushed);
+
+    if (tail->len != 1) {
+        VIR_TEST_VERBOSE("expected only the end marker after flushing, got %u bytes",
+                         tail->len);
+        goto cleanup;
+    }
+
+    if (safewrite(pipefd[1], tail->data, tail->len) < 0)
+        goto cleanup;
+    VIR_FORCE_CLOSE(pipefd[1]);
+
+    if ((len = virFileReadHeaderFD(pipefd[0], expected->len + 1, &actual)) < 0)
+        goto cleanup;
+
+    if (len != expected->len ||
+        memcmp(actual, expected->data, len) != 0) {
+        VIR_TEST_VERBOSE("flushed stream of %zd bytes differs from %u bytes",
+                         len, expected->len);
+        goto cleanup;
+    }
+
+    ret = 0;
+
+ cleanup:
+    VIR_FORCE_CLOSE(pipefd[0]);
+    VIR_FORCE_CLOSE(pipefd[1]);
+    testStatsRecordClear(records, G_N_ELEMENTS(records));
+    return ret;
+}
+
+
+static int
+mymain(void)
+{
+    int ret = 0;
+
+    if (virTestRun("Round trip", testStatsStreamRoundTrip, NULL) < 0)
+        ret = -1;
+    if (virTestRun("Flush", testStatsStreamFlush, NULL) < 0)
+        ret = -1;
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+VIR_TEST_MAIN(mymain)
@@ -19,8 +19,12 @@
 #include <config.h>
 
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
 
 #include "storage_source.h"
+#define LIBVIRT_STORAGE_SOURCE_PRIV_H_ALLOW
+#include "storage_source_priv.h"
 #include "testutils.h"
 #include "vircommand.h"
 #include "virfile.h"
@@ -432,6 +436,168 @@ testBackingParse(const void *args)
 }
 
 
+/* Returns the header cache key of @path as seen @settle seconds after
+ * the last change of the file. */
+static char *
+testHeaderCacheKey(const char *path,
+                   int settle)
+{
+    g_autoptr(virStorageSource) src = virStorageSourceNew();
+    struct stat sb;
+    char *key;
+
+    if (stat(path, &sb) < 0)
+        return NULL;
+
+    src->type = VIR_STORAGE_TYPE_FILE;
+    src->path = g_strdup(path);
+
+    if (virStorageSourceInit(src) < 0)
+        return NULL;
+
+    key = virStorageSourceHeaderCacheKey(src, -1, -1,
+                                         MAX(sb.st_mtime, sb.st_ctime) + settle);
+
+    virStorageSourceDeinit(src);
+    return key;
+}
+
+
+/* Checks that the cached header of @path is no longer used after
+ * a modification described by @what. */
+static int
+testHeaderCacheInvalidated(const char *path,
+                           const char *what,
+                           const char *oldkey)
+{
+    g_autofree char *key = NULL;
+    g_autofree char *buf = NULL;
+    size_t len;
+
+    if (!(key = testHeaderCacheKey(path, VIR_STORAGE_SOURCE_HEADER_CACHE_SETTLE)))
+        return -1;
+
+    if (STREQ(key, oldkey) ||
+        virStorageSourceHeaderCacheLookup(key, &buf, &len)) {
+        VIR_TEST_VERBOSE("cached header used after change of %s", what);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+static int
+testHeaderCache(const void *args G_GNUC_UNUSED)
+{
+    g_autofree char *dir = g_strdup(abs_builddir "/virstorageheadercache.XXXXXX");
+    g_autofree char *path = NULL;
+    g_autofree char *other = NULL;
+    g_autofree char *key = NULL;
+    g_autofree char *unsettled = NULL;
+    g_autofree char *buf = NULL;
+    struct timeval times[2] = { { 1000000000, 0 }, { 1000000000, 0 } };
+    VIR_AUTOCLOSE fd = -1;
+    size_t len;
+    int ret = -1;
+
+    if (!g_mkdtemp(dir))
+        return -1;
+
+    path = g_strdup_printf("%s/image", dir);
+    other = g_strdup_printf("%s/other", dir);
+
+    if (virFileWriteStr(path, "header", 0600) < 0)
+        goto cleanup;
+
+    if ((unsettled = testHeaderCacheKey(path, VIR_STORAGE_SOURCE_HEADER_CACHE_SETTLE - 1))) {
+        VIR_TEST_VERBOSE("recently changed file is cacheable");
+        goto cleanup;
+    }
+
+    if (!(key = testHeaderCacheKey(path, VIR_STORAGE_SOURCE_HEADER_CACHE_SETTLE)))
+        goto cleanup;
+
+    if (virStorageSourceHeaderCacheLookup(key, &buf, &len)) {
+        VIR_TEST_VERBOSE("header of a new file is cached");
+        goto cleanup;
+    }
+
+    virStorageSourceHeaderCacheInsert(key, "header", strlen("header"));
+
+    if (!virStorageSourceHeaderCacheLookup(key, &buf, &len) ||
+        len != strlen("header") || memcmp(buf, "header", len) != 0) {
+        VIR_TEST_VERBOSE("cached header not found");
+        goto cleanup;
+    }
+
+    if (utimes(path, times) < 0 ||
+        testHeaderCacheInvalidated(path, "mtime", key) < 0)
+        goto cleanup;
+
+    g_clear_pointer(&key, g_free);
+    if (!(key = testHeaderCacheKey(path, VIR_STORAGE_SOURCE_HEADER_CACHE_SETTLE)))
+        goto cleanup;
+
+    if ((fd = open(path, O_WRONLY | O_APPEND)) < 0 ||
+        safewrite(fd, "x", 1) != 1 ||
+        testHeaderCacheInvalidated(path, "size", key) < 0)
+        goto cleanup;
+
+    g_clear_pointer(&key, g_free);
+    if (!(key = testHeaderCacheKey(path, VIR_STORAGE_SOURCE_HEADER_CACHE_SETTLE)))
+        goto cleanup;
+
+    if (virFileWriteStr(other, "header", 0600) < 0 ||
+        rename(other, path) < 0 ||
+        testHeaderCacheInvalidated(path, "inode", key) < 0)
+        goto cleanup;
+
+    ret = 0;
+
+ cleanup:
+    virFileDeleteTree(dir);
+    return ret;
+}
+
+
+/* A full cache evicts the least recently used header. */
+static int
+testHeaderCacheEvict(const void *args G_GNUC_UNUSED)
+{
+    g_autofree char *buf = NULL;
+    size_t len;
+    size_t i;
+
+    for (i = 0; i <= VIR_STORAGE_SOURCE_HEADER_CACHE_MAX; i++) {
+        g_autofree char *key = g_strdup_printf("evict-%zu", i);
+
+        /* make the second header the least recently used one */
+        if (i == VIR_STORAGE_SOURCE_HEADER_CACHE_MAX &&
+            !virStorageSourceHeaderCacheLookup("evict-0", &buf, &len)) {
+            VIR_TEST_VERBOSE("header 'evict-0' not cached");
+            return -1;
+        }
+
+        virStorageSourceHeaderCacheInsert(key, "header", strlen("header"));
+    }
+
+    for (i = 0; i <= VIR_STORAGE_SOURCE_HEADER_CACHE_MAX; i++) {
+        g_autofree char *key = g_strdup_printf("evict-%zu", i);
+        bool expect = i != 1;
+
+        g_clear_pointer(&buf, g_free);
+        if (virStorageSourceHeaderCacheLookup(key, &buf, &len) != expect) {
+            VIR_TEST_VERBOSE("header '%s' %s", key,
+                             expect ? "was evicted" : "wasn't evicted");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
 static int
 mymain(void)
 {
@@ -449,6 +615,11 @@ mymain(void)
     if (storageRegisterAll() < 0)
        return EXIT_FAILURE;
 
+    if (virTestRun("Header cache", testHeaderCache, NULL) < 0)
+        ret = -1;
+    if (virTestRun("Header cache eviction", testHeaderCacheEvict, NULL) < 0)
+        ret = -1;
+
 #define TEST_CHAIN(testname, start, format, flags) \
     do { \
         data = (struct testChainData){ testname, start, format, flags }; \
@@ -365,6 +365,10 @@ static const vshCmdOptDef opts_srv_threadpool_info[] = {
      .completer = vshAdmServerCompleter,
      .help = N_("Server to retrieve threadpool attributes from."),
     },
+    {.name = "messages",
+     .type = VSH_OT_BOOL,
+     .help = N_("show statistics of RPC message buffers"),
+    },
     {.name = NULL}
 };
 
@@ -377,8 +381,12 @@ cmdSrvThreadpoolInfo(vshControl *ctl, const vshCmd *cmd)
     size_t i;
     const char *srvname = NULL;
     virAdmServerPtr srv = NULL;
+    unsigned int flags = 0;
     vshAdmControl *priv = ctl->privData;
 
+    if (vshCommandOptBool(cmd, "messages"))
+        flags |= VIR_SERVER_THREADPOOL_MESSAGE_STATS;
+
     if (vshCommandOptString(ctl, cmd, "server", &srvname) < 0)
         return false;
 
@@ -386,14 +394,16 @@ cmdSrvThreadpoolInfo(vshControl *ctl, const vshCmd *cmd)
         goto cleanup;
 
     if (virAdmServerGetThreadPoolParameters(srv, &params,
-                                            &nparams, 0) < 0) {
+                                            &nparams, flags) < 0) {
         vshError(ctl, "%s",
                  _("Unable to get server workerpool parameters"));
         goto cleanup;
     }
 
-    for (i = 0; i < nparams; i++)
-        vshPrint(ctl, "%-15s: %u\n", params[i].field, params[i].value.ui);
+    for (i = 0; i < nparams; i++) {
+        g_autofree char *str = vshGetTypedParamValue(ctl, &params[i]);
+        vshPrint(ctl, "%-15s: %s\n", params[i].field, str);
+    }
 
     ret = true;
 
@@ -617,6 +627,10 @@ static const vshCmdOptDef opts_client_info[] = {
      .required = true,
      .help = N_("client which to retrieve identity information for"),
     },
+    {.name = "calls",
+     .type = VSH_OT_BOOL,
+     .help = N_("show statistics of calls made by the client"),
+    },
     {.name = NULL}
 };
 
@@ -633,8 +647,12 @@ cmdClientInfo(vshControl *ctl, const vshCmd *cmd)
     virAdmClientPtr clnt = NULL;
     virTypedParameterPtr params = NULL;
     int nparams = 0;
+    unsigned int flags = 0;
     vshAdmControl *priv = ctl->privData;
 
+    if (vshCommandOptBool(cmd, "calls"))
+        flags |= VIR_CLIENT_GET_INFO_CALL_STATS;
+
     if (vshCommandOptULongLong(ctl, cmd, "client", &id) < 0)
         return false;
 
@@ -646,7 +664,7 @@ cmdClientInfo(vshControl *ctl, const vshCmd *cmd)
         goto cleanup;
 
     /* Retrieve client identity info */
-    if (virAdmClientGetInfo(clnt, &params, &nparams, 0) < 0) {
+    if (virAdmClientGetInfo(clnt, &params, &nparams, flags) < 0) {
         vshError(ctl, _("failed to retrieve client identity information for client '%1$llu' connected to server '%2$s'"),
                         id, virAdmServerGetName(srv));
         goto cleanup;
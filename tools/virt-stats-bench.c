@@ -0,0 +1,298 @@
+/*
+ * virt-stats-bench.c: compare bulk domain stats transports
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+#include "internal.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "virgettext.h"
+#include "virstatsstream.h"
+#include "virstring.h"
+
+
+typedef struct _virtStatsBenchResult virtStatsBenchResult;
+struct _virtStatsBenchResult {
+    double wall;
+    double cpu;
+    unsigned long long bytes;
+    size_t nrecords;
+};
+
+
+static void
+print_usage(const char *progname,
+            FILE *out)
+{
+    fprintf(out,
+            _("Usage:\n"
+              "  %1$s [options]\n"
+              "\n"
+              "Compare the cost of fetching bulk domain statistics using\n"
+              "virConnectGetAllDomainStats and virConnectGetAllDomainStatsStream.\n"
+              "\n"
+              "options:\n"
+              "  -c | --connect URI     hypervisor connection URI\n"
+              "  -n | --iterations N    number of iterations (default 10)\n"
+              "  -p | --parallel        request parallel stats collection\n"
+              "  -h | --help            display this help and exit\n"),
+            progname);
+}
+
+
+static double
+virtStatsBenchCPUTime(void)
+{
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_SELF, &ru) < 0)
+        return 0;
+
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+           (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+
+static unsigned long long
+virtStatsBenchXDRString(const char *str)
+{
+    return 4 + VIR_ROUND_UP(strlen(str), 4);
+}
+
+
+/* Approximates the size of the reply as encoded by the RPC layer */
+static unsigned long long
+virtStatsBenchXDRSize(virDomainStatsRecordPtr *records)
+{
+    unsigned long long size = 4;
+    virDomainStatsRecordPtr *next;
+    size_t i;
+
+    for (next = records; *next; next++) {
+        virDomainStatsRecordPtr rec = *next;
+
+        size += virtStatsBenchXDRString(virDomainGetName(rec->dom));
+        size += VIR_UUID_BUFLEN + 4 + 4;
+
+        for (i = 0; i < rec->nparams; i++) {
+            virTypedParameterPtr param = &rec->params[i];
+
+            size += virtStatsBenchXDRString(param->field) + 4;
+
+            switch ((virTypedParameterType) param->type) {
+            case VIR_TYPED_PARAM_INT:
+            case VIR_TYPED_PARAM_UINT:
+            case VIR_TYPED_PARAM_BOOLEAN:
+                size += 4;
+                break;
+            case VIR_TYPED_PARAM_LLONG:
+            case VIR_TYPED_PARAM_ULLONG:
+            case VIR_TYPED_PARAM_DOUBLE:
+                size += 8;
+                break;
+            case VIR_TYPED_PARAM_STRING:
+                size += virtStatsBenchXDRString(param->value.s);
+                break;
+            case VIR_TYPED_PARAM_LAST:
+                break;
+            }
+        }
+    }
+
+    return size;
+}
+
+
+static int
+virtStatsBenchTyped(virConnectPtr conn,
+                    unsigned int flags,
+                    virtStatsBenchResult *res)
+{
+    virDomainStatsRecordPtr *records = NULL;
+    int nrecords;
+
+    if ((nrecords = virConnectGetAllDomainStats(conn, 0, &records, flags)) < 0)
+        return -1;
+
+    res->bytes += virtStatsBenchXDRSize(records);
+    res->nrecords += nrecords;
+
+    virDomainStatsRecordListFree(records);
+    return 0;
+}
+
+
+static int
+virtStatsBenchStreamSink(virStreamPtr st G_GNUC_UNUSED,
+                         const char *data,
+                         size_t nbytes,
+                         void *opaque)
+{
+    GByteArray *buf = opaque;
+
+    g_byte_array_append(buf, (const guint8 *) data, nbytes);
+    return nbytes;
+}
+
+
+static int
+virtStatsBenchStream(virConnectPtr conn,
+                     unsigned int flags,
+                     virtStatsBenchResult *res)
+{
+    g_autoptr(GByteArray) buf = g_byte_array_new();
+    virStatsStreamRecord **records = NULL;
+    size_t nrecords = 0;
+    virStreamPtr st = NULL;
+    int ret = -1;
+
+    if (!(st = virStreamNew(conn, 0)))
+        return -1;
+
+    if (virConnectGetAllDomainStatsStream(conn, st, 0, flags) < 0)
+        goto cleanup;
+
+    if (virStreamRecvAll(st, virtStatsBenchStreamSink, buf) < 0) {
+        virStreamAbort(st);
+        goto cleanup;
+    }
+
+    if (virStreamFinish(st) < 0)
+        goto cleanup;
+
+    if (virStatsStreamDecode(buf->data, buf->len, &records, &nrecords) < 0)
+        goto cleanup;
+
+    res->bytes += buf->len;
+    res->nrecords += nrecords;
+    ret = 0;
+
+ cleanup:
+    virStatsStreamRecordListFree(records, nrecords);
+    virStreamFree(st);
+    return ret;
+}
+
+
+static int
+virtStatsBenchRun(virConnectPtr conn,
+                  const char *name,
+                  int (*func)(virConnectPtr, unsigned int, virtStatsBenchResult *),
+                  unsigned int flags,
+                  unsigned int iterations)
+{
+    virtStatsBenchResult res = { 0 };
+    gint64 start = g_get_monotonic_time();
+    double cpu = virtStatsBenchCPUTime();
+    size_t i;
+
+    for (i = 0; i < iterations; i++) {
+        if (func(conn, flags, &res) < 0)
+            return -1;
+    }
+
+    res.wall = (g_get_monotonic_time() - start) / 1e6;
+    res.cpu = virtStatsBenchCPUTime() - cpu;
+
+    printf("%-8s records/iter: %zu  bytes/iter: %llu  wall: %.3fs  cpu: %.3fs\n",
+           name, res.nrecords / iterations, res.bytes / iterations,
+           res.wall, res.cpu);
+
+    return 0;
+}
+
+
+int
+main(int argc,
+     char **argv)
+{
+    const char *progname = NULL;
+    const char *uri = NULL;
+    unsigned int iterations = 10;
+    unsigned int flags = 0;
+    virConnectPtr conn = NULL;
+    int arg = 0;
+    int ret = EXIT_FAILURE;
+
+    struct option opt[] = {
+        { "connect", required_argument, NULL, 'c' },
+        { "iterations", required_argument, NULL, 'n' },
+        { "parallel", no_argument, NULL, 'p' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+
+    if (virGettextInitialize() < 0)
+        return EXIT_FAILURE;
+
+    if (!(progname = strrchr(argv[0], '/')))
+        progname = argv[0];
+    else
+        progname++;
+
+    while ((arg = getopt_long(argc, argv, "c:n:ph", opt, NULL)) != -1) {
+        switch (arg) {
+        case 'c':
+            uri = optarg;
+            break;
+        case 'n':
+            if (virStrToLong_uip(optarg, NULL, 10, &iterations) < 0 ||
+                iterations == 0) {
+                fprintf(stderr, _("%1$s: invalid number of iterations '%2$s'\n"),
+                        progname, optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'p':
+            flags |= VIR_CONNECT_GET_ALL_DOMAINS_STATS_PARALLEL;
+            break;
+        case 'h':
+            print_usage(progname, stdout);
+            return EXIT_SUCCESS;
+        default:
+            print_usage(progname, stderr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (optind != argc) {
+        print_usage(progname, stderr);
+        return EXIT_FAILURE;
+    }
+
+    if (!(conn = virConnectOpenReadOnly(uri)))
+        return EXIT_FAILURE;
+
+    if (virtStatsBenchRun(conn, "typed", virtStatsBenchTyped,
+                          flags, iterations) < 0 ||
+        virtStatsBenchRun(conn, "stream", virtStatsBenchStream,
+                          flags, iterations) < 0) {
+        fprintf(stderr, _("%1$s: %2$s\n"), progname,
+                virGetLastErrorMessage());
+        goto cleanup;
+    }
+
+    ret = EXIT_SUCCESS;
+
+ cleanup:
+    virConnectClose(conn);
+    return ret;
+}